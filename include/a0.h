@@ -14,6 +14,7 @@
 #include <a0/env.h>
 #include <a0/err.h>
 #include <a0/event.h>
+#include <a0/executor.h>
 #include <a0/file.h>
 #include <a0/inline.h>
 #include <a0/latch.h>
@@ -25,6 +26,7 @@
 #include <a0/pathglob.h>
 #include <a0/prpc.h>
 #include <a0/pubsub.h>
+#include <a0/reactor.h>
 #include <a0/reader.h>
 #include <a0/rpc.h>
 #include <a0/thread_local.h>
@@ -41,9 +43,11 @@
 #include <a0/buf.hpp>
 #include <a0/c_wrap.hpp>
 #include <a0/cfg.hpp>
+#include <a0/coro.hpp>
 #include <a0/deadman.hpp>
 #include <a0/discovery.hpp>
 #include <a0/env.hpp>
+#include <a0/executor.hpp>
 #include <a0/file.hpp>
 #include <a0/log.hpp>
 #include <a0/middleware.hpp>
@@ -51,6 +55,7 @@
 #include <a0/pathglob.hpp>
 #include <a0/prpc.hpp>
 #include <a0/pubsub.hpp>
+#include <a0/reactor.hpp>
 #include <a0/reader.hpp>
 #include <a0/rpc.hpp>
 #include <a0/string_view.hpp>
@@ -14,7 +14,8 @@
  * This process may read and write.
  *
  * **READONLY**: buffer may be read by multiple processes.
- * No process will write.
+ * This process will not write. A transport in a READONLY arena
+ * tolerates writers in other processes.
  *
  * \endrst
  */
@@ -36,9 +37,10 @@ typedef enum a0_arena_mode_e {
   /// any other processes.
   /// Notification and locks are be disabled.
   A0_ARENA_MODE_EXCLUSIVE,
-  /// A promise that the arena will NOT be simultaneously written by
-  /// any other processes. This process my not write to the arena.
+  /// This process my not write to the arena.
   /// Notification and locks are be disabled.
+  /// Transport reads are validated, in case other processes write
+  /// simultaneously.
   A0_ARENA_MODE_READONLY,
 } a0_arena_mode_t;
 
@@ -54,6 +56,11 @@ typedef struct a0_arena_s {
   /// corrupt the arena content if other processes write or access the
   /// arena simultaneously. Be careful.
   a0_arena_mode_t mode;
+
+  /// Bytes mapped at buf.data, that buf.size may grow into.
+  ///
+  /// Zero if the arena cannot grow past buf.size.
+  size_t capacity;
 } a0_arena_t;
 
 #ifdef __cplusplus
@@ -0,0 +1,573 @@
+/**
+ * \file coro.hpp
+ * \rst
+ *
+ * Coroutines
+ * ---------------
+ *
+ * Awaitable subscribers, RPC clients and PRPC clients, for C++20.
+ *
+ * .. code-block:: cpp
+ *
+ *   a0::coro::Task<void> serve(a0::coro::Scheduler sched) {
+ *     a0::coro::Subscriber sub(sched, "topic");
+ *     a0::coro::RpcClient rpc(sched, "rpc_topic");
+ *     while (true) {
+ *       a0::Packet pkt = co_await sub.next();
+ *       a0::Packet reply = co_await rpc.send(pkt);
+ *       ...
+ *     }
+ *   }
+ *
+ *   a0::coro::Scheduler sched;
+ *   sched.spawn(serve(sched));
+ *   sched.run();
+ *
+ * Coroutines run on the threads that call Scheduler::run. A coroutine that
+ * awaits a packet is suspended without holding a thread, and is queued on
+ * its scheduler when the packet arrives. One thread can therefore wait on
+ * any number of subscriptions, RPCs and PRPC streams at once.
+ *
+ * Subscribers are driven by the scheduler's reactor; see reactor.h. RPC and
+ * PRPC replies are delivered by the client's reader thread, one per client.
+ *
+ * This header is empty before C++20.
+ *
+ * \endrst
+ */
+
+#pragma once
+
+#define A0_CPP_20 (__cplusplus >= 202002L)
+
+#if A0_CPP_20
+
+#include <a0/packet.hpp>
+#include <a0/prpc.hpp>
+#include <a0/pubsub.hpp>
+#include <a0/reactor.hpp>
+#include <a0/reader.hpp>
+#include <a0/rpc.hpp>
+#include <a0/string_view.hpp>
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace a0 {
+namespace coro {
+
+template <typename T>
+class Task;
+
+namespace details {
+struct BlockOn;
+}  // namespace details
+
+/// Runs coroutines on the threads that call run().
+///
+/// Copies share the same queue.
+class Scheduler {
+  struct State {
+    Reactor reactor;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> ready;
+    bool stopped{false};
+  };
+  std::shared_ptr<State> state_;
+
+  friend struct details::BlockOn;
+
+  // Resumes queued coroutines until *done is set under the queue lock.
+  void run_until(const bool* done) {
+    std::unique_lock<std::mutex> lk{state_->mu};
+    while (true) {
+      state_->cv.wait(lk, [&] { return *done || !state_->ready.empty(); });
+      if (*done) {
+        return;
+      }
+      auto handle = state_->ready.front();
+      state_->ready.pop_front();
+      lk.unlock();
+      handle.resume();
+      lk.lock();
+    }
+  }
+
+  // Sets *done and wakes the threads in run_until.
+  void complete(bool* done) {
+    std::unique_lock<std::mutex> lk{state_->mu};
+    *done = true;
+    state_->cv.notify_all();
+  }
+
+ public:
+  Scheduler()
+      : Scheduler(Reactor(Reactor::Options::DEFAULT)) {}
+  explicit Scheduler(Reactor reactor)
+      : state_{std::make_shared<State>()} {
+    state_->reactor = std::move(reactor);
+  }
+
+  Reactor reactor() const {
+    return state_->reactor;
+  }
+
+  /// Queues a suspended coroutine to be resumed by run(). Thread safe.
+  void post(std::coroutine_handle<> handle) {
+    std::unique_lock<std::mutex> lk{state_->mu};
+    state_->ready.push_back(handle);
+    state_->cv.notify_one();
+  }
+
+  /// Resumes queued coroutines until stop() is called.
+  ///
+  /// A stop() that happened before run() starts is forgotten.
+  void run() {
+    std::unique_lock<std::mutex> lk{state_->mu};
+    state_->stopped = false;
+    while (true) {
+      state_->cv.wait(lk, [&] { return state_->stopped || !state_->ready.empty(); });
+      if (state_->stopped) {
+        return;
+      }
+      auto handle = state_->ready.front();
+      state_->ready.pop_front();
+      lk.unlock();
+      handle.resume();
+      lk.lock();
+    }
+  }
+
+  /// Makes run() return, on every thread. Coroutines still queued are not resumed.
+  void stop() {
+    std::unique_lock<std::mutex> lk{state_->mu};
+    state_->stopped = true;
+    state_->cv.notify_all();
+  }
+
+  /// Awaitable that moves the awaiting coroutine onto this scheduler.
+  auto schedule() {
+    struct Awaiter {
+      Scheduler sched;
+      bool await_ready() const noexcept {
+        return false;
+      }
+      void await_suspend(std::coroutine_handle<> handle) {
+        sched.post(handle);
+      }
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{*this};
+  }
+
+  template <typename T>
+  void spawn(Task<T>);
+};
+
+namespace details {
+
+// Resumes whoever awaited the finished task.
+struct TaskFinalAwaiter {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+    return handle.promise().continuation;
+  }
+  void await_resume() const noexcept {}
+};
+
+template <typename T>
+struct TaskPromiseBase {
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+  std::exception_ptr err;
+
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+
+  TaskFinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+
+  void unhandled_exception() {
+    err = std::current_exception();
+  }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase<T> {
+  std::optional<T> value;
+
+  void return_value(T val) {
+    value = std::move(val);
+  }
+
+  T result() {
+    if (this->err) {
+      std::rethrow_exception(this->err);
+    }
+    return std::move(*value);
+  }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase<void> {
+  void return_void() {}
+
+  void result() {
+    if (this->err) {
+      std::rethrow_exception(this->err);
+    }
+  }
+};
+
+}  // namespace details
+
+/// A lazily started coroutine. It runs once awaited, or once spawned on a scheduler.
+template <typename T>
+class Task {
+ public:
+  struct promise_type : details::TaskPromise<T> {
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+  };
+
+  Task() = default;
+  Task(Task&& other) noexcept
+      : handle_{std::exchange(other.handle_, nullptr)} {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+      bool await_ready() const noexcept {
+        return !handle || handle.done();
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      T await_resume() {
+        return handle.promise().result();
+      }
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_{handle} {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace details {
+
+// Owns itself once started, and is destroyed when it completes.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() {
+      return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+Detached detach(Task<T> task) {
+  co_await std::move(task);
+}
+
+// Client callbacks get packets that only live for the duration of the call.
+inline Packet own(Packet pkt) {
+  auto payload = std::make_shared<std::string>(pkt.payload());
+  a0_packet_t c_pkt = *pkt.c;
+  c_pkt.payload = {(uint8_t*)payload->data(), payload->size()};
+  return Packet(c_pkt, [payload](a0_packet_t*) {});
+}
+
+// Shared between an awaiter and the callback that completes it.
+template <typename T>
+struct Waiter {
+  Scheduler sched;
+  std::mutex mu;
+  std::deque<T> items;
+  std::coroutine_handle<> handle;
+
+  // Called from the delivering thread.
+  void push(T item) {
+    std::coroutine_handle<> resume;
+    {
+      std::unique_lock<std::mutex> lk{mu};
+      items.push_back(std::move(item));
+      resume = std::exchange(handle, nullptr);
+    }
+    if (resume) {
+      sched.post(resume);
+    }
+  }
+
+  // Returns false if the coroutine must wait for push().
+  bool ready_or_wait(std::coroutine_handle<> awaiting) {
+    std::unique_lock<std::mutex> lk{mu};
+    if (!items.empty()) {
+      return true;
+    }
+    handle = awaiting;
+    return false;
+  }
+
+  T pop() {
+    std::unique_lock<std::mutex> lk{mu};
+    T item = std::move(items.front());
+    items.pop_front();
+    return item;
+  }
+};
+
+template <typename T>
+auto next(std::shared_ptr<Waiter<T>> waiter) {
+  struct Awaiter {
+    std::shared_ptr<Waiter<T>> waiter;
+    bool await_ready() const noexcept {
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+      return !waiter->ready_or_wait(awaiting);
+    }
+    T await_resume() {
+      return waiter->pop();
+    }
+  };
+  return Awaiter{std::move(waiter)};
+}
+
+}  // namespace details
+
+/// Starts the task on the scheduler. The task must not throw.
+template <typename T>
+void Scheduler::spawn(Task<T> task) {
+  post(details::detach(std::move(task)).handle);
+}
+
+namespace details {
+
+struct BlockOn {
+  template <typename T>
+  static Task<void> wrap(Scheduler sched, Task<T> task, bool* done, std::exception_ptr* err, std::optional<T>* out) {
+    try {
+      out->emplace(co_await std::move(task));
+    } catch (...) {
+      *err = std::current_exception();
+    }
+    sched.complete(done);
+  }
+
+  static Task<void> wrap(Scheduler sched, Task<void> task, bool* done, std::exception_ptr* err) {
+    try {
+      co_await std::move(task);
+    } catch (...) {
+      *err = std::current_exception();
+    }
+    sched.complete(done);
+  }
+
+  static void run_until(Scheduler& sched, const bool* done) {
+    sched.run_until(done);
+  }
+};
+
+}  // namespace details
+
+/// Runs the task to completion on the calling thread, and returns its result.
+///
+/// Other coroutines on the scheduler are resumed as well, until the task completes.
+/// Neither stop() nor other threads in run() are affected.
+template <typename T>
+T block_on(Scheduler sched, Task<T> task) {
+  bool done = false;
+  std::exception_ptr err;
+  std::optional<T> out;
+  sched.spawn(details::BlockOn::wrap(sched, std::move(task), &done, &err, &out));
+  details::BlockOn::run_until(sched, &done);
+  if (err) {
+    std::rethrow_exception(err);
+  }
+  return std::move(*out);
+}
+
+inline void block_on(Scheduler sched, Task<void> task) {
+  bool done = false;
+  std::exception_ptr err;
+  sched.spawn(details::BlockOn::wrap(sched, std::move(task), &done, &err));
+  details::BlockOn::run_until(sched, &done);
+  if (err) {
+    std::rethrow_exception(err);
+  }
+}
+
+/// A subscriber whose packets are awaited.
+///
+/// Packets that arrive while no coroutine awaits are queued.
+class Subscriber {
+  std::shared_ptr<details::Waiter<Packet>> waiter_;
+  ReactorSubscriber sub_;
+
+ public:
+  Subscriber() = default;
+  Subscriber(Scheduler sched, PubSubTopic topic, Reader::Options opts = Reader::Options())
+      : waiter_{std::make_shared<details::Waiter<Packet>>()} {
+    waiter_->sched = sched;
+    auto waiter = waiter_;
+    sub_ = ReactorSubscriber(sched.reactor(), std::move(topic), opts, [waiter](Packet pkt) {
+      waiter->push(std::move(pkt));
+    });
+  }
+
+  /// Awaits the next packet. Only one coroutine may await at a time.
+  auto next() {
+    return details::next(waiter_);
+  }
+};
+
+/// An RPC client whose replies are awaited.
+class RpcClient {
+  Scheduler sched_;
+  a0::RpcClient client_;
+
+ public:
+  RpcClient() = default;
+  RpcClient(Scheduler sched, RpcTopic topic)
+      : sched_{std::move(sched)}, client_{std::move(topic)} {}
+
+  /// Sends the request and awaits the reply.
+  auto send(Packet pkt) {
+    struct Awaiter {
+      Scheduler sched;
+      a0::RpcClient client;
+      Packet pkt;
+      Packet reply;
+      bool await_ready() const noexcept {
+        return false;
+      }
+      void await_suspend(std::coroutine_handle<> awaiting) {
+        // The awaiter outlives the callback, which resumes the coroutine.
+        client.send(pkt, [this, awaiting](Packet reply_) {
+          reply = details::own(std::move(reply_));
+          sched.post(awaiting);
+        });
+      }
+      Packet await_resume() {
+        return std::move(reply);
+      }
+    };
+    return Awaiter{sched_, client_, std::move(pkt), {}};
+  }
+  auto send(string_view payload) {
+    return send(Packet(std::string(payload)));
+  }
+
+  void cancel(string_view id) {
+    client_.cancel(id);
+  }
+};
+
+/// The progress packets of one PRPC connection.
+class PrpcStream {
+  std::shared_ptr<details::Waiter<std::optional<Packet>>> waiter_;
+  a0::PrpcClient client_;
+  std::string id_;
+
+  friend class PrpcClient;
+
+ public:
+  PrpcStream() = default;
+
+  /// Awaits the next progress packet. Empty after the last one.
+  ///
+  /// Only one coroutine may await at a time.
+  ///
+  /// .. code-block:: cpp
+  ///
+  ///   while (auto pkt = co_await stream.next()) { ... }
+  auto next() {
+    return details::next(waiter_);
+  }
+
+  void cancel() {
+    client_.cancel(id_);
+  }
+};
+
+/// A PRPC client whose progress packets are awaited.
+class PrpcClient {
+  Scheduler sched_;
+  a0::PrpcClient client_;
+
+ public:
+  PrpcClient() = default;
+  PrpcClient(Scheduler sched, PrpcTopic topic)
+      : sched_{std::move(sched)}, client_{std::move(topic)} {}
+
+  PrpcStream connect(Packet pkt) {
+    PrpcStream stream;
+    stream.waiter_ = std::make_shared<details::Waiter<std::optional<Packet>>>();
+    stream.waiter_->sched = sched_;
+    stream.client_ = client_;
+    stream.id_ = std::string(pkt.id());
+
+    auto waiter = stream.waiter_;
+    client_.connect(pkt, [waiter](Packet prog, bool done) {
+      waiter->push(details::own(std::move(prog)));
+      if (done) {
+        waiter->push(std::nullopt);
+      }
+    });
+    return stream;
+  }
+  PrpcStream connect(string_view payload) {
+    return connect(Packet(std::string(payload)));
+  }
+};
+
+}  // namespace coro
+}  // namespace a0
+
+#endif  // A0_CPP_20
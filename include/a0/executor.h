@@ -0,0 +1,175 @@
+/**
+ * \file executor.h
+ * \rst
+ *
+ * Executor
+ * ---------------
+ *
+ * An executor runs tasks on a pool of worker threads.
+ *
+ * Each worker has its own queue. Tasks submitted from a worker go to its own
+ * queue; others are spread round-robin. A worker whose queue is empty steals
+ * from the others.
+ *
+ * Ordering
+ * ---------------
+ *
+ * Tasks may be given a key. Tasks with equal keys run one at a time, in the
+ * order they were submitted. Tasks with different keys, and tasks without
+ * one, run concurrently.
+ *
+ * Keys are hashed into a fixed number of lanes, so unrelated keys may
+ * occasionally share a lane and run one after the other.
+ *
+ * Dispatch
+ * ---------------
+ *
+ * Readers, RPC servers and PRPC servers can dispatch their callbacks into an
+ * executor, instead of running them on the reader thread. See
+ * a0_executor_dispatch_t.
+ *
+ * \endrst
+ */
+
+#ifndef A0_EXECUTOR_H
+#define A0_EXECUTOR_H
+
+#include <a0/callback.h>
+#include <a0/err.h>
+#include <a0/mtx.h>
+#include <a0/packet.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \addtogroup EXECUTOR
+ *  @{
+ */
+
+typedef struct a0_executor_options_s {
+  /// Number of worker threads. Zero for one per online CPU.
+  uint32_t threads;
+} a0_executor_options_t;
+
+/// One worker thread per online CPU.
+extern const a0_executor_options_t A0_EXECUTOR_OPTIONS_DEFAULT;
+
+/// Tracks tasks, so that their submitter can wait for them to finish.
+///
+/// Zero-initialize before use.
+typedef struct a0_executor_group_s {
+  a0_mtx_t _mtx;
+  a0_cnd_t _cnd;
+  size_t _pending;
+} a0_executor_group_t;
+
+/// Waits until every task of the group has run.
+a0_err_t a0_executor_group_wait(a0_executor_group_t*);
+
+typedef struct a0_executor_task_s {
+  a0_callback_t fn;
+  /// Tasks with equal keys run one at a time, in submission order.
+  bool ordered;
+  uint64_t key;
+  /// Optional group to add the task to.
+  a0_executor_group_t* group;
+} a0_executor_task_t;
+
+typedef struct a0_executor_stats_s {
+  uint64_t submitted;
+  uint64_t executed;
+  /// Tasks run by a worker other than the one they were queued on.
+  uint64_t stolen;
+  /// Tasks submitted but not yet started.
+  size_t queue_depth;
+  /// Largest queue_depth seen.
+  size_t max_queue_depth;
+} a0_executor_stats_t;
+
+typedef struct a0_executor_worker_s a0_executor_worker_t;
+typedef struct a0_executor_lane_s a0_executor_lane_t;
+
+typedef struct a0_executor_s {
+  a0_executor_options_t _opts;
+  a0_executor_worker_t* _workers;
+  a0_executor_lane_t* _lanes;
+  uint32_t _next_worker;
+
+  // Idle workers sleep until a task is submitted.
+  pthread_mutex_t _idle_mu;
+  pthread_cond_t _idle_cnd;
+  size_t _idle_cnt;
+  bool _shutdown;
+  // Nodes queued on workers, ready to be taken.
+  size_t _runnable;
+
+  uint64_t _submitted;
+  uint64_t _executed;
+  size_t _queue_depth;
+  size_t _max_queue_depth;
+} a0_executor_t;
+
+/// ...
+a0_err_t a0_executor_init(a0_executor_t*, a0_executor_options_t);
+
+/// Runs the tasks already submitted, then stops the workers.
+///
+/// May not be called from within a task.
+a0_err_t a0_executor_close(a0_executor_t*);
+
+/// ...
+a0_err_t a0_executor_submit(a0_executor_t*, a0_executor_task_t);
+
+/// ...
+a0_err_t a0_executor_stats(a0_executor_t*, a0_executor_stats_t*);
+
+/** @}*/
+
+/** \addtogroup EXECUTOR_DISPATCH
+ *  @{
+ */
+
+typedef struct a0_packet_key_callback_s {
+  void* user_data;
+  /// Sets the key and returns true, if the packet must be ordered.
+  bool (*fn)(void* user_data, a0_flat_packet_t, uint64_t* key);
+} a0_packet_key_callback_t;
+
+/// Orders packets by the value of the given header. Packets without it are not ordered.
+///
+/// The header name must outlive the callback.
+a0_packet_key_callback_t a0_packet_key_header(const char* name);
+
+/// Orders all packets, so that callbacks run one at a time, in sequence order.
+a0_packet_key_callback_t a0_packet_key_all(void);
+
+/// Runs packet callbacks in an executor, instead of on the reader thread.
+///
+/// The packet is copied out of the transport before it is dispatched, and
+/// deserialized with the reader's alloc on the worker that runs the callback.
+/// The alloc may therefore be called from several workers at once.
+///
+/// Closing the reader waits for its callbacks that are still queued.
+///
+/// A packet that cannot be queued, for lack of memory, is not dropped: its
+/// callback runs on the reader thread, once the queued callbacks have run.
+typedef struct a0_executor_dispatch_s {
+  /// NULL to run callbacks on the reader thread.
+  a0_executor_t* executor;
+  /// Orders callbacks. A NULL fn leaves them unordered.
+  a0_packet_key_callback_t key;
+} a0_executor_dispatch_t;
+
+/** @}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // A0_EXECUTOR_H
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <a0/c_wrap.hpp>
+#include <a0/executor.h>
+#include <a0/packet.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace a0 {
+
+/// Runs tasks on a pool of worker threads. See executor.h.
+struct Executor : details::CppWrap<a0_executor_t> {
+  struct Options {
+    /// Number of worker threads. Zero for one per online CPU.
+    uint32_t threads;
+
+    /// One worker thread per online CPU.
+    static Options DEFAULT;
+  };
+
+  struct Stats {
+    uint64_t submitted;
+    uint64_t executed;
+    /// Tasks run by a worker other than the one they were queued on.
+    uint64_t stolen;
+    /// Tasks submitted but not yet started.
+    size_t queue_depth;
+    /// Largest queue_depth seen.
+    size_t max_queue_depth;
+  };
+
+  Executor() = default;
+  explicit Executor(Options);
+
+  void submit(std::function<void()>);
+  /// Tasks with equal keys run one at a time, in submission order.
+  void submit(uint64_t key, std::function<void()>);
+
+  Stats stats();
+};
+
+/// Runs packet callbacks in an executor, instead of on the reader thread.
+/// See a0_executor_dispatch_t.
+struct Dispatch {
+  /// Null to run callbacks on the reader thread.
+  Executor executor;
+  /// Sets the key and returns true, if the packet must be ordered.
+  /// Empty leaves callbacks unordered.
+  std::function<bool(FlatPacket, uint64_t*)> key;
+
+  Dispatch() = default;
+  Dispatch(Executor executor)  // NOLINT(google-explicit-constructor)
+      : executor{executor} {}
+  Dispatch(Executor executor, std::function<bool(FlatPacket, uint64_t*)> key)
+      : executor{executor}, key{std::move(key)} {}
+
+  /// Orders callbacks by the value of the given header.
+  static Dispatch by_header(Executor, std::string header);
+  /// Runs callbacks one at a time, in sequence order.
+  static Dispatch in_order(Executor);
+};
+
+}  // namespace a0
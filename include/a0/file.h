@@ -48,7 +48,57 @@
  *   file.size();
  *   file.path();  // absolute path
  *   file.fd();
- *   file.stat();  // at time of open
+ *   file.stat();  // at time of open, or of the last grow
+ *
+ * Growing
+ * -------
+ *
+ * A file can be grown while other processes are using it:
+ *
+ * .. code-block:: cpp
+ *
+ *   file.grow(64 * 1024 * 1024);
+ *
+ * A file can only grow into address space reserved when it was opened:
+ *
+ * .. code-block:: cpp
+ *
+ *   auto opts = a0::File::Options::DEFAULT;
+ *   opts.open_options.reserve_size = 1024 * 1024 * 1024;
+ *   a0::File file("path", opts);
+ *
+ * The file grows in place. The arena does not move, and other processes do
+ * not need to remap. Files never shrink.
+ *
+ * A file cannot grow past the reservation of any writable mapping of it, in
+ * any process, as transports in that mapping could not reach the new space.
+ * Grow fails with EBUSY until such mappings are closed. READONLY mappings do
+ * not block growth, and only see the space within their own reservation.
+ *
+ * A transport picks up the new size the next time any process resizes it,
+ * through the grown arena. Transports in other processes adopt that size the
+ * next time they lock. Publishers do both with **grow**.
+ *
+ * Pre-faulting
+ * ------------
+ *
+ * Files are created sparse, and pages are faulted in the first time they are
+ * touched. For a large transport, the first lap around the arena takes a page
+ * fault per page, in the writer and again in each reader.
+ *
+ * To pay that cost up front:
+ *
+ * .. code-block:: cpp
+ *
+ *   auto opts = a0::File::Options::DEFAULT;
+ *   opts.create_options.fallocate = true;  // allocate the pages at create
+ *   opts.open_options.populate = true;     // map them at open
+ *   opts.open_options.hugepage = true;     // prefer transparent huge pages
+ *   opts.open_options.lock = true;         // mlock, if RLIMIT_MEMLOCK allows
+ *   a0::File file("path", opts);
+ *
+ * **open_options** apply to each process separately, so readers that want
+ * a fault-free first lap must populate as well.
  *
  * Removing
  * --------
@@ -106,6 +156,8 @@ typedef struct a0_file_create_options_s {
   mode_t mode;
   /// Mode for directories that will be created as part of file create.
   mode_t dir_mode;
+  /// Allocate the backing pages at create, rather than leaving the file sparse.
+  bool fallocate;
 } a0_file_create_options_t;
 
 /// Options for opening files.
@@ -122,6 +174,25 @@ typedef struct a0_file_open_options_s {
   /// It is unspecified whether changes made to the file are visible in
   /// the mapped region.
   a0_arena_mode_t arena_mode;
+  /// Fault in the whole file at open, so the first lap does not page fault.
+  ///
+  /// Only covers the size at open. Space added by a later grow is faulted
+  /// on first touch.
+  bool populate;
+  /// Advise the kernel to back the mapping with transparent huge pages.
+  ///
+  /// Best effort. Requires shmem huge pages to be enabled for the filesystem.
+  bool hugepage;
+  /// mlock the file at open, so its pages are never reclaimed.
+  ///
+  /// Subject to RLIMIT_MEMLOCK. In READONLY mode, this copies the pages.
+  ///
+  /// Space added by a later grow is locked as it is added.
+  bool lock;
+  /// Address space to map, so the file can grow in place up to this size.
+  ///
+  /// Zero, or less than the file size, maps only the file. See Growing.
+  size_t reserve_size;
 } a0_file_open_options_t;
 
 /// File options.
@@ -134,9 +205,9 @@ typedef struct a0_file_options_s {
 
 /// Default file options.
 ///
-/// On create: 16MB and universal read+write.
+/// On create: 16MB, sparse, and universal read+write.
 ///
-/// On open: shared read+write.
+/// On open: shared read+write, faulted on demand, and mapped without room to grow.
 extern const a0_file_options_t A0_FILE_OPTIONS_DEFAULT;
 
 /// File object.
@@ -145,10 +216,12 @@ typedef struct a0_file_s {
   const char* path;
   /// File descriptor.
   int fd;
-  /// File stat (at time of open).
+  /// File stat (at time of open, or of the last grow).
   stat_t stat;
   /// Arena mapping into the file.
   a0_arena_t arena;
+  /// Whether the mapping is locked into memory.
+  bool _locked;
 } a0_file_t;
 
 /// Open a file at the given path.
@@ -166,6 +239,14 @@ a0_err_t a0_file_open(
 /// Closes a file. The file still exists.
 a0_err_t a0_file_close(a0_file_t*);
 
+/// Grows the file, and its arena, to at least the given size.
+///
+/// The arena does not move. Fails with A0_ERR_INVALID_ARG if the size is beyond
+/// the reserved address space, and with EBUSY if it is beyond the reserved
+/// address space of another writable mapping of the file. If another process
+/// has already grown the file further, the arena adopts that size.
+a0_err_t a0_file_grow(a0_file_t*, off_t size);
+
 typedef struct a0_file_iter_s {
   char _path[PATH_MAX + 1];
   size_t _path_len;
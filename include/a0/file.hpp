@@ -22,11 +22,21 @@ struct File : details::CppWrap<a0_file_t> {
       mode_t mode;
       /// Mode for directories that will be created as part of file creation.
       mode_t dir_mode;
+      /// Allocate the backing pages at create.
+      bool fallocate;
     } create_options;
 
     struct OpenOptions {
       /// ...
       a0_arena_mode_t arena_mode;
+      /// Fault in the whole file at open.
+      bool populate;
+      /// Advise transparent huge pages.
+      bool hugepage;
+      /// mlock the file at open, and as it grows.
+      bool lock;
+      /// Address space to map, so the file can grow in place.
+      size_t reserve_size;
     } open_options;
 
     /// Default file creation options.
@@ -56,6 +66,9 @@ struct File : details::CppWrap<a0_file_t> {
   /// File state.
   stat_t stat() const;
 
+  /// Grows the file to at least the given size. See a0_file_grow.
+  void grow(size_t);
+
   /// Removes the specified file.
   static void remove(string_view path);
   /// Removes the specified file or directory, including all subdirectories.
@@ -50,6 +50,24 @@ a0_err_t a0_mtx_timedlock(a0_mtx_t*, a0_time_mono_t*) A0_WARN_UNUSED_RESULT;
 a0_err_t a0_mtx_trylock(a0_mtx_t*) A0_WARN_UNUSED_RESULT;
 a0_err_t a0_mtx_unlock(a0_mtx_t*);
 
+// Adaptive spin state for a0_mtx_timedlock_spin.
+//
+// Before sleeping in the kernel, the lock polls the mutex for up to twice the
+// running estimate of iterations needed to acquire it, capped at max.
+// Spinning stops early once other waiters are queued in the kernel, since the
+// kernel hands the mutex directly to them.
+//
+// The state is local to the process and is updated by every lock.
+typedef struct a0_mtx_spin_s {
+  // Upper bound on spin iterations. Zero disables spinning.
+  uint32_t max;
+  // Running estimate of the spin iterations needed to acquire.
+  uint32_t estimate;
+} a0_mtx_spin_t;
+
+// Spins, as configured, before sleeping in the kernel. A null spin never spins.
+a0_err_t a0_mtx_timedlock_spin(a0_mtx_t*, a0_time_mono_t*, a0_mtx_spin_t*) A0_WARN_UNUSED_RESULT;
+
 // Returns true if the mutex is locked, regardless of whether the previous owner died.
 bool a0_mtx_lock_successful(a0_err_t);
 // Returns true if the mutex is locked and the previous owner died.
@@ -109,6 +109,47 @@
  *  | payload content               |
  *  +-------------------------------+
  *
+ * Serialization Format v2
+ * -----------------------
+ *
+ *  Packets written by a0_packet_serialize_v2 use a compact layout, with a
+ *  binary id and 32-bit offsets and lengths for each header:
+ *
+ *  +-----------------------------------------------+
+ *  | magic 0xA0 (u8), version 2 (u8), flags (u16)  |
+ *  +-----------------------------------------------+
+ *  | num headers (u32)                             |
+ *  +-----------------------------------------------+
+ *  | ID (16 bytes)                                 |
+ *  +-----------------------------------------------+
+ *  | offset for payload (u64)                      |
+ *  +-----------------------------------------------+
+ *  | hdr 0 key offset, key length,                 |
+ *  | val offset, val length (u32 each)             |
+ *  +-----------------------------------------------+
+ *  |   .   .   .   .   .   .   .   .   .   .   .   |
+ *  +-----------------------------------------------+
+ *  | hash table (only with 8 or more headers)      |
+ *  +-----------------------------------------------+
+ *  | hdr 0 key content                             |
+ *  +-----------------------------------------------+
+ *  | hdr 0 val content                             |
+ *  +-----------------------------------------------+
+ *  |   .   .   .   .   .   .   .   .   .   .   .   |
+ *  +-----------------------------------------------+
+ *  | payload content                               |
+ *  +-----------------------------------------------+
+ *
+ *  The hash table maps header keys to their first index, so lookups by key
+ *  need not scan every header.
+ *
+ *  Keys and values are still null terminated, so headers can be read in place.
+ *
+ *  .. note::
+ *
+ *    A v1 packet never starts with the magic byte, so both formats can be read
+ *    by the same functions.
+ *
  * Flat Packet
  * -----------
  *
@@ -126,6 +167,7 @@
 #include <a0/uuid.h>
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -250,8 +292,23 @@ a0_err_t a0_packet_header_iterator_next_match(a0_packet_header_iterator_t*, cons
 /// Serializes the packet to the allocated location.
 ///
 /// **Note**: the header order will NOT be retained.
+///
+/// If the payload data is NULL, space for the payload is reserved, but left unwritten.
 a0_err_t a0_packet_serialize(a0_packet_t, a0_alloc_t, a0_flat_packet_t* out);
 
+/// Serializes the packet to the allocated location, in the v2 format.
+///
+/// Readers older than the v2 format cannot read the result.
+///
+/// If the packet id is not a canonical uuid, as made by a0_uuidv4, the v1 format is used.
+a0_err_t a0_packet_serialize_v2(a0_packet_t, a0_alloc_t, a0_flat_packet_t* out);
+
+/// Compute packet statistics, for the v2 format.
+///
+/// If the packet id is not a canonical uuid, this matches a0_packet_stats,
+/// as a0_packet_serialize_v2 then uses the v1 format.
+a0_err_t a0_packet_stats_v2(a0_packet_t, a0_packet_stats_t*);
+
 /// Deserializes the flat packet into a normal packet.
 a0_err_t a0_packet_deserialize(a0_flat_packet_t, a0_alloc_t, a0_packet_t* out_pkt, a0_buf_t* out_buf);
 
@@ -261,11 +318,21 @@ a0_err_t a0_packet_deep_copy(a0_packet_t, a0_alloc_t, a0_packet_t* out_pkt, a0_b
 /// Compute packet statistics, for serialized packets.
 a0_err_t a0_flat_packet_stats(a0_flat_packet_t, a0_packet_stats_t*);
 
+/// Retrieve the serialization format version of the flat packet: 1 or 2.
+a0_err_t a0_flat_packet_version(a0_flat_packet_t, uint8_t* out);
+
 /// Retrieve the uuid within the flat packet.
 ///
 /// **Note**: the result points into the flat packet. It is not copied out.
+///
+/// v2 packets store the id in binary. Their id is decoded into a thread local
+/// buffer, which the next call from the same thread overwrites. Use
+/// a0_flat_packet_id_copy to keep it.
 a0_err_t a0_flat_packet_id(a0_flat_packet_t, a0_uuid_t**);
 
+/// Copies the uuid within the flat packet.
+a0_err_t a0_flat_packet_id_copy(a0_flat_packet_t, a0_uuid_t out);
+
 /// Retrieve the payload within the flat packet.
 ///
 /// **Note**: the result points into the flat packet. It is not copied out.
@@ -46,7 +46,8 @@ struct Packet : details::CppWrap<a0_packet_t> {
 
 /// FlatPacket is immutable.
 struct FlatPacket : details::CppWrap<a0_flat_packet_t> {
-  string_view id() const;
+  /// A copy of the id, as v2 packets store it in binary.
+  std::string id() const;
   string_view payload() const;
   size_t num_headers() const;
   std::pair<string_view, string_view> header(size_t idx) const;
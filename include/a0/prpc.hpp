@@ -1,6 +1,7 @@
 #pragma once
 
 #include <a0/c_wrap.hpp>
+#include <a0/executor.hpp>
 #include <a0/file.hpp>
 #include <a0/packet.hpp>
 #include <a0/prpc.h>
@@ -52,6 +53,12 @@ struct PrpcServer : details::CppWrap<a0_prpc_server_t> {
       PrpcTopic,
       std::function<void(PrpcConnection)> onconnection,
       std::function<void(string_view /* id */)> oncancel);
+  /// Runs the callbacks in the dispatch executor.
+  PrpcServer(
+      PrpcTopic,
+      Dispatch,
+      std::function<void(PrpcConnection)> onconnection,
+      std::function<void(string_view /* id */)> oncancel);
 };
 
 struct PrpcClient : details::CppWrap<a0_prpc_client_t> {
@@ -17,8 +17,29 @@ extern "C" {
 typedef struct a0_pubsub_topic_s {
   const char* name;
   const a0_file_options_t* file_opts;
+  /// Layout of the transport, if the topic is created.
+  ///
+  /// NULL for A0_PUBSUB_TRANSPORT_OPTIONS_DEFAULT.
+  const a0_transport_options_t* transport_opts;
 } a0_pubsub_topic_t;
 
+/// Transport layout of new pubsub topics.
+///
+/// Includes a sequence index, so subscribers can start at A0_INIT_SEQ or
+/// A0_INIT_SINCE without walking the topic. When the topic is opened with a
+/// NULL transport_opts, the index is sized to the file instead, with an entry
+/// per 256 bytes, so that it spans every packet the topic can hold.
+///
+/// Includes 16 watcher slots, so subscribers on a reactor are woken by
+/// publishers rather than polled, and 16 shared-reader slots, so zero-copy
+/// subscriber callbacks do not hold the exclusive lock. See a0_reader_zc_init.
+///
+/// Topics too small for this layout are created with A0_TRANSPORT_OPTIONS_DEFAULT.
+extern const a0_transport_options_t A0_PUBSUB_TRANSPORT_OPTIONS_DEFAULT;
+
+/// Opens the file of a pubsub topic, and creates its transport if needed.
+a0_err_t a0_pubsub_topic_open(a0_pubsub_topic_t, a0_file_t*);
+
 ///////////////
 // Publisher //
 ///////////////
@@ -29,9 +50,24 @@ typedef struct a0_publisher_s {
 } a0_publisher_t;
 
 a0_err_t a0_publisher_init(a0_publisher_t*, a0_pubsub_topic_t);
+/// Initializes a publisher whose writer uses the given options, e.g. to publish v2 packets.
+a0_err_t a0_publisher_init_options(a0_publisher_t*, a0_pubsub_topic_t, a0_writer_options_t);
 a0_err_t a0_publisher_close(a0_publisher_t*);
 a0_err_t a0_publisher_pub(a0_publisher_t*, a0_packet_t);
+/// Publishes the packets under a single transport lock, waking subscribers once.
+///
+/// If written is not NULL, it is set to the number of packets published. See a0_writer_write_batch.
+a0_err_t a0_publisher_pub_batch(a0_publisher_t*, const a0_packet_t*, size_t cnt, size_t* written);
+/// Reserves a packet to be filled in place. See a0_writer_reserve.
+a0_err_t a0_publisher_reserve(a0_publisher_t*, a0_packet_t, size_t payload_size, a0_writer_reservation_t*);
 a0_err_t a0_publisher_writer(a0_publisher_t*, a0_writer_t**);
+/// Grows the topic to at least the given size, without disrupting subscribers.
+///
+/// See a0_file_grow. Publishers and subscribers in other processes use the
+/// new space the next time they access the topic. Fails with EBUSY, leaving
+/// the topic unchanged, while any of them has the topic open without
+/// reserving room for the new size.
+a0_err_t a0_publisher_grow(a0_publisher_t*, size_t size);
 
 ////////////////
 // Subscriber //
@@ -51,6 +87,8 @@ a0_err_t a0_subscriber_sync_zc_init(a0_subscriber_sync_zc_t*,
 a0_err_t a0_subscriber_sync_zc_close(a0_subscriber_sync_zc_t*);
 
 a0_err_t a0_subscriber_sync_zc_can_read(a0_subscriber_sync_zc_t*, bool*);
+/// See a0_reader_sync_zc_watch.
+a0_err_t a0_subscriber_sync_zc_watch(a0_subscriber_sync_zc_t*, int* fd);
 a0_err_t a0_subscriber_sync_zc_read(a0_subscriber_sync_zc_t*, a0_zero_copy_callback_t);
 a0_err_t a0_subscriber_sync_zc_read_blocking(a0_subscriber_sync_zc_t*, a0_zero_copy_callback_t);
 a0_err_t a0_subscriber_sync_zc_read_blocking_timeout(a0_subscriber_sync_zc_t*, a0_time_mono_t*, a0_zero_copy_callback_t);
@@ -70,6 +108,8 @@ a0_err_t a0_subscriber_sync_init(a0_subscriber_sync_t*,
 a0_err_t a0_subscriber_sync_close(a0_subscriber_sync_t*);
 
 a0_err_t a0_subscriber_sync_can_read(a0_subscriber_sync_t*, bool*);
+/// See a0_reader_sync_zc_watch.
+a0_err_t a0_subscriber_sync_watch(a0_subscriber_sync_t*, int* fd);
 a0_err_t a0_subscriber_sync_read(a0_subscriber_sync_t*, a0_packet_t*);
 a0_err_t a0_subscriber_sync_read_blocking(a0_subscriber_sync_t*, a0_packet_t*);
 a0_err_t a0_subscriber_sync_read_blocking_timeout(a0_subscriber_sync_t*, a0_time_mono_t*, a0_packet_t*);
@@ -88,6 +128,21 @@ a0_err_t a0_subscriber_zc_init(a0_subscriber_zc_t*,
 
 a0_err_t a0_subscriber_zc_close(a0_subscriber_zc_t*);
 
+// Busy-polling threaded zero-copy version. See a0_reader_spin_zc_t.
+
+typedef struct a0_subscriber_spin_zc_s {
+  a0_file_t _file;
+  a0_reader_spin_zc_t _reader_spin_zc;
+} a0_subscriber_spin_zc_t;
+
+a0_err_t a0_subscriber_spin_zc_init(a0_subscriber_spin_zc_t*,
+                                    a0_pubsub_topic_t,
+                                    a0_reader_options_t,
+                                    a0_transport_poll_backoff_t,
+                                    a0_zero_copy_callback_t);
+
+a0_err_t a0_subscriber_spin_zc_close(a0_subscriber_spin_zc_t*);
+
 // Threaded allocated version.
 
 typedef struct a0_subscriber_s {
@@ -9,6 +9,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace a0 {
 
@@ -30,6 +33,7 @@ struct PubSubTopic {
 struct Publisher : details::CppWrap<a0_publisher_t> {
   Publisher() = default;
   explicit Publisher(PubSubTopic);
+  Publisher(PubSubTopic, Writer::Options);
 
   void pub(Packet);
   void pub(std::unordered_multimap<std::string, std::string> headers,
@@ -39,7 +43,19 @@ struct Publisher : details::CppWrap<a0_publisher_t> {
   void pub(string_view payload) {
     pub({}, payload);
   }
+  /// Publishes the packets under a single transport lock, waking subscribers once.
+  ///
+  /// If written is given, it is set to the number of packets published, even if this throws.
+  void pub_batch(const std::vector<Packet>&, size_t* written = nullptr);
+  /// Reserves a packet with an unwritten payload. See a0_writer_reserve.
+  WriterReservation reserve(std::unordered_multimap<std::string, std::string> headers,
+                            size_t payload_size);
+  WriterReservation reserve(size_t payload_size) {
+    return reserve({}, payload_size);
+  }
   Writer writer();
+  /// Grows the topic to at least the given size. See a0_publisher_grow.
+  void grow(size_t);
 };
 
 struct SubscriberSyncZeroCopy : details::CppWrap<a0_subscriber_sync_zc_t> {
@@ -56,6 +72,8 @@ struct SubscriberSyncZeroCopy : details::CppWrap<a0_subscriber_sync_zc_t> {
       : SubscriberSyncZeroCopy(topic, Reader::Options(init, iter)) {}
 
   bool can_read();
+  /// Descriptor that becomes readable on new frames. See a0_reader_sync_zc_watch.
+  int watch();
   void read(std::function<void(TransportLocked, FlatPacket)>);
   void read_blocking(std::function<void(TransportLocked, FlatPacket)>);
   void read_blocking(TimeMono, std::function<void(TransportLocked, FlatPacket)>);
@@ -79,6 +97,8 @@ struct SubscriberSync : details::CppWrap<a0_subscriber_sync_t> {
       : SubscriberSync(topic, Reader::Init(init), Reader::Iter(iter)) {}
 
   bool can_read();
+  /// Descriptor that becomes readable on new frames. See a0_reader_sync_zc_watch.
+  int watch();
   Packet read();
   Packet read_blocking();
   Packet read_blocking(TimeMono);
@@ -98,6 +118,23 @@ struct SubscriberZeroCopy : details::CppWrap<a0_subscriber_zc_t> {
       : SubscriberZeroCopy(topic, Reader::Options(init, iter), fn) {}
 };
 
+/// Busy-polling zero-copy subscriber, for dedicated cores. See a0_reader_spin_zc_t.
+struct SubscriberSpinZeroCopy : details::CppWrap<a0_subscriber_spin_zc_t> {
+  using Backoff = ReaderSpinZeroCopy::Backoff;
+
+  SubscriberSpinZeroCopy() = default;
+  SubscriberSpinZeroCopy(PubSubTopic, Reader::Options, Backoff, std::function<void(TransportLocked, FlatPacket)>);
+
+  SubscriberSpinZeroCopy(PubSubTopic topic, std::function<void(TransportLocked, FlatPacket)> fn)
+      : SubscriberSpinZeroCopy(topic, Reader::Options(), Backoff::RELAX, fn) {}
+  SubscriberSpinZeroCopy(PubSubTopic topic, Reader::Init init, std::function<void(TransportLocked, FlatPacket)> fn)
+      : SubscriberSpinZeroCopy(topic, Reader::Options(init), Backoff::RELAX, fn) {}
+  SubscriberSpinZeroCopy(PubSubTopic topic, Reader::Iter iter, std::function<void(TransportLocked, FlatPacket)> fn)
+      : SubscriberSpinZeroCopy(topic, Reader::Options(iter), Backoff::RELAX, fn) {}
+  SubscriberSpinZeroCopy(PubSubTopic topic, Reader::Init init, Reader::Iter iter, std::function<void(TransportLocked, FlatPacket)> fn)
+      : SubscriberSpinZeroCopy(topic, Reader::Options(init, iter), Backoff::RELAX, fn) {}
+};
+
 struct Subscriber : details::CppWrap<a0_subscriber_t> {
   Subscriber() = default;
   Subscriber(PubSubTopic, Reader::Options, std::function<void(Packet)>);
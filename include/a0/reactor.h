@@ -0,0 +1,192 @@
+/**
+ * \file reactor.h
+ * \rst
+ *
+ * Reactor
+ * ---------------
+ *
+ * A reactor drives many readers and subscribers from a few threads, instead
+ * of one thread each.
+ *
+ * .. code-block:: cpp
+ *
+ *   a0::Reactor reactor(a0::Reactor::Options::DEFAULT);
+ *   a0::ReactorSubscriber sub_a(reactor, "topic_a", callback_a);
+ *   a0::ReactorSubscriber sub_b(reactor, "topic_b", callback_b);
+ *
+ * Each reader is driven by one of the reactor threads, so its callbacks run
+ * one at a time, in sequence order. Callbacks of readers on the same thread
+ * run one at a time as well, so a slow callback delays the others. Readers
+ * are assigned to threads round-robin.
+ *
+ * A reactor thread sleeps in epoll. Readers of transports created with
+ * watcher slots wake it through a watcher descriptor; see Watching in
+ * transport.h. Readers of other transports, or of read-only arenas, are
+ * polled every **poll_interval_ns**, without locking while idle.
+ *
+ * A watcher cannot be signaled by writers in another network namespace. Such
+ * writers mark it, and the thread, which checks its watchers at least every
+ * 100ms, polls that reader from then on.
+ *
+ * A thread reads at most **batch** frames from one reader before moving on to
+ * the next ready reader, so a busy topic does not starve the others.
+ *
+ * \endrst
+ */
+
+#ifndef A0_REACTOR_H
+#define A0_REACTOR_H
+
+#include <a0/alloc.h>
+#include <a0/arena.h>
+#include <a0/callback.h>
+#include <a0/err.h>
+#include <a0/file.h>
+#include <a0/packet.h>
+#include <a0/pubsub.h>
+#include <a0/reader.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \addtogroup REACTOR
+ *  @{
+ */
+
+typedef struct a0_reactor_options_s {
+  /// Number of threads. Zero is treated as one.
+  uint32_t threads;
+  /// How often readers without a watcher descriptor are polled. Zero polls continuously.
+  uint32_t poll_interval_ns;
+  /// Most frames read from one reader before moving on. Zero for no limit.
+  uint32_t batch;
+} a0_reactor_options_t;
+
+/// One thread, a 1ms poll interval and batches of 64 frames.
+extern const a0_reactor_options_t A0_REACTOR_OPTIONS_DEFAULT;
+
+typedef struct a0_reactor_thread_s a0_reactor_thread_t;
+
+typedef struct a0_reactor_s {
+  a0_reactor_options_t _opts;
+  a0_reactor_thread_t* _threads;
+  uint32_t _next_thread;
+} a0_reactor_t;
+
+/// ...
+a0_err_t a0_reactor_init(a0_reactor_t*, a0_reactor_options_t);
+
+/// Fails with EBUSY while readers remain. May not be called from within a callback.
+a0_err_t a0_reactor_close(a0_reactor_t*);
+
+// A reader as seen by its reactor thread.
+typedef struct a0_reactor_source_s {
+  a0_reader_sync_zc_t* _reader_sync_zc;
+  // Reads one frame. Returns A0_ERR_AGAIN once the reader is idle.
+  a0_err_t (*_read)(struct a0_reactor_source_s*);
+  a0_reactor_thread_t* _thread;
+
+  // Owned by the reactor thread.
+  int _fd;
+  uint64_t _seen_seq_high;
+  struct a0_reactor_source_s* _prev;
+  struct a0_reactor_source_s* _next;
+  bool _ready;
+  struct a0_reactor_source_s* _ready_prev;
+  struct a0_reactor_source_s* _ready_next;
+} a0_reactor_source_t;
+
+/** @}*/
+
+/** \addtogroup REACTOR_READER_ZC
+ *  @{
+ */
+
+typedef struct a0_reactor_reader_zc_s {
+  a0_reactor_source_t _source;
+  a0_reader_sync_zc_t _reader_sync_zc;
+  a0_zero_copy_callback_t _onpacket;
+} a0_reactor_reader_zc_t;
+
+/// The callback is run as with a0_reader_sync_zc_read, on a reactor thread.
+a0_err_t a0_reactor_reader_zc_init(a0_reactor_reader_zc_t*,
+                                   a0_reactor_t*,
+                                   a0_arena_t,
+                                   a0_reader_options_t,
+                                   a0_zero_copy_callback_t);
+
+/// No callback runs once this returns. May not be called from within a callback.
+a0_err_t a0_reactor_reader_zc_close(a0_reactor_reader_zc_t*);
+
+/** @}*/
+
+/** \addtogroup REACTOR_READER
+ *  @{
+ */
+
+typedef struct a0_reactor_reader_s {
+  a0_reactor_source_t _source;
+  a0_reader_sync_zc_t _reader_sync_zc;
+  a0_alloc_t _alloc;
+  a0_packet_callback_t _onpacket;
+} a0_reactor_reader_t;
+
+/// The callback is run without the transport lock, on a reactor thread.
+a0_err_t a0_reactor_reader_init(a0_reactor_reader_t*,
+                                a0_reactor_t*,
+                                a0_arena_t,
+                                a0_alloc_t,
+                                a0_reader_options_t,
+                                a0_packet_callback_t);
+
+/// No callback runs once this returns. May not be called from within a callback.
+a0_err_t a0_reactor_reader_close(a0_reactor_reader_t*);
+
+/** @}*/
+
+/** \addtogroup REACTOR_SUBSCRIBER
+ *  @{
+ */
+
+typedef struct a0_reactor_subscriber_zc_s {
+  a0_file_t _file;
+  a0_reactor_reader_zc_t _reactor_reader_zc;
+} a0_reactor_subscriber_zc_t;
+
+/// See a0_reactor_reader_zc_init.
+a0_err_t a0_reactor_subscriber_zc_init(a0_reactor_subscriber_zc_t*,
+                                       a0_reactor_t*,
+                                       a0_pubsub_topic_t,
+                                       a0_reader_options_t,
+                                       a0_zero_copy_callback_t);
+
+/// ...
+a0_err_t a0_reactor_subscriber_zc_close(a0_reactor_subscriber_zc_t*);
+
+typedef struct a0_reactor_subscriber_s {
+  a0_file_t _file;
+  a0_reactor_reader_t _reactor_reader;
+} a0_reactor_subscriber_t;
+
+/// See a0_reactor_reader_init.
+a0_err_t a0_reactor_subscriber_init(a0_reactor_subscriber_t*,
+                                    a0_reactor_t*,
+                                    a0_pubsub_topic_t,
+                                    a0_alloc_t,
+                                    a0_reader_options_t,
+                                    a0_packet_callback_t);
+
+/// ...
+a0_err_t a0_reactor_subscriber_close(a0_reactor_subscriber_t*);
+
+/** @}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // A0_REACTOR_H
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <a0/arena.hpp>
+#include <a0/c_wrap.hpp>
+#include <a0/packet.hpp>
+#include <a0/pubsub.hpp>
+#include <a0/reactor.h>
+#include <a0/reader.hpp>
+#include <a0/transport.hpp>
+
+#include <cstdint>
+#include <functional>
+
+namespace a0 {
+
+/// Drives many readers and subscribers from a few threads. See reactor.h.
+struct Reactor : details::CppWrap<a0_reactor_t> {
+  struct Options {
+    /// Number of threads. Zero is treated as one.
+    uint32_t threads;
+    /// How often readers without a watcher descriptor are polled. Zero polls continuously.
+    uint32_t poll_interval_ns;
+    /// Most frames read from one reader before moving on. Zero for no limit.
+    uint32_t batch;
+
+    /// One thread, a 1ms poll interval and batches of 64 frames.
+    static Options DEFAULT;
+  };
+
+  Reactor() = default;
+  explicit Reactor(Options);
+};
+
+struct ReactorReaderZeroCopy : details::CppWrap<a0_reactor_reader_zc_t> {
+  ReactorReaderZeroCopy() = default;
+  ReactorReaderZeroCopy(Reactor, Arena, Reader::Options, std::function<void(TransportLocked, FlatPacket)>);
+
+  ReactorReaderZeroCopy(Reactor reactor, Arena arena, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReactorReaderZeroCopy(reactor, arena, Reader::Options(), fn) {}
+};
+
+struct ReactorReader : details::CppWrap<a0_reactor_reader_t> {
+  ReactorReader() = default;
+  ReactorReader(Reactor, Arena, Reader::Options, std::function<void(Packet)>);
+
+  ReactorReader(Reactor reactor, Arena arena, std::function<void(Packet)> fn)
+      : ReactorReader(reactor, arena, Reader::Options(), fn) {}
+};
+
+struct ReactorSubscriberZeroCopy : details::CppWrap<a0_reactor_subscriber_zc_t> {
+  ReactorSubscriberZeroCopy() = default;
+  ReactorSubscriberZeroCopy(Reactor, PubSubTopic, Reader::Options, std::function<void(TransportLocked, FlatPacket)>);
+
+  ReactorSubscriberZeroCopy(Reactor reactor, PubSubTopic topic, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReactorSubscriberZeroCopy(reactor, topic, Reader::Options(), fn) {}
+};
+
+struct ReactorSubscriber : details::CppWrap<a0_reactor_subscriber_t> {
+  ReactorSubscriber() = default;
+  ReactorSubscriber(Reactor, PubSubTopic, Reader::Options, std::function<void(Packet)>);
+
+  ReactorSubscriber(Reactor reactor, PubSubTopic topic, std::function<void(Packet)> fn)
+      : ReactorSubscriber(reactor, topic, Reader::Options(), fn) {}
+};
+
+}  // namespace a0
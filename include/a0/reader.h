@@ -24,6 +24,8 @@
  * * **INIT_AWAIT_NEW** (default): Start with messages written after the creation of the reader.
  * * **INIT_MOST_RECENT**: Start with the most recently written message. Useful for state and configuration. But be careful, this can be quite old!
  * * **INIT_OLDEST**: Start with the oldest message still in available in the transport.
+ * * **INIT_SEQ**: Start with the message with the given transport sequence number, or the oldest message after it still available. If no message with that sequence number has been written yet, behaves as **INIT_AWAIT_NEW**.
+ * * **INIT_SINCE**: Start with the oldest message committed at or after the given time. If no such message has been written yet, behaves as **INIT_AWAIT_NEW**. Exact only if the transport sequence index spans every message in the transport, as for pubsub topics; if it spans only the newest, messages older than the index are skipped. Without an index, behaves as **INIT_OLDEST**.
  *
  * An optional **ITER** can be added to specify how to continue reading messages. After each callback:
  *
@@ -41,11 +43,13 @@
 #include <a0/callback.h>
 #include <a0/err.h>
 #include <a0/event.h>
+#include <a0/executor.h>
 #include <a0/packet.h>
 #include <a0/transport.h>
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,6 +63,8 @@ typedef enum a0_reader_init_s {
   A0_INIT_OLDEST,
   A0_INIT_MOST_RECENT,
   A0_INIT_AWAIT_NEW,
+  A0_INIT_SEQ,
+  A0_INIT_SINCE,
 } a0_reader_init_t;
 
 /** @}*/
@@ -77,6 +83,10 @@ typedef enum a0_reader_iter_s {
 typedef struct a0_reader_options_s {
   a0_reader_init_t init;
   a0_reader_iter_t iter;
+  /// Transport sequence number to start at, for A0_INIT_SEQ.
+  uint64_t seq;
+  /// Commit time to start at, for A0_INIT_SINCE.
+  a0_time_mono_t since;
 } a0_reader_options_t;
 
 extern const a0_reader_options_t A0_READER_OPTIONS_DEFAULT;
@@ -87,6 +97,14 @@ typedef struct a0_zero_copy_callback_s {
   void (*fn)(void* user_data, a0_transport_locked_t, a0_flat_packet_t);
 } a0_zero_copy_callback_t;
 
+/// Callback for a batch of packets.
+///
+/// The packets are valid until the callback returns.
+typedef struct a0_zero_copy_batch_callback_s {
+  void* user_data;
+  void (*fn)(void* user_data, a0_transport_locked_t, a0_flat_packet_t*, size_t);
+} a0_zero_copy_batch_callback_t;
+
 /** \addtogroup READER_SYNC_ZC
  *  @{
  */
@@ -95,6 +113,7 @@ typedef struct a0_reader_sync_zc_s {
   a0_transport_t _transport;
   a0_reader_options_t _opts;
   bool _first_read_done;
+  a0_transport_watcher_t _watcher;
 } a0_reader_sync_zc_t;
 
 /// ...
@@ -103,14 +122,44 @@ a0_err_t a0_reader_sync_zc_init(a0_reader_sync_zc_t*,
                                 a0_reader_options_t);
 
 /// ...
+///
+/// If the reader is watched, must be called by the thread that called watch.
 a0_err_t a0_reader_sync_zc_close(a0_reader_sync_zc_t*);
 
+/// Returns a descriptor, for epoll or similar, that becomes readable when new
+/// frames are committed.
+///
+/// Read until A0_ERR_AGAIN after watching, and whenever the descriptor is
+/// readable. A read that returns A0_ERR_AGAIN re-arms the descriptor.
+///
+/// Requires a transport created with watcher slots. See Watching in transport.h.
+a0_err_t a0_reader_sync_zc_watch(a0_reader_sync_zc_t*, int* fd);
+
 /// ...
 a0_err_t a0_reader_sync_zc_can_read(a0_reader_sync_zc_t*, bool*);
 
 /// ...
+///
+/// If the transport has a free shared-reader slot, the callback is run under a
+/// shared lock, rather than the exclusive lock. The same holds for the blocking
+/// variants below.
+///
+/// For READONLY arenas, the callback is given a validated copy of the frame.
 a0_err_t a0_reader_sync_zc_read(a0_reader_sync_zc_t*, a0_zero_copy_callback_t);
 
+/// Reads up to max_n frames, or every available frame if max_n is zero, under
+/// one lock. The callback is run once per frame.
+///
+/// If the transport has a free shared-reader slot, the frames are read under a
+/// shared lock, so writers proceed while the batch is read. The batch then ends
+/// at the last frame committed when the lock was downgraded.
+///
+/// Returns A0_ERR_AGAIN if no frame is available. n_read, if not NULL, is set to
+/// the number of frames read.
+///
+/// For READONLY arenas, frames are copied and read one at a time.
+a0_err_t a0_reader_sync_zc_read_many(a0_reader_sync_zc_t*, size_t max_n, a0_zero_copy_callback_t, size_t* n_read);
+
 /// ...
 a0_err_t a0_reader_sync_zc_read_blocking(a0_reader_sync_zc_t*, a0_zero_copy_callback_t);
 
@@ -140,6 +189,9 @@ a0_err_t a0_reader_sync_close(a0_reader_sync_t*);
 /// ...
 a0_err_t a0_reader_sync_can_read(a0_reader_sync_t*, bool*);
 
+/// See a0_reader_sync_zc_watch.
+a0_err_t a0_reader_sync_watch(a0_reader_sync_t*, int* fd);
+
 /// ...
 a0_err_t a0_reader_sync_read(a0_reader_sync_t*, a0_packet_t*);
 
@@ -162,23 +214,79 @@ typedef struct a0_reader_zc_s {
   a0_reader_options_t _opts;
 
   a0_zero_copy_callback_t _onpacket;
+  a0_zero_copy_batch_callback_t _onbatch;
+  a0_flat_packet_t* _batch;
+  size_t _batch_cap;
+
+  // Held by the reader thread while a callback runs under a shared lock.
+  pthread_mutex_t _lease_mu;
 
   pthread_t _thread;
   uint32_t _thread_id;
   a0_event_t _thread_start_event;
 } a0_reader_zc_t;
 
-/// ...
+/// If the transport has a free shared-reader slot, the callback is run under a
+/// shared lock, pinning the frames it is given, rather than the exclusive lock.
+/// A slow callback then does not stall writers or other readers.
+///
+/// Pubsub topics have reader slots. Other transports need a nonzero
+/// reader_slots, see a0_transport_options_t.
 a0_err_t a0_reader_zc_init(a0_reader_zc_t*,
                            a0_arena_t,
                            a0_reader_options_t,
                            a0_zero_copy_callback_t);
 
+/// Hands the callback every frame available on each wakeup, up to max_batch
+/// frames at a time, rather than one frame per call.
+///
+/// Batches are only formed with A0_ITER_NEXT. A0_ITER_NEWEST gives batches of one.
+a0_err_t a0_reader_zc_init_batch(a0_reader_zc_t*,
+                                 a0_arena_t,
+                                 a0_reader_options_t,
+                                 size_t max_batch,
+                                 a0_zero_copy_batch_callback_t);
+
 /// May not be called from within a callback.
 a0_err_t a0_reader_zc_close(a0_reader_zc_t*);
 
 /** @}*/
 
+/** \addtogroup READER_SPIN_ZC
+ *  @{
+ */
+
+/// Threaded zero-copy reader that busy-polls, for dedicated cores.
+///
+/// The reader thread never sleeps. It polls the committed seq_high without
+/// locking, and only locks to read once new frames are committed. The
+/// callback is run as with a0_reader_sync_zc_read.
+///
+/// The thread spins at full speed on its core. See Busy Polling in transport.h.
+typedef struct a0_reader_spin_zc_s {
+  a0_reader_sync_zc_t _reader_sync_zc;
+  a0_transport_poll_backoff_t _backoff;
+
+  a0_zero_copy_callback_t _onpacket;
+
+  bool _shutdown;
+  pthread_t _thread;
+  uint32_t _thread_id;
+  a0_event_t _thread_start_event;
+} a0_reader_spin_zc_t;
+
+/// ...
+a0_err_t a0_reader_spin_zc_init(a0_reader_spin_zc_t*,
+                                a0_arena_t,
+                                a0_reader_options_t,
+                                a0_transport_poll_backoff_t,
+                                a0_zero_copy_callback_t);
+
+/// May not be called from within a callback.
+a0_err_t a0_reader_spin_zc_close(a0_reader_spin_zc_t*);
+
+/** @}*/
+
 /** \addtogroup READER
  *  @{
  */
@@ -187,6 +295,8 @@ typedef struct a0_reader_s {
   a0_reader_zc_t _reader_zc;
   a0_alloc_t _alloc;
   a0_packet_callback_t _onpacket;
+  a0_executor_dispatch_t _dispatch;
+  a0_executor_group_t _group;
 } a0_reader_t;
 
 /// ...
@@ -196,6 +306,14 @@ a0_err_t a0_reader_init(a0_reader_t*,
                         a0_reader_options_t,
                         a0_packet_callback_t);
 
+/// Runs the callback in the dispatch executor. See a0_executor_dispatch_t.
+a0_err_t a0_reader_init_dispatch(a0_reader_t*,
+                                 a0_arena_t,
+                                 a0_alloc_t,
+                                 a0_reader_options_t,
+                                 a0_executor_dispatch_t,
+                                 a0_packet_callback_t);
+
 /// ...
 a0_err_t a0_reader_close(a0_reader_t*);
 
@@ -2,10 +2,14 @@
 
 #include <a0/arena.hpp>
 #include <a0/c_wrap.hpp>
+#include <a0/executor.hpp>
 #include <a0/packet.hpp>
 #include <a0/reader.h>
+#include <a0/time.hpp>
 #include <a0/transport.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 namespace a0 {
@@ -15,6 +19,8 @@ struct Reader : details::CppWrap<a0_reader_t> {
     OLDEST = A0_INIT_OLDEST,
     MOST_RECENT = A0_INIT_MOST_RECENT,
     AWAIT_NEW = A0_INIT_AWAIT_NEW,
+    SEQ = A0_INIT_SEQ,
+    SINCE = A0_INIT_SINCE,
   };
 
   enum struct Iter {
@@ -25,6 +31,10 @@ struct Reader : details::CppWrap<a0_reader_t> {
   struct Options {
     Init init;
     Iter iter;
+    /// Transport sequence number to start at, for INIT_SEQ.
+    uint64_t seq;
+    /// Commit time to start at, for INIT_SINCE.
+    TimeMono since;
     static Options DEFAULT;
 
     Options()
@@ -38,10 +48,16 @@ struct Reader : details::CppWrap<a0_reader_t> {
       init = init_;
       iter = iter_;
     }
+    Options(Init init_, Iter iter_, uint64_t seq_)
+        : init{init_}, iter{iter_}, seq{seq_} {}
+    Options(Init init_, Iter iter_, TimeMono since_)
+        : Options(init_, iter_) { since = since_; }
   };
 
   Reader() = default;
   Reader(Arena, Options, std::function<void(Packet)>);
+  /// Runs the callback in the dispatch executor.
+  Reader(Arena, Options, Dispatch, std::function<void(Packet)>);
 
   Reader(Arena arena, std::function<void(Packet)> fn)
       : Reader(arena, Options(), fn) {}
@@ -56,6 +72,8 @@ struct Reader : details::CppWrap<a0_reader_t> {
 static const Reader::Init& INIT_OLDEST = Reader::Init::OLDEST;
 static const Reader::Init& INIT_MOST_RECENT = Reader::Init::MOST_RECENT;
 static const Reader::Init& INIT_AWAIT_NEW = Reader::Init::AWAIT_NEW;
+static const Reader::Init& INIT_SEQ = Reader::Init::SEQ;
+static const Reader::Init& INIT_SINCE = Reader::Init::SINCE;
 static const Reader::Iter& ITER_NEXT = Reader::Iter::NEXT;
 static const Reader::Iter& ITER_NEWEST = Reader::Iter::NEWEST;
 
@@ -73,7 +91,12 @@ struct ReaderSyncZeroCopy : details::CppWrap<a0_reader_sync_zc_t> {
       : ReaderSyncZeroCopy(arena, Reader::Options(init, iter)) {}
 
   bool can_read();
+  /// Descriptor that becomes readable on new frames. See a0_reader_sync_zc_watch.
+  int watch();
   void read(std::function<void(TransportLocked, FlatPacket)>);
+  /// Reads up to max_n available frames under one lock, or all of them if max_n
+  /// is zero. Returns the number read. See a0_reader_sync_zc_read_many.
+  size_t read_many(size_t max_n, std::function<void(TransportLocked, FlatPacket)>);
   void read_blocking(std::function<void(TransportLocked, FlatPacket)>);
   void read_blocking(TimeMono, std::function<void(TransportLocked, FlatPacket)>);
 };
@@ -92,6 +115,8 @@ struct ReaderSync : details::CppWrap<a0_reader_sync_t> {
       : ReaderSync(arena, Reader::Options(init, iter)) {}
 
   bool can_read();
+  /// Descriptor that becomes readable on new frames. See a0_reader_sync_zc_watch.
+  int watch();
   Packet read();
   Packet read_blocking();
   Packet read_blocking(TimeMono);
@@ -111,6 +136,26 @@ struct ReaderZeroCopy : details::CppWrap<a0_reader_zc_t> {
       : ReaderZeroCopy(arena, Reader::Options(init, iter), fn) {}
 };
 
+/// Threaded zero-copy reader that busy-polls, for dedicated cores. See a0_reader_spin_zc_t.
+struct ReaderSpinZeroCopy : details::CppWrap<a0_reader_spin_zc_t> {
+  enum struct Backoff {
+    RELAX = A0_TRANSPORT_POLL_RELAX,
+    UMWAIT = A0_TRANSPORT_POLL_UMWAIT,
+  };
+
+  ReaderSpinZeroCopy() = default;
+  ReaderSpinZeroCopy(Arena, Reader::Options, Backoff, std::function<void(TransportLocked, FlatPacket)>);
+
+  ReaderSpinZeroCopy(Arena arena, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReaderSpinZeroCopy(arena, Reader::Options(), Backoff::RELAX, fn) {}
+  ReaderSpinZeroCopy(Arena arena, Reader::Init init, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReaderSpinZeroCopy(arena, Reader::Options(init), Backoff::RELAX, fn) {}
+  ReaderSpinZeroCopy(Arena arena, Reader::Iter iter, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReaderSpinZeroCopy(arena, Reader::Options(iter), Backoff::RELAX, fn) {}
+  ReaderSpinZeroCopy(Arena arena, Reader::Init init, Reader::Iter iter, std::function<void(TransportLocked, FlatPacket)> fn)
+      : ReaderSpinZeroCopy(arena, Reader::Options(init, iter), Backoff::RELAX, fn) {}
+};
+
 void read_random_access(Arena, size_t off, std::function<void(TransportLocked, FlatPacket)>);
 
 }  // namespace a0
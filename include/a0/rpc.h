@@ -5,6 +5,7 @@
 #include <a0/arena.h>
 #include <a0/buf.h>
 #include <a0/callback.h>
+#include <a0/executor.h>
 #include <a0/file.h>
 #include <a0/map.h>
 #include <a0/packet.h>
@@ -50,6 +51,15 @@ a0_err_t a0_rpc_server_init(a0_rpc_server_t*,
                             a0_alloc_t,
                             a0_rpc_request_callback_t onrequest,
                             a0_packet_id_callback_t oncancel);
+/// Runs the callbacks in the dispatch executor. See a0_executor_dispatch_t.
+///
+/// Unless ordered by the dispatch key, a cancel may run before, or concurrently with, its request.
+a0_err_t a0_rpc_server_init_dispatch(a0_rpc_server_t*,
+                                     a0_rpc_topic_t,
+                                     a0_alloc_t,
+                                     a0_executor_dispatch_t,
+                                     a0_rpc_request_callback_t onrequest,
+                                     a0_packet_id_callback_t oncancel);
 a0_err_t a0_rpc_server_close(a0_rpc_server_t*);
 
 // Note: do NOT respond with the request packet. The ids MUST be unique!
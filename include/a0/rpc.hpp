@@ -1,6 +1,7 @@
 #pragma once
 
 #include <a0/c_wrap.hpp>
+#include <a0/executor.hpp>
 #include <a0/file.hpp>
 #include <a0/packet.hpp>
 #include <a0/pubsub.h>
@@ -51,6 +52,12 @@ struct RpcServer : details::CppWrap<a0_rpc_server_t> {
       RpcTopic,
       std::function<void(RpcRequest)> onrequest,
       std::function<void(string_view /* id */)> oncancel);
+  /// Runs the callbacks in the dispatch executor.
+  RpcServer(
+      RpcTopic,
+      Dispatch,
+      std::function<void(RpcRequest)> onrequest,
+      std::function<void(string_view /* id */)> oncancel);
 };
 
 struct RpcClient : details::CppWrap<a0_rpc_client_t> {
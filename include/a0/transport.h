@@ -16,17 +16,38 @@
  * The frames are layed out in the given arena, one after the other, max-aligned
  * in case the bytes needs to be reinterpreted as a struct.
  *
+ * The alignment can instead be chosen when the transport is created, with
+ * frame_align. Topics that are scanned can start every frame on its own cache
+ * line, with a frame_align of 64. Topics of small messages can pack frames
+ * tighter, with a frame_align of 8 and compact frames. See Compact Frames.
+ *
  * Once the arena is exhausted, and the next requested frame cannot be added without
  * overrunning the arena, the oldest frames will be evicted to make space.
  *
  * A transport has a single exclusive lock that must be acquired before reading or
  * writing frames. This is to prevent a frame from being erased while another process
  * is reading the frame. A general reader-writer-lock prevents consistency guarantees,
- * but we may allow for a fixed, limited, number of simultanious readers in the future.
+ * but a transport may be created with a fixed, limited, number of shared-reader slots.
+ * See Shared Readers below.
  *
  * The layout of the transport is guaranteed to be consistent on the same machine,
  * regardless of libc implementations.
  *
+ * Compact Frames
+ * --------------
+ *
+ * Every frame starts with a 40 byte a0_transport_frame_hdr_t, holding 64-bit
+ * links to its neighbors and its own offset. A transport created with
+ * compact_frames instead starts every frame with a 24 byte header, holding
+ * 32-bit links relative to the frame, and no offset of its own.
+ *
+ * Compact frames are only accessed through a0_transport_frame_data, the
+ * allocator from a0_transport_allocator, and the data of a reservation.
+ * a0_transport_frame and a0_transport_alloc fail with ENOTSUP, as there is no
+ * a0_transport_frame_t to point to. Readers and writers work with either.
+ *
+ * The arena of a compact transport is limited to 2GB, for the relative links.
+ *
  * Constructing
  * ------------
  *
@@ -81,6 +102,110 @@
  * Allocation may cause eviction, even if not committed. To see if an allocation
  * would cause an eviction, use a0_transport_alloc_evicts.
  *
+ * All frames evicted by a single allocation are removed in one atomic state
+ * transition, with a single notification to waiters.
+ *
+ * Seeking
+ * -------
+ *
+ * a0_transport_jump_seq moves the pointer to a frame by sequence number.
+ *
+ * By default, this walks the frame list from the head or tail, whichever is
+ * closer. A transport created with a nonzero seq_index_size keeps an index of
+ * the offsets of that many of the most recent frames, directly after the
+ * shared-reader slots. Seeking to an indexed frame takes constant time.
+ *
+ * To index every frame, choose seq_index_size larger than the arena size
+ * divided by the smallest expected frame size (payload plus 40 byte header).
+ * Each entry costs 16 bytes of arena. Pubsub topics are sized this way. Frames
+ * older than the index are reached by walking from the oldest indexed frame.
+ *
+ * The index also records the time at which each frame was committed.
+ * a0_transport_jump_time moves the pointer to the oldest frame committed at or
+ * after a given time, with a binary search over the index. This is exact if
+ * the index spans every frame. Otherwise, frames older than the index have
+ * unknown commit times, and if the search reaches the oldest indexed frame,
+ * the pointer stops there. It never moves to a frame committed before the
+ * given time, but may pass over older frames committed after it.
+ *
+ * Shared Readers
+ * --------------
+ *
+ * A transport created with a0_transport_init_options and a nonzero reader_slots
+ * reserves that many shared-reader slots, directly after the header.
+ *
+ * a0_transport_downgrade converts an exclusive lock into a shared lock, held
+ * through one of these slots. The frames at and after the current transport
+ * pointer are pinned, and the exclusive lock is released. Other readers and
+ * writers proceed concurrently. A writer only waits for a shared reader if it
+ * must evict, or clear, a frame pinned by that reader.
+ *
+ * A shared lock sees the transport as it was when downgraded, beginning at the
+ * pinned frame. It only allows read access. Alloc, commit, clear, resize and
+ * wait fail with EPERM.
+ *
+ * If no slot is free, or the transport has no slots, the lock remains exclusive.
+ *
+ * Slots are robust locks. If a shared reader dies, its pin is released.
+ *
+ * Multiple Producers
+ * ------------------
+ *
+ * A transport created with a nonzero producer_slots lets that many producers
+ * fill frames concurrently, directly after the sequence index.
+ *
+ * a0_transport_reserve allocates and commits a frame, under the lock. The
+ * producer may then unlock and fill the frame, while other producers reserve
+ * and fill their own. a0_transport_publish, under the lock, marks the frame
+ * filled. Only the lock-protected reserve and publish are serialized, not the
+ * copies. Writers use this for large packets. See a0_writer_write.
+ *
+ * Readers see frames in sequence order, and only once every earlier frame is
+ * published. Frames from a0_transport_alloc are published at commit, after
+ * the reserved frames before them.
+ *
+ * A frame that is not yet published is never evicted or cleared. Writers that
+ * need its space wait for it. If that frame was reserved by the calling
+ * thread, the writer fails with EDEADLK instead.
+ *
+ * a0_transport_discard publishes a reserved frame as discarded, for a producer
+ * that could not fill it. Slots are robust locks. If a producer dies before
+ * publishing, its frame is likewise discarded.
+ *
+ * Discarded frames keep their sequence number and space, but are never read.
+ * Emptiness checks, jumps, and steps pass over them, as if they were evicted.
+ *
+ * Backpressure
+ * ------------
+ *
+ * By default, writers evict the oldest frames, whether or not they were read.
+ *
+ * A transport created with a nonzero cursor_slots lets that many subscribers
+ * register durable cursors, directly after the producer slots. A cursor
+ * records the oldest frame its subscriber has not consumed. Frames at or after
+ * a registered cursor are not evicted.
+ *
+ * An allocation that would evict such a frame fails with A0_ERR_AGAIN.
+ * a0_transport_alloc_timeout instead waits for the subscriber, up to a
+ * timeout. a0_transport_clear is not subject to backpressure.
+ *
+ * Cursors are robust locks, held from register to unregister by the
+ * registering thread. If a subscriber dies, its cursor is released.
+ *
+ * Read-Only Arenas
+ * ----------------
+ *
+ * A transport in a READONLY arena never writes to the arena, and does not
+ * block writers in other processes.
+ *
+ * Locking takes a snapshot of the committed state, validated against a
+ * commit counter. Frames may still be evicted and overwritten by a writer
+ * while they are being read. a0_transport_frame checks that the frame header
+ * is in bounds, but the data should be copied, or inspected, and then checked
+ * with a0_transport_iter_revalidate before it is trusted.
+ *
+ * Alloc, commit, clear, resize and wait fail with EPERM.
+ *
  * Frame Structure
  * ---------------
  *
@@ -98,6 +223,74 @@
  * The predicate is checked immediately, then whenever the transport is unlocked
  * following a commit or eviction.
  *
+ * The number of blocked waiters is tracked in the shared header. If no thread, in
+ * any process, is waiting, a commit does not issue a wake syscall.
+ *
+ * Waiters are woken when the transport is unlocked, not on each commit. All
+ * commits made under a single lock result in at most one wake.
+ *
+ * Waiters on a0_transport_nonempty_pred or a0_transport_has_next_pred register
+ * the sequence number they are waiting for. A commit only wakes those waiters
+ * whose sequence number was committed, along with waiters on any other predicate.
+ *
+ * Spinning
+ * --------
+ *
+ * When the lock is held for less time than a kernel round trip, as on isolated
+ * cores, sleeping costs more than it saves. Each connection may spin first.
+ *
+ * With a nonzero lock_spin_ns, a contended lock polls the mutex for up to
+ * that long before sleeping. The spin adapts to how long recent locks took to
+ * acquire, and ends early once other lockers are queued in the kernel.
+ *
+ * With a nonzero wait_spin_ns, a wait whose predicate is unsatisfied unlocks
+ * and polls the commit counter for up to that long, before sleeping. A commit
+ * during the poll re-checks the predicate without a wake syscall.
+ *
+ * Durations are converted to iterations of a cpu relax hint, calibrated once
+ * per process. Spinning burns the core, and helps only if the lock holder or
+ * writer is running on another core.
+ *
+ * Busy Polling
+ * ------------
+ *
+ * A reader on a dedicated core can avoid the lock and the kernel entirely
+ * until there is something to read. a0_transport_poll_seq_high reads the
+ * committed seq_high without locking, in any arena mode, at the cost of a read
+ * of the header and committed state cache lines.
+ *
+ * Between polls, a0_transport_poll_pause backs off, either with a cpu relax
+ * hint, or by waiting in a light sleep state with UMWAIT until the header
+ * line holding the commit counter is written. UMWAIT falls back to the relax
+ * hint on cpus without WAITPKG.
+ *
+ * See a0_reader_spin_zc_t.
+ *
+ * Watching
+ * --------
+ *
+ * Event loops cannot block a thread in a0_transport_wait. A transport created
+ * with a nonzero watcher_slots lets that many connections register a watcher
+ * instead, directly after the cursor slots.
+ *
+ * A watcher owns a file descriptor, suitable for epoll, poll or io_uring,
+ * that becomes readable when frames are committed. It is a datagram socket in
+ * the abstract unix namespace, named in the watcher slot, which writers in any
+ * process signal by name, after unlocking.
+ *
+ * Only armed watchers are signaled, and only once. A watcher should be armed,
+ * under the lock, once it has read every frame, after which the next commit
+ * signals it. Arming drains the descriptor. Idle watchers thus cost a writer one
+ * sendto per burst of commits, and busy watchers cost it nothing.
+ *
+ * Abstract names are per network namespace. A writer in another network
+ * namespace than the watcher cannot signal it, and marks the watcher as
+ * unreachable instead. Such a watcher must be polled, see
+ * a0_transport_watcher_reachable.
+ *
+ * Watchers are robust locks, held from register to unregister by the
+ * registering thread. If a watcher dies, its slot is reused.
+ *
  * Consistency
  * -----------
  *
@@ -118,6 +311,7 @@
 #include <a0/arena.h>
 #include <a0/buf.h>
 #include <a0/callback.h>
+#include <a0/mtx.h>
 #include <a0/time.h>
 
 #include <stdbool.h>
@@ -132,6 +326,14 @@ extern "C" {
  *  @{
  */
 
+typedef struct a0_transport_state_s {
+  uint64_t seq_low;
+  uint64_t seq_high;
+  size_t off_head;
+  size_t off_tail;
+  size_t high_water_mark;
+} a0_transport_state_t;
+
 typedef struct a0_transport_s {
   a0_arena_t _arena;
 
@@ -144,8 +346,86 @@ typedef struct a0_transport_s {
 
   // Whether the transport has shutdown the notification mechanism.
   bool _shutdown;
+
+  // Shared-reader slot held by this connection, if the lock is shared.
+  struct a0_transport_reader_slot_s* _reader_slot;
+
+  // Snapshot of the committed state, for READONLY arenas.
+  a0_transport_state_t _snapshot;
+
+  // Wakes owed to waiters for commits made under the current lock.
+  uint32_t _wake_bits;
+  // Frames allocated under the current lock, to commit before it is released.
+  bool _commit_pending;
+
+  // Adaptive spin state for the transport lock.
+  a0_mtx_spin_t _lock_spin;
+  // Iterations a wait may poll for commits before sleeping.
+  uint32_t _wait_spin_iters;
 } a0_transport_t;
 
+/// Maximum number of shared-reader slots in a transport.
+#define A0_TRANSPORT_MAX_READER_SLOTS 64
+/// Maximum number of producer slots in a transport.
+#define A0_TRANSPORT_MAX_PRODUCER_SLOTS 64
+/// Maximum number of durable cursor slots in a transport.
+#define A0_TRANSPORT_MAX_CURSOR_SLOTS 64
+/// Maximum number of watcher slots in a transport.
+#define A0_TRANSPORT_MAX_WATCHER_SLOTS 64
+
+typedef struct a0_transport_options_s {
+  /// Number of shared-reader slots to reserve, if the transport is created.
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint8_t reader_slots;
+  /// Number of entries in the sequence index, if the transport is created.
+  ///
+  /// Zero, or a power of two. See Seeking.
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint32_t seq_index_size;
+  /// Number of producer slots to reserve, if the transport is created.
+  ///
+  /// See Multiple Producers.
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint8_t producer_slots;
+  /// Number of durable cursor slots to reserve, if the transport is created.
+  ///
+  /// See Backpressure.
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint8_t cursor_slots;
+  /// Alignment of frames, in bytes, if the transport is created.
+  ///
+  /// A power of two from 8 to 64, or zero for alignof(max_align_t).
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint8_t frame_align;
+  /// Number of watcher slots to reserve, if the transport is created.
+  ///
+  /// See Watching.
+  ///
+  /// Ignored when connecting to an existing transport.
+  uint8_t watcher_slots;
+  /// Nanoseconds a contended lock may spin before sleeping. Zero disables.
+  ///
+  /// Applies to this connection only. See Spinning.
+  uint32_t lock_spin_ns;
+  /// Nanoseconds a wait may poll for commits before sleeping. Zero disables.
+  ///
+  /// Applies to this connection only. See Spinning.
+  uint32_t wait_spin_ns;
+  /// Whether frames use the compact header, if the transport is created.
+  ///
+  /// See Compact Frames.
+  ///
+  /// Ignored when connecting to an existing transport.
+  bool compact_frames;
+} a0_transport_options_t;
+
+extern const a0_transport_options_t A0_TRANSPORT_OPTIONS_DEFAULT;
+
 typedef struct a0_transport_frame_hdr_s {
   /// Sequence number.
   uint64_t seq;
@@ -154,6 +434,8 @@ typedef struct a0_transport_frame_hdr_s {
   /// Offset of the next frame.
   size_t next_off;
   /// Offset of the previous frame.
+  ///
+  /// The low bit is set if the frame was discarded. See Multiple Producers.
   size_t prev_off;
   /// Size of the data within the frame.
   size_t data_size;
@@ -174,14 +456,40 @@ typedef struct a0_transport_locked_s {
 
 /// Creates or connects to the transport in the given arena.
 a0_err_t a0_transport_init(a0_transport_t*, a0_arena_t);
+/// Creates or connects to the transport in the given arena, with the given options.
+a0_err_t a0_transport_init_options(a0_transport_t*, a0_arena_t, a0_transport_options_t);
 
 /// Locks the transport.
 a0_err_t a0_transport_lock(a0_transport_t*, a0_transport_locked_t* lk_out);
+/// Locks the transport, then downgrades the lock to a shared lock.
+a0_err_t a0_transport_lock_shared(a0_transport_t*, a0_transport_locked_t* lk_out);
+/// Converts an exclusive lock into a shared lock, pinning the frames at and
+/// after the current transport pointer.
+///
+/// The lock remains exclusive if no shared-reader slot is available.
+a0_err_t a0_transport_downgrade(a0_transport_locked_t);
+/// Checks whether the lock is a shared lock.
+a0_err_t a0_transport_is_shared(a0_transport_locked_t, bool*);
 /// Unlocks the transport.
 ///
 /// The locked_transport object is invalid afterwards.
 a0_err_t a0_transport_unlock(a0_transport_locked_t);
 
+/// Backoff between busy polls. See Busy Polling.
+typedef enum a0_transport_poll_backoff_e {
+  /// Relax the cpu briefly.
+  A0_TRANSPORT_POLL_RELAX,
+  /// Wait with UMWAIT for a write to the commit counter, if supported.
+  A0_TRANSPORT_POLL_UMWAIT,
+} a0_transport_poll_backoff_t;
+
+/// Reads the committed seq_high without locking. See Busy Polling.
+a0_err_t a0_transport_poll_seq_high(a0_transport_t*, uint64_t*);
+/// Pauses a busy poll that last read the given seq_high.
+///
+/// Returns early once a commit may have changed it.
+a0_err_t a0_transport_poll_pause(a0_transport_t*, uint64_t seq_high, a0_transport_poll_backoff_t);
+
 /// Shuts down the notification mechanism and waits for all waiters to return.
 a0_err_t a0_transport_shutdown(a0_transport_locked_t);
 
@@ -194,11 +502,27 @@ a0_err_t a0_transport_empty(a0_transport_locked_t, bool*);
 a0_err_t a0_transport_nonempty(a0_transport_locked_t, bool*);
 /// Checks whether the user's transport pointer is valid.
 a0_err_t a0_transport_iter_valid(a0_transport_locked_t, bool*);
+/// Checks whether the user's transport pointer is valid, against the latest
+/// committed state rather than the state at lock time.
+///
+/// For READONLY arenas, use this after reading a frame to detect whether it
+/// was evicted while being read.
+a0_err_t a0_transport_iter_revalidate(a0_transport_locked_t, bool*);
 /// Moves the user's transport pointer to the given offset.
 ///
 /// Be careful! There is no validation that the offset is the
 /// start of a valid frame.
 a0_err_t a0_transport_jump(a0_transport_locked_t, size_t off);
+/// Moves the user's transport pointer to the frame with the given sequence number.
+///
+/// If that frame was discarded, moves to the next frame that was not.
+/// Fails with A0_ERR_RANGE if the frame is not available.
+a0_err_t a0_transport_jump_seq(a0_transport_locked_t, uint64_t seq);
+/// Moves the user's transport pointer to the oldest frame committed at or after the given time.
+///
+/// Requires a sequence index. See Seeking.
+/// Fails with A0_ERR_RANGE if no such frame is available.
+a0_err_t a0_transport_jump_time(a0_transport_locked_t, a0_time_mono_t);
 /// Moves the user's transport pointer to the oldest frame.
 ///
 /// Note that this is inclusive.
@@ -245,10 +569,25 @@ a0_err_t a0_transport_seq_low(a0_transport_locked_t, uint64_t* out);
 /// Returns the latest available sequence number.
 a0_err_t a0_transport_seq_high(a0_transport_locked_t, uint64_t* out);
 
+/// Returns the latest allocated sequence number.
+///
+/// Unlike seq_high, this includes frames reserved by producers, but not yet published.
+a0_err_t a0_transport_seq_high_allocated(a0_transport_locked_t, uint64_t* out);
+
 /// Accesses the frame within the arena, at the current transport pointer.
 ///
 /// Caller does NOT own `frame_out->data` and should not clean it up!
+///
+/// Fails with ENOTSUP if the transport has compact frames. See Compact Frames.
 a0_err_t a0_transport_frame(a0_transport_locked_t, a0_transport_frame_t** frame_out);
+/// Accesses the data of the frame within the arena, at the current transport pointer.
+///
+/// Unlike a0_transport_frame, works with either frame header.
+a0_err_t a0_transport_frame_data(a0_transport_locked_t, a0_buf_t* out);
+/// Reads the time at which the frame at the current transport pointer was committed.
+///
+/// Requires a sequence index, and fails with A0_ERR_RANGE if the frame is no longer indexed.
+a0_err_t a0_transport_frame_time(a0_transport_locked_t, a0_time_mono_t* out);
 
 /// Allocates a new frame within the arena.
 ///
@@ -262,22 +601,100 @@ a0_err_t a0_transport_frame(a0_transport_locked_t, a0_transport_frame_t** frame_
 ///     If an alloc evicts an old frame, that frame is lost, even if no
 ///     commit call is issued.
 /// \endrst
+///
+/// Fails with ENOTSUP if the transport has compact frames. Use a0_transport_allocator.
 a0_err_t a0_transport_alloc(a0_transport_locked_t, size_t, a0_transport_frame_t** frame_out);
+/// Allocates a frame, waiting up to the timeout for subscribers to consume frames
+/// that the allocation would evict. See Backpressure.
+///
+/// Fails with ENOTSUP if the transport has compact frames.
+a0_err_t a0_transport_alloc_timeout(a0_transport_locked_t,
+                                    size_t,
+                                    a0_time_mono_t* timeout,
+                                    a0_transport_frame_t** frame_out);
 /// Checks whether an alloc call would evict.
 a0_err_t a0_transport_alloc_evicts(a0_transport_locked_t, size_t, bool*);
 /// Creates an allocator that allocates within the transport.
 a0_err_t a0_transport_allocator(a0_transport_locked_t*, a0_alloc_t*);
 /// Commits the allocated frames.
 a0_err_t a0_transport_commit(a0_transport_locked_t);
+/// Commits the allocated frames when the lock is next released, or at the next commit.
+///
+/// Frames allocated under one lock then become visible to readers together,
+/// with a single commit. If the transport has producer slots, this commits now.
+a0_err_t a0_transport_commit_deferred(a0_transport_locked_t);
 
 /// Returns the arena space in use.
 a0_err_t a0_transport_used_space(a0_transport_locked_t, size_t*);
-/// Resizes the underlying arena. Fails with A0_ERR_INVALID_ARG if this would delete active data.
+/// Resizes the underlying arena. Fails with A0_ERR_INVALID_ARG if this would delete active data,
+/// or exceed the arena.
+///
+/// To grow past the arena, first grow the mapping in place, as with a0_file_grow, and resize
+/// through a transport on the grown arena. Transports in other processes adopt the new size
+/// the next time they lock, as far as their mapping reaches.
+///
+/// A transport whose mapping does not reach the frames committed in the grown space fails to
+/// read them, stepping to or accessing them with ESPIPE, and fails to alloc with A0_ERR_RANGE.
+/// a0_file_grow refuses to grow a file past another writable mapping of it.
 a0_err_t a0_transport_resize(a0_transport_locked_t, size_t);
 
 /// Clears the transport.
 a0_err_t a0_transport_clear(a0_transport_locked_t);
 
+/// A frame reserved by a producer, to be filled and published.
+typedef struct a0_transport_reservation_s {
+  /// The reserved frame. NULL if the transport has compact frames.
+  a0_transport_frame_t* frame;
+  /// The data of the reserved frame.
+  a0_buf_t data;
+  struct a0_transport_producer_slot_s* _slot;
+} a0_transport_reservation_t;
+
+/// Allocates and commits a frame that readers will not see until it is published.
+///
+/// The frame may be filled after unlocking. Waits if every producer slot is in use.
+/// Fails with ENOTSUP if the transport has no producer slots.
+a0_err_t a0_transport_reserve(a0_transport_locked_t, size_t, a0_transport_reservation_t* out);
+/// Publishes a filled frame. Must be called by the thread that reserved it.
+a0_err_t a0_transport_publish(a0_transport_locked_t, a0_transport_reservation_t*);
+/// Publishes a reserved frame as discarded, so that readers skip it.
+/// Must be called by the thread that reserved it.
+a0_err_t a0_transport_discard(a0_transport_locked_t, a0_transport_reservation_t*);
+
+/// A subscriber's durable cursor.
+typedef struct a0_transport_cursor_s {
+  struct a0_transport_cursor_slot_s* _slot;
+} a0_transport_cursor_t;
+
+/// Registers a durable cursor, keeping frames from seq onward until consumed.
+///
+/// Fails with ENOTSUP if the transport has no cursor slots, or EBUSY if all are in use.
+a0_err_t a0_transport_cursor_register(a0_transport_locked_t, uint64_t seq, a0_transport_cursor_t* out);
+/// Marks the frames up to, and including, seq as consumed.
+a0_err_t a0_transport_cursor_consume(a0_transport_locked_t, a0_transport_cursor_t*, uint64_t seq);
+/// Releases the cursor. Must be called by the thread that registered it.
+a0_err_t a0_transport_cursor_unregister(a0_transport_locked_t, a0_transport_cursor_t*);
+
+/// A connection's pollable notification channel. See Watching.
+typedef struct a0_transport_watcher_s {
+  /// Becomes readable when frames are committed while the watcher is armed.
+  int fd;
+  struct a0_transport_watcher_slot_s* _slot;
+} a0_transport_watcher_t;
+
+/// Registers an armed watcher.
+///
+/// Fails with ENOTSUP if the transport has no watcher slots, or EBUSY if all are in use.
+a0_err_t a0_transport_watcher_register(a0_transport_locked_t, a0_transport_watcher_t* out);
+/// Drains the watcher's descriptor, and arms it for the next commit.
+a0_err_t a0_transport_watcher_arm(a0_transport_locked_t, a0_transport_watcher_t*);
+/// Releases the watcher and closes its descriptor. Must be called by the thread that registered it.
+a0_err_t a0_transport_watcher_unregister(a0_transport_locked_t, a0_transport_watcher_t*);
+/// Whether every writer so far could signal the watcher. Does not need the lock.
+///
+/// Once false, commits may be missed by the descriptor, and the transport must be polled.
+a0_err_t a0_transport_watcher_reachable(a0_transport_watcher_t*, bool* out);
+
 /** @}*/
 
 #ifdef __cplusplus
@@ -13,6 +13,9 @@
 namespace a0 {
 
 using Frame = a0_transport_frame_t;
+using Reservation = a0_transport_reservation_t;
+using Cursor = a0_transport_cursor_t;
+using Watcher = a0_transport_watcher_t;
 
 struct TransportLocked : details::CppWrap<a0_transport_locked_t> {
   bool empty() const;
@@ -24,8 +27,13 @@ struct TransportLocked : details::CppWrap<a0_transport_locked_t> {
 
   bool iter_valid() const;
   Frame* frame() const;
+  /// The data of the current frame. Works with compact frames, unlike frame().
+  Buf frame_data() const;
+  TimeMono frame_time() const;
 
   void jump(size_t off);
+  void jump_seq(uint64_t seq);
+  void jump_time(TimeMono);
   void jump_head();
   void jump_tail();
   bool has_next() const;
@@ -34,22 +42,78 @@ struct TransportLocked : details::CppWrap<a0_transport_locked_t> {
   void step_prev();
 
   Frame* alloc(size_t);
+  /// Allocates, waiting for subscribers to consume frames it would evict. See Backpressure.
+  Frame* alloc_for(size_t, std::chrono::nanoseconds);
+  Frame* alloc_until(size_t, TimeMono);
   bool alloc_evicts(size_t) const;
 
   void commit();
 
   void clear();
 
+  /// Reserves a frame that may be filled after unlocking. See Multiple Producers.
+  Reservation reserve(size_t);
+  /// Publishes a reserved frame, once filled.
+  void publish(Reservation&);
+
+  /// Registers a durable cursor, keeping frames from seq onward until consumed.
+  Cursor cursor_register(uint64_t seq);
+  void cursor_consume(Cursor&, uint64_t seq);
+  void cursor_unregister(Cursor&);
+
+  /// Registers a watcher, whose fd becomes readable on commit. See Watching.
+  Watcher watcher_register();
+  void watcher_arm(Watcher&);
+  void watcher_unregister(Watcher&);
+  /// Whether every writer so far could signal the watcher. See a0_transport_watcher_reachable.
+  bool watcher_reachable(Watcher&);
+
   void wait(std::function<bool()>);
   void wait_for(std::function<bool()>, std::chrono::nanoseconds);
   void wait_until(std::function<bool()>, TimeMono);
+
+  /// Converts the lock into a shared lock, if a shared-reader slot is available.
+  void downgrade();
+  bool is_shared() const;
 };
 
 struct Transport : details::CppWrap<a0_transport_t> {
+  /// Options for creating a new transport.
+  ///
+  /// These will not change an existing transport.
+  struct Options {
+    /// Number of shared-reader slots.
+    uint8_t reader_slots;
+    /// Number of sequence index entries. Zero, or a power of two.
+    uint32_t seq_index_size;
+    /// Number of producer slots. Zero for a single-producer transport.
+    uint8_t producer_slots;
+    /// Number of durable cursor slots. Zero for a transport that evicts unread frames.
+    uint8_t cursor_slots;
+    /// Alignment of frames, in bytes. Zero for alignof(max_align_t).
+    uint8_t frame_align;
+    /// Number of watcher slots. Zero for a transport without pollable notifications.
+    uint8_t watcher_slots;
+    /// Nanoseconds a contended lock may spin before sleeping. Zero disables.
+    uint32_t lock_spin_ns;
+    /// Nanoseconds a wait may poll for commits before sleeping. Zero disables.
+    uint32_t wait_spin_ns;
+    /// Whether frames use the compact header. See Compact Frames.
+    bool compact_frames;
+
+    /// Default transport creation options.
+    ///
+    /// No shared-reader slots, no sequence index, no producer slots, no cursor slots,
+    /// max-aligned full frames, no watcher slots and no spinning.
+    static Options DEFAULT;
+  };
+
   Transport() = default;
   explicit Transport(Arena);
+  Transport(Arena, Options);
 
   TransportLocked lock();
+  TransportLocked lock_shared();
 };
 
 }  // namespace a0
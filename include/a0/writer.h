@@ -18,6 +18,9 @@
 #include <a0/inline.h>
 #include <a0/middleware.h>
 #include <a0/packet.h>
+#include <a0/transport.h>
+
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,12 +35,78 @@ struct a0_writer_s {
   a0_writer_t* _next;
 };
 
+/// A packet reserved in the writer's arena, to be filled in place.
+///
+/// See a0_writer_reserve.
+typedef struct a0_writer_reservation_s {
+  /// Writable payload, within the arena.
+  a0_buf_t payload;
+
+  a0_transport_locked_t _tlk;
+  a0_transport_reservation_t _res;
+} a0_writer_reservation_t;
+
+typedef struct a0_writer_options_s {
+  /// Serialization format of written packets: 1 or 2.
+  ///
+  /// Readers older than the v2 format cannot read v2 packets. See
+  /// a0_packet_serialize_v2.
+  uint8_t packet_version;
+} a0_writer_options_t;
+
+/// Writes v1 packets.
+extern const a0_writer_options_t A0_WRITER_OPTIONS_DEFAULT;
+
 /// Initializes a writer.
 a0_err_t a0_writer_init(a0_writer_t*, a0_arena_t);
+/// Initializes a writer with the given options.
+a0_err_t a0_writer_init_options(a0_writer_t*, a0_arena_t, a0_writer_options_t);
 /// Closes the given writer.
 a0_err_t a0_writer_close(a0_writer_t*);
 /// Serializes the given packet into the writer's arena.
+///
+/// If the transport has producer slots, a packet with a payload of 4kB or more
+/// is serialized into a reserved frame after unlocking, as with
+/// a0_writer_reserve. Other writers are not blocked by the copy.
 a0_err_t a0_writer_write(a0_writer_t*, a0_packet_t);
+/**
+ * Serializes the given packets into the writer's arena.
+ *
+ * Packets pass through the middleware individually, but the transport is
+ * locked once for the whole batch. The packets are committed together, and
+ * readers woken once, at the end.
+ *
+ * Stops at the first packet that fails. Earlier packets remain written, and
+ * are still committed. If written is not NULL, it is set to the number of
+ * packets that passed, which is the index of the failed packet.
+ */
+a0_err_t a0_writer_write_batch(a0_writer_t*, const a0_packet_t*, size_t cnt, size_t* written);
+
+/**
+ * Reserves space for a packet in the writer's arena, without writing the payload.
+ *
+ * The given packet passes through the middleware as with a0_writer_write, but
+ * its payload is replaced by payload_size unwritten bytes. The caller fills
+ * the payload in place, then calls a0_writer_commit or a0_writer_abort.
+ *
+ * If the transport has producer slots, the frame is reserved with
+ * a0_transport_reserve and filled unlocked, so other writers are not blocked
+ * while the payload is filled. An aborted reservation is then published as a
+ * discarded frame, as later frames may already follow it. Readers skip it.
+ *
+ * Otherwise, the transport stays locked until the reservation is committed or
+ * aborted.
+ *
+ * Commit and abort must be called from the reserving thread.
+ *
+ * Middleware that reads the payload, such as json_mergepatch, is not supported.
+ * Returns A0_ERR_CANCELLED if a middleware chose not to write the packet.
+ */
+a0_err_t a0_writer_reserve(a0_writer_t*, a0_packet_t, size_t payload_size, a0_writer_reservation_t*);
+/// Publishes a reserved packet.
+a0_err_t a0_writer_commit(a0_writer_reservation_t*);
+/// Discards a reserved packet.
+a0_err_t a0_writer_abort(a0_writer_reservation_t*);
 
 /// Modifies the writer to include the given middleware.
 ///
@@ -1,21 +1,56 @@
 #pragma once
 
 #include <a0/arena.hpp>
+#include <a0/buf.hpp>
 #include <a0/c_wrap.hpp>
 #include <a0/middleware.hpp>
 #include <a0/packet.hpp>
 #include <a0/writer.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace a0 {
 
+/// A packet reserved in a writer's arena, to be filled in place.
+///
+/// Aborted on destruction, if neither committed nor aborted.
+struct WriterReservation : details::CppWrap<a0_writer_reservation_t> {
+  /// Writable payload, within the arena.
+  Buf payload();
+  void commit();
+  void abort();
+};
+
 struct Writer : details::CppWrap<a0_writer_t> {
+  struct Options {
+    /// Serialization format of written packets: 1 or 2. See a0_writer_options_t.
+    uint8_t packet_version;
+
+    /// Writes v1 packets.
+    static Options DEFAULT;
+  };
+
   Writer() = default;
   explicit Writer(Arena);
+  Writer(Arena, Options);
 
   void write(Packet);
   void write(string_view sv) { write(Packet(sv, ref)); }
+  /// Writes the packets under a single transport lock, waking readers once.
+  ///
+  /// If written is given, it is set to the number of packets written, even if this throws.
+  void write_batch(const std::vector<Packet>&, size_t* written = nullptr);
+
+  /// Reserves a packet with an unwritten payload. See a0_writer_reserve.
+  WriterReservation reserve(std::unordered_multimap<std::string, std::string> headers,
+                            size_t payload_size);
+  WriterReservation reserve(size_t payload_size) {
+    return reserve({}, payload_size);
+  }
 
   void push(Middleware);
   Writer wrap(Middleware);
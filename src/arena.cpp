@@ -14,7 +14,7 @@ Arena::Arena(Buf buf, a0_arena_mode_t mode) {
   set_c(
       &c,
       [&](a0_arena_t* c) {
-        *c = {*buf.c, mode};
+        *c = {*buf.c, mode, 0};
         return A0_OK;
       },
       [buf](a0_arena_t*) {});
@@ -4,6 +4,12 @@
 #include <a0.h>
 #include <picobench/picobench.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
 static const char BENCH_FILE[] = "bench.a0";
 
 template <typename T>
@@ -149,8 +155,9 @@ bench_fn_t bench_a0_alloc(int msg_size) {
     a0_transport_lock(&fixture.transport, &lk);
     for (auto&& _ : s) {
       use(_);
-      a0_transport_frame_t frame;
+      a0_transport_frame_t* frame;
       a0_transport_alloc(lk, msg_size, &frame);
+      use(frame);
     }
     a0_transport_unlock(lk);
   };
@@ -167,11 +174,771 @@ bench_fn_t bench_a0_alloc_memcpy(int msg_size) {
     a0_transport_lock(&fixture.transport, &lk);
     for (auto&& _ : s) {
       use(_);
-      a0_transport_frame_t frame;
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+    }
+    a0_transport_unlock(lk);
+  };
+}
+
+bench_fn_t bench_a0_alloc_memcpy_commit(int msg_size) {
+  return [msg_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    std::string src(msg_size, 0);
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&fixture.transport, &lk);
+    for (auto&& _ : s) {
+      use(_);
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+      a0_transport_commit(lk);
+    }
+    a0_transport_unlock(lk);
+  };
+}
+
+bench_fn_t bench_a0_write_mixed(int small_size, int large_size) {
+  return [small_size, large_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    std::string src(large_size, 0);
+    int smalls_per_large = large_size / small_size;
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&fixture.transport, &lk);
+    for (auto&& _ : s) {
+      use(_);
+      // Refill the region the next large frame will evict with small frames.
+      for (int i = 0; i < smalls_per_large; i++) {
+        a0_transport_frame_t* frame;
+        a0_transport_alloc(lk, small_size, &frame);
+        memcpy(frame->data, src.data(), small_size);
+      }
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, large_size, &frame);
+      memcpy(frame->data, src.data(), large_size);
+      a0_transport_commit(lk);
+    }
+    a0_transport_unlock(lk);
+  };
+}
+
+bench_fn_t bench_a0_writer_burst(int msg_size, int burst) {
+  return [msg_size, burst](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+
+    std::string src(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)src.data(), src.size()};
+
+    for (auto&& _ : s) {
+      use(_);
+      for (int i = 0; i < burst; i++) {
+        a0_writer_write(&w, pkt);
+      }
+    }
+    a0_writer_close(&w);
+  };
+}
+
+bench_fn_t bench_a0_writer_burst_batch(int msg_size, int burst) {
+  return [msg_size, burst](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+
+    std::string src(msg_size, 0);
+    std::vector<a0_packet_t> pkts(burst);
+    for (auto&& pkt : pkts) {
+      a0_packet_init(&pkt);
+      pkt.payload = {(uint8_t*)src.data(), src.size()};
+    }
+
+    for (auto&& _ : s) {
+      use(_);
+      a0_writer_write_batch(&w, pkts.data(), pkts.size(), NULL);
+    }
+    a0_writer_close(&w);
+  };
+}
+
+bench_fn_t bench_a0_writer_write(int msg_size) {
+  return [msg_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+
+    // The producer fills a staging buffer, which the writer copies.
+    std::string staging(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)staging.data(), staging.size()};
+
+    for (auto&& _ : s) {
+      use(_);
+      memset(&staging[0], 1, msg_size);
+      a0_writer_write(&w, pkt);
+    }
+    a0_writer_close(&w);
+  };
+}
+
+bench_fn_t bench_a0_writer_reserve(int msg_size) {
+  return [msg_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+
+    // The producer fills the frame in place.
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+
+    for (auto&& _ : s) {
+      use(_);
+      a0_writer_reservation_t res;
+      a0_writer_reserve(&w, pkt, msg_size, &res);
+      memset(res.payload.data, 1, msg_size);
+      a0_writer_commit(&res);
+    }
+    a0_writer_close(&w);
+  };
+}
+
+bench_fn_t bench_a0_jump_seq(int msg_size, uint32_t seq_index_size) {
+  return [msg_size, seq_index_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    // Recreate the transport, with the sequence index.
+    memset(fixture.file.arena.buf.data, 0, fixture.file.arena.buf.size);
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.seq_index_size = seq_index_size;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+
+    std::string src(msg_size, 0);
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&transport, &lk);
+
+    // Fill the arena once over.
+    uint64_t seq_low = 0;
+    while (seq_low <= 1) {
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+      a0_transport_commit(lk);
+      a0_transport_seq_low(lk, &seq_low);
+    }
+    uint64_t seq_high;
+    a0_transport_seq_high(lk, &seq_high);
+
+    uint64_t seq = seq_low;
+    for (auto&& _ : s) {
+      use(_);
+      a0_transport_jump_seq(lk, seq);
+      seq = seq_low + (seq - seq_low + 7919) % (seq_high - seq_low + 1);
+    }
+    a0_transport_unlock(lk);
+  };
+}
+
+// Writes one lap around a fresh arena, or a lap after a warm-up lap. A fresh
+// sparse arena takes a page fault per page on the first lap, unless prefaulted.
+bench_fn_t bench_a0_write_lap(int msg_size, off_t file_size, bool prefault, bool warm) {
+  return [msg_size, file_size, prefault, warm](picobench::state& s) {
+    a0_file_remove(BENCH_FILE);
+    a0_file_options_t opts = A0_FILE_OPTIONS_DEFAULT;
+    opts.create_options.size = file_size;
+    opts.create_options.fallocate = prefault;
+    opts.open_options.populate = prefault;
+    opts.open_options.hugepage = prefault;
+    a0_file_t file;
+    a0_file_open(BENCH_FILE, &opts, &file);
+    a0_transport_t transport;
+    a0_transport_init(&transport, file.arena);
+
+    std::string src(msg_size, 0);
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&transport, &lk);
+
+    if (warm) {
+      uint64_t seq_low = 0;
+      while (seq_low <= 1) {
+        a0_transport_frame_t* frame;
+        a0_transport_alloc(lk, msg_size, &frame);
+        memcpy(frame->data, src.data(), msg_size);
+        a0_transport_commit(lk);
+        a0_transport_seq_low(lk, &seq_low);
+      }
+    }
+
+    for (auto&& _ : s) {
+      use(_);
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+      a0_transport_commit(lk);
+    }
+    a0_transport_unlock(lk);
+
+    a0_file_close(&file);
+    a0_file_remove(BENCH_FILE);
+  };
+}
+
+// Seeks to the oldest frame committed at or after a time, either with a binary
+// search over the sequence index or with a linear scan from the head.
+bench_fn_t bench_a0_jump_time(int msg_size, bool binary_search) {
+  return [msg_size, binary_search](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    // Recreate the transport, with a sequence index covering every frame.
+    memset(fixture.file.arena.buf.data, 0, fixture.file.arena.buf.size);
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.seq_index_size = 1 << 18;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+
+    std::string src(msg_size, 0);
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&transport, &lk);
+
+    // Fill the arena once over.
+    uint64_t seq_low = 0;
+    while (seq_low <= 1) {
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+      a0_transport_commit(lk);
+      a0_transport_seq_low(lk, &seq_low);
+    }
+    uint64_t seq_high;
+    a0_transport_seq_high(lk, &seq_high);
+
+    std::vector<a0_time_mono_t> times;
+    for (uint64_t seq = seq_low; seq <= seq_high; seq += 7919) {
+      a0_transport_jump_seq(lk, seq);
+      times.emplace_back();
+      a0_transport_frame_time(lk, &times.back());
+    }
+
+    size_t i = 0;
+    for (auto&& _ : s) {
+      use(_);
+      a0_time_mono_t target = times[i++ % times.size()];
+      if (binary_search) {
+        a0_transport_jump_time(lk, target);
+      } else {
+        a0_transport_jump_head(lk);
+        a0_time_mono_t time;
+        a0_transport_frame_time(lk, &time);
+        while (time.ts.tv_sec < target.ts.tv_sec ||
+               (time.ts.tv_sec == target.ts.tv_sec && time.ts.tv_nsec < target.ts.tv_nsec)) {
+          a0_transport_step_next(lk);
+          a0_transport_frame_time(lk, &time);
+        }
+      }
+    }
+    a0_transport_unlock(lk);
+  };
+}
+
+// Writes from one producer, while other producers reserve packets and fill
+// them slowly, as when reading a payload from a device. Without producer slots
+// the transport stays locked during each fill.
+bench_fn_t bench_a0_writer_contended(int msg_size, int producers, uint8_t producer_slots) {
+  return [msg_size, producers, producer_slots](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    // Recreate the transport, with the producer slots.
+    memset(fixture.file.arena.buf.data, 0, fixture.file.arena.buf.size);
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.producer_slots = producer_slots;
+    a0_transport_t transport;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+
+    std::string src(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)src.data(), src.size()};
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> others;
+    for (int i = 1; i < producers; i++) {
+      others.emplace_back([&]() {
+        a0_writer_t w;
+        a0_writer_init(&w, fixture.file.arena);
+        while (!done) {
+          a0_writer_reservation_t res;
+          a0_writer_reserve(&w, pkt, msg_size, &res);
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+          memcpy(res.payload.data, src.data(), msg_size);
+          a0_writer_commit(&res);
+        }
+        a0_writer_close(&w);
+      });
+    }
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+    for (auto&& _ : s) {
+      use(_);
+      a0_writer_write(&w, pkt);
+    }
+    a0_writer_close(&w);
+
+    done = true;
+    for (auto&& other : others) {
+      other.join();
+    }
+  };
+}
+
+// Writes from every producer at once. With producer slots, packets of 4kB or
+// more are copied unlocked, so the copies can overlap. Needs a core per
+// producer to be meaningful.
+bench_fn_t bench_a0_writer_parallel(int msg_size, int producers, uint8_t producer_slots) {
+  return [msg_size, producers, producer_slots](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    // Recreate the transport, with the producer slots.
+    memset(fixture.file.arena.buf.data, 0, fixture.file.arena.buf.size);
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.producer_slots = producer_slots;
+    a0_transport_t transport;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+
+    std::string src(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)src.data(), src.size()};
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> others;
+    for (int i = 1; i < producers; i++) {
+      others.emplace_back([&]() {
+        a0_writer_t w;
+        a0_writer_init(&w, fixture.file.arena);
+        while (!done) {
+          a0_writer_write(&w, pkt);
+        }
+        a0_writer_close(&w);
+      });
+    }
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+    for (auto&& _ : s) {
+      use(_);
+      a0_writer_write(&w, pkt);
+    }
+    a0_writer_close(&w);
+
+    done = true;
+    for (auto&& other : others) {
+      other.join();
+    }
+  };
+}
+
+// Commits while other threads poll the committed state through READONLY
+// transports, as lock-free subscribers do. Readers only touch the first header
+// cache line and the committed state page, so writer latency should not depend
+// on the number of readers. Needs a core per thread to be meaningful.
+bench_fn_t bench_a0_commit_polled(int msg_size, int readers) {
+  return [msg_size, readers](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_arena_t readonly_arena = fixture.file.arena;
+    readonly_arena.mode = A0_ARENA_MODE_READONLY;
+
+    std::string src(msg_size, 0);
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> others;
+    for (int i = 0; i < readers; i++) {
+      others.emplace_back([&]() {
+        a0_transport_t transport;
+        a0_transport_init(&transport, readonly_arena);
+        uint64_t seq_high = 0;
+        while (!done) {
+          a0_transport_locked_t lk;
+          a0_transport_lock(&transport, &lk);
+          a0_transport_seq_high(lk, &seq_high);
+          a0_transport_unlock(lk);
+        }
+        use(seq_high);
+      });
+    }
+
+    a0_transport_locked_t lk;
+    for (auto&& _ : s) {
+      use(_);
+      a0_transport_lock(&fixture.transport, &lk);
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, msg_size, &frame);
+      memcpy(frame->data, src.data(), msg_size);
+      a0_transport_commit(lk);
+      a0_transport_unlock(lk);
+    }
+
+    done = true;
+    for (auto&& other : others) {
+      other.join();
+    }
+  };
+}
+
+// Two threads take turns committing to the transport, each waiting for the
+// other's commit. Each iteration is a round trip of two lock handoffs and two
+// wakes. Spinning only helps if each thread has its own core.
+bench_fn_t bench_a0_ping_pong(uint32_t spin_ns) {
+  return [spin_ns](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.lock_spin_ns = spin_ns;
+    opts.wait_spin_ns = spin_ns;
+
+    struct turn_t {
+      a0_transport_locked_t* lk;
+      uint64_t seq;
+    };
+    auto turn_pred = [](turn_t* turn) {
+      return a0_predicate_t{
+          .user_data = turn,
+          .fn = [](void* user_data, bool* out) {
+            auto* turn = (turn_t*)user_data;
+            uint64_t seq_high;
+            a0_transport_seq_high(*turn->lk, &seq_high);
+            *out = seq_high >= turn->seq;
+            return A0_OK;
+          },
+      };
+    };
+
+    // Waits for the other thread to commit the given seq, then commits the next.
+    auto play = [&](a0_transport_locked_t* lk, uint64_t seq) {
+      turn_t turn = {lk, seq};
+      a0_transport_wait(*lk, turn_pred(&turn));
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(*lk, 8, &frame);
+      a0_transport_commit(*lk);
+    };
+
+    int iters = s.iterations();
+    std::thread pong([&]() {
+      a0_transport_t transport;
+      a0_transport_init_options(&transport, fixture.file.arena, opts);
+      a0_transport_locked_t lk;
+      a0_transport_lock(&transport, &lk);
+      for (int i = 0; i < iters; i++) {
+        play(&lk, 2 * i + 1);
+      }
+      a0_transport_unlock(lk);
+    });
+
+    a0_transport_t transport;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+    a0_transport_locked_t lk;
+    a0_transport_lock(&transport, &lk);
+    int i = 0;
+    for (auto&& _ : s) {
+      use(_);
+      play(&lk, 2 * i++);
+    }
+    a0_transport_unlock(lk);
+
+    pong.join();
+  };
+}
+
+// Commits a frame, then waits for a threaded reader to see it. Each iteration
+// is one wake of the reader. The busy-polling reader needs its own core; on
+// a shared core it only runs when the writer yields.
+bench_fn_t bench_a0_reader_wake(bool spin) {
+  return [spin](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    std::atomic<uint64_t> seen{0};
+    a0_zero_copy_callback_t onpacket = {
+        .user_data = &seen,
+        .fn = [](void* user_data, a0_transport_locked_t, a0_flat_packet_t) {
+          ((std::atomic<uint64_t>*)user_data)->fetch_add(1);
+        },
+    };
+
+    a0_reader_zc_t reader_zc;
+    a0_reader_spin_zc_t reader_spin_zc;
+    if (spin) {
+      a0_reader_spin_zc_init(&reader_spin_zc, fixture.file.arena, A0_READER_OPTIONS_DEFAULT, A0_TRANSPORT_POLL_RELAX, onpacket);
+    } else {
+      a0_reader_zc_init(&reader_zc, fixture.file.arena, A0_READER_OPTIONS_DEFAULT, onpacket);
+    }
+
+    uint64_t sent = 0;
+    a0_transport_locked_t lk;
+    for (auto&& _ : s) {
+      use(_);
+      a0_transport_lock(&fixture.transport, &lk);
+      a0_transport_frame_t* frame;
+      a0_transport_alloc(lk, 8, &frame);
+      a0_transport_commit(lk);
+      a0_transport_unlock(lk);
+
+      sent++;
+      while (seen < sent) {
+        std::this_thread::yield();
+      }
+    }
+
+    if (spin) {
+      a0_reader_spin_zc_close(&reader_spin_zc);
+    } else {
+      a0_reader_zc_close(&reader_zc);
+    }
+  };
+}
+
+// Catches up on a backlog of frames, either one lock per frame or up to 1024
+// frames per lock. Each iteration is one frame.
+bench_fn_t bench_a0_reader_catch_up(int msg_size, bool many) {
+  return [msg_size, many](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    a0_transport_locked_t lk;
+    a0_transport_lock(&fixture.transport, &lk);
+    for (int i = 0; i < s.iterations(); i++) {
+      a0_transport_frame_t* frame;
       a0_transport_alloc(lk, msg_size, &frame);
-      memcpy(frame.data, src.data(), msg_size);
+      a0_transport_commit(lk);
     }
     a0_transport_unlock(lk);
+
+    a0_reader_sync_zc_t reader;
+    a0_reader_sync_zc_init(&reader, fixture.file.arena, {A0_INIT_OLDEST, A0_ITER_NEXT, 0, {}});
+
+    uint64_t sum = 0;
+    a0_zero_copy_callback_t cb = {
+        .user_data = &sum,
+        .fn = [](void* user_data, a0_transport_locked_t, a0_flat_packet_t fpkt) {
+          *(uint64_t*)user_data += fpkt.buf.size;
+        },
+    };
+
+    size_t pending = 0;
+    for (auto&& _ : s) {
+      use(_);
+      if (!many) {
+        a0_reader_sync_zc_read(&reader, cb);
+        continue;
+      }
+      if (!pending) {
+        a0_reader_sync_zc_read_many(&reader, 1024, cb, &pending);
+      }
+      pending--;
+    }
+    use(sum);
+
+    a0_reader_sync_zc_close(&reader);
+  };
+}
+
+// Writes while a threaded zero-copy reader spends 10us on every frame. Without
+// a shared-reader slot, the callback holds the exclusive lock, and each write
+// waits for it. Needs a core per thread to be meaningful.
+bench_fn_t bench_a0_writer_slow_reader(int msg_size, uint8_t reader_slots) {
+  return [msg_size, reader_slots](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    // Recreate the transport, with the reader slots.
+    memset(fixture.file.arena.buf.data, 0, fixture.file.arena.buf.size);
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.reader_slots = reader_slots;
+    a0_transport_init_options(&transport, fixture.file.arena, opts);
+
+    a0_zero_copy_callback_t onpacket = {
+        .user_data = nullptr,
+        .fn = [](void*, a0_transport_locked_t, a0_flat_packet_t fpkt) {
+          use(fpkt);
+          a0_time_mono_t start, now;
+          a0_time_mono_now(&start);
+          do {
+            a0_time_mono_now(&now);
+          } while ((now.ts.tv_sec - start.ts.tv_sec) * 1000000000 + (now.ts.tv_nsec - start.ts.tv_nsec) < 10 * 1000);
+        },
+    };
+    a0_reader_zc_t reader_zc;
+    a0_reader_zc_init(&reader_zc, fixture.file.arena, A0_READER_OPTIONS_DEFAULT, onpacket);
+
+    std::string src(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)src.data(), src.size()};
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+    for (auto&& _ : s) {
+      use(_);
+      a0_writer_write(&w, pkt);
+    }
+    a0_writer_close(&w);
+
+    a0_reader_zc_close(&reader_zc);
+  };
+}
+
+// Reads a backlog of frames through the C++ ReaderSync, dropping each Packet
+// before the next read, so that its buffer is recycled.
+bench_fn_t bench_a0_cpp_reader_sync(int msg_size) {
+  return [msg_size](picobench::state& s) {
+    BenchFixture fixture;
+    (void)fixture;
+
+    std::string src(msg_size, 0);
+    a0_packet_t pkt;
+    a0_packet_init(&pkt);
+    pkt.payload = {(uint8_t*)src.data(), src.size()};
+
+    a0_writer_t w;
+    a0_writer_init(&w, fixture.file.arena);
+    for (int i = 0; i < s.iterations(); i++) {
+      a0_writer_write(&w, pkt);
+    }
+    a0_writer_close(&w);
+
+    a0::File file(BENCH_FILE);
+    a0::ReaderSync reader(file, a0::INIT_OLDEST);
+    for (auto&& _ : s) {
+      use(_);
+      use(reader.read().payload().size());
+    }
+  };
+}
+
+struct BenchPacket {
+  explicit BenchPacket(int num_hdrs) {
+    for (int i = 0; i < num_hdrs; i++) {
+      keys.push_back("a0_bench_key_" + std::to_string(i));
+      vals.push_back("a0_bench_val_" + std::to_string(i));
+    }
+    for (int i = 0; i < num_hdrs; i++) {
+      hdrs.push_back({keys[i].c_str(), vals[i].c_str()});
+    }
+    payload = std::string(64, 0);
+
+    a0_packet_init(&pkt);
+    pkt.headers_block = {hdrs.data(), hdrs.size(), nullptr};
+    pkt.payload = {(uint8_t*)payload.data(), payload.size()};
+  }
+
+  a0_err_t serialize(bool v2, a0_flat_packet_t* out) {
+    a0_alloc_t alloc = {
+        .user_data = &flat,
+        .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
+          auto* vec = (std::vector<uint8_t>*)user_data;
+          vec->resize(size);
+          *out = {vec->data(), size};
+          return A0_OK;
+        },
+        .dealloc = nullptr,
+    };
+    return v2 ? a0_packet_serialize_v2(pkt, alloc, out) : a0_packet_serialize(pkt, alloc, out);
+  }
+
+  std::vector<std::string> keys;
+  std::vector<std::string> vals;
+  std::vector<a0_packet_header_t> hdrs;
+  std::string payload;
+  std::vector<uint8_t> flat;
+  a0_packet_t pkt;
+};
+
+bench_fn_t bench_a0_packet_serialize(int num_hdrs, bool v2) {
+  return [num_hdrs, v2](picobench::state& s) {
+    BenchPacket bench_pkt(num_hdrs);
+    a0_flat_packet_t fpkt;
+    for (auto&& _ : s) {
+      use(_);
+      bench_pkt.serialize(v2, &fpkt);
+      use(fpkt);
+    }
+  };
+}
+
+bench_fn_t bench_a0_packet_deserialize(int num_hdrs, bool v2) {
+  return [num_hdrs, v2](picobench::state& s) {
+    BenchPacket bench_pkt(num_hdrs);
+    a0_flat_packet_t fpkt;
+    bench_pkt.serialize(v2, &fpkt);
+
+    std::vector<uint8_t> space;
+    a0_alloc_t alloc = {
+        .user_data = &space,
+        .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
+          auto* vec = (std::vector<uint8_t>*)user_data;
+          vec->resize(size);
+          *out = {vec->data(), size};
+          return A0_OK;
+        },
+        .dealloc = nullptr,
+    };
+
+    a0_packet_t pkt;
+    a0_buf_t buf;
+    for (auto&& _ : s) {
+      use(_);
+      a0_packet_deserialize(fpkt, alloc, &pkt, &buf);
+      use(pkt);
+    }
+  };
+}
+
+bench_fn_t bench_a0_flat_packet_lookup(int num_hdrs, bool v2) {
+  return [num_hdrs, v2](picobench::state& s) {
+    BenchPacket bench_pkt(num_hdrs);
+    a0_flat_packet_t fpkt;
+    bench_pkt.serialize(v2, &fpkt);
+
+    // The last header is the worst case for a linear scan.
+    std::string key = bench_pkt.keys.back();
+    for (auto&& _ : s) {
+      use(_);
+      a0_flat_packet_header_iterator_t iter;
+      a0_packet_header_t hdr;
+      a0_flat_packet_header_iterator_init(&iter, &fpkt);
+      a0_flat_packet_header_iterator_next_match(&iter, key.c_str(), &hdr);
+      use(hdr);
+    }
   };
 }
 
@@ -205,6 +972,203 @@ int main() {
         .iterations({suite.iter});
     r.add_benchmark("a0_alloc_memcpy", bench_a0_alloc_memcpy(suite.msg_size))
         .iterations({suite.iter});
+    r.add_benchmark("a0_alloc_memcpy_commit", bench_a0_alloc_memcpy_commit(suite.msg_size))
+        .iterations({suite.iter});
+
+    auto writer_group = suite.name + " : writer copy vs reserve";
+    r.set_suite(writer_group.c_str());
+    r.add_benchmark("a0_writer_write", bench_a0_writer_write(suite.msg_size))
+        .iterations({suite.iter / 10});
+    r.add_benchmark("a0_writer_reserve", bench_a0_writer_reserve(suite.msg_size))
+        .iterations({suite.iter / 10});
+
+    r.run();
+  }
+
+  struct mixed_suite {
+    std::string name;
+    int small_size;
+    int large_size;
+    int iter;
+  };
+  std::vector<mixed_suite> mixed_suites;
+  mixed_suites.push_back({"64B + 64kB msgs", 64, 64 * 1024, (int)1e4});
+  mixed_suites.push_back({"64B + 1MB msgs", 64, 1024 * 1024, (int)5e2});
+  mixed_suites.push_back({"1kB + 1MB msgs", 1024, 1024 * 1024, (int)2e3});
+
+  for (auto&& suite : mixed_suites) {
+    picobench::runner r;
+
+    auto mixed_group = suite.name + " : mixed-size writes";
+    r.set_suite(mixed_group.c_str());
+    r.add_benchmark("a0_write_mixed", bench_a0_write_mixed(suite.small_size, suite.large_size))
+        .iterations({suite.iter});
+
+    r.run();
+  }
+
+  struct burst_suite {
+    std::string name;
+    int msg_size;
+    int burst;
+    int iter;
+  };
+  std::vector<burst_suite> burst_suites;
+  burst_suites.push_back({"64B x 16 msgs", 64, 16, (int)1e5});
+  burst_suites.push_back({"64B x 256 msgs", 64, 256, (int)1e4});
+
+  for (auto&& suite : burst_suites) {
+    picobench::runner r;
+
+    auto burst_group = suite.name + " : writer bursts";
+    r.set_suite(burst_group.c_str());
+    r.add_benchmark("a0_writer_write", bench_a0_writer_burst(suite.msg_size, suite.burst))
+        .iterations({suite.iter});
+    r.add_benchmark("a0_writer_write_batch", bench_a0_writer_burst_batch(suite.msg_size, suite.burst))
+        .iterations({suite.iter});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("64B msgs : jump_seq");
+    r.add_benchmark("a0_jump_seq", bench_a0_jump_seq(64, 0)).iterations({(int)1e3});
+    r.add_benchmark("a0_jump_seq_indexed", bench_a0_jump_seq(64, 1 << 18)).iterations({(int)1e6});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("64B msgs : jump_time");
+    r.add_benchmark("a0_jump_time_scan", bench_a0_jump_time(64, false)).iterations({(int)1e3});
+    r.add_benchmark("a0_jump_time", bench_a0_jump_time(64, true)).iterations({(int)1e6});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    // One lap around a 256MB arena.
+    off_t lap_size = 256 * 1024 * 1024;
+    int lap_iter = lap_size / (64 * 1024 + 128);
+
+    r.set_suite("64kB msgs x 256MB arena : first lap vs steady state");
+    r.add_benchmark("a0_write_first_lap", bench_a0_write_lap(64 * 1024, lap_size, false, false))
+        .iterations({lap_iter});
+    r.add_benchmark("a0_write_first_lap_prefault", bench_a0_write_lap(64 * 1024, lap_size, true, false))
+        .iterations({lap_iter});
+    r.add_benchmark("a0_write_steady", bench_a0_write_lap(64 * 1024, lap_size, false, true))
+        .iterations({lap_iter});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("1kB msgs x 4 producers : writes during slow reserved fills");
+    r.add_benchmark("a0_writer_write_locked", bench_a0_writer_contended(1024, 4, 0)).iterations({(int)1e4});
+    r.add_benchmark("a0_writer_write_producer_slots", bench_a0_writer_contended(1024, 4, 4))
+        .iterations({(int)1e4});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("16kB msgs x 4 producers : concurrent writes");
+    r.add_benchmark("a0_writer_write_locked", bench_a0_writer_parallel(16 * 1024, 4, 0)).iterations({(int)1e4});
+    r.add_benchmark("a0_writer_write_producer_slots", bench_a0_writer_parallel(16 * 1024, 4, 4))
+        .iterations({(int)1e4});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("64B msgs : commit with polling readers");
+    r.add_benchmark("a0_commit", bench_a0_commit_polled(64, 0)).iterations({(int)1e6});
+    r.add_benchmark("a0_commit_1_reader", bench_a0_commit_polled(64, 1)).iterations({(int)1e6});
+    r.add_benchmark("a0_commit_4_readers", bench_a0_commit_polled(64, 4)).iterations({(int)1e6});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("ping pong : spin before sleeping");
+    r.add_benchmark("a0_no_spin", bench_a0_ping_pong(0)).iterations({(int)1e4});
+    r.add_benchmark("a0_spin_2us", bench_a0_ping_pong(2 * 1000)).iterations({(int)1e4});
+    r.add_benchmark("a0_spin_20us", bench_a0_ping_pong(20 * 1000)).iterations({(int)1e4});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("reader wake : futex vs busy poll");
+    r.add_benchmark("a0_reader_zc", bench_a0_reader_wake(false)).iterations({(int)1e3});
+    r.add_benchmark("a0_reader_spin_zc", bench_a0_reader_wake(true)).iterations({(int)1e3});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("64B msgs : writes beside a slow zero-copy reader");
+    r.add_benchmark("a0_writer_write", bench_a0_writer_slow_reader(64, 0)).iterations({(int)1e4});
+    r.add_benchmark("a0_writer_write_leased", bench_a0_writer_slow_reader(64, 1)).iterations({(int)1e4});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("64B msgs : reader catch-up");
+    r.add_benchmark("a0_reader_sync_zc_read", bench_a0_reader_catch_up(64, false)).iterations({(int)1e5});
+    r.add_benchmark("a0_reader_sync_zc_read_many", bench_a0_reader_catch_up(64, true)).iterations({(int)1e5});
+
+    r.run();
+  }
+
+  {
+    picobench::runner r;
+
+    r.set_suite("cpp reader_sync : pooled packet buffers");
+    r.add_benchmark("64B", bench_a0_cpp_reader_sync(64)).iterations({(int)2e4});
+    r.add_benchmark("10kB", bench_a0_cpp_reader_sync(10 * 1024)).iterations({(int)1e3});
+
+    r.run();
+  }
+
+  for (int num_hdrs : {4, 32}) {
+    picobench::runner r;
+
+    auto serialize_group = std::to_string(num_hdrs) + " headers : packet serialize";
+    r.set_suite(serialize_group.c_str());
+    r.add_benchmark("a0_packet_serialize", bench_a0_packet_serialize(num_hdrs, false)).iterations({(int)1e6});
+    r.add_benchmark("a0_packet_serialize_v2", bench_a0_packet_serialize(num_hdrs, true)).iterations({(int)1e6});
+
+    auto deserialize_group = std::to_string(num_hdrs) + " headers : packet deserialize";
+    r.set_suite(deserialize_group.c_str());
+    r.add_benchmark("a0_packet_deserialize", bench_a0_packet_deserialize(num_hdrs, false)).iterations({(int)1e6});
+    r.add_benchmark("a0_packet_deserialize_v2", bench_a0_packet_deserialize(num_hdrs, true)).iterations({(int)1e6});
+
+    auto lookup_group = std::to_string(num_hdrs) + " headers : flat packet header lookup";
+    r.set_suite(lookup_group.c_str());
+    r.add_benchmark("a0_flat_packet_next_match", bench_a0_flat_packet_lookup(num_hdrs, false)).iterations({(int)1e6});
+    r.add_benchmark("a0_flat_packet_next_match_v2", bench_a0_flat_packet_lookup(num_hdrs, true)).iterations({(int)1e6});
 
     r.run();
   }
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <a0/alloc.h>
+#include <a0/buf.h>
+#include <a0/err.h>
+#include <a0/packet.h>
+#include <a0/packet.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "err_macro.h"
+
+namespace a0 {
+namespace details {
+
+// Recycles the buffers that the C++ wrappers deserialize packets into.
+//
+// Buffers are grouped into power-of-two size classes, from 64B to 4MB. A
+// released buffer is kept for reuse within its class, up to 1MB of idle
+// buffers per class, and at least two. Larger buffers are not pooled.
+class BufferPool {
+ public:
+  struct Block {
+    uint8_t* data;
+    size_t cap;
+  };
+
+  // Never destroyed, since packets may be released during static destruction.
+  static BufferPool& global() {
+    static BufferPool* pool = new BufferPool;
+    return *pool;
+  }
+
+  // Holds the state of Packets. Kept apart from the buffers, so that it never
+  // displaces a recently released buffer.
+  static BufferPool& packet_state() {
+    static BufferPool* pool = new BufferPool;
+    return *pool;
+  }
+
+  // Returns a block of at least the given size. The data is NULL if out of memory.
+  Block acquire(size_t size) {
+    size_t shift = class_shift(size);
+    if (shift > kMaxShift) {
+      return {(uint8_t*)malloc(size), size};
+    }
+
+    Class& cls = classes_[shift - kMinShift];
+    {
+      std::unique_lock<std::mutex> lk{cls.mu};
+      if (!cls.free.empty()) {
+        Block block = cls.free.back();
+        cls.free.pop_back();
+        return block;
+      }
+    }
+
+    size_t cap = size_t(1) << shift;
+    return {(uint8_t*)malloc(cap), cap};
+  }
+
+  void release(Block block) {
+    if (!block.data) {
+      return;
+    }
+
+    size_t shift = class_shift(block.cap);
+    if (shift <= kMaxShift && block.cap == size_t(1) << shift) {
+      Class& cls = classes_[shift - kMinShift];
+      std::unique_lock<std::mutex> lk{cls.mu};
+      // The free list was reserved up front, so this never allocates.
+      if (cls.free.size() < cls.free.capacity()) {
+        cls.free.push_back(block);
+        return;
+      }
+    }
+    free(block.data);
+  }
+
+  // Releases a block acquired for the given size.
+  void release(uint8_t* data, size_t size) {
+    size_t shift = class_shift(size);
+    release({data, shift > kMaxShift ? size : size_t(1) << shift});
+  }
+
+ private:
+  static constexpr size_t kMinShift = 6;
+  static constexpr size_t kMaxShift = 22;
+  static constexpr size_t kClassBudget = 1 << 20;
+
+  struct Class {
+    std::mutex mu;
+    std::vector<Block> free;
+  };
+
+  Class classes_[kMaxShift - kMinShift + 1];
+
+  BufferPool() {
+    for (size_t shift = kMinShift; shift <= kMaxShift; shift++) {
+      size_t max_free = kClassBudget >> shift;
+      classes_[shift - kMinShift].free.reserve(max_free < 2 ? 2 : max_free);
+    }
+  }
+
+  static size_t class_shift(size_t size) {
+    if (size <= (size_t(1) << kMinShift)) {
+      return kMinShift;
+    }
+    return 64 - __builtin_clzll(size - 1);
+  }
+};
+
+// Wraps a packet whose headers and payload are owned by the deleter. Unlike
+// the Packet constructor, the headers are not copied. Defined in packet.cpp.
+Packet adopt_packet(a0_packet_t, std::function<void(a0_packet_t*)> deleter);
+
+// A pooled buffer, that a packet is deserialized into before a Packet takes it.
+class PacketBuffer {
+ public:
+  PacketBuffer() = default;
+  PacketBuffer(const PacketBuffer&) = delete;
+  PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+  ~PacketBuffer() {
+    BufferPool::global().release(block_);
+  }
+
+  // Matches the signature of a0_alloc_t::alloc.
+  a0_err_t alloc(size_t size, a0_buf_t* out) {
+    if (block_.cap < size) {
+      BufferPool::global().release(block_);
+      block_ = BufferPool::global().acquire(size);
+      if (!block_.data) {
+        block_ = {nullptr, 0};
+        return A0_MAKE_SYSERR(ENOMEM);
+      }
+    }
+    *out = {block_.data, size};
+    return A0_OK;
+  }
+
+  // Hands the buffer to a Packet. It returns to the pool when the last copy
+  // of the Packet is dropped.
+  Packet take(a0_packet_t pkt) {
+    BufferPool::Block block = block_;
+    block_ = {nullptr, 0};
+    return adopt_packet(pkt, [block](a0_packet_t*) { BufferPool::global().release(block); });
+  }
+
+  void swap(PacketBuffer& other) {
+    std::swap(block_, other.block_);
+  }
+
+ private:
+  BufferPool::Block block_{nullptr, 0};
+};
+
+inline a0_alloc_t packet_buffer_alloc(PacketBuffer* buffer) {
+  return a0_alloc_t{
+      .user_data = buffer,
+      .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
+        return ((PacketBuffer*)user_data)->alloc(size, out);
+      },
+      .dealloc = nullptr,
+  };
+}
+
+}  // namespace details
+}  // namespace a0
@@ -1,9 +1,20 @@
 #pragma once
 
+#include <a0/executor.h>
+#include <a0/executor.hpp>
 #include <a0/file.h>
 #include <a0/file.hpp>
+#include <a0/packet.hpp>
 #include <a0/reader.h>
 #include <a0/reader.hpp>
+#include <a0/writer.h>
+#include <a0/writer.hpp>
+
+#include <cstdint>
+#include <functional>
+
+#include "buffer_pool.hpp"
+#include "c_wrap.hpp"
 
 namespace a0 {
 namespace {  // NOLINT(google-build-namespaces)
@@ -14,9 +25,14 @@ inline a0_file_options_t c_fileopts(File::Options opts) {
           .size = opts.create_options.size,
           .mode = opts.create_options.mode,
           .dir_mode = opts.create_options.dir_mode,
+          .fallocate = opts.create_options.fallocate,
       },
       .open_options = {
           .arena_mode = opts.open_options.arena_mode,
+          .populate = opts.open_options.populate,
+          .hugepage = opts.open_options.hugepage,
+          .lock = opts.open_options.lock,
+          .reserve_size = opts.open_options.reserve_size,
       },
   };
 }
@@ -25,8 +41,39 @@ inline a0_reader_options_t c_readeropts(Reader::Options opts) {
   return {
       .init = (a0_reader_init_t)opts.init,
       .iter = (a0_reader_iter_t)opts.iter,
+      .seq = opts.seq,
+      .since = opts.since.c ? *opts.since.c : a0_time_mono_t{},
+  };
+}
+
+inline a0_writer_options_t c_writeropts(Writer::Options opts) {
+  return {
+      .packet_version = opts.packet_version,
   };
 }
 
+// The dispatch must outlive the returned struct.
+inline a0_executor_dispatch_t c_dispatch(Dispatch* dispatch) {
+  a0_executor_dispatch_t c_dispatch = {};
+  c_dispatch.executor = dispatch->executor.c.get();
+  if (dispatch->key) {
+    c_dispatch.key = {
+        .user_data = &dispatch->key,
+        .fn = [](void* user_data, a0_flat_packet_t fpkt, uint64_t* key) {
+          auto* fn = (std::function<bool(FlatPacket, uint64_t*)>*)user_data;
+          return (*fn)(cpp_wrap<FlatPacket>(fpkt), key);
+        },
+    };
+  }
+  return c_dispatch;
+}
+
+// Buffer that packets are deserialized into, before the callback takes it.
+// Per thread, since dispatched packets may be deserialized on several workers at once.
+inline details::PacketBuffer* deserialize_buffer() {
+  thread_local details::PacketBuffer data;
+  return &data;
+}
+
 }  // namespace
 }  // namespace a0
@@ -133,7 +133,7 @@ CPP cpp_wrap(typename CPP::c_type* c) {
 }
 
 template <typename T>
-void check(const std::string& fn_name, const details::CppWrap<T>* cpp_obj) {
+void check(const char* fn_name, const details::CppWrap<T>* cpp_obj) {
   if (!cpp_obj || !cpp_obj->c) {
     auto msg = std::string("AlephZero method called with NULL object: ") + fn_name;
     fprintf(stderr, "%s\n", msg.c_str());
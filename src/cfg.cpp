@@ -17,6 +17,7 @@
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_opts.hpp"
 #include "c_wrap.hpp"
 
@@ -57,22 +58,11 @@ Cfg::Cfg(CfgTopic topic) {
 
 A0_STATIC_INLINE
 Packet Cfg_read(std::function<a0_err_t(a0_alloc_t, a0_packet_t*)> fn) {
-  auto data = std::make_shared<std::vector<uint8_t>>();
-
-  a0_alloc_t alloc = {
-      .user_data = data.get(),
-      .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-        auto* data = (std::vector<uint8_t>*)user_data;
-        data->resize(size);
-        *out = {data->data(), size};
-        return A0_OK;
-      },
-      .dealloc = nullptr,
-  };
+  details::PacketBuffer data;
 
   a0_packet_t pkt;
-  check(fn(alloc, &pkt));
-  return Packet(pkt, [data](a0_packet_t*) {});
+  check(fn(details::packet_buffer_alloc(&data), &pkt));
+  return data.take(pkt);
 }
 
 Packet Cfg::read() const {
@@ -134,7 +124,7 @@ void Cfg::update_var() {
 namespace {
 
 struct CfgWatcherImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
   std::function<void(Packet)> onpacket;
 
 #ifdef A0_EXT_NLOHMANN
@@ -157,24 +147,13 @@ CfgWatcher::CfgWatcher(
         auto cfo = c_fileopts(topic.file_opts);
         a0_cfg_topic_t c_topic{topic.name.c_str(), &cfo};
 
-        a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (CfgWatcherImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
-            },
-            .dealloc = nullptr,
-        };
+        a0_alloc_t alloc = details::packet_buffer_alloc(&impl->data);
 
         a0_packet_callback_t c_onpacket = {
             .user_data = impl,
             .fn = [](void* user_data, a0_packet_t pkt) {
               auto* impl = (CfgWatcherImpl*)user_data;
-              auto data = std::make_shared<std::vector<uint8_t>>();
-              std::swap(*data, impl->data);
-              impl->onpacket(Packet(pkt, [data](a0_packet_t*) {}));
+              impl->onpacket(impl->data.take(pkt));
             }};
 
         return a0_cfg_watcher_init(c, c_topic, alloc, c_onpacket);
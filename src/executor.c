@@ -0,0 +1,428 @@
+#include <a0/callback.h>
+#include <a0/cmp.h>
+#include <a0/empty.h>
+#include <a0/err.h>
+#include <a0/executor.h>
+#include <a0/inline.h>
+#include <a0/mtx.h>
+#include <a0/packet.h>
+#include <a0/thread_local.h>
+#include <a0/unused.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "err_macro.h"
+
+const a0_executor_options_t A0_EXECUTOR_OPTIONS_DEFAULT = {
+    .threads = 0,
+};
+
+// Number of lanes for ordered tasks. A power of two.
+#define A0_EXECUTOR_LANES 256
+// Most tasks a lane runs before yielding its worker.
+#define A0_EXECUTOR_LANE_BATCH 16
+
+typedef struct a0_executor_node_s {
+  a0_executor_task_t task;
+  // Set for the node that runs a lane.
+  a0_executor_lane_t* lane;
+  struct a0_executor_node_s* next;
+} a0_executor_node_t;
+
+typedef struct a0_executor_queue_s {
+  a0_executor_node_t* head;
+  a0_executor_node_t* tail;
+} a0_executor_queue_t;
+
+struct a0_executor_worker_s {
+  a0_executor_t* executor;
+  uint32_t idx;
+  pthread_t thread;
+
+  pthread_mutex_t mu;
+  a0_executor_queue_t queue;
+
+  uint64_t stolen;
+};
+
+// Ordered tasks wait in a lane. The lane is queued on a worker, as a single
+// node, while it has tasks, so its tasks never run concurrently.
+struct a0_executor_lane_s {
+  pthread_mutex_t mu;
+  a0_executor_queue_t queue;
+  bool scheduled;
+  a0_executor_node_t runner;
+};
+
+// The worker run by the current thread, if any.
+static A0_THREAD_LOCAL a0_executor_worker_t* a0_executor_current_worker = NULL;
+
+A0_STATIC_INLINE
+void a0_executor_queue_push(a0_executor_queue_t* queue, a0_executor_node_t* node) {
+  node->next = NULL;
+  if (queue->tail) {
+    queue->tail->next = node;
+  } else {
+    queue->head = node;
+  }
+  queue->tail = node;
+}
+
+A0_STATIC_INLINE
+a0_executor_node_t* a0_executor_queue_pop(a0_executor_queue_t* queue) {
+  a0_executor_node_t* node = queue->head;
+  if (node) {
+    queue->head = node->next;
+    if (!queue->head) {
+      queue->tail = NULL;
+    }
+  }
+  return node;
+}
+
+A0_STATIC_INLINE
+void a0_executor_group_add(a0_executor_group_t* group) {
+  a0_err_t err = a0_mtx_lock(&group->_mtx);
+  if (a0_mtx_lock_successful(err)) {
+    group->_pending++;
+    a0_mtx_unlock(&group->_mtx);
+  }
+}
+
+A0_STATIC_INLINE
+void a0_executor_group_done(a0_executor_group_t* group) {
+  a0_err_t err = a0_mtx_lock(&group->_mtx);
+  if (a0_mtx_lock_successful(err)) {
+    if (!--group->_pending) {
+      a0_cnd_broadcast(&group->_cnd, &group->_mtx);
+    }
+    a0_mtx_unlock(&group->_mtx);
+  }
+}
+
+a0_err_t a0_executor_group_wait(a0_executor_group_t* group) {
+  a0_err_t err = a0_mtx_lock(&group->_mtx);
+  if (!a0_mtx_lock_successful(err)) {
+    return err;
+  }
+  err = A0_OK;
+  while (!err && group->_pending) {
+    err = a0_cnd_wait(&group->_cnd, &group->_mtx);
+  }
+  a0_mtx_unlock(&group->_mtx);
+  return err;
+}
+
+// Queues a node on a worker, and wakes an idle worker to take it.
+A0_STATIC_INLINE
+void a0_executor_schedule(a0_executor_t* executor, a0_executor_node_t* node) {
+  a0_executor_worker_t* worker = a0_executor_current_worker;
+  if (!worker || worker->executor != executor) {
+    uint32_t idx = a0_atomic_fetch_add(&executor->_next_worker, 1) % executor->_opts.threads;
+    worker = &executor->_workers[idx];
+  }
+
+  pthread_mutex_lock(&worker->mu);
+  a0_atomic_add_fetch(&executor->_runnable, 1);
+  a0_executor_queue_push(&worker->queue, node);
+  pthread_mutex_unlock(&worker->mu);
+
+  pthread_mutex_lock(&executor->_idle_mu);
+  if (executor->_idle_cnt) {
+    pthread_cond_signal(&executor->_idle_cnd);
+  }
+  pthread_mutex_unlock(&executor->_idle_mu);
+}
+
+A0_STATIC_INLINE
+void a0_executor_run_task(a0_executor_t* executor, a0_executor_task_t task) {
+  a0_atomic_add_fetch(&executor->_queue_depth, -1);
+  a0_callback_call(task.fn);
+  a0_atomic_add_fetch(&executor->_executed, 1);
+  if (task.group) {
+    a0_executor_group_done(task.group);
+  }
+}
+
+A0_STATIC_INLINE
+void a0_executor_run_lane(a0_executor_t* executor, a0_executor_lane_t* lane) {
+  for (int i = 0; i < A0_EXECUTOR_LANE_BATCH; i++) {
+    pthread_mutex_lock(&lane->mu);
+    a0_executor_node_t* node = a0_executor_queue_pop(&lane->queue);
+    if (!node) {
+      lane->scheduled = false;
+      pthread_mutex_unlock(&lane->mu);
+      return;
+    }
+    pthread_mutex_unlock(&lane->mu);
+
+    a0_executor_run_task(executor, node->task);
+    free(node);
+  }
+
+  // Let other work run before the rest of the lane.
+  a0_executor_schedule(executor, &lane->runner);
+}
+
+A0_STATIC_INLINE
+a0_executor_node_t* a0_executor_take(a0_executor_worker_t* worker) {
+  pthread_mutex_lock(&worker->mu);
+  a0_executor_node_t* node = a0_executor_queue_pop(&worker->queue);
+  if (node) {
+    a0_atomic_add_fetch(&worker->executor->_runnable, -1);
+  }
+  pthread_mutex_unlock(&worker->mu);
+  return node;
+}
+
+A0_STATIC_INLINE
+a0_executor_node_t* a0_executor_steal(a0_executor_worker_t* worker) {
+  a0_executor_t* executor = worker->executor;
+  for (uint32_t i = 1; i < executor->_opts.threads; i++) {
+    a0_executor_worker_t* victim = &executor->_workers[(worker->idx + i) % executor->_opts.threads];
+    a0_executor_node_t* node = a0_executor_take(victim);
+    if (node) {
+      a0_atomic_add_fetch(&worker->stolen, 1);
+      return node;
+    }
+  }
+  return NULL;
+}
+
+static void* a0_executor_worker_main(void* data) {
+  a0_executor_worker_t* worker = (a0_executor_worker_t*)data;
+  a0_executor_t* executor = worker->executor;
+  a0_executor_current_worker = worker;
+
+  while (true) {
+    a0_executor_node_t* node = a0_executor_take(worker);
+    if (!node) {
+      node = a0_executor_steal(worker);
+    }
+
+    if (node) {
+      if (node->lane) {
+        a0_executor_run_lane(executor, node->lane);
+      } else {
+        a0_executor_run_task(executor, node->task);
+        free(node);
+      }
+      continue;
+    }
+
+    // Sleep unless a node was queued since the take and steal. Tasks waiting
+    // behind a running lane are not runnable; its worker requeues the lane.
+    pthread_mutex_lock(&executor->_idle_mu);
+    if (!a0_atomic_load(&executor->_runnable)) {
+      if (executor->_shutdown) {
+        pthread_mutex_unlock(&executor->_idle_mu);
+        break;
+      }
+      executor->_idle_cnt++;
+      pthread_cond_wait(&executor->_idle_cnd, &executor->_idle_mu);
+      executor->_idle_cnt--;
+    }
+    pthread_mutex_unlock(&executor->_idle_mu);
+  }
+
+  return NULL;
+}
+
+a0_err_t a0_executor_init(a0_executor_t* executor, a0_executor_options_t opts) {
+  *executor = (a0_executor_t)A0_EMPTY;
+  if (!opts.threads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.threads = cpus > 0 ? (uint32_t)cpus : 1;
+  }
+  executor->_opts = opts;
+
+  executor->_workers = (a0_executor_worker_t*)calloc(opts.threads, sizeof(a0_executor_worker_t));
+  executor->_lanes = (a0_executor_lane_t*)calloc(A0_EXECUTOR_LANES, sizeof(a0_executor_lane_t));
+  if (!executor->_workers || !executor->_lanes) {
+    free(executor->_workers);
+    free(executor->_lanes);
+    return A0_MAKE_SYSERR(ENOMEM);
+  }
+
+  pthread_mutex_init(&executor->_idle_mu, NULL);
+  pthread_cond_init(&executor->_idle_cnd, NULL);
+
+  for (uint32_t i = 0; i < A0_EXECUTOR_LANES; i++) {
+    a0_executor_lane_t* lane = &executor->_lanes[i];
+    pthread_mutex_init(&lane->mu, NULL);
+    lane->runner.lane = lane;
+  }
+
+  for (uint32_t i = 0; i < opts.threads; i++) {
+    a0_executor_worker_t* worker = &executor->_workers[i];
+    worker->executor = executor;
+    worker->idx = i;
+    pthread_mutex_init(&worker->mu, NULL);
+  }
+  uint32_t started = 0;
+  int create_err = 0;
+  for (; started < opts.threads; started++) {
+    create_err = pthread_create(&executor->_workers[started].thread, NULL, a0_executor_worker_main, &executor->_workers[started]);
+    if (create_err) {
+      break;
+    }
+  }
+  if (!create_err) {
+    return A0_OK;
+  }
+
+  // Unwind the workers that did start.
+  pthread_mutex_lock(&executor->_idle_mu);
+  executor->_shutdown = true;
+  pthread_cond_broadcast(&executor->_idle_cnd);
+  pthread_mutex_unlock(&executor->_idle_mu);
+
+  for (uint32_t i = 0; i < started; i++) {
+    pthread_join(executor->_workers[i].thread, NULL);
+  }
+  for (uint32_t i = 0; i < opts.threads; i++) {
+    pthread_mutex_destroy(&executor->_workers[i].mu);
+  }
+  for (uint32_t i = 0; i < A0_EXECUTOR_LANES; i++) {
+    pthread_mutex_destroy(&executor->_lanes[i].mu);
+  }
+  pthread_cond_destroy(&executor->_idle_cnd);
+  pthread_mutex_destroy(&executor->_idle_mu);
+
+  free(executor->_workers);
+  free(executor->_lanes);
+  *executor = (a0_executor_t)A0_EMPTY;
+  return A0_MAKE_SYSERR(create_err);
+}
+
+a0_err_t a0_executor_close(a0_executor_t* executor) {
+  A0_ASSERT(executor, "Cannot close null executor.");
+
+  a0_executor_worker_t* worker = a0_executor_current_worker;
+  if (worker && worker->executor == executor) {
+    return A0_MAKE_SYSERR(EDEADLK);
+  }
+
+  pthread_mutex_lock(&executor->_idle_mu);
+  executor->_shutdown = true;
+  pthread_cond_broadcast(&executor->_idle_cnd);
+  pthread_mutex_unlock(&executor->_idle_mu);
+
+  for (uint32_t i = 0; i < executor->_opts.threads; i++) {
+    pthread_join(executor->_workers[i].thread, NULL);
+    pthread_mutex_destroy(&executor->_workers[i].mu);
+  }
+  for (uint32_t i = 0; i < A0_EXECUTOR_LANES; i++) {
+    pthread_mutex_destroy(&executor->_lanes[i].mu);
+  }
+  pthread_cond_destroy(&executor->_idle_cnd);
+  pthread_mutex_destroy(&executor->_idle_mu);
+
+  free(executor->_workers);
+  free(executor->_lanes);
+  executor->_workers = NULL;
+  executor->_lanes = NULL;
+  return A0_OK;
+}
+
+a0_err_t a0_executor_submit(a0_executor_t* executor, a0_executor_task_t task) {
+  A0_ASSERT(executor, "Cannot submit to null executor.");
+
+  a0_executor_node_t* node = (a0_executor_node_t*)malloc(sizeof(a0_executor_node_t));
+  if (!node) {
+    return A0_MAKE_SYSERR(ENOMEM);
+  }
+  node->task = task;
+  node->lane = NULL;
+
+  if (task.group) {
+    a0_executor_group_add(task.group);
+  }
+
+  a0_atomic_add_fetch(&executor->_submitted, 1);
+  size_t depth = a0_atomic_add_fetch(&executor->_queue_depth, 1);
+  size_t max_depth = a0_atomic_load(&executor->_max_queue_depth);
+  while (depth > max_depth && !a0_cas(&executor->_max_queue_depth, max_depth, depth)) {
+    max_depth = a0_atomic_load(&executor->_max_queue_depth);
+  }
+
+  if (!task.ordered) {
+    a0_executor_schedule(executor, node);
+    return A0_OK;
+  }
+
+  // Fibonacci hashing spreads sequential keys across lanes.
+  a0_executor_lane_t* lane = &executor->_lanes[(task.key * 0x9E3779B97F4A7C15ull) >> 56];
+  pthread_mutex_lock(&lane->mu);
+  a0_executor_queue_push(&lane->queue, node);
+  bool schedule = !lane->scheduled;
+  lane->scheduled = true;
+  pthread_mutex_unlock(&lane->mu);
+
+  if (schedule) {
+    a0_executor_schedule(executor, &lane->runner);
+  }
+  return A0_OK;
+}
+
+a0_err_t a0_executor_stats(a0_executor_t* executor, a0_executor_stats_t* out) {
+  A0_ASSERT(executor, "Cannot read stats of null executor.");
+
+  *out = (a0_executor_stats_t)A0_EMPTY;
+  out->submitted = a0_atomic_load(&executor->_submitted);
+  out->executed = a0_atomic_load(&executor->_executed);
+  out->queue_depth = a0_atomic_load(&executor->_queue_depth);
+  out->max_queue_depth = a0_atomic_load(&executor->_max_queue_depth);
+  for (uint32_t i = 0; i < executor->_opts.threads; i++) {
+    out->stolen += a0_atomic_load(&executor->_workers[i].stolen);
+  }
+  return A0_OK;
+}
+
+//////////////////
+//  Dispatch    //
+//////////////////
+
+A0_STATIC_INLINE
+bool a0_packet_key_header_fn(void* user_data, a0_flat_packet_t fpkt, uint64_t* key) {
+  a0_flat_packet_header_iterator_t iter;
+  a0_flat_packet_header_iterator_init(&iter, &fpkt);
+  a0_packet_header_t hdr;
+  if (a0_flat_packet_header_iterator_next_match(&iter, (const char*)user_data, &hdr)) {
+    return false;
+  }
+
+  size_t hash;
+  a0_hash_eval(A0_HASH_STR, &hdr.val, &hash);
+  *key = hash;
+  return true;
+}
+
+a0_packet_key_callback_t a0_packet_key_header(const char* name) {
+  return (a0_packet_key_callback_t){
+      .user_data = (void*)name,
+      .fn = a0_packet_key_header_fn,
+  };
+}
+
+A0_STATIC_INLINE
+bool a0_packet_key_all_fn(void* user_data, a0_flat_packet_t fpkt, uint64_t* key) {
+  A0_MAYBE_UNUSED(user_data);
+  A0_MAYBE_UNUSED(fpkt);
+  *key = 0;
+  return true;
+}
+
+a0_packet_key_callback_t a0_packet_key_all(void) {
+  return (a0_packet_key_callback_t){
+      .user_data = NULL,
+      .fn = a0_packet_key_all_fn,
+  };
+}
@@ -0,0 +1,96 @@
+#include <a0/empty.h>
+#include <a0/executor.h>
+#include <a0/executor.hpp>
+#include <a0/packet.h>
+#include <a0/packet.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "c_wrap.hpp"
+
+namespace a0 {
+
+Executor::Options Executor::Options::DEFAULT = {
+    .threads = A0_EXECUTOR_OPTIONS_DEFAULT.threads,
+};
+
+Executor::Executor(Options opts) {
+  set_c(
+      &c,
+      [&](a0_executor_t* c) {
+        a0_executor_options_t c_opts{
+            .threads = opts.threads,
+        };
+        return a0_executor_init(c, c_opts);
+      },
+      a0_executor_close);
+}
+
+namespace {
+
+void submit_impl(a0_executor_t* c, bool ordered, uint64_t key, std::function<void()> fn) {
+  auto* heap_fn = new std::function<void()>(std::move(fn));
+
+  a0_executor_task_t task = A0_EMPTY;
+  task.fn = a0_callback_t{
+      .user_data = heap_fn,
+      .fn = [](void* user_data) {
+        std::unique_ptr<std::function<void()>> fn((std::function<void()>*)user_data);
+        (*fn)();
+        return A0_OK;
+      },
+  };
+  task.ordered = ordered;
+  task.key = key;
+
+  auto err = a0_executor_submit(c, task);
+  if (err) {
+    delete heap_fn;
+  }
+  check(err);
+}
+
+}  // namespace
+
+void Executor::submit(std::function<void()> fn) {
+  CHECK_C;
+  submit_impl(&*c, false, 0, std::move(fn));
+}
+
+void Executor::submit(uint64_t key, std::function<void()> fn) {
+  CHECK_C;
+  submit_impl(&*c, true, key, std::move(fn));
+}
+
+Executor::Stats Executor::stats() {
+  CHECK_C;
+  a0_executor_stats_t c_stats;
+  check(a0_executor_stats(&*c, &c_stats));
+  return Stats{
+      .submitted = c_stats.submitted,
+      .executed = c_stats.executed,
+      .stolen = c_stats.stolen,
+      .queue_depth = c_stats.queue_depth,
+      .max_queue_depth = c_stats.max_queue_depth,
+  };
+}
+
+Dispatch Dispatch::by_header(Executor executor, std::string header) {
+  return Dispatch(executor, [header](FlatPacket fpkt, uint64_t* key) {
+    auto c_key = a0_packet_key_header(header.c_str());
+    return c_key.fn(c_key.user_data, *fpkt.c, key);
+  });
+}
+
+Dispatch Dispatch::in_order(Executor executor) {
+  return Dispatch(executor, [](FlatPacket, uint64_t* key) {
+    *key = 0;
+    return true;
+  });
+}
+
+}  // namespace a0
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -28,6 +29,13 @@
 #include "ref_cnt.h"
 #endif
 
+#ifndef F_OFD_SETLK
+// Open file description locks, from Linux 3.15. glibc only declares them
+// under _GNU_SOURCE.
+#define F_OFD_GETLK 36
+#define F_OFD_SETLK 37
+#endif
+
 A0_STATIC_INLINE
 a0_err_t a0_mkdir(const char* path, mode_t mode) {
   stat_t st;
@@ -138,11 +146,23 @@ a0_err_t a0_mktmp(const char* dir, a0_file_create_options_t opts, a0_file_t* fil
 
   file->path = path;
 
+  a0_err_t err = A0_OK;
   if (fchmod(file->fd, opts.mode) == -1 ||
-      ftruncate(file->fd, opts.size) == -1 ||
-      fstat(file->fd, &file->stat) == -1) {
-    a0_err_t err = A0_MAKE_SYSERR(errno);
+      ftruncate(file->fd, opts.size) == -1) {
+    err = A0_MAKE_SYSERR(errno);
+  }
+  if (!err && opts.fallocate) {
+    // posix_fallocate returns the error, rather than setting errno.
+    int fallocate_err = posix_fallocate(file->fd, 0, opts.size);
+    if (fallocate_err) {
+      err = A0_MAKE_SYSERR(fallocate_err);
+    }
+  }
+  if (!err && fstat(file->fd, &file->stat) == -1) {
+    err = A0_MAKE_SYSERR(errno);
+  }
 
+  if (err) {
     close(file->fd);
     file->fd = -1;
 
@@ -167,28 +187,129 @@ a0_err_t a0_tmp_move(a0_file_t* file, const char* path) {
   return err;
 }
 
+// The mapping covers the reserved address space, past the end of the file.
+// Pages past the end are only touched after the file has grown to cover them.
+A0_STATIC_INLINE
+size_t a0_file_reserved_size(a0_file_t* file) {
+  return file->arena.capacity;
+}
+
+// Faults in every page of the region, in case the kernel cannot populate it for us.
+//
+// Shared mappings are touched with a no-op atomic write, so pages are mapped
+// writable and the first real write does not fault again. Private mappings are
+// only read, so they are not copied.
+static void a0_file_prefault(uint8_t* data, size_t size, bool write) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  for (size_t off = 0; off < size; off += page_size) {
+    if (write) {
+      __atomic_fetch_add(data + off, 0, __ATOMIC_RELAXED);
+    } else {
+      (void)*(volatile uint8_t*)(data + off);
+    }
+  }
+}
+
+A0_STATIC_INLINE
+void a0_file_populate(a0_file_t* file) {
+  bool write = file->arena.mode != A0_ARENA_MODE_READONLY;
+  int advice = -1;
+#if defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+  advice = write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ;
+#endif
+  if (advice == -1 || madvise(file->arena.buf.data, file->arena.buf.size, advice) == -1) {
+    a0_file_prefault(file->arena.buf.data, file->arena.buf.size, write);
+  }
+}
+
+A0_STATIC_INLINE
+void a0_file_set_capacity(a0_file_t* file, const a0_file_open_options_t* open_options) {
+  file->arena.buf.size = file->stat.st_size;
+  file->arena.capacity = file->arena.buf.size;
+  if (open_options->reserve_size > file->arena.capacity) {
+    file->arena.capacity = open_options->reserve_size;
+  }
+}
+
+// A writable mapping holds a read lock on the byte at its capacity, so that
+// a0_file_grow can refuse to grow the file past it. Transports in the mapping
+// could not reach frames committed in the grown space.
+//
+// The lock is an open file description lock, so it is released when the file
+// is closed, or its process dies. The size is read again under a shared flock,
+// so that no grow happens between reading it and placing the lock.
+A0_STATIC_INLINE
+a0_err_t a0_file_lock_capacity(a0_file_t* file, const a0_file_open_options_t* open_options) {
+  A0_RETURN_SYSERR_ON_MINUS_ONE(flock(file->fd, LOCK_SH));
+
+  a0_err_t err = A0_OK;
+  if (fstat(file->fd, &file->stat) == -1) {
+    err = A0_MAKE_SYSERR(errno);
+  } else {
+    a0_file_set_capacity(file, open_options);
+    struct flock capacity_lock = {
+        .l_type = F_RDLCK,
+        .l_whence = SEEK_SET,
+        .l_start = (off_t)file->arena.capacity,
+        .l_len = 1,
+        .l_pid = 0,
+    };
+    if (fcntl(file->fd, F_OFD_SETLK, &capacity_lock) == -1) {
+      err = A0_MAKE_SYSERR(errno);
+    }
+  }
+
+  flock(file->fd, LOCK_UN);
+  return err;
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_mmap(a0_file_t* file, const a0_file_open_options_t* open_options) {
   file->arena.mode = open_options->arena_mode;
-  file->arena.buf.size = file->stat.st_size;
+  if (open_options->arena_mode == A0_ARENA_MODE_READONLY) {
+    // READONLY transports bound every read by their own mapping.
+    a0_file_set_capacity(file, open_options);
+  } else {
+    A0_RETURN_ERR_ON_ERR(a0_file_lock_capacity(file, open_options));
+  }
+  file->_locked = false;
 
-  int mmap_flags = MAP_SHARED;
+  int mmap_flags = MAP_SHARED | MAP_NORESERVE;
   if (open_options->arena_mode == A0_ARENA_MODE_READONLY) {
-    mmap_flags = MAP_PRIVATE;
+    mmap_flags = MAP_PRIVATE | MAP_NORESERVE;
   }
 
   file->arena.buf.data = (uint8_t*)mmap(
       /* addr   = */ 0,
-      /* len    = */ file->arena.buf.size,
+      /* len    = */ a0_file_reserved_size(file),
       /* prot   = */ PROT_READ | PROT_WRITE,
       /* flags  = */ mmap_flags,
       /* fd     = */ file->fd,
       /* offset = */ 0);
   if ((intptr_t)file->arena.buf.data == -1) {
     file->arena.buf = (a0_buf_t)A0_EMPTY;
+    file->arena.capacity = 0;
     return A0_MAKE_SYSERR(errno);
   }
 
+  // Advisory. Not every kernel supports transparent huge pages on shmem.
+  if (open_options->hugepage) {
+    madvise(file->arena.buf.data, a0_file_reserved_size(file), MADV_HUGEPAGE);
+  }
+
+  if (open_options->populate) {
+    a0_file_populate(file);
+  }
+
+  if (open_options->lock && mlock(file->arena.buf.data, file->arena.buf.size) == -1) {
+    a0_err_t err = A0_MAKE_SYSERR(errno);
+    munmap(file->arena.buf.data, a0_file_reserved_size(file));
+    file->arena.buf = (a0_buf_t)A0_EMPTY;
+    file->arena.capacity = 0;
+    return err;
+  }
+  file->_locked = open_options->lock;
+
   return A0_OK;
 }
 
@@ -198,8 +319,9 @@ a0_err_t a0_munmap(a0_file_t* file) {
     return A0_MAKE_SYSERR(EBADF);
   }
 
-  A0_RETURN_SYSERR_ON_MINUS_ONE(munmap(file->arena.buf.data, file->arena.buf.size));
+  A0_RETURN_SYSERR_ON_MINUS_ONE(munmap(file->arena.buf.data, a0_file_reserved_size(file)));
   file->arena.buf = (a0_buf_t)A0_EMPTY;
+  file->arena.capacity = 0;
 
   return A0_OK;
 }
@@ -212,9 +334,14 @@ const a0_file_options_t A0_FILE_OPTIONS_DEFAULT = {
         .mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH,
         // Global read+write+execute.
         .dir_mode = S_IRWXU | S_IRWXG | S_IRWXO,
+        .fallocate = false,
     },
     .open_options = {
         .arena_mode = A0_ARENA_MODE_SHARED,
+        .populate = false,
+        .hugepage = false,
+        .lock = false,
+        .reserve_size = 0,
     },
 };
 
@@ -335,6 +462,66 @@ a0_err_t a0_file_close(a0_file_t* file) {
   return a0_munmap(file);
 }
 
+a0_err_t a0_file_grow(a0_file_t* file, off_t size) {
+  if (!file->path || !file->arena.buf.data) {
+    return A0_MAKE_SYSERR(EBADF);
+  }
+  if (file->arena.mode == A0_ARENA_MODE_READONLY) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  size_t reserved_size = a0_file_reserved_size(file);
+  if (size < 0 || (size_t)size > reserved_size) {
+    return A0_ERR_INVALID_ARG;
+  }
+
+  // Serialize growth across processes, so a smaller grow never undoes a larger one.
+  A0_RETURN_SYSERR_ON_MINUS_ONE(flock(file->fd, LOCK_EX));
+
+  stat_t st;
+  a0_err_t err = A0_OK;
+  if (fstat(file->fd, &st) == -1) {
+    err = A0_MAKE_SYSERR(errno);
+  } else if (st.st_size < size) {
+    // Refuse to grow past the capacity of another writable mapping.
+    // See a0_file_lock_capacity.
+    struct flock probe = {
+        .l_type = F_WRLCK,
+        .l_whence = SEEK_SET,
+        .l_start = 0,
+        .l_len = size,
+        .l_pid = 0,
+    };
+    if (fcntl(file->fd, F_OFD_GETLK, &probe) == -1) {
+      err = A0_MAKE_SYSERR(errno);
+    } else if (probe.l_type != F_UNLCK) {
+      err = A0_MAKE_SYSERR(EBUSY);
+    } else if (ftruncate(file->fd, size) == -1) {
+      err = A0_MAKE_SYSERR(errno);
+    }
+  }
+  if (!err && fstat(file->fd, &st) == -1) {
+    err = A0_MAKE_SYSERR(errno);
+  }
+
+  flock(file->fd, LOCK_UN);
+  A0_RETURN_ERR_ON_ERR(err);
+
+  size_t new_size = (size_t)st.st_size < reserved_size ? (size_t)st.st_size : reserved_size;
+  size_t old_size = file->arena.buf.size;
+  if (new_size > old_size) {
+    // Locked files lock the new pages too. The size is left unchanged on
+    // failure, so the grow can be retried.
+    if (file->_locked &&
+        mlock(file->arena.buf.data + old_size, new_size - old_size) == -1) {
+      return A0_MAKE_SYSERR(errno);
+    }
+    file->arena.buf.size = new_size;
+  }
+  file->stat = st;
+
+  return A0_OK;
+}
+
 a0_err_t a0_file_iter_init(a0_file_iter_t* iter, const char* path) {
   char* abspath;
   A0_RETURN_ERR_ON_ERR(a0_abspath(path, &abspath));
@@ -23,9 +23,14 @@ File::Options File::Options::DEFAULT = {
         .size = A0_FILE_OPTIONS_DEFAULT.create_options.size,
         .mode = A0_FILE_OPTIONS_DEFAULT.create_options.mode,
         .dir_mode = A0_FILE_OPTIONS_DEFAULT.create_options.dir_mode,
+        .fallocate = A0_FILE_OPTIONS_DEFAULT.create_options.fallocate,
     },
     .open_options = {
         .arena_mode = A0_FILE_OPTIONS_DEFAULT.open_options.arena_mode,
+        .populate = A0_FILE_OPTIONS_DEFAULT.open_options.populate,
+        .hugepage = A0_FILE_OPTIONS_DEFAULT.open_options.hugepage,
+        .lock = A0_FILE_OPTIONS_DEFAULT.open_options.lock,
+        .reserve_size = A0_FILE_OPTIONS_DEFAULT.open_options.reserve_size,
     },
 };
 
@@ -85,6 +90,11 @@ stat_t File::stat() const {
   return c->stat;
 }
 
+void File::grow(size_t size) {
+  CHECK_C;
+  check(a0_file_grow(&*c, (off_t)size));
+}
+
 void File::remove(string_view path) {
   auto err = a0_file_remove(path.data());
   // Ignore "No such file or directory" errors.
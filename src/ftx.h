@@ -58,6 +58,22 @@ a0_err_t a0_ftx_wait(a0_ftx_t* ftx, int confirm_val, const a0_time_mono_t* timeo
   return a0_futex(ftx, FUTEX_WAIT_BITSET, confirm_val, (uintptr_t)&ts_mono, NULL, FUTEX_BITSET_MATCH_ANY);
 }
 
+A0_STATIC_INLINE
+a0_err_t a0_ftx_wait_bitset(a0_ftx_t* ftx, int confirm_val, const a0_time_mono_t* timeout, uint32_t bitset) {
+  if (!timeout) {
+    return a0_futex(ftx, FUTEX_WAIT_BITSET, confirm_val, 0, NULL, (int)bitset);
+  }
+
+  timespec_t ts_mono;
+  A0_RETURN_ERR_ON_ERR(a0_clock_convert(CLOCK_BOOTTIME, timeout->ts, CLOCK_MONOTONIC, &ts_mono));
+  return a0_futex(ftx, FUTEX_WAIT_BITSET, confirm_val, (uintptr_t)&ts_mono, NULL, (int)bitset);
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_ftx_wake_bitset(a0_ftx_t* ftx, int cnt, uint32_t bitset) {
+  return a0_futex(ftx, FUTEX_WAKE_BITSET, cnt, 0, NULL, (int)bitset);
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_ftx_wake(a0_ftx_t* ftx, int cnt) {
   return a0_futex(ftx, FUTEX_WAKE, cnt, 0, NULL, 0);
@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_opts.hpp"
 #include "c_wrap.hpp"
 
@@ -65,7 +66,7 @@ void Logger::dbg(Packet pkt) {
 namespace {
 
 struct LogListenerImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
   std::function<void(Packet)> onpacket;
 };
 
@@ -84,24 +85,13 @@ LogListener::LogListener(
         auto cfo = c_fileopts(topic.file_opts);
         a0_log_topic_t c_topic{topic.name.c_str(), &cfo};
 
-        a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (LogListenerImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
-            },
-            .dealloc = nullptr,
-        };
+        a0_alloc_t alloc = details::packet_buffer_alloc(&impl->data);
 
         a0_packet_callback_t c_onpacket = {
             .user_data = impl,
             .fn = [](void* user_data, a0_packet_t pkt) {
               auto* impl = (LogListenerImpl*)user_data;
-              auto data = std::make_shared<std::vector<uint8_t>>();
-              std::swap(*data, impl->data);
-              impl->onpacket(Packet(pkt, [data](a0_packet_t*) {}));
+              impl->onpacket(impl->data.take(pkt));
             }};
 
         return a0_log_listener_init(c, c_topic, alloc, (a0_log_level_t)lvl, c_readeropts(opts), c_onpacket);
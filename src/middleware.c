@@ -1,4 +1,5 @@
 #include <a0/buf.h>
+#include <a0/empty.h>
 #include <a0/err.h>
 #include <a0/inline.h>
 #include <a0/middleware.h>
@@ -165,7 +166,7 @@ a0_err_t a0_add_transport_seq_header_process_locked(void* data, a0_transport_loc
   A0_MAYBE_UNUSED(data);
 
   uint64_t seq;
-  a0_transport_seq_high(tlk, &seq);
+  a0_transport_seq_high_allocated(tlk, &seq);
 
   char seq_buf[20];
   char* seq_str;
@@ -262,12 +263,8 @@ a0_err_t a0_json_mergepatch_process_locked_nonempty(
     a0_middleware_chain_t chain) {
   // Grab the original json content from the most recent packet.
   a0_transport_jump_tail(tlk);
-  a0_transport_frame_t* frame;
-  a0_transport_frame(tlk, &frame);
-
-  a0_flat_packet_t flat_packet = {
-      .buf = {frame->data, frame->hdr.data_size},
-  };
+  a0_flat_packet_t flat_packet = A0_EMPTY;
+  a0_transport_frame_data(tlk, &flat_packet.buf);
 
   // Parse the original json.
   a0_buf_t original_payload;
@@ -8,6 +8,7 @@
 #include <limits.h>
 #include <linux/futex.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -16,16 +17,53 @@
 #include "err_macro.h"
 #include "ftx.h"
 #include "robust.h"
+#include "spin.h"
 #include "tsan.h"
 
+// Polls the mutex until it is free, then tries to take it without kernel involvement.
+//
+// Follows the adaptive mutex heuristic: spin up to twice the iterations
+// recent locks needed, and move the estimate an eighth of the way toward this
+// lock's count.
 A0_STATIC_INLINE
-a0_err_t a0_mtx_timedlock_robust(a0_mtx_t* mtx, a0_time_mono_t* timeout) {
+bool a0_mtx_spin_acquire(a0_mtx_t* mtx, uint32_t tid, a0_mtx_spin_t* spin) {
+  uint32_t estimate = a0_atomic_load(&spin->estimate);
+  uint32_t limit = 2 * estimate + 16;
+  if (limit > spin->max) {
+    limit = spin->max;
+  }
+
+  bool locked = false;
+  uint32_t iter = 0;
+  for (; iter < limit; iter++) {
+    const uint32_t val = a0_atomic_load(&mtx->ftx);
+    if (!val && a0_cas(&mtx->ftx, 0, tid)) {
+      locked = true;
+      break;
+    }
+    // The kernel hands the mutex directly to queued waiters, and only the kernel
+    // recovers it from a dead owner.
+    if (val & (FUTEX_WAITERS | FUTEX_OWNER_DIED)) {
+      break;
+    }
+    a0_spin_relax();
+  }
+
+  a0_atomic_store(&spin->estimate, (uint32_t)((int64_t)estimate + ((int64_t)iter - (int64_t)estimate) / 8));
+  return locked;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_mtx_timedlock_robust(a0_mtx_t* mtx, a0_time_mono_t* timeout, a0_mtx_spin_t* spin) {
   const uint32_t tid = a0_tid();
 
   // Try to lock without kernel involvement.
   if (a0_cas(&mtx->ftx, 0, tid)) {
     return A0_OK;
   }
+  if (spin && spin->max && a0_mtx_spin_acquire(mtx, tid, spin)) {
+    return A0_OK;
+  }
 
   // Ask the kernel to lock.
   a0_err_t err = a0_ftx_lock_pi(&mtx->ftx, timeout);
@@ -35,11 +73,11 @@ a0_err_t a0_mtx_timedlock_robust(a0_mtx_t* mtx, a0_time_mono_t* timeout) {
   return err;
 }
 
-a0_err_t a0_mtx_timedlock(a0_mtx_t* mtx, a0_time_mono_t* timeout) {
+a0_err_t a0_mtx_timedlock_spin(a0_mtx_t* mtx, a0_time_mono_t* timeout, a0_mtx_spin_t* spin) {
   // Note: __tsan_mutex_pre_lock should come here, but tsan doesn't provide
   //       a way to "fail" a lock. Only a trylock.
   a0_robust_op_start(mtx);
-  const a0_err_t err = a0_mtx_timedlock_robust(mtx, timeout);
+  const a0_err_t err = a0_mtx_timedlock_robust(mtx, timeout, spin);
   if (a0_mtx_lock_successful(err)) {
     __tsan_mutex_pre_lock(mtx, 0);
     a0_robust_op_add(mtx);
@@ -49,6 +87,10 @@ a0_err_t a0_mtx_timedlock(a0_mtx_t* mtx, a0_time_mono_t* timeout) {
   return err;
 }
 
+a0_err_t a0_mtx_timedlock(a0_mtx_t* mtx, a0_time_mono_t* timeout) {
+  return a0_mtx_timedlock_spin(mtx, timeout, NULL);
+}
+
 a0_err_t a0_mtx_lock(a0_mtx_t* mtx) {
   return a0_mtx_timedlock(mtx, A0_TIMEOUT_NEVER);
 }
@@ -162,13 +204,13 @@ a0_err_t a0_cnd_timedwait(a0_cnd_t* cnd, a0_mtx_t* mtx, a0_time_mono_t* timeout)
   // We need to manually lock on timeout.
   // Note: We keep the timeout error.
   if (A0_SYSERR(err) == ETIMEDOUT) {
-    a0_mtx_timedlock_robust(mtx, A0_TIMEOUT_NEVER);
+    a0_mtx_timedlock_robust(mtx, A0_TIMEOUT_NEVER, NULL);
   }
 
   // Someone else grabbed and mutated the resource between the unlock and wait.
   // No need to wait.
   if (A0_SYSERR(err) == EAGAIN) {
-    err = a0_mtx_timedlock_robust(mtx, A0_TIMEOUT_NEVER);
+    err = a0_mtx_timedlock_robust(mtx, A0_TIMEOUT_NEVER, NULL);
   }
 
   a0_robust_op_add(mtx);
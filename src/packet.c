@@ -2,8 +2,11 @@
 #include <a0/buf.h>
 #include <a0/err.h>
 #include <a0/packet.h>
+#include <a0/thread_local.h>
 #include <a0/uuid.h>
 
+#include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -85,7 +88,7 @@ a0_err_t a0_packet_serialize(a0_packet_t pkt, a0_alloc_t alloc, a0_flat_packet_t
   a0_packet_stats_t stats;
   A0_RETURN_ERR_ON_ERR(a0_packet_stats(pkt, &stats));
 
-  a0_alloc(alloc, stats.serial_size, out);
+  A0_RETURN_ERR_ON_ERR(a0_alloc(alloc, stats.serial_size, out));
 
   // Write pointer into index.
   size_t idx_off = 0;
@@ -116,16 +119,18 @@ a0_err_t a0_packet_serialize(a0_packet_t pkt, a0_alloc_t alloc, a0_flat_packet_t
       idx_off += sizeof(size_t);
 
       // Header key content.
-      memcpy(out->data + off, hdr->key, strlen(hdr->key) + 1);
-      off += strlen(hdr->key) + 1;
+      size_t key_size = strlen(hdr->key) + 1;
+      memcpy(out->data + off, hdr->key, key_size);
+      off += key_size;
 
       // Header val offset.
       memcpy(out->data + idx_off, &off, sizeof(size_t));
       idx_off += sizeof(size_t);
 
       // Header val content.
-      memcpy(out->data + off, hdr->val, strlen(hdr->val) + 1);
-      off += strlen(hdr->val) + 1;
+      size_t val_size = strlen(hdr->val) + 1;
+      memcpy(out->data + off, hdr->val, val_size);
+      off += val_size;
     }
   }
 
@@ -133,14 +138,432 @@ a0_err_t a0_packet_serialize(a0_packet_t pkt, a0_alloc_t alloc, a0_flat_packet_t
   memcpy(out->data + idx_off, &off, sizeof(size_t));
 
   // Payload content.
-  if (pkt.payload.size) {
+  if (pkt.payload.data && pkt.payload.size) {
     memcpy(out->data + off, pkt.payload.data, pkt.payload.size);
   }
 
   return A0_OK;
 }
 
+// Packet format v2.
+//
+// See "Serialization Format v2" in packet.h. Multi-byte fields are read and
+// written with memcpy, since a flat packet need not be aligned.
+
+enum {
+  A0_PACKET_V2_MAGIC = 0xA0,
+  A0_PACKET_V2_VERSION = 2,
+  // Set if the key hash table follows the index.
+  A0_PACKET_V2_HASHED = 1 << 0,
+  // Packets with fewer headers are scanned linearly.
+  A0_PACKET_V2_HASH_MIN_HDRS = 8,
+  // Header lengths and key hashes are kept for this many headers.
+  A0_PACKET_V2_LEN_CACHE = 32,
+  A0_PACKET_V2_ID_SIZE = 16,
+};
+
+typedef struct a0_packet_v2_hdr_s {
+  uint8_t magic;
+  uint8_t version;
+  uint16_t flags;
+  uint32_t num_hdrs;
+  uint8_t id[A0_PACKET_V2_ID_SIZE];
+  uint64_t payload_off;
+} a0_packet_v2_hdr_t;
+
+typedef struct a0_packet_v2_entry_s {
+  uint32_t key_off;
+  uint32_t key_len;
+  uint32_t val_off;
+  uint32_t val_len;
+} a0_packet_v2_entry_t;
+
+A0_STATIC_INLINE
+bool a0_flat_packet_is_v2(a0_flat_packet_t fpkt) {
+  // A v1 packet starts with its ASCII id, so never with the magic byte.
+  return fpkt.buf.size >= sizeof(a0_packet_v2_hdr_t) &&
+         fpkt.buf.data[0] == A0_PACKET_V2_MAGIC &&
+         fpkt.buf.data[1] == A0_PACKET_V2_VERSION;
+}
+
+A0_STATIC_INLINE
+uint32_t a0_packet_v2_load_u32(const uint8_t* ptr) {
+  uint32_t val;
+  memcpy(&val, ptr, sizeof(uint32_t));
+  return val;
+}
+
+A0_STATIC_INLINE
+void a0_packet_v2_store_u32(uint8_t* ptr, uint32_t val) {
+  memcpy(ptr, &val, sizeof(uint32_t));
+}
+
+A0_STATIC_INLINE
+a0_packet_v2_hdr_t a0_packet_v2_hdr(a0_flat_packet_t fpkt) {
+  a0_packet_v2_hdr_t hdr;
+  memcpy(&hdr, fpkt.buf.data, sizeof(a0_packet_v2_hdr_t));
+  return hdr;
+}
+
+A0_STATIC_INLINE
+a0_packet_v2_entry_t a0_packet_v2_entry(a0_flat_packet_t fpkt, size_t idx) {
+  a0_packet_v2_entry_t entry;
+  memcpy(&entry,
+         fpkt.buf.data + sizeof(a0_packet_v2_hdr_t) + idx * sizeof(a0_packet_v2_entry_t),
+         sizeof(a0_packet_v2_entry_t));
+  return entry;
+}
+
+// Offset of the hash table, which starts with its number of slots.
+A0_STATIC_INLINE
+size_t a0_packet_v2_table_off(size_t num_hdrs) {
+  return sizeof(a0_packet_v2_hdr_t) + num_hdrs * sizeof(a0_packet_v2_entry_t);
+}
+
+// Offset of the header content, directly after the index and hash table.
+A0_STATIC_INLINE
+size_t a0_packet_v2_content_off(size_t num_hdrs, size_t table_size, bool hashed) {
+  size_t off = a0_packet_v2_table_off(num_hdrs);
+  if (hashed) {
+    // Slot count, slots, and the per-header chain of duplicate keys.
+    off += (1 + table_size + num_hdrs) * sizeof(uint32_t);
+  }
+  return off;
+}
+
+// Slots in the hash table, which is kept at most half full. Zero for packets
+// scanned linearly.
+A0_STATIC_INLINE
+size_t a0_packet_v2_table_size(size_t num_hdrs) {
+  if (num_hdrs < A0_PACKET_V2_HASH_MIN_HDRS) {
+    return 0;
+  }
+  size_t table_size = 1;
+  while (table_size < 2 * num_hdrs) {
+    table_size <<= 1;
+  }
+  return table_size;
+}
+
+A0_STATIC_INLINE
+uint64_t a0_packet_v2_load_u64(const char* ptr) {
+  uint64_t val;
+  memcpy(&val, ptr, sizeof(uint64_t));
+  return val;
+}
+
+A0_STATIC_INLINE
+uint32_t a0_packet_v2_hash(const char* key, size_t len) {
+  // Multiplicative hash over 8 byte words. Header keys are short, so this
+  // is much cheaper than hashing a byte at a time.
+  // Loads are fixed size, so none become calls to memcpy.
+  const uint64_t k = 0x9E3779B97F4A7C15ull;
+  uint64_t hash = len * k;
+  if (len >= sizeof(uint64_t)) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+      hash = (hash ^ a0_packet_v2_load_u64(key + i)) * k;
+    }
+    if (i < len) {
+      // The last word overlaps the previous one.
+      hash = (hash ^ a0_packet_v2_load_u64(key + len - sizeof(uint64_t))) * k;
+    }
+  } else if (len >= sizeof(uint32_t)) {
+    uint32_t lo;
+    uint32_t hi;
+    memcpy(&lo, key, sizeof(uint32_t));
+    memcpy(&hi, key + len - sizeof(uint32_t), sizeof(uint32_t));
+    hash = (hash ^ ((uint64_t)hi << 32 | lo)) * k;
+  } else if (len) {
+    uint64_t word = (uint8_t)key[0] | (uint8_t)key[len / 2] << 8 | (uint8_t)key[len - 1] << 16;
+    hash = (hash ^ word) * k;
+  }
+  // Slots are picked with the low bits, so mix the high bits down.
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  return (uint32_t)hash;
+}
+
+// One plus the value of each uppercase hex digit. Zero for any other char.
+static const uint8_t A0_PACKET_V2_HEX[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+// Packs a canonical id, as made by a0_uuidv4, into 16 bytes.
+// Fails for any other id, which could not be restored exactly.
+A0_STATIC_INLINE
+bool a0_packet_v2_id_pack(const a0_uuid_t id, uint8_t out[A0_PACKET_V2_ID_SIZE]) {
+  static const uint8_t pos[A0_PACKET_V2_ID_SIZE] = {0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+  if (id[8] != '-' || id[13] != '-' || id[18] != '-' || id[23] != '-' || id[A0_UUID_SIZE]) {
+    return false;
+  }
+  uint8_t valid = 1;
+  for (size_t i = 0; i < A0_PACKET_V2_ID_SIZE; i++) {
+    uint8_t hi = A0_PACKET_V2_HEX[(uint8_t)id[pos[i]]];
+    uint8_t lo = A0_PACKET_V2_HEX[(uint8_t)id[pos[i] + 1]];
+    valid &= (hi != 0) & (lo != 0);
+    out[i] = (uint8_t)((hi - 1) << 4 | (lo - 1));
+  }
+  return valid;
+}
+
+A0_STATIC_INLINE
+void a0_packet_v2_id_unpack(const uint8_t in[A0_PACKET_V2_ID_SIZE], a0_uuid_t out) {
+  static const char hex[] = "0123456789ABCDEF";
+  size_t pos = 0;
+  for (size_t byte = 0; byte < A0_PACKET_V2_ID_SIZE; byte++) {
+    if (pos == 8 || pos == 13 || pos == 18 || pos == 23) {
+      out[pos++] = '-';
+    }
+    out[pos++] = hex[in[byte] >> 4];
+    out[pos++] = hex[in[byte] & 0xF];
+  }
+  out[A0_UUID_SIZE] = 0;
+}
+
+a0_err_t a0_packet_serialize_v2(a0_packet_t pkt, a0_alloc_t alloc, a0_flat_packet_t* out_fpkt) {
+  uint8_t id[A0_PACKET_V2_ID_SIZE];
+  if (!a0_packet_v2_id_pack(pkt.id, id)) {
+    return a0_packet_serialize(pkt, alloc, out_fpkt);
+  }
+
+  a0_buf_t unused_out;
+  a0_buf_t* out = &unused_out;
+  if (out_fpkt) {
+    out = &out_fpkt->buf;
+  }
+
+  // Measure each header once. The lengths are kept for the copy below.
+  size_t lens[2 * A0_PACKET_V2_LEN_CACHE];
+  uint32_t hashes[A0_PACKET_V2_LEN_CACHE];
+  size_t num_hdrs = 0;
+  size_t hdr_content_size = 0;
+  for (a0_packet_headers_block_t* block = &pkt.headers_block;
+       block;
+       block = block->next_block) {
+    for (size_t i = 0; i < block->size; i++) {
+      size_t key_len = strlen(block->headers[i].key);
+      size_t val_len = strlen(block->headers[i].val);
+      if (num_hdrs < A0_PACKET_V2_LEN_CACHE) {
+        lens[2 * num_hdrs] = key_len;
+        lens[2 * num_hdrs + 1] = val_len;
+      }
+      hdr_content_size += key_len + 1 + val_len + 1;
+      num_hdrs++;
+    }
+  }
+
+  size_t table_size = a0_packet_v2_table_size(num_hdrs);
+  bool hashed = table_size != 0;
+
+  size_t content_off = a0_packet_v2_content_off(num_hdrs, table_size, hashed);
+  size_t payload_off = content_off + hdr_content_size;
+  if (payload_off > UINT32_MAX) {
+    return A0_MAKE_SYSERR(EOVERFLOW);
+  }
+
+  A0_RETURN_ERR_ON_ERR(a0_alloc(alloc, payload_off + pkt.payload.size, out));
+
+  a0_packet_v2_hdr_t hdr = {
+      .magic = A0_PACKET_V2_MAGIC,
+      .version = A0_PACKET_V2_VERSION,
+      .flags = hashed ? A0_PACKET_V2_HASHED : 0,
+      .num_hdrs = (uint32_t)num_hdrs,
+      .id = {0},
+      .payload_off = payload_off,
+  };
+  memcpy(hdr.id, id, sizeof(id));
+  memcpy(out->data, &hdr, sizeof(hdr));
+
+  uint8_t* table = out->data + a0_packet_v2_table_off(num_hdrs);
+  uint8_t* slots = table + sizeof(uint32_t);
+  uint8_t* chain = slots + table_size * sizeof(uint32_t);
+  if (hashed) {
+    a0_packet_v2_store_u32(table, (uint32_t)table_size);
+    memset(slots, 0, (table_size + num_hdrs) * sizeof(uint32_t));
+  }
+
+  size_t idx = 0;
+  size_t off = content_off;
+  for (a0_packet_headers_block_t* block = &pkt.headers_block;
+       block;
+       block = block->next_block) {
+    for (size_t i = 0; i < block->size; i++, idx++) {
+      a0_packet_header_t* pkt_hdr = &block->headers[i];
+      size_t key_len = idx < A0_PACKET_V2_LEN_CACHE ? lens[2 * idx] : strlen(pkt_hdr->key);
+      size_t val_len = idx < A0_PACKET_V2_LEN_CACHE ? lens[2 * idx + 1] : strlen(pkt_hdr->val);
+
+      a0_packet_v2_entry_t entry = {
+          .key_off = (uint32_t)off,
+          .key_len = (uint32_t)key_len,
+          .val_off = (uint32_t)(off + key_len + 1),
+          .val_len = (uint32_t)val_len,
+      };
+      memcpy(out->data + sizeof(a0_packet_v2_hdr_t) + idx * sizeof(a0_packet_v2_entry_t),
+             &entry,
+             sizeof(entry));
+
+      memcpy(out->data + entry.key_off, pkt_hdr->key, key_len + 1);
+      memcpy(out->data + entry.val_off, pkt_hdr->val, val_len + 1);
+      off += key_len + 1 + val_len + 1;
+
+      if (!hashed) {
+        continue;
+      }
+
+      // Slots hold one plus the index of the first header with a key.
+      // Later headers with the same key are chained from it, in order.
+      uint32_t hash = a0_packet_v2_hash(pkt_hdr->key, key_len);
+      if (idx < A0_PACKET_V2_LEN_CACHE) {
+        hashes[idx] = hash;
+      }
+      size_t slot = hash & (table_size - 1);
+      while (true) {
+        uint32_t first = a0_packet_v2_load_u32(slots + slot * sizeof(uint32_t));
+        if (!first) {
+          a0_packet_v2_store_u32(slots + slot * sizeof(uint32_t), (uint32_t)(idx + 1));
+          break;
+        }
+        // Most collisions are between different keys, and rejected by hash.
+        if (first - 1 < A0_PACKET_V2_LEN_CACHE && hashes[first - 1] != hash) {
+          slot = (slot + 1) & (table_size - 1);
+          continue;
+        }
+        a0_packet_v2_entry_t other;
+        memcpy(&other,
+               out->data + sizeof(a0_packet_v2_hdr_t) + (first - 1) * sizeof(a0_packet_v2_entry_t),
+               sizeof(other));
+        if (other.key_len == key_len && !memcmp(out->data + other.key_off, pkt_hdr->key, key_len)) {
+          uint32_t tail = first - 1;
+          uint32_t next;
+          while ((next = a0_packet_v2_load_u32(chain + tail * sizeof(uint32_t)))) {
+            tail = next - 1;
+          }
+          a0_packet_v2_store_u32(chain + tail * sizeof(uint32_t), (uint32_t)(idx + 1));
+          break;
+        }
+        slot = (slot + 1) & (table_size - 1);
+      }
+    }
+  }
+
+  // Payload content.
+  if (pkt.payload.data && pkt.payload.size) {
+    memcpy(out->data + payload_off, pkt.payload.data, pkt.payload.size);
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_packet_stats_v2(a0_packet_t pkt, a0_packet_stats_t* stats) {
+  A0_RETURN_ERR_ON_ERR(a0_packet_stats(pkt, stats));
+
+  uint8_t id[A0_PACKET_V2_ID_SIZE];
+  if (!a0_packet_v2_id_pack(pkt.id, id)) {
+    return A0_OK;
+  }
+
+  size_t table_size = a0_packet_v2_table_size(stats->num_hdrs);
+  size_t content_off = a0_packet_v2_content_off(stats->num_hdrs, table_size, table_size != 0);
+  if (content_off + stats->content_size - pkt.payload.size > UINT32_MAX) {
+    return A0_MAKE_SYSERR(EOVERFLOW);
+  }
+  stats->serial_size = content_off + stats->content_size;
+  return A0_OK;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_packet_deserialize_v2(a0_flat_packet_t fpkt, a0_alloc_t alloc, a0_packet_t* out_pkt, a0_buf_t* out_buf) {
+  a0_packet_v2_hdr_t hdr = a0_packet_v2_hdr(fpkt);
+  a0_packet_v2_id_unpack(hdr.id, out_pkt->id);
+
+  size_t table_size = 0;
+  bool hashed = hdr.flags & A0_PACKET_V2_HASHED;
+  if (hashed) {
+    table_size = a0_packet_v2_load_u32(fpkt.buf.data + a0_packet_v2_table_off(hdr.num_hdrs));
+  }
+  size_t content_off = a0_packet_v2_content_off(hdr.num_hdrs, table_size, hashed);
+
+  A0_RETURN_ERR_ON_ERR(a0_alloc(alloc,
+                                hdr.num_hdrs * sizeof(a0_packet_header_t) + fpkt.buf.size - content_off,
+                                out_buf));
+
+  // The header content and payload are contiguous, and copied at once.
+  a0_packet_header_t* headers = (a0_packet_header_t*)out_buf->data;
+  uint8_t* content = out_buf->data + hdr.num_hdrs * sizeof(a0_packet_header_t);
+  memcpy(content, fpkt.buf.data + content_off, fpkt.buf.size - content_off);
+
+  for (size_t i = 0; i < hdr.num_hdrs; i++) {
+    a0_packet_v2_entry_t entry = a0_packet_v2_entry(fpkt, i);
+    headers[i].key = (char*)(content + (entry.key_off - content_off));
+    headers[i].val = (char*)(content + (entry.val_off - content_off));
+  }
+
+  out_pkt->headers_block = (a0_packet_headers_block_t){headers, hdr.num_hdrs, NULL};
+  out_pkt->payload = (a0_buf_t){
+      content + (hdr.payload_off - content_off),
+      fpkt.buf.size - hdr.payload_off,
+  };
+
+  return A0_OK;
+}
+
+// Finds the first header at or after from_idx with the given key, using the hash table.
+A0_STATIC_INLINE
+a0_err_t a0_flat_packet_v2_find_hashed(a0_flat_packet_t fpkt, size_t num_hdrs, const char* key, size_t key_len, size_t from_idx, size_t* out_idx) {
+  const uint8_t* table = fpkt.buf.data + a0_packet_v2_table_off(num_hdrs);
+  size_t table_size = a0_packet_v2_load_u32(table);
+  const uint8_t* slots = table + sizeof(uint32_t);
+  const uint8_t* chain = slots + table_size * sizeof(uint32_t);
+
+  size_t slot = a0_packet_v2_hash(key, key_len) & (table_size - 1);
+  while (true) {
+    uint32_t first = a0_packet_v2_load_u32(slots + slot * sizeof(uint32_t));
+    if (!first) {
+      return A0_ERR_NOT_FOUND;
+    }
+    a0_packet_v2_entry_t entry = a0_packet_v2_entry(fpkt, first - 1);
+    if (entry.key_len == key_len && !memcmp(fpkt.buf.data + entry.key_off, key, key_len)) {
+      uint32_t idx = first;
+      while (idx && idx - 1 < from_idx) {
+        idx = a0_packet_v2_load_u32(chain + (idx - 1) * sizeof(uint32_t));
+      }
+      if (!idx) {
+        return A0_ERR_NOT_FOUND;
+      }
+      *out_idx = idx - 1;
+      return A0_OK;
+    }
+    slot = (slot + 1) & (table_size - 1);
+  }
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_flat_packet_v2_find(a0_flat_packet_t fpkt, const char* key, size_t from_idx, size_t* out_idx) {
+  a0_packet_v2_hdr_t hdr = a0_packet_v2_hdr(fpkt);
+  size_t key_len = strlen(key);
+  if (hdr.flags & A0_PACKET_V2_HASHED) {
+    return a0_flat_packet_v2_find_hashed(fpkt, hdr.num_hdrs, key, key_len, from_idx, out_idx);
+  }
+
+  for (size_t i = from_idx; i < hdr.num_hdrs; i++) {
+    a0_packet_v2_entry_t entry = a0_packet_v2_entry(fpkt, i);
+    if (entry.key_len == key_len && !memcmp(fpkt.buf.data + entry.key_off, key, key_len)) {
+      *out_idx = i;
+      return A0_OK;
+    }
+  }
+  return A0_ERR_NOT_FOUND;
+}
+
 a0_err_t a0_packet_deserialize(a0_flat_packet_t fpkt, a0_alloc_t alloc, a0_packet_t* out_pkt, a0_buf_t* out_buf) {
+  if (a0_flat_packet_is_v2(fpkt)) {
+    return a0_packet_deserialize_v2(fpkt, alloc, out_pkt, out_buf);
+  }
+
   a0_buf_t in = fpkt.buf;
   memcpy(out_pkt->id, in.data, sizeof(a0_uuid_t));
 
@@ -229,8 +652,26 @@ a0_err_t a0_packet_deep_copy(a0_packet_t in, a0_alloc_t alloc, a0_packet_t* out_
   return A0_OK;
 }
 
+a0_err_t a0_flat_packet_version(a0_flat_packet_t fpkt, uint8_t* out) {
+  *out = a0_flat_packet_is_v2(fpkt) ? A0_PACKET_V2_VERSION : 1;
+  return A0_OK;
+}
+
 a0_err_t a0_flat_packet_stats(a0_flat_packet_t fpkt, a0_packet_stats_t* stats) {
   stats->serial_size = fpkt.buf.size;
+
+  if (a0_flat_packet_is_v2(fpkt)) {
+    a0_packet_v2_hdr_t hdr = a0_packet_v2_hdr(fpkt);
+    bool hashed = hdr.flags & A0_PACKET_V2_HASHED;
+    size_t table_size = 0;
+    if (hashed) {
+      table_size = a0_packet_v2_load_u32(fpkt.buf.data + a0_packet_v2_table_off(hdr.num_hdrs));
+    }
+    stats->num_hdrs = hdr.num_hdrs;
+    stats->content_size = fpkt.buf.size - a0_packet_v2_content_off(hdr.num_hdrs, table_size, hashed);
+    return A0_OK;
+  }
+
   stats->num_hdrs = *(size_t*)(fpkt.buf.data + sizeof(a0_uuid_t));
 
   size_t content_off =
@@ -248,12 +689,36 @@ a0_err_t a0_flat_packet_stats(a0_flat_packet_t fpkt, a0_packet_stats_t* stats) {
   return A0_OK;
 }
 
+// Binary v2 ids are decoded here, by a0_flat_packet_id.
+static A0_THREAD_LOCAL a0_uuid_t a0_flat_packet_id_buf;
+
 a0_err_t a0_flat_packet_id(a0_flat_packet_t fpkt, a0_uuid_t** out) {
+  if (a0_flat_packet_is_v2(fpkt)) {
+    a0_packet_v2_id_unpack(a0_packet_v2_hdr(fpkt).id, a0_flat_packet_id_buf);
+    *out = &a0_flat_packet_id_buf;
+    return A0_OK;
+  }
   *out = (a0_uuid_t*)fpkt.buf.data;
   return A0_OK;
 }
 
+a0_err_t a0_flat_packet_id_copy(a0_flat_packet_t fpkt, a0_uuid_t out) {
+  if (a0_flat_packet_is_v2(fpkt)) {
+    a0_packet_v2_hdr_t hdr = a0_packet_v2_hdr(fpkt);
+    a0_packet_v2_id_unpack(hdr.id, out);
+    return A0_OK;
+  }
+  memcpy(out, fpkt.buf.data, sizeof(a0_uuid_t));
+  return A0_OK;
+}
+
 a0_err_t a0_flat_packet_payload(a0_flat_packet_t fpkt, a0_buf_t* out) {
+  if (a0_flat_packet_is_v2(fpkt)) {
+    a0_packet_v2_hdr_t hdr = a0_packet_v2_hdr(fpkt);
+    *out = (a0_buf_t){fpkt.buf.data + hdr.payload_off, fpkt.buf.size - hdr.payload_off};
+    return A0_OK;
+  }
+
   size_t num_hdrs = *(size_t*)(fpkt.buf.data + sizeof(a0_uuid_t));
 
   size_t payload_off;
@@ -272,6 +737,18 @@ a0_err_t a0_flat_packet_payload(a0_flat_packet_t fpkt, a0_buf_t* out) {
 }
 
 a0_err_t a0_flat_packet_header(a0_flat_packet_t fpkt, size_t idx, a0_packet_header_t* out) {
+  if (a0_flat_packet_is_v2(fpkt)) {
+    if (idx >= a0_packet_v2_hdr(fpkt).num_hdrs) {
+      return A0_ERR_NOT_FOUND;
+    }
+    a0_packet_v2_entry_t entry = a0_packet_v2_entry(fpkt, idx);
+    *out = (a0_packet_header_t){
+        .key = (char*)(fpkt.buf.data + entry.key_off),
+        .val = (char*)(fpkt.buf.data + entry.val_off),
+    };
+    return A0_OK;
+  }
+
   size_t num_hdrs = *(size_t*)(fpkt.buf.data + sizeof(a0_uuid_t));
   if (idx >= num_hdrs) {
     return A0_ERR_NOT_FOUND;
@@ -302,6 +779,13 @@ a0_err_t a0_flat_packet_header_iterator_next(a0_flat_packet_header_iterator_t* i
 }
 
 a0_err_t a0_flat_packet_header_iterator_next_match(a0_flat_packet_header_iterator_t* iter, const char* key, a0_packet_header_t* out) {
+  if (a0_flat_packet_is_v2(*iter->_fpkt)) {
+    size_t idx;
+    A0_RETURN_ERR_ON_ERR(a0_flat_packet_v2_find(*iter->_fpkt, key, iter->_idx, &idx));
+    iter->_idx = idx + 1;
+    return a0_flat_packet_header(*iter->_fpkt, idx, out);
+  }
+
   do {
     A0_RETURN_ERR_ON_ERR(a0_flat_packet_header_iterator_next(iter, out));
   } while (strcmp(key, out->key) != 0);
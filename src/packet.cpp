@@ -6,80 +6,139 @@
 #include <a0/uuid.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_wrap.hpp"
 #include "err_macro.h"
 
 namespace a0 {
 namespace {
 
+// The state behind a Packet.
+//
+// It is allocated from the packet state pool, and so is the shared_ptr control
+// block, so that delivering a packet does not malloc in steady state. The C++
+// headers of a delivered packet are only built if asked for.
 struct PacketImpl {
-  std::unordered_multimap<std::string, std::string> cpp_hdrs;
+  a0_packet_t c;
+  std::function<void(a0_packet_t*)> deleter;
+
   std::vector<a0_packet_header_t> c_hdrs;
+
+  std::once_flag cpp_hdrs_once;
+  std::unordered_multimap<std::string, std::string> cpp_hdrs;
+};
+
+struct PacketDeleter {
+  PacketImpl* impl;
+
+  void operator()(a0_packet_t* c) {
+    if (impl->deleter) {
+      impl->deleter(c);
+    }
+    impl->~PacketImpl();
+    details::BufferPool::packet_state().release((uint8_t*)impl, sizeof(PacketImpl));
+  }
+};
+
+template <typename T>
+struct PacketAllocator {
+  using value_type = T;
+
+  PacketAllocator() = default;
+  template <typename U>
+  PacketAllocator(const PacketAllocator<U>&) {}  // NOLINT(google-explicit-constructor)
+
+  T* allocate(size_t n) {
+    auto block = details::BufferPool::packet_state().acquire(n * sizeof(T));
+    if (!block.data) {
+      throw std::bad_alloc();
+    }
+    return (T*)block.data;
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    details::BufferPool::packet_state().release((uint8_t*)ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const PacketAllocator<U>&) const { return true; }
+  template <typename U>
+  bool operator!=(const PacketAllocator<U>&) const { return false; }
 };
 
+// Takes ownership of the impl, even on failure.
+std::shared_ptr<a0_packet_t> wrap_packet_impl(PacketImpl* impl) {
+  try {
+    return std::shared_ptr<a0_packet_t>(&impl->c, PacketDeleter{impl}, PacketAllocator<a0_packet_t>());
+  } catch (...) {
+    PacketDeleter{impl}(&impl->c);
+    throw;
+  }
+}
+
+PacketImpl* new_packet_impl(std::function<void(a0_packet_t*)> deleter) {
+  auto block = details::BufferPool::packet_state().acquire(sizeof(PacketImpl));
+  if (!block.data) {
+    throw std::bad_alloc();
+  }
+  auto* impl = new (block.data) PacketImpl;
+  impl->deleter = std::move(deleter);
+  return impl;
+}
+
 std::shared_ptr<a0_packet_t> make_cpp_packet(
     string_view id,
     std::unordered_multimap<std::string, std::string> hdrs,
     string_view payload_view,
     std::function<void(a0_packet_t*)> deleter) {
-  std::shared_ptr<a0_packet_t> c;
-  set_c_impl<PacketImpl>(
-      &c,
-      [&](a0_packet_t* c, PacketImpl* impl) {
-        // Handle id.
-
-        if (id.empty()) {
-          // Create a new ID.
-          A0_RETURN_ERR_ON_ERR(a0_packet_init(&*c));
-        } else if (id.size() == A0_UUID_SIZE) {
-          memcpy(c->id, id.data(), sizeof(a0_uuid_t));
-        } else {
-          return A0_ERR_INVALID_ARG;
-        }
-
-        // Handle headers.
-
-        impl->cpp_hdrs = std::move(hdrs);
-
-        for (const auto& elem : impl->cpp_hdrs) {
-          impl->c_hdrs.push_back(a0_packet_header_t{
-              .key = elem.first.c_str(),
-              .val = elem.second.c_str(),
-          });
-        }
-
-        c->headers_block = {
-            .headers = impl->c_hdrs.data(),
-            .size = impl->c_hdrs.size(),
-            .next_block = nullptr,
-        };
-
-        // Handle payload.
-
-        c->payload = as_buf(payload_view);
-
-        return A0_OK;
-      },
-      [deleter](a0_packet_t* c, PacketImpl*) {
-        if (deleter) {
-          deleter(c);
-        }
-      });
+  auto c = wrap_packet_impl(new_packet_impl(std::move(deleter)));
+  auto* impl = std::get_deleter<PacketDeleter>(c)->impl;
+
+  if (id.empty()) {
+    // Create a new ID.
+    check(a0_packet_init(&*c));
+  } else if (id.size() == A0_UUID_SIZE) {
+    memcpy(c->id, id.data(), sizeof(a0_uuid_t));
+  } else {
+    check(A0_ERR_INVALID_ARG);
+  }
+
+  std::call_once(impl->cpp_hdrs_once, [&]() {
+    impl->cpp_hdrs = std::move(hdrs);
+  });
+  impl->c_hdrs.reserve(impl->cpp_hdrs.size());
+  for (const auto& elem : impl->cpp_hdrs) {
+    impl->c_hdrs.push_back(a0_packet_header_t{
+        .key = elem.first.c_str(),
+        .val = elem.second.c_str(),
+    });
+  }
+  c->headers_block = {
+      .headers = impl->c_hdrs.data(),
+      .size = impl->c_hdrs.size(),
+      .next_block = nullptr,
+  };
+
+  c->payload = as_buf(payload_view);
+
   return c;
 }
 
 }  // namespace
 
 Packet::Packet()
-    : Packet(std::string{}) {}
+    : Packet(string_view(""), ref) {}
 
 Packet::Packet(std::string payload)
     : Packet({}, std::move(payload)) {}
@@ -121,9 +180,21 @@ Packet::Packet(a0_packet_t pkt, std::function<void(a0_packet_t*)> deleter) {
       pkt.id,
       std::move(hdrs),
       string_view((char*)pkt.payload.data, pkt.payload.size),
-      deleter);
+      std::move(deleter));
 }
 
+namespace details {
+
+// The headers stay where they are, and are only copied if asked for.
+Packet adopt_packet(a0_packet_t pkt, std::function<void(a0_packet_t*)> deleter) {
+  Packet cpp;
+  cpp.c = wrap_packet_impl(new_packet_impl(std::move(deleter)));
+  *cpp.c = pkt;
+  return cpp;
+}
+
+}  // namespace details
+
 string_view Packet::id() const {
   CHECK_C;
   return c->id;
@@ -131,7 +202,15 @@ string_view Packet::id() const {
 
 const std::unordered_multimap<std::string, std::string>& Packet::headers() const {
   CHECK_C;
-  const auto* impl = c_impl<PacketImpl>(&c);
+  auto* impl = std::get_deleter<PacketDeleter>(c)->impl;
+  std::call_once(impl->cpp_hdrs_once, [&]() {
+    a0_packet_header_iterator_t iter;
+    a0_packet_header_iterator_init(&iter, &impl->c);
+    a0_packet_header_t hdr;
+    while (!a0_packet_header_iterator_next(&iter, &hdr)) {
+      impl->cpp_hdrs.insert({hdr.key, hdr.val});
+    }
+  });
   return impl->cpp_hdrs;
 }
 
@@ -140,11 +219,11 @@ string_view Packet::payload() const {
   return string_view((char*)c->payload.data, c->payload.size);
 }
 
-string_view FlatPacket::id() const {
+std::string FlatPacket::id() const {
   CHECK_C;
-  a0_uuid_t* uuid;
-  check(a0_flat_packet_id(*c, &uuid));
-  return string_view(*uuid, A0_UUID_SIZE);
+  a0_uuid_t uuid;
+  check(a0_flat_packet_id_copy(*c, uuid));
+  return std::string(uuid, A0_UUID_SIZE);
 }
 
 string_view FlatPacket::payload() const {
@@ -1,6 +1,7 @@
 #include <a0/alloc.h>
 #include <a0/buf.h>
 #include <a0/cmp.h>
+#include <a0/empty.h>
 #include <a0/env.h>
 #include <a0/err.h>
 #include <a0/file.h>
@@ -66,6 +67,15 @@ a0_err_t a0_prpc_server_init(a0_prpc_server_t* server,
                              a0_alloc_t alloc,
                              a0_prpc_connection_callback_t onconnect,
                              a0_packet_id_callback_t oncancel) {
+  return a0_prpc_server_init_dispatch(server, topic, alloc, (a0_executor_dispatch_t)A0_EMPTY, onconnect, oncancel);
+}
+
+a0_err_t a0_prpc_server_init_dispatch(a0_prpc_server_t* server,
+                                      a0_prpc_topic_t topic,
+                                      a0_alloc_t alloc,
+                                      a0_executor_dispatch_t dispatch,
+                                      a0_prpc_connection_callback_t onconnect,
+                                      a0_packet_id_callback_t oncancel) {
   server->_onconnect = onconnect;
   server->_oncancel = oncancel;
 
@@ -86,11 +96,12 @@ a0_err_t a0_prpc_server_init(a0_prpc_server_t* server,
     return err;
   }
 
-  err = a0_reader_init(
+  err = a0_reader_init_dispatch(
       &server->_connection_reader,
       server->_file.arena,
       alloc,
-      (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT},
+      (a0_reader_options_t){.init = A0_INIT_AWAIT_NEW, .iter = A0_ITER_NEXT},
+      dispatch,
       (a0_packet_callback_t){
           .user_data = server,
           .fn = a0_prpc_server_onpacket,
@@ -213,7 +224,7 @@ a0_err_t a0_prpc_client_init(a0_prpc_client_t* client,
       &client->_progress_reader,
       client->_file.arena,
       alloc,
-      (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT},
+      (a0_reader_options_t){.init = A0_INIT_AWAIT_NEW, .iter = A0_ITER_NEXT},
       (a0_packet_callback_t){
           .user_data = client,
           .fn = a0_prpc_client_onpacket,
@@ -20,6 +20,7 @@
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_opts.hpp"
 #include "c_wrap.hpp"
 
@@ -28,7 +29,7 @@ namespace a0 {
 namespace {
 
 struct PrpcServerRequestImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
 };
 
 }  // namespace
@@ -52,7 +53,7 @@ void PrpcConnection::send(Packet pkt, bool done) {
 namespace {
 
 struct PrpcServerImpl {
-  std::vector<uint8_t> data;
+  Dispatch dispatch;
   std::function<void(PrpcConnection)> onconnect;
   std::function<void(string_view)> oncancel;
 };
@@ -62,10 +63,18 @@ struct PrpcServerImpl {
 PrpcServer::PrpcServer(
     PrpcTopic topic,
     std::function<void(PrpcConnection)> onconnect,
+    std::function<void(string_view /* id */)> oncancel)
+    : PrpcServer(std::move(topic), Dispatch(), std::move(onconnect), std::move(oncancel)) {}
+
+PrpcServer::PrpcServer(
+    PrpcTopic topic,
+    Dispatch dispatch,
+    std::function<void(PrpcConnection)> onconnect,
     std::function<void(string_view /* id */)> oncancel) {
   set_c_impl<PrpcServerImpl>(
       &c,
       [&](a0_prpc_server_t* c, PrpcServerImpl* impl) {
+        impl->dispatch = std::move(dispatch);
         impl->onconnect = std::move(onconnect);
         impl->oncancel = std::move(oncancel);
 
@@ -73,12 +82,9 @@ PrpcServer::PrpcServer(
         a0_prpc_topic_t c_topic{topic.name.c_str(), &cfo};
 
         a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (PrpcServerImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
+            .user_data = nullptr,
+            .alloc = [](void*, size_t size, a0_buf_t* out) {
+              return deserialize_buffer()->alloc(size, out);
             },
             .dealloc = nullptr,
         };
@@ -90,7 +96,7 @@ PrpcServer::PrpcServer(
 
               PrpcConnection cpp_conn = make_cpp_impl<PrpcConnection, PrpcServerRequestImpl>(
                   [&](a0_prpc_connection_t* c_conn, PrpcServerRequestImpl* conn_impl) {
-                    std::swap(impl->data, conn_impl->data);
+                    deserialize_buffer()->swap(conn_impl->data);
                     *c_conn = conn;
                     return A0_OK;
                   });
@@ -105,7 +111,7 @@ PrpcServer::PrpcServer(
               impl->oncancel(id);
             }};
 
-        return a0_prpc_server_init(c, c_topic, alloc, c_onconnect, c_oncancel);
+        return a0_prpc_server_init_dispatch(c, c_topic, alloc, c_dispatch(&impl->dispatch), c_onconnect, c_oncancel);
       },
       [](a0_prpc_server_t* c, PrpcServerImpl*) {
         a0_prpc_server_close(c);
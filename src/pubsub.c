@@ -9,15 +9,64 @@
 #include <a0/reader.h>
 #include <a0/time.h>
 #include <a0/topic.h>
+#include <a0/transport.h>
 #include <a0/writer.h>
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "err_macro.h"
 
+const a0_transport_options_t A0_PUBSUB_TRANSPORT_OPTIONS_DEFAULT = {
+    .reader_slots = 16,
+    .seq_index_size = 1024,
+    .producer_slots = 0,
+    .cursor_slots = 0,
+    .frame_align = 0,
+    .watcher_slots = 16,
+    .lock_spin_ns = 0,
+    .wait_spin_ns = 0,
+};
+
+// No packet with the standard headers serializes into a smaller frame.
+#define A0_PUBSUB_MIN_FRAME_SIZE 256
+
+// Sizes the sequence index to hold every frame that fits in the arena, so that
+// every retained frame can be sought by sequence number or commit time.
 A0_STATIC_INLINE
+uint32_t a0_pubsub_seq_index_size(size_t arena_size) {
+  size_t max_frames = arena_size / A0_PUBSUB_MIN_FRAME_SIZE;
+  uint32_t size = 2;
+  while (size < max_frames && size < ((uint32_t)1 << 31)) {
+    size <<= 1;
+  }
+  return size;
+}
+
 a0_err_t a0_pubsub_topic_open(a0_pubsub_topic_t topic, a0_file_t* file) {
-  return a0_topic_open(a0_env_topic_tmpl_pubsub(), topic.name, topic.file_opts, file);
+  A0_RETURN_ERR_ON_ERR(a0_topic_open(a0_env_topic_tmpl_pubsub(), topic.name, topic.file_opts, file));
+  if (file->arena.mode == A0_ARENA_MODE_READONLY) {
+    return A0_OK;
+  }
+
+  // The layout is fixed by whichever publisher or subscriber creates the
+  // transport. Later connections ignore the options.
+  a0_transport_options_t opts = A0_PUBSUB_TRANSPORT_OPTIONS_DEFAULT;
+  if (topic.transport_opts) {
+    opts = *topic.transport_opts;
+  } else {
+    opts.seq_index_size = a0_pubsub_seq_index_size(file->arena.buf.size);
+  }
+  a0_transport_t transport;
+  a0_err_t err = a0_transport_init_options(&transport, file->arena, opts);
+  if (err == A0_ERR_INVALID_ARG && !topic.transport_opts) {
+    err = a0_transport_init(&transport, file->arena);
+  }
+  if (err) {
+    a0_file_close(file);
+  }
+  return err;
 }
 
 /////////////////
@@ -25,9 +74,13 @@ a0_err_t a0_pubsub_topic_open(a0_pubsub_topic_t topic, a0_file_t* file) {
 /////////////////
 
 a0_err_t a0_publisher_init(a0_publisher_t* pub, a0_pubsub_topic_t topic) {
+  return a0_publisher_init_options(pub, topic, A0_WRITER_OPTIONS_DEFAULT);
+}
+
+a0_err_t a0_publisher_init_options(a0_publisher_t* pub, a0_pubsub_topic_t topic, a0_writer_options_t opts) {
   A0_RETURN_ERR_ON_ERR(a0_pubsub_topic_open(topic, &pub->_file));
 
-  a0_err_t err = a0_writer_init(&pub->_writer, pub->_file.arena);
+  a0_err_t err = a0_writer_init_options(&pub->_writer, pub->_file.arena, opts);
   if (err) {
     a0_file_close(&pub->_file);
     return err;
@@ -53,11 +106,33 @@ a0_err_t a0_publisher_pub(a0_publisher_t* pub, a0_packet_t pkt) {
   return a0_writer_write(&pub->_writer, pkt);
 }
 
+a0_err_t a0_publisher_pub_batch(a0_publisher_t* pub, const a0_packet_t* pkts, size_t cnt, size_t* written) {
+  return a0_writer_write_batch(&pub->_writer, pkts, cnt, written);
+}
+
+a0_err_t a0_publisher_reserve(a0_publisher_t* pub, a0_packet_t pkt, size_t payload_size, a0_writer_reservation_t* out) {
+  return a0_writer_reserve(&pub->_writer, pkt, payload_size, out);
+}
+
 a0_err_t a0_publisher_writer(a0_publisher_t* pub, a0_writer_t** out) {
   *out = &pub->_writer;
   return A0_OK;
 }
 
+a0_err_t a0_publisher_grow(a0_publisher_t* pub, size_t size) {
+  A0_RETURN_ERR_ON_ERR(a0_file_grow(&pub->_file, (off_t)size));
+
+  // The writer's transport adopts the new size when it next locks.
+  a0_transport_t transport;
+  A0_RETURN_ERR_ON_ERR(a0_transport_init(&transport, pub->_file.arena));
+
+  a0_transport_locked_t tlk;
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(&transport, &tlk));
+  a0_err_t err = a0_transport_resize(tlk, pub->_file.arena.buf.size);
+  a0_transport_unlock(tlk);
+  return err;
+}
+
 //////////////////
 //  Subscriber  //
 //////////////////
@@ -91,6 +166,10 @@ a0_err_t a0_subscriber_sync_zc_can_read(a0_subscriber_sync_zc_t* sub_sync_zc, bo
   return a0_reader_sync_zc_can_read(&sub_sync_zc->_reader_sync_zc, can_read);
 }
 
+a0_err_t a0_subscriber_sync_zc_watch(a0_subscriber_sync_zc_t* sub_sync_zc, int* fd) {
+  return a0_reader_sync_zc_watch(&sub_sync_zc->_reader_sync_zc, fd);
+}
+
 a0_err_t a0_subscriber_sync_zc_read(a0_subscriber_sync_zc_t* sub_sync_zc, a0_zero_copy_callback_t onpacket) {
   return a0_reader_sync_zc_read(&sub_sync_zc->_reader_sync_zc, onpacket);
 }
@@ -134,6 +213,10 @@ a0_err_t a0_subscriber_sync_can_read(a0_subscriber_sync_t* sub_sync, bool* can_r
   return a0_reader_sync_can_read(&sub_sync->_reader_sync, can_read);
 }
 
+a0_err_t a0_subscriber_sync_watch(a0_subscriber_sync_t* sub_sync, int* fd) {
+  return a0_reader_sync_watch(&sub_sync->_reader_sync, fd);
+}
+
 a0_err_t a0_subscriber_sync_read(a0_subscriber_sync_t* sub_sync, a0_packet_t* pkt) {
   return a0_reader_sync_read(&sub_sync->_reader_sync, pkt);
 }
@@ -173,6 +256,35 @@ a0_err_t a0_subscriber_zc_close(a0_subscriber_zc_t* sub_zc) {
   return A0_OK;
 }
 
+// Busy-polling threaded zero-copy version.
+
+a0_err_t a0_subscriber_spin_zc_init(a0_subscriber_spin_zc_t* sub_spin_zc,
+                                    a0_pubsub_topic_t topic,
+                                    a0_reader_options_t opts,
+                                    a0_transport_poll_backoff_t backoff,
+                                    a0_zero_copy_callback_t onpacket) {
+  A0_RETURN_ERR_ON_ERR(a0_pubsub_topic_open(topic, &sub_spin_zc->_file));
+
+  a0_err_t err = a0_reader_spin_zc_init(
+      &sub_spin_zc->_reader_spin_zc,
+      sub_spin_zc->_file.arena,
+      opts,
+      backoff,
+      onpacket);
+  if (err) {
+    a0_file_close(&sub_spin_zc->_file);
+    return err;
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_subscriber_spin_zc_close(a0_subscriber_spin_zc_t* sub_spin_zc) {
+  a0_reader_spin_zc_close(&sub_spin_zc->_reader_spin_zc);
+  a0_file_close(&sub_spin_zc->_file);
+  return A0_OK;
+}
+
 // Threaded allocated version.
 
 a0_err_t a0_subscriber_init(a0_subscriber_t* sub,
@@ -20,21 +20,26 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_opts.hpp"
 #include "c_wrap.hpp"
 
 namespace a0 {
 
-Publisher::Publisher(PubSubTopic topic) {
+Publisher::Publisher(PubSubTopic topic)
+    : Publisher(std::move(topic), Writer::Options::DEFAULT) {}
+
+Publisher::Publisher(PubSubTopic topic, Writer::Options opts) {
   set_c(
       &c,
       [&](a0_publisher_t* c) {
         auto cfo = c_fileopts(topic.file_opts);
-        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo};
-        return a0_publisher_init(c, c_topic);
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
+        return a0_publisher_init_options(c, c_topic, c_writeropts(opts));
       },
       a0_publisher_close);
 }
@@ -44,6 +49,27 @@ void Publisher::pub(Packet pkt) {
   check(a0_publisher_pub(&*c, *pkt.c));
 }
 
+void Publisher::pub_batch(const std::vector<Packet>& pkts, size_t* written) {
+  CHECK_C;
+  std::vector<a0_packet_t> c_pkts;
+  c_pkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    c_pkts.push_back(*pkt.c);
+  }
+  check(a0_publisher_pub_batch(&*c, c_pkts.data(), c_pkts.size(), written));
+}
+
+WriterReservation Publisher::reserve(std::unordered_multimap<std::string, std::string> headers,
+                                     size_t payload_size) {
+  CHECK_C;
+  return writer().reserve(std::move(headers), payload_size);
+}
+
+void Publisher::grow(size_t size) {
+  CHECK_C;
+  check(a0_publisher_grow(&*c, size));
+}
+
 Writer Publisher::writer() {
   CHECK_C;
   auto save = c;
@@ -61,7 +87,7 @@ SubscriberSyncZeroCopy::SubscriberSyncZeroCopy(PubSubTopic topic, Reader::Option
       &c,
       [&](a0_subscriber_sync_zc_t* c) {
         auto cfo = c_fileopts(topic.file_opts);
-        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo};
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
         return a0_subscriber_sync_zc_init(c, c_topic, c_readeropts(opts));
       },
       [](a0_subscriber_sync_zc_t* c) {
@@ -76,6 +102,13 @@ bool SubscriberSyncZeroCopy::can_read() {
   return ret;
 }
 
+int SubscriberSyncZeroCopy::watch() {
+  CHECK_C;
+  int fd;
+  check(a0_subscriber_sync_zc_watch(&*c, &fd));
+  return fd;
+}
+
 A0_STATIC_INLINE
 a0_zero_copy_callback_t SubscriberSyncZeroCopy_callback(std::function<void(TransportLocked, FlatPacket)>* fn) {
   return a0_zero_copy_callback_t{
@@ -104,7 +137,7 @@ void SubscriberSyncZeroCopy::read_blocking(TimeMono timeout, std::function<void(
 namespace {
 
 struct SubscriberSyncImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
 };
 
 }  // namespace
@@ -114,18 +147,9 @@ SubscriberSync::SubscriberSync(PubSubTopic topic, Reader::Options opts) {
       &c,
       [&](a0_subscriber_sync_t* c, SubscriberSyncImpl* impl) {
         auto cfo = c_fileopts(topic.file_opts);
-        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo};
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
 
-        a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (SubscriberSyncImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
-            },
-            .dealloc = nullptr,
-        };
+        a0_alloc_t alloc = details::packet_buffer_alloc(&impl->data);
         return a0_subscriber_sync_init(c, c_topic, alloc, c_readeropts(opts));
       },
       [](a0_subscriber_sync_t* c, SubscriberSyncImpl*) {
@@ -140,13 +164,18 @@ bool SubscriberSync::can_read() {
   return ret;
 }
 
+int SubscriberSync::watch() {
+  CHECK_C;
+  int fd;
+  check(a0_subscriber_sync_watch(&*c, &fd));
+  return fd;
+}
+
 A0_STATIC_INLINE
 Packet SubscriberSync_read(SubscriberSyncImpl* impl, std::function<a0_err_t(a0_packet_t*)> fn) {
   a0_packet_t pkt;
   check(fn(&pkt));
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  std::swap(*data, impl->data);
-  return Packet(pkt, [data](a0_packet_t*) {});
+  return impl->data.take(pkt);
 }
 
 Packet SubscriberSync::read() {
@@ -188,7 +217,7 @@ SubscriberZeroCopy::SubscriberZeroCopy(
         impl->onpacket = std::move(onpacket);
 
         auto cfo = c_fileopts(topic.file_opts);
-        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo};
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
 
         a0_zero_copy_callback_t c_onpacket = {
             .user_data = impl,
@@ -204,10 +233,37 @@ SubscriberZeroCopy::SubscriberZeroCopy(
       });
 }
 
+SubscriberSpinZeroCopy::SubscriberSpinZeroCopy(
+    PubSubTopic topic,
+    Reader::Options opts,
+    Backoff backoff,
+    std::function<void(TransportLocked, FlatPacket)> onpacket) {
+  set_c_impl<SubscriberZeroCopyImpl>(
+      &c,
+      [&](a0_subscriber_spin_zc_t* c, SubscriberZeroCopyImpl* impl) {
+        impl->onpacket = std::move(onpacket);
+
+        auto cfo = c_fileopts(topic.file_opts);
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
+
+        a0_zero_copy_callback_t c_onpacket = {
+            .user_data = impl,
+            .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+              auto* impl = (SubscriberZeroCopyImpl*)user_data;
+              impl->onpacket(cpp_wrap<TransportLocked>(&tlk), cpp_wrap<FlatPacket>(&fpkt));
+            }};
+
+        return a0_subscriber_spin_zc_init(c, c_topic, c_readeropts(opts), (a0_transport_poll_backoff_t)backoff, c_onpacket);
+      },
+      [](a0_subscriber_spin_zc_t* c, SubscriberZeroCopyImpl*) {
+        a0_subscriber_spin_zc_close(c);
+      });
+}
+
 namespace {
 
 struct SubscriberImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
   std::function<void(Packet)> onpacket;
 };
 
@@ -223,26 +279,15 @@ Subscriber::Subscriber(
         impl->onpacket = std::move(onpacket);
 
         auto cfo = c_fileopts(topic.file_opts);
-        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo};
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
 
-        a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (SubscriberImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
-            },
-            .dealloc = nullptr,
-        };
+        a0_alloc_t alloc = details::packet_buffer_alloc(&impl->data);
 
         a0_packet_callback_t c_onpacket = {
             .user_data = impl,
             .fn = [](void* user_data, a0_packet_t pkt) {
               auto* impl = (SubscriberImpl*)user_data;
-              auto data = std::make_shared<std::vector<uint8_t>>();
-              std::swap(*data, impl->data);
-              impl->onpacket(Packet(pkt, [data](a0_packet_t*) {}));
+              impl->onpacket(impl->data.take(pkt));
             }};
 
         return a0_subscriber_init(c, c_topic, alloc, c_readeropts(opts), c_onpacket);
@@ -0,0 +1,649 @@
+#include <a0/alloc.h>
+#include <a0/arena.h>
+#include <a0/buf.h>
+#include <a0/callback.h>
+#include <a0/empty.h>
+#include <a0/err.h>
+#include <a0/event.h>
+#include <a0/file.h>
+#include <a0/inline.h>
+#include <a0/mtx.h>
+#include <a0/packet.h>
+#include <a0/pubsub.h>
+#include <a0/reactor.h>
+#include <a0/reader.h>
+#include <a0/tid.h>
+#include <a0/transport.h>
+#include <a0/unused.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "err_macro.h"
+
+typedef struct epoll_event epoll_event_t;
+
+// How often a thread with only watched sources wakes, to find watchers that
+// writers in another network namespace could not signal.
+#define A0_REACTOR_WATCH_CHECK_MS 100
+
+const a0_reactor_options_t A0_REACTOR_OPTIONS_DEFAULT = {
+    .threads = 1,
+    .poll_interval_ns = 1000 * 1000,
+    .batch = 64,
+};
+
+// Sources are added and removed by the thread that drives them, so that the
+// thread owns their watchers.
+typedef enum a0_reactor_op_type_e {
+  A0_REACTOR_OP_ADD,
+  A0_REACTOR_OP_REMOVE,
+  A0_REACTOR_OP_SHUTDOWN,
+} a0_reactor_op_type_t;
+
+typedef struct a0_reactor_op_s {
+  a0_reactor_op_type_t type;
+  a0_reactor_source_t* source;
+  // Set once the op is done. NULL for heap-allocated ops, which the thread frees.
+  a0_event_t* done;
+  struct a0_reactor_op_s* next;
+} a0_reactor_op_t;
+
+struct a0_reactor_thread_s {
+  a0_reactor_options_t opts;
+  int epoll_fd;
+  int wake_fd;
+
+  pthread_t thread;
+  uint32_t thread_id;
+  a0_event_t thread_start_event;
+
+  // Guards the pending ops and the source count.
+  a0_mtx_t mtx;
+  a0_reactor_op_t* ops_head;
+  a0_reactor_op_t* ops_tail;
+  size_t source_cnt;
+
+  // Owned by the thread.
+  a0_reactor_source_t* watched;
+  a0_reactor_source_t* polled;
+  a0_reactor_source_t* ready_head;
+  a0_reactor_source_t* ready_tail;
+  size_t ready_cnt;
+};
+
+/////////////
+//  Lists  //
+/////////////
+
+// Sources are either watched or polled, and linked into that list.
+A0_STATIC_INLINE
+void a0_reactor_list_push(a0_reactor_source_t** head, a0_reactor_source_t* source) {
+  source->_prev = NULL;
+  source->_next = *head;
+  if (*head) {
+    (*head)->_prev = source;
+  }
+  *head = source;
+}
+
+A0_STATIC_INLINE
+void a0_reactor_list_remove(a0_reactor_source_t** head, a0_reactor_source_t* source) {
+  if (source->_prev) {
+    source->_prev->_next = source->_next;
+  } else {
+    *head = source->_next;
+  }
+  if (source->_next) {
+    source->_next->_prev = source->_prev;
+  }
+}
+
+A0_STATIC_INLINE
+void a0_reactor_ready_push(a0_reactor_thread_t* thread, a0_reactor_source_t* source) {
+  if (source->_ready) {
+    return;
+  }
+  source->_ready = true;
+  source->_ready_prev = thread->ready_tail;
+  source->_ready_next = NULL;
+  if (thread->ready_tail) {
+    thread->ready_tail->_ready_next = source;
+  } else {
+    thread->ready_head = source;
+  }
+  thread->ready_tail = source;
+  thread->ready_cnt++;
+}
+
+A0_STATIC_INLINE
+void a0_reactor_ready_remove(a0_reactor_thread_t* thread, a0_reactor_source_t* source) {
+  if (!source->_ready) {
+    return;
+  }
+  source->_ready = false;
+  if (source->_ready_prev) {
+    source->_ready_prev->_ready_next = source->_ready_next;
+  } else {
+    thread->ready_head = source->_ready_next;
+  }
+  if (source->_ready_next) {
+    source->_ready_next->_ready_prev = source->_ready_prev;
+  } else {
+    thread->ready_tail = source->_ready_prev;
+  }
+  thread->ready_cnt--;
+}
+
+//////////////
+//  Thread  //
+//////////////
+
+A0_STATIC_INLINE
+void a0_reactor_thread_add(a0_reactor_thread_t* thread, a0_reactor_source_t* source) {
+  source->_fd = -1;
+  source->_ready = false;
+
+  int fd;
+  if (!a0_reader_sync_zc_watch(source->_reader_sync_zc, &fd)) {
+    epoll_event_t evt = A0_EMPTY;
+    evt.events = EPOLLIN;
+    evt.data.ptr = source;
+    if (!epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, fd, &evt)) {
+      source->_fd = fd;
+      a0_reactor_list_push(&thread->watched, source);
+    }
+  }
+
+  if (source->_fd < 0) {
+    a0_transport_poll_seq_high(&source->_reader_sync_zc->_transport, &source->_seen_seq_high);
+    a0_reactor_list_push(&thread->polled, source);
+  }
+
+  // Frames may have been committed before the reader was watched.
+  a0_reactor_ready_push(thread, source);
+}
+
+A0_STATIC_INLINE
+void a0_reactor_thread_remove(a0_reactor_thread_t* thread, a0_reactor_source_t* source) {
+  if (source->_fd >= 0) {
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, source->_fd, NULL);
+    a0_reactor_list_remove(&thread->watched, source);
+  } else {
+    a0_reactor_list_remove(&thread->polled, source);
+  }
+  a0_reactor_ready_remove(thread, source);
+
+  // Unregisters the watcher, which this thread holds.
+  a0_reader_sync_zc_close(source->_reader_sync_zc);
+}
+
+// Returns false once the thread is shut down.
+A0_STATIC_INLINE
+bool a0_reactor_thread_run_ops(a0_reactor_thread_t* thread) {
+  uint64_t cnt;
+  (void)!read(thread->wake_fd, &cnt, sizeof(uint64_t));
+
+  a0_err_t err = a0_mtx_lock(&thread->mtx);
+  if (!a0_mtx_lock_successful(err)) {
+    return true;
+  }
+  a0_reactor_op_t* op = thread->ops_head;
+  thread->ops_head = NULL;
+  thread->ops_tail = NULL;
+  a0_mtx_unlock(&thread->mtx);
+
+  bool running = true;
+  while (op) {
+    a0_reactor_op_t* next = op->next;
+    if (op->type == A0_REACTOR_OP_ADD) {
+      a0_reactor_thread_add(thread, op->source);
+    } else if (op->type == A0_REACTOR_OP_REMOVE) {
+      a0_reactor_thread_remove(thread, op->source);
+    } else {
+      running = false;
+    }
+
+    // The op may be gone once done is set.
+    if (op->done) {
+      a0_event_set(op->done);
+    } else {
+      free(op);
+    }
+    op = next;
+  }
+  return running;
+}
+
+A0_STATIC_INLINE
+void a0_reactor_thread_poll(a0_reactor_thread_t* thread) {
+  for (a0_reactor_source_t* source = thread->polled; source; source = source->_next) {
+    uint64_t seq_high;
+    a0_transport_poll_seq_high(&source->_reader_sync_zc->_transport, &seq_high);
+    if (seq_high != source->_seen_seq_high) {
+      source->_seen_seq_high = seq_high;
+      a0_reactor_ready_push(thread, source);
+    }
+  }
+}
+
+// Polls the watched sources that a writer could not signal, from another
+// network namespace. Their watcher stays registered until they are removed.
+A0_STATIC_INLINE
+void a0_reactor_thread_check_watched(a0_reactor_thread_t* thread) {
+  a0_reactor_source_t* source = thread->watched;
+  while (source) {
+    a0_reactor_source_t* next = source->_next;
+    bool reachable = true;
+    a0_transport_watcher_reachable(&source->_reader_sync_zc->_watcher, &reachable);
+    if (!reachable) {
+      epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, source->_fd, NULL);
+      a0_reactor_list_remove(&thread->watched, source);
+      source->_fd = -1;
+      a0_transport_poll_seq_high(&source->_reader_sync_zc->_transport, &source->_seen_seq_high);
+      a0_reactor_list_push(&thread->polled, source);
+      // The missed commits are read now.
+      a0_reactor_ready_push(thread, source);
+    }
+    source = next;
+  }
+}
+
+// Reads a batch from each source that was ready. A source that still has
+// frames goes to the back of the queue.
+A0_STATIC_INLINE
+void a0_reactor_thread_drain(a0_reactor_thread_t* thread) {
+  uint32_t batch = thread->opts.batch;
+  for (size_t i = thread->ready_cnt; i > 0 && thread->ready_head; i--) {
+    a0_reactor_source_t* source = thread->ready_head;
+    a0_reactor_ready_remove(thread, source);
+
+    bool idle = false;
+    for (uint32_t j = 0; !batch || j < batch; j++) {
+      if (source->_read(source)) {
+        idle = true;
+        break;
+      }
+    }
+
+    if (!idle) {
+      a0_reactor_ready_push(thread, source);
+    }
+  }
+}
+
+A0_STATIC_INLINE
+int a0_reactor_thread_timeout_ms(a0_reactor_thread_t* thread) {
+  if (thread->ready_head) {
+    return 0;
+  }
+  if (thread->polled) {
+    return (int)((thread->opts.poll_interval_ns + 999999) / 1000000);
+  }
+  if (thread->watched) {
+    return A0_REACTOR_WATCH_CHECK_MS;
+  }
+  return -1;
+}
+
+static void* a0_reactor_thread_main(void* data) {
+  a0_reactor_thread_t* thread = (a0_reactor_thread_t*)data;
+  // Alert that the thread has started.
+  thread->thread_id = a0_tid();
+  a0_event_set(&thread->thread_start_event);
+
+  epoll_event_t evts[64];
+  bool running = true;
+  while (running) {
+    int num_evt = epoll_wait(thread->epoll_fd, evts, 64, a0_reactor_thread_timeout_ms(thread));
+
+    // Ops are run last, so that no event refers to a removed source.
+    bool woken = false;
+    for (int i = 0; i < num_evt; i++) {
+      if (evts[i].data.ptr) {
+        a0_reactor_ready_push(thread, (a0_reactor_source_t*)evts[i].data.ptr);
+      } else {
+        woken = true;
+      }
+    }
+    if (woken) {
+      running = a0_reactor_thread_run_ops(thread);
+    }
+
+    a0_reactor_thread_check_watched(thread);
+    a0_reactor_thread_poll(thread);
+    a0_reactor_thread_drain(thread);
+  }
+
+  return NULL;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_thread_post(a0_reactor_thread_t* thread, a0_reactor_op_t* op, int source_delta) {
+  op->next = NULL;
+
+  a0_err_t err = a0_mtx_lock(&thread->mtx);
+  if (!a0_mtx_lock_successful(err)) {
+    return err;
+  }
+  if (thread->ops_tail) {
+    thread->ops_tail->next = op;
+  } else {
+    thread->ops_head = op;
+  }
+  thread->ops_tail = op;
+  thread->source_cnt += source_delta;
+  a0_mtx_unlock(&thread->mtx);
+
+  uint64_t one = 1;
+  (void)!write(thread->wake_fd, &one, sizeof(uint64_t));
+  return A0_OK;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_thread_init(a0_reactor_thread_t* thread, a0_reactor_options_t opts) {
+  thread->opts = opts;
+
+  thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  A0_RETURN_SYSERR_ON_MINUS_ONE(thread->epoll_fd);
+
+  thread->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (thread->wake_fd == -1) {
+    a0_err_t err = A0_MAKE_SYSERR(errno);
+    close(thread->epoll_fd);
+    return err;
+  }
+
+  epoll_event_t evt = A0_EMPTY;
+  evt.events = EPOLLIN;
+  evt.data.ptr = NULL;
+  a0_err_t err = A0_OK;
+  if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, thread->wake_fd, &evt)) {
+    err = A0_MAKE_SYSERR(errno);
+  } else {
+    int create_err = pthread_create(&thread->thread, NULL, a0_reactor_thread_main, thread);
+    if (create_err) {
+      err = A0_MAKE_SYSERR(create_err);
+    }
+  }
+
+  if (err) {
+    close(thread->wake_fd);
+    close(thread->epoll_fd);
+  }
+  return err;
+}
+
+A0_STATIC_INLINE
+void a0_reactor_thread_close(a0_reactor_thread_t* thread) {
+  a0_reactor_op_t op = {.type = A0_REACTOR_OP_SHUTDOWN, .source = NULL, .done = NULL, .next = NULL};
+  a0_event_t done = A0_EMPTY;
+  op.done = &done;
+  a0_reactor_thread_post(thread, &op, 0);
+  pthread_join(thread->thread, NULL);
+
+  close(thread->wake_fd);
+  close(thread->epoll_fd);
+}
+
+///////////////
+//  Reactor  //
+///////////////
+
+a0_err_t a0_reactor_init(a0_reactor_t* reactor, a0_reactor_options_t opts) {
+  *reactor = (a0_reactor_t)A0_EMPTY;
+  if (!opts.threads) {
+    opts.threads = 1;
+  }
+  reactor->_opts = opts;
+
+  reactor->_threads = (a0_reactor_thread_t*)calloc(opts.threads, sizeof(a0_reactor_thread_t));
+  if (!reactor->_threads) {
+    return A0_MAKE_SYSERR(ENOMEM);
+  }
+
+  for (uint32_t i = 0; i < opts.threads; i++) {
+    a0_err_t err = a0_reactor_thread_init(&reactor->_threads[i], opts);
+    if (err) {
+      while (i--) {
+        a0_reactor_thread_close(&reactor->_threads[i]);
+      }
+      free(reactor->_threads);
+      reactor->_threads = NULL;
+      return err;
+    }
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_reactor_close(a0_reactor_t* reactor) {
+  A0_ASSERT(reactor, "Cannot close null reactor.");
+
+  for (uint32_t i = 0; i < reactor->_opts.threads; i++) {
+    a0_reactor_thread_t* thread = &reactor->_threads[i];
+    a0_event_wait(&thread->thread_start_event);
+    if (a0_tid() == thread->thread_id) {
+      return A0_MAKE_SYSERR(EDEADLK);
+    }
+
+    a0_err_t err = a0_mtx_lock(&thread->mtx);
+    if (!a0_mtx_lock_successful(err)) {
+      return err;
+    }
+    size_t source_cnt = thread->source_cnt;
+    a0_mtx_unlock(&thread->mtx);
+    if (source_cnt) {
+      return A0_MAKE_SYSERR(EBUSY);
+    }
+  }
+
+  for (uint32_t i = 0; i < reactor->_opts.threads; i++) {
+    a0_reactor_thread_close(&reactor->_threads[i]);
+  }
+  free(reactor->_threads);
+  reactor->_threads = NULL;
+
+  return A0_OK;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_source_init(a0_reactor_source_t* source,
+                                a0_reactor_t* reactor,
+                                a0_reader_sync_zc_t* reader_sync_zc,
+                                a0_err_t (*read)(a0_reactor_source_t*)) {
+  A0_ASSERT(reactor, "Cannot add a reader to a null reactor.");
+
+  uint32_t idx = a0_atomic_fetch_add(&reactor->_next_thread, 1) % reactor->_opts.threads;
+  *source = (a0_reactor_source_t)A0_EMPTY;
+  source->_reader_sync_zc = reader_sync_zc;
+  source->_read = read;
+  source->_thread = &reactor->_threads[idx];
+  source->_fd = -1;
+
+  a0_reactor_op_t* op = (a0_reactor_op_t*)malloc(sizeof(a0_reactor_op_t));
+  if (!op) {
+    return A0_MAKE_SYSERR(ENOMEM);
+  }
+  *op = (a0_reactor_op_t){.type = A0_REACTOR_OP_ADD, .source = source, .done = NULL, .next = NULL};
+
+  a0_err_t err = a0_reactor_thread_post(source->_thread, op, 1);
+  if (err) {
+    free(op);
+  }
+  return err;
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_source_close(a0_reactor_source_t* source) {
+  a0_reactor_thread_t* thread = source->_thread;
+  a0_event_wait(&thread->thread_start_event);
+  if (a0_tid() == thread->thread_id) {
+    return A0_MAKE_SYSERR(EDEADLK);
+  }
+
+  a0_event_t done = A0_EMPTY;
+  a0_reactor_op_t op = {.type = A0_REACTOR_OP_REMOVE, .source = source, .done = &done, .next = NULL};
+  A0_RETURN_ERR_ON_ERR(a0_reactor_thread_post(thread, &op, -1));
+  return a0_event_wait(&done);
+}
+
+////////////////////////
+//  Zero-copy reader  //
+////////////////////////
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_reader_zc_read(a0_reactor_source_t* source) {
+  a0_reactor_reader_zc_t* reactor_reader_zc = (a0_reactor_reader_zc_t*)source;
+  return a0_reader_sync_zc_read(&reactor_reader_zc->_reader_sync_zc, reactor_reader_zc->_onpacket);
+}
+
+a0_err_t a0_reactor_reader_zc_init(a0_reactor_reader_zc_t* reactor_reader_zc,
+                                   a0_reactor_t* reactor,
+                                   a0_arena_t arena,
+                                   a0_reader_options_t opts,
+                                   a0_zero_copy_callback_t onpacket) {
+  reactor_reader_zc->_onpacket = onpacket;
+  A0_RETURN_ERR_ON_ERR(a0_reader_sync_zc_init(&reactor_reader_zc->_reader_sync_zc, arena, opts));
+
+  a0_err_t err = a0_reactor_source_init(
+      &reactor_reader_zc->_source,
+      reactor,
+      &reactor_reader_zc->_reader_sync_zc,
+      a0_reactor_reader_zc_read);
+  if (err) {
+    a0_reader_sync_zc_close(&reactor_reader_zc->_reader_sync_zc);
+  }
+  return err;
+}
+
+a0_err_t a0_reactor_reader_zc_close(a0_reactor_reader_zc_t* reactor_reader_zc) {
+  return a0_reactor_source_close(&reactor_reader_zc->_source);
+}
+
+//////////////
+//  Reader  //
+//////////////
+
+typedef struct a0_reactor_reader_read_data_s {
+  a0_alloc_t alloc;
+  a0_packet_t pkt;
+  a0_buf_t buf;
+} a0_reactor_reader_read_data_t;
+
+A0_STATIC_INLINE
+void a0_reactor_reader_read_impl(void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+  A0_MAYBE_UNUSED(tlk);
+  a0_reactor_reader_read_data_t* data = (a0_reactor_reader_read_data_t*)user_data;
+  a0_packet_deserialize(fpkt, data->alloc, &data->pkt, &data->buf);
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_reactor_reader_read(a0_reactor_source_t* source) {
+  a0_reactor_reader_t* reactor_reader = (a0_reactor_reader_t*)source;
+
+  a0_reactor_reader_read_data_t data = (a0_reactor_reader_read_data_t)A0_EMPTY;
+  data.alloc = reactor_reader->_alloc;
+  a0_zero_copy_callback_t zc_cb = (a0_zero_copy_callback_t){
+      .user_data = &data,
+      .fn = a0_reactor_reader_read_impl,
+  };
+  A0_RETURN_ERR_ON_ERR(a0_reader_sync_zc_read(&reactor_reader->_reader_sync_zc, zc_cb));
+
+  a0_packet_callback_call(reactor_reader->_onpacket, data.pkt);
+  a0_dealloc(reactor_reader->_alloc, data.buf);
+  return A0_OK;
+}
+
+a0_err_t a0_reactor_reader_init(a0_reactor_reader_t* reactor_reader,
+                                a0_reactor_t* reactor,
+                                a0_arena_t arena,
+                                a0_alloc_t alloc,
+                                a0_reader_options_t opts,
+                                a0_packet_callback_t onpacket) {
+  reactor_reader->_alloc = alloc;
+  reactor_reader->_onpacket = onpacket;
+  A0_RETURN_ERR_ON_ERR(a0_reader_sync_zc_init(&reactor_reader->_reader_sync_zc, arena, opts));
+
+  a0_err_t err = a0_reactor_source_init(
+      &reactor_reader->_source,
+      reactor,
+      &reactor_reader->_reader_sync_zc,
+      a0_reactor_reader_read);
+  if (err) {
+    a0_reader_sync_zc_close(&reactor_reader->_reader_sync_zc);
+  }
+  return err;
+}
+
+a0_err_t a0_reactor_reader_close(a0_reactor_reader_t* reactor_reader) {
+  return a0_reactor_source_close(&reactor_reader->_source);
+}
+
+//////////////////
+//  Subscriber  //
+//////////////////
+
+a0_err_t a0_reactor_subscriber_zc_init(a0_reactor_subscriber_zc_t* sub_zc,
+                                       a0_reactor_t* reactor,
+                                       a0_pubsub_topic_t topic,
+                                       a0_reader_options_t opts,
+                                       a0_zero_copy_callback_t onpacket) {
+  A0_RETURN_ERR_ON_ERR(a0_pubsub_topic_open(topic, &sub_zc->_file));
+
+  a0_err_t err = a0_reactor_reader_zc_init(
+      &sub_zc->_reactor_reader_zc,
+      reactor,
+      sub_zc->_file.arena,
+      opts,
+      onpacket);
+  if (err) {
+    a0_file_close(&sub_zc->_file);
+    return err;
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_reactor_subscriber_zc_close(a0_reactor_subscriber_zc_t* sub_zc) {
+  A0_RETURN_ERR_ON_ERR(a0_reactor_reader_zc_close(&sub_zc->_reactor_reader_zc));
+  a0_file_close(&sub_zc->_file);
+  return A0_OK;
+}
+
+a0_err_t a0_reactor_subscriber_init(a0_reactor_subscriber_t* sub,
+                                    a0_reactor_t* reactor,
+                                    a0_pubsub_topic_t topic,
+                                    a0_alloc_t alloc,
+                                    a0_reader_options_t opts,
+                                    a0_packet_callback_t onpacket) {
+  A0_RETURN_ERR_ON_ERR(a0_pubsub_topic_open(topic, &sub->_file));
+
+  a0_err_t err = a0_reactor_reader_init(
+      &sub->_reactor_reader,
+      reactor,
+      sub->_file.arena,
+      alloc,
+      opts,
+      onpacket);
+  if (err) {
+    a0_file_close(&sub->_file);
+    return err;
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_reactor_subscriber_close(a0_reactor_subscriber_t* sub) {
+  A0_RETURN_ERR_ON_ERR(a0_reactor_reader_close(&sub->_reactor_reader));
+  a0_file_close(&sub->_file);
+  return A0_OK;
+}
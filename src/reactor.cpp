@@ -0,0 +1,168 @@
+#include <a0/alloc.h>
+#include <a0/arena.hpp>
+#include <a0/buf.h>
+#include <a0/packet.h>
+#include <a0/packet.hpp>
+#include <a0/pubsub.h>
+#include <a0/pubsub.hpp>
+#include <a0/reactor.h>
+#include <a0/reactor.hpp>
+#include <a0/reader.h>
+#include <a0/reader.hpp>
+#include <a0/transport.h>
+#include <a0/transport.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "c_opts.hpp"
+#include "c_wrap.hpp"
+
+namespace a0 {
+
+Reactor::Options Reactor::Options::DEFAULT = {
+    .threads = A0_REACTOR_OPTIONS_DEFAULT.threads,
+    .poll_interval_ns = A0_REACTOR_OPTIONS_DEFAULT.poll_interval_ns,
+    .batch = A0_REACTOR_OPTIONS_DEFAULT.batch,
+};
+
+Reactor::Reactor(Options opts) {
+  set_c(
+      &c,
+      [&](a0_reactor_t* c) {
+        a0_reactor_options_t c_opts{
+            .threads = opts.threads,
+            .poll_interval_ns = opts.poll_interval_ns,
+            .batch = opts.batch,
+        };
+        return a0_reactor_init(c, c_opts);
+      },
+      a0_reactor_close);
+}
+
+namespace {
+
+struct ReactorZeroCopyImpl {
+  // Readers keep their reactor open.
+  Reactor reactor;
+  Arena arena;
+  std::function<void(TransportLocked, FlatPacket)> cb;
+};
+
+a0_zero_copy_callback_t ReactorZeroCopy_callback(ReactorZeroCopyImpl* impl) {
+  return {
+      .user_data = impl,
+      .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+        auto* impl = (ReactorZeroCopyImpl*)user_data;
+        impl->cb(cpp_wrap<TransportLocked>(tlk), cpp_wrap<FlatPacket>(fpkt));
+      },
+  };
+}
+
+struct ReactorImpl {
+  Reactor reactor;
+  Arena arena;
+  details::PacketBuffer data;
+  std::function<void(Packet)> cb;
+};
+
+a0_alloc_t ReactorImpl_alloc(ReactorImpl* impl) {
+  return details::packet_buffer_alloc(&impl->data);
+}
+
+a0_packet_callback_t ReactorImpl_callback(ReactorImpl* impl) {
+  return {
+      .user_data = impl,
+      .fn = [](void* user_data, a0_packet_t pkt) {
+        auto* impl = (ReactorImpl*)user_data;
+        impl->cb(impl->data.take(pkt));
+      },
+  };
+}
+
+}  // namespace
+
+ReactorReaderZeroCopy::ReactorReaderZeroCopy(
+    Reactor reactor,
+    Arena arena,
+    Reader::Options opts,
+    std::function<void(TransportLocked, FlatPacket)> cb) {
+  set_c_impl<ReactorZeroCopyImpl>(
+      &c,
+      [&](a0_reactor_reader_zc_t* c, ReactorZeroCopyImpl* impl) {
+        impl->reactor = reactor;
+        impl->arena = arena;
+        impl->cb = std::move(cb);
+        return a0_reactor_reader_zc_init(c, &*reactor.c, *arena.c, c_readeropts(opts), ReactorZeroCopy_callback(impl));
+      },
+      [](a0_reactor_reader_zc_t* c, ReactorZeroCopyImpl*) {
+        a0_reactor_reader_zc_close(c);
+      });
+}
+
+ReactorReader::ReactorReader(
+    Reactor reactor,
+    Arena arena,
+    Reader::Options opts,
+    std::function<void(Packet)> cb) {
+  set_c_impl<ReactorImpl>(
+      &c,
+      [&](a0_reactor_reader_t* c, ReactorImpl* impl) {
+        impl->reactor = reactor;
+        impl->arena = arena;
+        impl->cb = std::move(cb);
+        return a0_reactor_reader_init(c, &*reactor.c, *arena.c, ReactorImpl_alloc(impl), c_readeropts(opts), ReactorImpl_callback(impl));
+      },
+      [](a0_reactor_reader_t* c, ReactorImpl*) {
+        a0_reactor_reader_close(c);
+      });
+}
+
+ReactorSubscriberZeroCopy::ReactorSubscriberZeroCopy(
+    Reactor reactor,
+    PubSubTopic topic,
+    Reader::Options opts,
+    std::function<void(TransportLocked, FlatPacket)> cb) {
+  set_c_impl<ReactorZeroCopyImpl>(
+      &c,
+      [&](a0_reactor_subscriber_zc_t* c, ReactorZeroCopyImpl* impl) {
+        impl->reactor = reactor;
+        impl->cb = std::move(cb);
+
+        auto cfo = c_fileopts(topic.file_opts);
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
+
+        return a0_reactor_subscriber_zc_init(c, &*reactor.c, c_topic, c_readeropts(opts), ReactorZeroCopy_callback(impl));
+      },
+      [](a0_reactor_subscriber_zc_t* c, ReactorZeroCopyImpl*) {
+        a0_reactor_subscriber_zc_close(c);
+      });
+}
+
+ReactorSubscriber::ReactorSubscriber(
+    Reactor reactor,
+    PubSubTopic topic,
+    Reader::Options opts,
+    std::function<void(Packet)> cb) {
+  set_c_impl<ReactorImpl>(
+      &c,
+      [&](a0_reactor_subscriber_t* c, ReactorImpl* impl) {
+        impl->reactor = reactor;
+        impl->cb = std::move(cb);
+
+        auto cfo = c_fileopts(topic.file_opts);
+        a0_pubsub_topic_t c_topic{topic.name.c_str(), &cfo, nullptr};
+
+        return a0_reactor_subscriber_init(c, &*reactor.c, c_topic, ReactorImpl_alloc(impl), c_readeropts(opts), ReactorImpl_callback(impl));
+      },
+      [](a0_reactor_subscriber_t* c, ReactorImpl*) {
+        a0_reactor_subscriber_close(c);
+      });
+}
+
+}  // namespace a0
@@ -4,6 +4,7 @@
 #include <a0/empty.h>
 #include <a0/err.h>
 #include <a0/event.h>
+#include <a0/executor.h>
 #include <a0/inline.h>
 #include <a0/packet.h>
 #include <a0/reader.h>
@@ -16,7 +17,11 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "atomic.h"
 #include "err_macro.h"
 
 #ifdef DEBUG
@@ -26,8 +31,51 @@
 const a0_reader_options_t A0_READER_OPTIONS_DEFAULT = {
     .init = A0_INIT_AWAIT_NEW,
     .iter = A0_ITER_NEXT,
+    .seq = 0,
+    .since = {{0, 0}},
 };
 
+// Moves the transport pointer to where a new reader starts.
+//
+// A0_INIT_SEQ is resolved into A0_INIT_OLDEST, at the requested frame, or into
+// A0_INIT_AWAIT_NEW, if that frame has not been written yet. A0_INIT_SINCE
+// is resolved likewise.
+A0_STATIC_INLINE
+void a0_reader_init_jump(a0_transport_locked_t tlk, a0_reader_options_t* opts) {
+  if (opts->init == A0_INIT_SEQ) {
+    uint64_t seq_low;
+    uint64_t seq_high;
+    bool empty;
+    a0_transport_seq_low(tlk, &seq_low);
+    a0_transport_seq_high(tlk, &seq_high);
+    a0_transport_empty(tlk, &empty);
+
+    // Fails if every frame from the requested one on was discarded.
+    if (!empty && opts->seq <= seq_high &&
+        !a0_transport_jump_seq(tlk, opts->seq > seq_low ? opts->seq : seq_low)) {
+      opts->init = A0_INIT_OLDEST;
+      return;
+    }
+    opts->init = A0_INIT_AWAIT_NEW;
+  } else if (opts->init == A0_INIT_SINCE) {
+    a0_err_t err = a0_transport_jump_time(tlk, opts->since);
+    if (err == A0_ERR_RANGE) {
+      opts->init = A0_INIT_AWAIT_NEW;
+    } else {
+      opts->init = A0_INIT_OLDEST;
+      if (!err) {
+        return;
+      }
+    }
+  }
+
+  if (opts->init == A0_INIT_OLDEST) {
+    a0_transport_jump_head(tlk);
+  } else if (opts->init == A0_INIT_MOST_RECENT || opts->init == A0_INIT_AWAIT_NEW) {
+    a0_transport_jump_tail(tlk);
+  }
+}
+
 // Synchronous zero-copy version.
 
 a0_err_t a0_reader_sync_zc_init(a0_reader_sync_zc_t* reader_sync_zc,
@@ -35,16 +83,13 @@ a0_err_t a0_reader_sync_zc_init(a0_reader_sync_zc_t* reader_sync_zc,
                                 a0_reader_options_t opts) {
   reader_sync_zc->_opts = opts;
   reader_sync_zc->_first_read_done = false;
+  reader_sync_zc->_watcher = (a0_transport_watcher_t){.fd = -1, ._slot = NULL};
   A0_RETURN_ERR_ON_ERR(a0_transport_init(&reader_sync_zc->_transport, arena));
 
   a0_transport_locked_t tlk;
   A0_RETURN_ERR_ON_ERR(a0_transport_lock(&reader_sync_zc->_transport, &tlk));
 
-  if (opts.init == A0_INIT_OLDEST) {
-    a0_transport_jump_head(tlk);
-  } else if (opts.init == A0_INIT_MOST_RECENT || opts.init == A0_INIT_AWAIT_NEW) {
-    a0_transport_jump_tail(tlk);
-  }
+  a0_reader_init_jump(tlk, &reader_sync_zc->_opts);
 
   A0_RETURN_ERR_ON_ERR(a0_transport_unlock(tlk));
 
@@ -64,6 +109,29 @@ a0_err_t a0_reader_sync_zc_close(a0_reader_sync_zc_t* reader_sync_zc) {
       "Reader (sync+zc) closing. Arena was previously closed.");
 #endif
 
+  if (reader_sync_zc->_watcher._slot) {
+    a0_transport_locked_t tlk;
+    A0_RETURN_ERR_ON_ERR(a0_transport_lock(&reader_sync_zc->_transport, &tlk));
+    a0_err_t err = a0_transport_watcher_unregister(tlk, &reader_sync_zc->_watcher);
+    a0_transport_unlock(tlk);
+    return err;
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_reader_sync_zc_watch(a0_reader_sync_zc_t* reader_sync_zc, int* fd) {
+  A0_ASSERT(reader_sync_zc, "Cannot watch null reader (sync+zc).");
+
+  if (!reader_sync_zc->_watcher._slot) {
+    a0_transport_locked_t tlk;
+    A0_RETURN_ERR_ON_ERR(a0_transport_lock(&reader_sync_zc->_transport, &tlk));
+    a0_err_t err = a0_transport_watcher_register(tlk, &reader_sync_zc->_watcher);
+    a0_transport_unlock(tlk);
+    A0_RETURN_ERR_ON_ERR(err);
+  }
+
+  *fd = reader_sync_zc->_watcher.fd;
   return A0_OK;
 }
 
@@ -89,6 +157,32 @@ typedef struct a0_reader_sync_zc_align_read_callback_s {
   a0_err_t (*fn)(void* user_data, a0_reader_sync_zc_t*, a0_transport_locked_t);
 } a0_reader_sync_zc_read_align_callback_t;
 
+// Readers of READONLY arenas do not block writers, so the frame may be
+// evicted while it is being read. The frame is copied, and the copy is only
+// passed to the callback once the frame is known to have survived the copy.
+//
+// Returns ESPIPE if the frame was evicted.
+A0_STATIC_INLINE
+a0_err_t a0_reader_sync_zc_read_copy(a0_transport_locked_t tlk, a0_zero_copy_callback_t cb) {
+  // Checks that the frame data lies within the arena.
+  a0_buf_t frame_data;
+  A0_RETURN_ERR_ON_ERR(a0_transport_frame_data(tlk, &frame_data));
+
+  a0_flat_packet_t flat_packet = {
+      .buf = {(uint8_t*)malloc(frame_data.size), frame_data.size},
+  };
+  memcpy(flat_packet.buf.data, frame_data.data, frame_data.size);
+
+  bool valid;
+  a0_transport_iter_revalidate(tlk, &valid);
+  if (valid) {
+    cb.fn(cb.user_data, tlk, flat_packet);
+  }
+
+  free(flat_packet.buf.data);
+  return valid ? A0_OK : A0_MAKE_SYSERR(ESPIPE);
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_reader_sync_zc_read_helper(a0_reader_sync_zc_t* reader_sync_zc,
                                        a0_zero_copy_callback_t cb,
@@ -100,18 +194,39 @@ a0_err_t a0_reader_sync_zc_read_helper(a0_reader_sync_zc_t* reader_sync_zc,
 
   a0_err_t err = align_read.fn(align_read.user_data, reader_sync_zc, tlk);
   if (err) {
+    // The reader is idle. A commit after unlocking signals the watcher.
+    if (err == A0_ERR_AGAIN && reader_sync_zc->_watcher._slot) {
+      a0_transport_watcher_arm(tlk, &reader_sync_zc->_watcher);
+    }
     a0_transport_unlock(tlk);
     return err;
   }
 
   reader_sync_zc->_first_read_done = true;
 
-  a0_transport_frame_t* frame;
-  a0_transport_frame(tlk, &frame);
+  while (tlk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    err = a0_reader_sync_zc_read_copy(tlk, cb);
+    a0_transport_unlock(tlk);
+    if (A0_SYSERR(err) != ESPIPE) {
+      return err;
+    }
 
-  a0_flat_packet_t flat_packet = {
-      .buf = {frame->data, frame->hdr.data_size},
-  };
+    // The frame was lost to a writer. The pointer now refers to an evicted
+    // frame, so the next attempt continues from the oldest frame.
+    A0_RETURN_ERR_ON_ERR(a0_transport_lock(&reader_sync_zc->_transport, &tlk));
+    err = align_read.fn(align_read.user_data, reader_sync_zc, tlk);
+    if (err) {
+      a0_transport_unlock(tlk);
+      return err;
+    }
+  }
+
+  // Let writers and other readers proceed while the callback runs.
+  // This is a no-op if the transport has no free shared-reader slot.
+  a0_transport_downgrade(tlk);
+
+  a0_flat_packet_t flat_packet = A0_EMPTY;
+  a0_transport_frame_data(tlk, &flat_packet.buf);
 
   cb.fn(cb.user_data, tlk, flat_packet);
 
@@ -161,6 +276,61 @@ a0_err_t a0_reader_sync_zc_read(a0_reader_sync_zc_t* reader_sync_zc,
       (a0_reader_sync_zc_read_align_callback_t){NULL, a0_reader_sync_zc_read_align});
 }
 
+a0_err_t a0_reader_sync_zc_read_many(a0_reader_sync_zc_t* reader_sync_zc,
+                                     size_t max_n,
+                                     a0_zero_copy_callback_t cb,
+                                     size_t* n_read) {
+  A0_ASSERT(reader_sync_zc, "Cannot read from null reader (sync+zc).");
+
+  size_t n = 0;
+  a0_err_t err = A0_OK;
+
+  // Frames of READONLY arenas must each be copied and revalidated.
+  if (reader_sync_zc->_transport._arena.mode == A0_ARENA_MODE_READONLY) {
+    while ((!max_n || n < max_n) && !(err = a0_reader_sync_zc_read(reader_sync_zc, cb))) {
+      n++;
+    }
+    if (n_read) {
+      *n_read = n;
+    }
+    return n ? A0_OK : err;
+  }
+
+  a0_transport_locked_t tlk;
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(&reader_sync_zc->_transport, &tlk));
+
+  err = a0_reader_sync_zc_read_align(NULL, reader_sync_zc, tlk);
+  if (err) {
+    if (err == A0_ERR_AGAIN && reader_sync_zc->_watcher._slot) {
+      a0_transport_watcher_arm(tlk, &reader_sync_zc->_watcher);
+    }
+    a0_transport_unlock(tlk);
+    if (n_read) {
+      *n_read = 0;
+    }
+    return err;
+  }
+
+  reader_sync_zc->_first_read_done = true;
+
+  // The frames after the current one stay pinned by the shared lock.
+  // A batch that ends under a shared lock does not arm the watcher, since
+  // frames may have been committed after the downgrade. The next read does.
+  a0_transport_downgrade(tlk);
+
+  do {
+    a0_flat_packet_t flat_packet = A0_EMPTY;
+    a0_transport_frame_data(tlk, &flat_packet.buf);
+    cb.fn(cb.user_data, tlk, flat_packet);
+    n++;
+  } while ((!max_n || n < max_n) && !a0_reader_sync_zc_read_align(NULL, reader_sync_zc, tlk));
+
+  if (n_read) {
+    *n_read = n;
+  }
+  return a0_transport_unlock(tlk);
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_reader_sync_zc_read_blocking_align(void* unused, a0_reader_sync_zc_t* reader_sync_zc, a0_transport_locked_t tlk) {
   A0_MAYBE_UNUSED(unused);
@@ -248,6 +418,12 @@ a0_err_t a0_reader_sync_can_read(a0_reader_sync_t* reader_sync, bool* can_read)
   return a0_reader_sync_zc_can_read(&reader_sync->_reader_sync_zc, can_read);
 }
 
+a0_err_t a0_reader_sync_watch(a0_reader_sync_t* reader_sync, int* fd) {
+  A0_ASSERT(reader_sync, "Cannot watch null reader (sync).");
+
+  return a0_reader_sync_zc_watch(&reader_sync->_reader_sync_zc, fd);
+}
+
 typedef struct a0_reader_sync_read_data_s {
   a0_alloc_t alloc;
   a0_packet_t* out_pkt;
@@ -295,16 +471,79 @@ a0_err_t a0_reader_sync_read_blocking_timeout(a0_reader_sync_t* reader_sync, a0_
 
 // Threaded zero-copy version.
 
+// The reader thread holds the exclusive lock between waits. A lease downgrades
+// it for the duration of a callback, pinning the frames from the current one
+// onward, so that writers and other readers are not held up by the callback.
+//
+// A leased connection may not be shut down, so close holds _lease_mu while it
+// shuts down, and the reader thread skips the lease if close is underway.
+A0_STATIC_INLINE
+bool a0_reader_zc_lease_acquire(a0_reader_zc_t* reader_zc, a0_transport_locked_t tlk) {
+  if (pthread_mutex_trylock(&reader_zc->_lease_mu)) {
+    return false;
+  }
+  a0_transport_downgrade(tlk);
+  return true;
+}
+
+// Returns to the exclusive lock, which the reader thread waits under.
+// The callback may itself have released the lease, by unlocking and relocking.
+A0_STATIC_INLINE
+void a0_reader_zc_lease_release(a0_reader_zc_t* reader_zc, a0_transport_locked_t tlk, bool leased) {
+  if (!leased) {
+    return;
+  }
+  bool shared;
+  a0_transport_is_shared(tlk, &shared);
+  if (shared) {
+    a0_transport_unlock(tlk);
+    a0_transport_lock(tlk.transport, &tlk);
+  }
+  pthread_mutex_unlock(&reader_zc->_lease_mu);
+}
+
+// Gathers the current frame, and those committed after it, into one batch.
+A0_STATIC_INLINE
+void a0_reader_zc_thread_handle_batch(a0_reader_zc_t* reader_zc, a0_transport_locked_t tlk) {
+  // Lease before gathering, so that the whole batch is pinned.
+  bool leased = a0_reader_zc_lease_acquire(reader_zc, tlk);
+
+  size_t n = 0;
+  while (true) {
+    reader_zc->_batch[n] = (a0_flat_packet_t)A0_EMPTY;
+    a0_transport_frame_data(tlk, &reader_zc->_batch[n++].buf);
+
+    if (n == reader_zc->_batch_cap || reader_zc->_opts.iter != A0_ITER_NEXT) {
+      break;
+    }
+    bool has_next;
+    a0_transport_has_next(tlk, &has_next);
+    if (!has_next) {
+      break;
+    }
+    a0_transport_step_next(tlk);
+  }
+
+  reader_zc->_onbatch.fn(reader_zc->_onbatch.user_data, tlk, reader_zc->_batch, n);
+
+  a0_reader_zc_lease_release(reader_zc, tlk, leased);
+}
+
 A0_STATIC_INLINE
 void a0_reader_zc_thread_handle_pkt(a0_reader_zc_t* reader_zc, a0_transport_locked_t tlk) {
-  a0_transport_frame_t* frame;
-  a0_transport_frame(tlk, &frame);
+  if (reader_zc->_batch) {
+    a0_reader_zc_thread_handle_batch(reader_zc, tlk);
+    return;
+  }
 
-  a0_flat_packet_t fpkt = {
-      .buf = {frame->data, frame->hdr.data_size},
-  };
+  bool leased = a0_reader_zc_lease_acquire(reader_zc, tlk);
+
+  a0_flat_packet_t fpkt = A0_EMPTY;
+  a0_transport_frame_data(tlk, &fpkt.buf);
 
   reader_zc->_onpacket.fn(reader_zc->_onpacket.user_data, tlk, fpkt);
+
+  a0_reader_zc_lease_release(reader_zc, tlk, leased);
 }
 
 A0_STATIC_INLINE
@@ -374,14 +613,8 @@ void* a0_reader_zc_thread_main(void* data) {
   return NULL;
 }
 
-a0_err_t a0_reader_zc_init(a0_reader_zc_t* reader_zc,
-                           a0_arena_t arena,
-                           a0_reader_options_t opts,
-                           a0_zero_copy_callback_t onpacket) {
-  *reader_zc = (a0_reader_zc_t)A0_EMPTY;
-  reader_zc->_opts = opts;
-  reader_zc->_onpacket = onpacket;
-
+A0_STATIC_INLINE
+a0_err_t a0_reader_zc_start(a0_reader_zc_t* reader_zc, a0_arena_t arena) {
   A0_RETURN_ERR_ON_ERR(a0_transport_init(&reader_zc->_transport, arena));
 
 #ifdef DEBUG
@@ -392,16 +625,11 @@ a0_err_t a0_reader_zc_init(a0_reader_zc_t* reader_zc,
   a0_transport_lock(&reader_zc->_transport, &tlk);
 
   a0_transport_empty(tlk, &reader_zc->_started_empty);
-  if (!reader_zc->_started_empty) {
-    if (opts.init == A0_INIT_OLDEST) {
-      a0_transport_jump_head(tlk);
-    } else if (opts.init == A0_INIT_MOST_RECENT || opts.init == A0_INIT_AWAIT_NEW) {
-      a0_transport_jump_tail(tlk);
-    }
-  }
+  a0_reader_init_jump(tlk, &reader_zc->_opts);
 
   a0_transport_unlock(tlk);
 
+  pthread_mutex_init(&reader_zc->_lease_mu, NULL);
   pthread_create(
       &reader_zc->_thread,
       NULL,
@@ -411,6 +639,43 @@ a0_err_t a0_reader_zc_init(a0_reader_zc_t* reader_zc,
   return A0_OK;
 }
 
+a0_err_t a0_reader_zc_init(a0_reader_zc_t* reader_zc,
+                           a0_arena_t arena,
+                           a0_reader_options_t opts,
+                           a0_zero_copy_callback_t onpacket) {
+  *reader_zc = (a0_reader_zc_t)A0_EMPTY;
+  reader_zc->_opts = opts;
+  reader_zc->_onpacket = onpacket;
+
+  return a0_reader_zc_start(reader_zc, arena);
+}
+
+a0_err_t a0_reader_zc_init_batch(a0_reader_zc_t* reader_zc,
+                                 a0_arena_t arena,
+                                 a0_reader_options_t opts,
+                                 size_t max_batch,
+                                 a0_zero_copy_batch_callback_t onbatch) {
+  if (!max_batch) {
+    return A0_MAKE_SYSERR(EINVAL);
+  }
+
+  *reader_zc = (a0_reader_zc_t)A0_EMPTY;
+  reader_zc->_opts = opts;
+  reader_zc->_onbatch = onbatch;
+  reader_zc->_batch_cap = max_batch;
+  reader_zc->_batch = (a0_flat_packet_t*)malloc(max_batch * sizeof(a0_flat_packet_t));
+  if (!reader_zc->_batch) {
+    return A0_MAKE_SYSERR(ENOMEM);
+  }
+
+  a0_err_t err = a0_reader_zc_start(reader_zc, arena);
+  if (err) {
+    free(reader_zc->_batch);
+    reader_zc->_batch = NULL;
+  }
+  return err;
+}
+
 a0_err_t a0_reader_zc_close(a0_reader_zc_t* reader_zc) {
   a0_event_wait(&reader_zc->_thread_start_event);
   if (pthread_equal(pthread_self(), reader_zc->_thread_id)) {
@@ -420,16 +685,92 @@ a0_err_t a0_reader_zc_close(a0_reader_zc_t* reader_zc) {
   a0_ref_cnt_dec(reader_zc->_transport._arena.buf.data, NULL);
 #endif
 
+  pthread_mutex_lock(&reader_zc->_lease_mu);
   a0_transport_locked_t tlk;
   a0_transport_lock(&reader_zc->_transport, &tlk);
   a0_transport_shutdown(tlk);
   a0_transport_unlock(tlk);
+  pthread_mutex_unlock(&reader_zc->_lease_mu);
 
   pthread_join(reader_zc->_thread, NULL);
+  pthread_mutex_destroy(&reader_zc->_lease_mu);
+
+  free(reader_zc->_batch);
+  reader_zc->_batch = NULL;
 
   return A0_OK;
 }
 
+// Busy-polling threaded zero-copy version.
+
+// Reads every frame available, under one lock each.
+A0_STATIC_INLINE
+void a0_reader_spin_zc_drain(a0_reader_spin_zc_t* reader_spin_zc) {
+  while (a0_reader_sync_zc_read(&reader_spin_zc->_reader_sync_zc, reader_spin_zc->_onpacket) == A0_OK) {
+  }
+}
+
+A0_STATIC_INLINE
+void* a0_reader_spin_zc_thread_main(void* data) {
+  a0_reader_spin_zc_t* reader_spin_zc = (a0_reader_spin_zc_t*)data;
+  // Alert that the thread has started.
+  reader_spin_zc->_thread_id = a0_tid();
+  a0_event_set(&reader_spin_zc->_thread_start_event);
+
+  a0_transport_t* transport = &reader_spin_zc->_reader_sync_zc._transport;
+
+  // The first read may be of frames committed before the reader started.
+  uint64_t seen_seq_high;
+  a0_transport_poll_seq_high(transport, &seen_seq_high);
+  a0_reader_spin_zc_drain(reader_spin_zc);
+
+  while (!a0_atomic_load(&reader_spin_zc->_shutdown)) {
+    uint64_t seq_high;
+    a0_transport_poll_seq_high(transport, &seq_high);
+    if (seq_high == seen_seq_high) {
+      a0_transport_poll_pause(transport, seen_seq_high, reader_spin_zc->_backoff);
+      continue;
+    }
+
+    seen_seq_high = seq_high;
+    a0_reader_spin_zc_drain(reader_spin_zc);
+  }
+
+  return NULL;
+}
+
+a0_err_t a0_reader_spin_zc_init(a0_reader_spin_zc_t* reader_spin_zc,
+                                a0_arena_t arena,
+                                a0_reader_options_t opts,
+                                a0_transport_poll_backoff_t backoff,
+                                a0_zero_copy_callback_t onpacket) {
+  *reader_spin_zc = (a0_reader_spin_zc_t)A0_EMPTY;
+  reader_spin_zc->_backoff = backoff;
+  reader_spin_zc->_onpacket = onpacket;
+
+  A0_RETURN_ERR_ON_ERR(a0_reader_sync_zc_init(&reader_spin_zc->_reader_sync_zc, arena, opts));
+
+  pthread_create(
+      &reader_spin_zc->_thread,
+      NULL,
+      a0_reader_spin_zc_thread_main,
+      reader_spin_zc);
+
+  return A0_OK;
+}
+
+a0_err_t a0_reader_spin_zc_close(a0_reader_spin_zc_t* reader_spin_zc) {
+  a0_event_wait(&reader_spin_zc->_thread_start_event);
+  if (a0_tid() == reader_spin_zc->_thread_id) {
+    return A0_MAKE_SYSERR(EDEADLK);
+  }
+
+  a0_atomic_store(&reader_spin_zc->_shutdown, true);
+  pthread_join(reader_spin_zc->_thread, NULL);
+
+  return a0_reader_sync_zc_close(&reader_spin_zc->_reader_sync_zc);
+}
+
 // Threaded version.
 
 A0_STATIC_INLINE
@@ -446,24 +787,107 @@ void a0_reader_onpacket_wrapper(void* user_data, a0_transport_locked_t tlk, a0_f
   a0_transport_lock(tlk.transport, &tlk);
 }
 
+// A packet copied out of the transport, waiting for a worker.
+typedef struct a0_reader_dispatched_s {
+  a0_reader_t* reader;
+  a0_flat_packet_t fpkt;
+  uint8_t data[];
+} a0_reader_dispatched_t;
+
+A0_STATIC_INLINE
+a0_err_t a0_reader_dispatched_run(void* user_data) {
+  a0_reader_dispatched_t* dispatched = (a0_reader_dispatched_t*)user_data;
+  a0_reader_t* reader = dispatched->reader;
+
+  a0_packet_t pkt;
+  a0_buf_t buf;
+  a0_packet_deserialize(dispatched->fpkt, reader->_alloc, &pkt, &buf);
+  a0_packet_callback_call(reader->_onpacket, pkt);
+  a0_dealloc(reader->_alloc, buf);
+
+  free(dispatched);
+  return A0_OK;
+}
+
+// Runs the callback on the reader thread, after the callbacks already
+// dispatched, so that a packet that cannot be dispatched is neither dropped
+// nor reordered.
+A0_STATIC_INLINE
+void a0_reader_onpacket_inline(a0_reader_t* reader, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+  a0_packet_t pkt;
+  a0_buf_t buf;
+  a0_packet_deserialize(fpkt, reader->_alloc, &pkt, &buf);
+  a0_transport_unlock(tlk);
+
+  a0_executor_group_wait(&reader->_group);
+  a0_packet_callback_call(reader->_onpacket, pkt);
+  a0_dealloc(reader->_alloc, buf);
+
+  a0_transport_lock(tlk.transport, &tlk);
+}
+
+A0_STATIC_INLINE
+void a0_reader_onpacket_dispatch(void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+  a0_reader_t* reader = (a0_reader_t*)user_data;
+
+  a0_reader_dispatched_t* dispatched = (a0_reader_dispatched_t*)malloc(sizeof(a0_reader_dispatched_t) + fpkt.buf.size);
+  if (!dispatched) {
+    a0_reader_onpacket_inline(reader, tlk, fpkt);
+    return;
+  }
+  dispatched->reader = reader;
+  memcpy(dispatched->data, fpkt.buf.data, fpkt.buf.size);
+  dispatched->fpkt = (a0_flat_packet_t){{dispatched->data, fpkt.buf.size}};
+
+  a0_executor_task_t task = (a0_executor_task_t)A0_EMPTY;
+  task.fn = (a0_callback_t){
+      .user_data = dispatched,
+      .fn = a0_reader_dispatched_run,
+  };
+  task.group = &reader->_group;
+  if (reader->_dispatch.key.fn) {
+    task.ordered = reader->_dispatch.key.fn(reader->_dispatch.key.user_data, dispatched->fpkt, &task.key);
+  }
+
+  if (a0_executor_submit(reader->_dispatch.executor, task)) {
+    a0_reader_onpacket_inline(reader, tlk, dispatched->fpkt);
+    free(dispatched);
+  }
+}
+
 a0_err_t a0_reader_init(a0_reader_t* reader,
                         a0_arena_t arena,
                         a0_alloc_t alloc,
                         a0_reader_options_t opts,
                         a0_packet_callback_t onpacket) {
+  return a0_reader_init_dispatch(reader, arena, alloc, opts, (a0_executor_dispatch_t)A0_EMPTY, onpacket);
+}
+
+a0_err_t a0_reader_init_dispatch(a0_reader_t* reader,
+                                 a0_arena_t arena,
+                                 a0_alloc_t alloc,
+                                 a0_reader_options_t opts,
+                                 a0_executor_dispatch_t dispatch,
+                                 a0_packet_callback_t onpacket) {
   reader->_alloc = alloc;
   reader->_onpacket = onpacket;
+  reader->_dispatch = dispatch;
+  reader->_group = (a0_executor_group_t)A0_EMPTY;
 
   a0_zero_copy_callback_t onpacket_wrapper = (a0_zero_copy_callback_t){
       .user_data = reader,
-      .fn = a0_reader_onpacket_wrapper,
+      .fn = dispatch.executor ? a0_reader_onpacket_dispatch : a0_reader_onpacket_wrapper,
   };
 
   return a0_reader_zc_init(&reader->_reader_zc, arena, opts, onpacket_wrapper);
 }
 
 a0_err_t a0_reader_close(a0_reader_t* reader) {
-  return a0_reader_zc_close(&reader->_reader_zc);
+  A0_RETURN_ERR_ON_ERR(a0_reader_zc_close(&reader->_reader_zc));
+  if (reader->_dispatch.executor) {
+    A0_RETURN_ERR_ON_ERR(a0_executor_group_wait(&reader->_group));
+  }
+  return A0_OK;
 }
 
 a0_err_t a0_read_random_access(a0_arena_t arena, size_t off, a0_zero_copy_callback_t cb) {
@@ -478,10 +902,10 @@ a0_err_t a0_read_random_access(a0_arena_t arena, size_t off, a0_zero_copy_callba
     a0_transport_unlock(tlk);
     return err;
   }
-  a0_transport_frame_t* frame;
-  a0_transport_frame(tlk, &frame);
+  a0_flat_packet_t flat_packet = A0_EMPTY;
+  a0_transport_frame_data(tlk, &flat_packet.buf);
 
-  cb.fn(cb.user_data, tlk, (a0_flat_packet_t){{frame->data, frame->hdr.data_size}});
+  cb.fn(cb.user_data, tlk, flat_packet);
 
   return a0_transport_unlock(tlk);
 }
@@ -27,6 +27,7 @@ namespace a0 {
 Reader::Options Reader::Options::DEFAULT = {
     (Reader::Init)A0_READER_OPTIONS_DEFAULT.init,
     (Reader::Iter)A0_READER_OPTIONS_DEFAULT.iter,
+    A0_READER_OPTIONS_DEFAULT.seq,
 };
 
 ReaderSyncZeroCopy::ReaderSyncZeroCopy(Arena arena, Reader::Options opts) {
@@ -47,6 +48,13 @@ bool ReaderSyncZeroCopy::can_read() {
   return ret;
 }
 
+int ReaderSyncZeroCopy::watch() {
+  CHECK_C;
+  int fd;
+  check(a0_reader_sync_zc_watch(&*c, &fd));
+  return fd;
+}
+
 A0_STATIC_INLINE
 a0_zero_copy_callback_t ReadZeroCopy_CallbackWrapper(std::function<void(TransportLocked, FlatPacket)>* fn) {
   return {
@@ -65,6 +73,16 @@ void ReaderSyncZeroCopy::read(std::function<void(TransportLocked, FlatPacket)> f
   check(a0_reader_sync_zc_read(&*c, ReadZeroCopy_CallbackWrapper(&fn)));
 }
 
+size_t ReaderSyncZeroCopy::read_many(size_t max_n, std::function<void(TransportLocked, FlatPacket)> fn) {
+  CHECK_C;
+  size_t n_read = 0;
+  auto err = a0_reader_sync_zc_read_many(&*c, max_n, ReadZeroCopy_CallbackWrapper(&fn), &n_read);
+  if (err != A0_ERR_AGAIN) {
+    check(err);
+  }
+  return n_read;
+}
+
 void ReaderSyncZeroCopy::read_blocking(std::function<void(TransportLocked, FlatPacket)> fn) {
   CHECK_C;
   check(a0_reader_sync_zc_read_blocking(&*c, ReadZeroCopy_CallbackWrapper(&fn)));
@@ -79,7 +97,7 @@ namespace {
 
 struct ReaderSyncImpl {
   Arena arena;
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
 };
 
 }  // namespace
@@ -90,16 +108,7 @@ ReaderSync::ReaderSync(Arena arena, Reader::Options opts) {
       [&](a0_reader_sync_t* c, ReaderSyncImpl* impl) {
         impl->arena = arena;
 
-        a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (ReaderSyncImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
-            },
-            .dealloc = nullptr,
-        };
+        a0_alloc_t alloc = details::packet_buffer_alloc(&impl->data);
         return a0_reader_sync_init(c, *arena.c, alloc, c_readeropts(opts));
       },
       [](a0_reader_sync_t* c, ReaderSyncImpl*) {
@@ -114,15 +123,20 @@ bool ReaderSync::can_read() {
   return ret;
 }
 
+int ReaderSync::watch() {
+  CHECK_C;
+  int fd;
+  check(a0_reader_sync_watch(&*c, &fd));
+  return fd;
+}
+
 Packet ReaderSync::read() {
   CHECK_C;
   auto* impl = c_impl<ReaderSyncImpl>(&c);
 
   a0_packet_t pkt;
   check(a0_reader_sync_read(&*c, &pkt));
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  std::swap(*data, impl->data);
-  return Packet(pkt, [data](a0_packet_t*) {});
+  return impl->data.take(pkt);
 }
 
 Packet ReaderSync::read_blocking() {
@@ -131,9 +145,7 @@ Packet ReaderSync::read_blocking() {
 
   a0_packet_t pkt;
   check(a0_reader_sync_read_blocking(&*c, &pkt));
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  std::swap(*data, impl->data);
-  return Packet(pkt, [data](a0_packet_t*) {});
+  return impl->data.take(pkt);
 }
 
 Packet ReaderSync::read_blocking(TimeMono timeout) {
@@ -142,9 +154,7 @@ Packet ReaderSync::read_blocking(TimeMono timeout) {
 
   a0_packet_t pkt;
   check(a0_reader_sync_read_blocking_timeout(&*c, &*timeout.c, &pkt));
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  std::swap(*data, impl->data);
-  return Packet(pkt, [data](a0_packet_t*) {});
+  return impl->data.take(pkt);
 }
 
 namespace {
@@ -179,11 +189,36 @@ ReaderZeroCopy::ReaderZeroCopy(
       });
 }
 
+ReaderSpinZeroCopy::ReaderSpinZeroCopy(
+    Arena arena,
+    Reader::Options opts,
+    Backoff backoff,
+    std::function<void(TransportLocked, FlatPacket)> cb) {
+  set_c_impl<ReaderZeroCopyImpl>(
+      &c,
+      [&](a0_reader_spin_zc_t* c, ReaderZeroCopyImpl* impl) {
+        impl->cb = std::move(cb);
+
+        a0_zero_copy_callback_t c_cb = {
+            .user_data = impl,
+            .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+              auto* impl = (ReaderZeroCopyImpl*)user_data;
+              impl->cb(cpp_wrap<TransportLocked>(tlk), cpp_wrap<FlatPacket>(fpkt));
+            },
+        };
+
+        return a0_reader_spin_zc_init(c, *arena.c, c_readeropts(opts), (a0_transport_poll_backoff_t)backoff, c_cb);
+      },
+      [arena](a0_reader_spin_zc_t* c, ReaderZeroCopyImpl*) {
+        a0_reader_spin_zc_close(c);
+      });
+}
+
 namespace {
 
 struct ReaderImpl {
   Arena arena;
-  std::vector<uint8_t> data;
+  Dispatch dispatch;
   std::function<void(Packet)> cb;
 };
 
@@ -192,20 +227,25 @@ struct ReaderImpl {
 Reader::Reader(
     Arena arena,
     Reader::Options opts,
+    std::function<void(Packet)> cb)
+    : Reader(arena, opts, Dispatch(), std::move(cb)) {}
+
+Reader::Reader(
+    Arena arena,
+    Reader::Options opts,
+    Dispatch dispatch,
     std::function<void(Packet)> cb) {
   set_c_impl<ReaderImpl>(
       &c,
       [&](a0_reader_t* c, ReaderImpl* impl) {
         impl->arena = arena;
+        impl->dispatch = std::move(dispatch);
         impl->cb = cb;
 
         a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (ReaderImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
+            .user_data = nullptr,
+            .alloc = [](void*, size_t size, a0_buf_t* out) {
+              return deserialize_buffer()->alloc(size, out);
             },
             .dealloc = nullptr,
         };
@@ -214,12 +254,10 @@ Reader::Reader(
             .user_data = impl,
             .fn = [](void* user_data, a0_packet_t pkt) {
               auto* impl = (ReaderImpl*)user_data;
-              auto data = std::make_shared<std::vector<uint8_t>>();
-              std::swap(*data, impl->data);
-              impl->cb(Packet(pkt, [data](a0_packet_t*) {}));
+              impl->cb(deserialize_buffer()->take(pkt));
             }};
 
-        return a0_reader_init(c, *arena.c, alloc, c_readeropts(opts), c_cb);
+        return a0_reader_init_dispatch(c, *arena.c, alloc, c_readeropts(opts), c_dispatch(&impl->dispatch), c_cb);
       },
       [](a0_reader_t* c, ReaderImpl*) {
         a0_reader_close(c);
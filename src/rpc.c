@@ -66,6 +66,15 @@ a0_err_t a0_rpc_server_init(a0_rpc_server_t* server,
                             a0_alloc_t alloc,
                             a0_rpc_request_callback_t onrequest,
                             a0_packet_id_callback_t oncancel) {
+  return a0_rpc_server_init_dispatch(server, topic, alloc, (a0_executor_dispatch_t)A0_EMPTY, onrequest, oncancel);
+}
+
+a0_err_t a0_rpc_server_init_dispatch(a0_rpc_server_t* server,
+                                     a0_rpc_topic_t topic,
+                                     a0_alloc_t alloc,
+                                     a0_executor_dispatch_t dispatch,
+                                     a0_rpc_request_callback_t onrequest,
+                                     a0_packet_id_callback_t oncancel) {
   server->_onrequest = onrequest;
   server->_oncancel = oncancel;
 
@@ -86,11 +95,12 @@ a0_err_t a0_rpc_server_init(a0_rpc_server_t* server,
     return err;
   }
 
-  err = a0_reader_init(
+  err = a0_reader_init_dispatch(
       &server->_request_reader,
       server->_file.arena,
       alloc,
-      (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT},
+      (a0_reader_options_t){.init = A0_INIT_AWAIT_NEW, .iter = A0_ITER_NEXT},
+      dispatch,
       (a0_packet_callback_t){
           .user_data = server,
           .fn = a0_rpc_server_onpacket,
@@ -220,7 +230,7 @@ a0_err_t a0_rpc_client_init(a0_rpc_client_t* client,
       &client->_response_reader,
       client->_file.arena,
       alloc,
-      (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT},
+      (a0_reader_options_t){.init = A0_INIT_AWAIT_NEW, .iter = A0_ITER_NEXT},
       (a0_packet_callback_t){
           .user_data = client,
           .fn = a0_rpc_client_onpacket,
@@ -276,7 +286,7 @@ a0_err_t a0_rpc_client_send_blocking_timeout(a0_rpc_client_t* client, a0_packet_
       &reader_sync,
       client->_file.arena,
       alloc,
-      (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT}));
+      (a0_reader_options_t){.init = A0_INIT_AWAIT_NEW, .iter = A0_ITER_NEXT}));
 
   a0_err_t err = a0_rpc_client_send(client, pkt, (a0_packet_callback_t)A0_EMPTY);
   while (!err) {
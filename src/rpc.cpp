@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "c_opts.hpp"
 #include "c_wrap.hpp"
 
@@ -30,7 +31,7 @@ namespace a0 {
 namespace {
 
 struct RpcServerRequestImpl {
-  std::vector<uint8_t> data;
+  details::PacketBuffer data;
 };
 
 }  // namespace
@@ -54,7 +55,7 @@ void RpcRequest::reply(Packet pkt) {
 namespace {
 
 struct RpcServerImpl {
-  std::vector<uint8_t> data;
+  Dispatch dispatch;
   std::function<void(RpcRequest)> onrequest;
   std::function<void(string_view)> oncancel;
 };
@@ -64,10 +65,18 @@ struct RpcServerImpl {
 RpcServer::RpcServer(
     RpcTopic topic,
     std::function<void(RpcRequest)> onrequest,
+    std::function<void(string_view /* id */)> oncancel)
+    : RpcServer(std::move(topic), Dispatch(), std::move(onrequest), std::move(oncancel)) {}
+
+RpcServer::RpcServer(
+    RpcTopic topic,
+    Dispatch dispatch,
+    std::function<void(RpcRequest)> onrequest,
     std::function<void(string_view /* id */)> oncancel) {
   set_c_impl<RpcServerImpl>(
       &c,
       [&](a0_rpc_server_t* c, RpcServerImpl* impl) {
+        impl->dispatch = std::move(dispatch);
         impl->onrequest = std::move(onrequest);
         impl->oncancel = std::move(oncancel);
 
@@ -75,12 +84,9 @@ RpcServer::RpcServer(
         a0_rpc_topic_t c_topic{topic.name.c_str(), &cfo};
 
         a0_alloc_t alloc = {
-            .user_data = impl,
-            .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-              auto* impl = (RpcServerImpl*)user_data;
-              impl->data.resize(size);
-              *out = {impl->data.data(), size};
-              return A0_OK;
+            .user_data = nullptr,
+            .alloc = [](void*, size_t size, a0_buf_t* out) {
+              return deserialize_buffer()->alloc(size, out);
             },
             .dealloc = nullptr,
         };
@@ -92,7 +98,7 @@ RpcServer::RpcServer(
 
               RpcRequest cpp_req = make_cpp_impl<RpcRequest, RpcServerRequestImpl>(
                   [&](a0_rpc_request_t* c_req, RpcServerRequestImpl* req_impl) {
-                    std::swap(impl->data, req_impl->data);
+                    deserialize_buffer()->swap(req_impl->data);
                     *c_req = req;
                     return A0_OK;
                   });
@@ -107,7 +113,7 @@ RpcServer::RpcServer(
               impl->oncancel(id);
             }};
 
-        return a0_rpc_server_init(c, c_topic, alloc, c_onrequest, c_oncancel);
+        return a0_rpc_server_init_dispatch(c, c_topic, alloc, c_dispatch(&impl->dispatch), c_onrequest, c_oncancel);
       },
       [](a0_rpc_server_t* c, RpcServerImpl*) {
         a0_rpc_server_close(c);
@@ -193,41 +199,23 @@ void RpcClient::send(Packet pkt, std::function<void(Packet)> onreply) {
 Packet RpcClient::send_blocking(Packet pkt) {
   CHECK_C;
 
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  a0_alloc_t alloc = {
-      .user_data = data.get(),
-      .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-        auto* data = (std::vector<uint8_t>*)user_data;
-        data->resize(size);
-        *out = {data->data(), size};
-        return A0_OK;
-      },
-      .dealloc = nullptr,
-  };
+  details::PacketBuffer data;
+  a0_alloc_t alloc = details::packet_buffer_alloc(&data);
 
   a0_packet_t resp;
   check(a0_rpc_client_send_blocking(&*c, *pkt.c, alloc, &resp));
-  return Packet(resp, [data](a0_packet_t*) {});
+  return data.take(resp);
 }
 
 Packet RpcClient::send_blocking(Packet pkt, TimeMono timeout) {
   CHECK_C;
 
-  auto data = std::make_shared<std::vector<uint8_t>>();
-  a0_alloc_t alloc = {
-      .user_data = data.get(),
-      .alloc = [](void* user_data, size_t size, a0_buf_t* out) {
-        auto* data = (std::vector<uint8_t>*)user_data;
-        data->resize(size);
-        *out = {data->data(), size};
-        return A0_OK;
-      },
-      .dealloc = nullptr,
-  };
+  details::PacketBuffer data;
+  a0_alloc_t alloc = details::packet_buffer_alloc(&data);
 
   a0_packet_t resp;
   check(a0_rpc_client_send_blocking_timeout(&*c, *pkt.c, &*timeout.c, alloc, &resp));
-  return Packet(resp, [data](a0_packet_t*) {});
+  return data.take(resp);
 }
 
 std::future<Packet> RpcClient::send(Packet pkt) {
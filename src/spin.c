@@ -0,0 +1,96 @@
+#include "spin.h"
+
+#include <a0/unused.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#include "atomic.h"
+#include "clock.h"
+
+#define A0_SPIN_CALIBRATION_ITERS 1024
+#define A0_SPIN_CALIBRATION_ROUNDS 8
+
+// TSC cycles an UMWAIT may sleep without a write. The kernel caps this further,
+// through IA32_UMWAIT_CONTROL.
+#define A0_SPIN_UMWAIT_CYCLES 100000
+
+// Picoseconds per a0_spin_relax. Zero until calibrated.
+static uint32_t a0_spin_ps_per_iter;
+
+static uint32_t a0_spin_calibrate() {
+  // Take the fastest round, to discount preemption.
+  uint64_t best_ns = UINT64_MAX;
+  for (int round = 0; round < A0_SPIN_CALIBRATION_ROUNDS; round++) {
+    timespec_t start;
+    timespec_t end;
+    a0_clock_now(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < A0_SPIN_CALIBRATION_ITERS; i++) {
+      a0_spin_relax();
+    }
+    a0_clock_now(CLOCK_MONOTONIC, &end);
+    uint64_t ns = (uint64_t)((end.tv_sec - start.tv_sec) * NS_PER_SEC + (end.tv_nsec - start.tv_nsec));
+    if (ns < best_ns) {
+      best_ns = ns;
+    }
+  }
+
+  uint64_t ps = best_ns * 1000 / A0_SPIN_CALIBRATION_ITERS;
+  return ps ? (uint32_t)ps : 1;
+}
+
+uint32_t a0_spin_iters(uint32_t ns) {
+  if (!ns) {
+    return 0;
+  }
+  // Racing calibrations store similar values, so the race is benign.
+  uint32_t ps_per_iter = a0_atomic_load(&a0_spin_ps_per_iter);
+  if (!ps_per_iter) {
+    ps_per_iter = a0_spin_calibrate();
+    a0_atomic_store(&a0_spin_ps_per_iter, ps_per_iter);
+  }
+  uint64_t iters = (uint64_t)ns * 1000 / ps_per_iter;
+  return iters > UINT32_MAX ? UINT32_MAX : (iters ? (uint32_t)iters : 1);
+}
+
+#if defined(__x86_64__)
+
+// Whether the cpu supports WAITPKG: zero until checked, then 1 for yes or 2 for no.
+static uint32_t a0_spin_waitpkg;
+
+bool a0_spin_umwait(const uint32_t* addr, uint32_t val) {
+  uint32_t waitpkg = a0_atomic_load(&a0_spin_waitpkg);
+  if (!waitpkg) {
+    unsigned int eax, ebx, ecx, edx;
+    waitpkg = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 5)) ? 1 : 2;
+    a0_atomic_store(&a0_spin_waitpkg, waitpkg);
+  }
+  if (waitpkg != 1) {
+    return false;
+  }
+
+  // Arm the monitor before the check, so a write after the check ends the wait.
+  __asm__ __volatile__("umonitor %0" ::"r"(addr) : "memory");
+  if (a0_atomic_load(addr) == val) {
+    // Control 1 selects C0.1, which is shallower and faster to wake than C0.2.
+    const uint64_t deadline = __rdtsc() + A0_SPIN_UMWAIT_CYCLES;
+    __asm__ __volatile__("umwait %0" ::"r"(1u), "a"((uint32_t)deadline), "d"((uint32_t)(deadline >> 32)) : "memory", "cc");
+  }
+  return true;
+}
+
+#else
+
+bool a0_spin_umwait(const uint32_t* addr, uint32_t val) {
+  A0_MAYBE_UNUSED(addr);
+  A0_MAYBE_UNUSED(val);
+  return false;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef A0_SRC_SPIN_H
+#define A0_SRC_SPIN_H
+
+#include <a0/inline.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hints to the cpu that this is a busy-wait loop.
+//
+// On x86, PAUSE yields pipeline resources to the sibling hyperthread and avoids
+// the memory-order mis-speculation penalty when the polled line changes.
+A0_STATIC_INLINE
+void a0_spin_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  a0_barrier();
+#endif
+}
+
+// Number of a0_spin_relax iterations that take roughly the given duration.
+//
+// The cost of a relax varies by an order of magnitude between cpus, so it is
+// measured once per process.
+uint32_t a0_spin_iters(uint32_t ns);
+
+// Waits in a light sleep state until the cache line holding addr is written,
+// or a short deadline passes. Returns immediately if *addr != val.
+//
+// Returns false, without waiting, if the cpu does not support UMWAIT.
+bool a0_spin_umwait(const uint32_t* addr, uint32_t val);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // A0_SRC_SPIN_H
@@ -0,0 +1,147 @@
+#include <a0/coro.hpp>
+#include <a0/file.h>
+#include <a0/packet.hpp>
+#include <a0/prpc.hpp>
+#include <a0/pubsub.hpp>
+#include <a0/reader.hpp>
+#include <a0/rpc.hpp>
+
+#include <doctest.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#if A0_CPP_20
+
+struct CoroFixture {
+  CoroFixture() {
+    clear();
+  }
+
+  ~CoroFixture() {
+    clear();
+  }
+
+  void clear() {
+    a0_file_remove("test.pubsub.a0");
+    a0_file_remove("test.rpc.a0");
+    a0_file_remove("test.prpc.a0");
+  }
+};
+
+namespace {
+
+a0::coro::Task<std::vector<std::string>> relay(a0::coro::Scheduler sched, int n) {
+  a0::coro::Subscriber sub(sched, "test", a0::Reader::Options(a0::INIT_OLDEST));
+  a0::coro::RpcClient rpc(sched, "test");
+
+  std::vector<std::string> replies;
+  for (int i = 0; i < n; i++) {
+    a0::Packet pkt = co_await sub.next();
+    a0::Packet reply = co_await rpc.send(std::string(pkt.payload()));
+    replies.push_back(std::string(reply.payload()));
+  }
+  co_return replies;
+}
+
+a0::coro::Task<void> send_one(a0::coro::Scheduler sched, a0::coro::RpcClient rpc, int* remaining) {
+  a0::Packet reply = co_await rpc.send("ping");
+  REQUIRE(reply.payload() == "echo ping");
+  if (!--*remaining) {
+    sched.stop();
+  }
+}
+
+a0::coro::Task<std::vector<std::string>> stream(a0::coro::Scheduler sched) {
+  a0::coro::PrpcClient client(sched, "test");
+  auto conn = client.connect("count");
+
+  std::vector<std::string> progress;
+  while (auto pkt = co_await conn.next()) {
+    progress.push_back(std::string(pkt->payload()));
+  }
+  co_return progress;
+}
+
+a0::coro::Task<int> add_one(a0::coro::Scheduler sched, int val) {
+  co_await sched.schedule();
+  co_return val + 1;
+}
+
+a0::coro::Task<void> set_and_stop(a0::coro::Scheduler sched, bool* ran) {
+  *ran = true;
+  sched.stop();
+  co_return;
+}
+
+}  // namespace
+
+TEST_CASE_FIXTURE(CoroFixture, "coro] block_on twice") {
+  a0::coro::Scheduler sched;
+  REQUIRE(a0::coro::block_on(sched, add_one(sched, 1)) == 2);
+  REQUIRE(a0::coro::block_on(sched, add_one(sched, 2)) == 3);
+
+  // A stop() does not end block_on, and is forgotten by the next run().
+  sched.stop();
+  REQUIRE(a0::coro::block_on(sched, add_one(sched, 3)) == 4);
+
+  bool ran = false;
+  sched.spawn(set_and_stop(sched, &ran));
+  sched.run();
+  REQUIRE(ran);
+}
+
+TEST_CASE_FIXTURE(CoroFixture, "coro] subscriber and rpc") {
+  a0::RpcServer server(
+      "test",
+      [](a0::RpcRequest req) {
+        req.reply("echo " + std::string(req.pkt().payload()));
+      },
+      [](a0::string_view) {});
+
+  a0::Publisher pub("test");
+  pub.pub("a");
+  pub.pub("b");
+
+  a0::coro::Scheduler sched;
+  auto task = relay(sched, 3);
+  pub.pub("c");
+
+  REQUIRE(a0::coro::block_on(sched, std::move(task)) == std::vector<std::string>{"echo a", "echo b", "echo c"});
+}
+
+TEST_CASE_FIXTURE(CoroFixture, "coro] concurrent rpcs on one thread") {
+  a0::RpcServer server(
+      "test",
+      [](a0::RpcRequest req) {
+        req.reply("echo " + std::string(req.pkt().payload()));
+      },
+      [](a0::string_view) {});
+
+  a0::coro::Scheduler sched;
+  a0::coro::RpcClient rpc(sched, "test");
+
+  int remaining = 100;
+  for (int i = 0; i < 100; i++) {
+    sched.spawn(send_one(sched, rpc, &remaining));
+  }
+  sched.run();
+  REQUIRE(remaining == 0);
+}
+
+TEST_CASE_FIXTURE(CoroFixture, "coro] prpc stream") {
+  a0::PrpcServer server(
+      "test",
+      [](a0::PrpcConnection conn) {
+        for (int i = 0; i < 3; i++) {
+          conn.send(std::to_string(i), i == 2);
+        }
+      },
+      [](a0::string_view) {});
+
+  a0::coro::Scheduler sched;
+  REQUIRE(a0::coro::block_on(sched, stream(sched)) == std::vector<std::string>{"0", "1", "2"});
+}
+
+#endif  // A0_CPP_20
@@ -0,0 +1,258 @@
+#include <a0/arena.h>
+#include <a0/callback.h>
+#include <a0/empty.h>
+#include <a0/err.h>
+#include <a0/executor.h>
+#include <a0/executor.hpp>
+#include <a0/file.h>
+#include <a0/latch.h>
+#include <a0/packet.h>
+#include <a0/packet.hpp>
+#include <a0/reader.h>
+#include <a0/rpc.h>
+#include <a0/rpc.hpp>
+#include <a0/string_view.hpp>
+#include <a0/writer.h>
+
+#include <doctest.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/err_macro.h"
+#include "src/test_util.hpp"
+
+struct ExecutorFixture {
+  const char* topic_path = "test.rpc.a0";
+
+  ExecutorFixture() {
+    a0_file_remove(topic_path);
+  }
+
+  ~ExecutorFixture() {
+    a0_file_remove(topic_path);
+  }
+};
+
+namespace {
+
+struct ordered_t {
+  std::mutex mu;
+  bool overlap;
+  std::map<uint64_t, int> running;
+  std::map<uint64_t, std::vector<int>> seen;
+};
+
+struct ordered_task_t {
+  ordered_t* data;
+  uint64_t key;
+  int idx;
+};
+
+a0_err_t run_ordered(void* user_data) {
+  auto* task = (ordered_task_t*)user_data;
+  auto* data = task->data;
+  {
+    std::unique_lock<std::mutex> lk{data->mu};
+    data->overlap |= data->running[task->key]++ > 0;
+  }
+  {
+    std::unique_lock<std::mutex> lk{data->mu};
+    data->seen[task->key].push_back(task->idx);
+    data->running[task->key]--;
+  }
+  return A0_OK;
+}
+
+}  // namespace
+
+TEST_CASE("executor] ordered tasks") {
+  a0_executor_options_t opts = A0_EXECUTOR_OPTIONS_DEFAULT;
+  opts.threads = 4;
+  a0_executor_t executor;
+  REQUIRE_OK(a0_executor_init(&executor, opts));
+
+  ordered_t data{};
+  a0_executor_group_t group = A0_EMPTY;
+  std::vector<ordered_task_t> tasks(1000);
+  for (int i = 0; i < 1000; i++) {
+    tasks[i] = {&data, (uint64_t)(i % 4), i};
+
+    a0_executor_task_t task = A0_EMPTY;
+    task.fn = {&tasks[i], run_ordered};
+    task.ordered = true;
+    task.key = tasks[i].key;
+    task.group = &group;
+    REQUIRE_OK(a0_executor_submit(&executor, task));
+  }
+  REQUIRE_OK(a0_executor_group_wait(&group));
+
+  REQUIRE(!data.overlap);
+  REQUIRE(data.seen.size() == 4);
+  for (auto&& kv : data.seen) {
+    REQUIRE(kv.second.size() == 250);
+    for (size_t i = 0; i < kv.second.size(); i++) {
+      REQUIRE(kv.second[i] == (int)(kv.first + 4 * i));
+    }
+  }
+
+  a0_executor_stats_t stats;
+  REQUIRE_OK(a0_executor_stats(&executor, &stats));
+  REQUIRE(stats.submitted == 1000);
+  REQUIRE(stats.executed == 1000);
+  REQUIRE(stats.queue_depth == 0);
+  REQUIRE(stats.max_queue_depth >= 1);
+  REQUIRE(stats.max_queue_depth <= 1000);
+
+  REQUIRE_OK(a0_executor_close(&executor));
+}
+
+namespace {
+
+a0_err_t run_blocked(void* user_data) {
+  auto* release = (a0_latch_t*)user_data;
+  a0_latch_wait(release);
+  return A0_OK;
+}
+
+int64_t process_cpu_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+TEST_CASE("executor] idle workers sleep behind a running lane") {
+  a0_executor_options_t opts = A0_EXECUTOR_OPTIONS_DEFAULT;
+  opts.threads = 4;
+  a0_executor_t executor;
+  REQUIRE_OK(a0_executor_init(&executor, opts));
+
+  // The first task blocks its lane, so the second is queued but not runnable.
+  a0_latch_t release;
+  a0_latch_init(&release, 1);
+  a0_executor_group_t group = A0_EMPTY;
+  for (int i = 0; i < 2; i++) {
+    a0_executor_task_t task = A0_EMPTY;
+    task.fn = {&release, run_blocked};
+    task.ordered = true;
+    task.key = 0;
+    task.group = &group;
+    REQUIRE_OK(a0_executor_submit(&executor, task));
+  }
+
+  int64_t before = process_cpu_ns();
+  usleep(200 * 1000);
+  int64_t spent = process_cpu_ns() - before;
+  REQUIRE(spent < 50 * 1000 * 1000);
+
+  a0_latch_count_down(&release, 1);
+  REQUIRE_OK(a0_executor_group_wait(&group));
+  REQUIRE_OK(a0_executor_close(&executor));
+}
+
+TEST_CASE("executor] reader dispatch") {
+  std::vector<uint8_t> arena_data(64 * 1024);
+  a0_arena_t arena = {{arena_data.data(), arena_data.size()}, A0_ARENA_MODE_SHARED, 0};
+
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+  for (int i = 0; i < 20; i++) {
+    REQUIRE_OK(a0_writer_write(&w, a0::test::pkt({{"key", i % 2 ? "odd" : "even"}}, std::to_string(i))));
+  }
+  REQUIRE_OK(a0_writer_close(&w));
+
+  a0_executor_options_t opts = A0_EXECUTOR_OPTIONS_DEFAULT;
+  opts.threads = 3;
+  a0_executor_t executor;
+  REQUIRE_OK(a0_executor_init(&executor, opts));
+
+  struct data_t {
+    std::mutex mu;
+    std::map<std::string, std::vector<int>> seen;
+  } data{};
+
+  a0_packet_callback_t onpacket = {
+      .user_data = &data,
+      .fn = [](void* user_data, a0_packet_t pkt) {
+        auto* data = (data_t*)user_data;
+        std::unique_lock<std::mutex> lk{data->mu};
+        data->seen[a0::test::hdr(pkt).find("key")->second].push_back(std::stoi(a0::test::str(pkt.payload)));
+      },
+  };
+
+  a0_executor_dispatch_t dispatch = {&executor, a0_packet_key_header("key")};
+  a0_reader_options_t reader_opts = A0_READER_OPTIONS_DEFAULT;
+  reader_opts.init = A0_INIT_OLDEST;
+  a0_reader_t reader;
+  REQUIRE_OK(a0_reader_init_dispatch(&reader, arena, a0::test::alloc(), reader_opts, dispatch, onpacket));
+
+  while (true) {
+    a0_executor_stats_t stats;
+    REQUIRE_OK(a0_executor_stats(&executor, &stats));
+    if (stats.submitted == 20) {
+      break;
+    }
+  }
+  REQUIRE_OK(a0_reader_close(&reader));
+
+  // Closing the reader waits for its callbacks.
+  std::vector<int> want_even, want_odd;
+  for (int i = 0; i < 20; i += 2) {
+    want_even.push_back(i);
+    want_odd.push_back(i + 1);
+  }
+  REQUIRE(data.seen["even"] == want_even);
+  REQUIRE(data.seen["odd"] == want_odd);
+
+  REQUIRE_OK(a0_executor_close(&executor));
+}
+
+TEST_CASE_FIXTURE(ExecutorFixture, "executor] cpp rpc dispatch") {
+  a0::Executor executor(a0::Executor::Options{2});
+
+  // The first request only completes once the second starts, which would
+  // deadlock if requests ran one at a time.
+  a0_latch_t second_started;
+  a0_latch_init(&second_started, 1);
+
+  a0::RpcServer server(
+      "test",
+      executor,
+      [&](a0::RpcRequest req) {
+        if (req.pkt().payload() == "first") {
+          a0_latch_wait(&second_started);
+        } else {
+          a0_latch_count_down(&second_started, 1);
+        }
+        req.reply(req.pkt().payload());
+      },
+      [](a0::string_view) {});
+
+  std::mutex mu;
+  std::vector<std::string> replies;
+  a0_latch_t replied;
+  a0_latch_init(&replied, 2);
+  auto onreply = [&](a0::Packet pkt) {
+    std::unique_lock<std::mutex> lk{mu};
+    replies.push_back(std::string(pkt.payload()));
+    a0_latch_count_down(&replied, 1);
+  };
+
+  a0::RpcClient client("test");
+  client.send("first", onreply);
+  client.send("second", onreply);
+  a0_latch_wait(&replied);
+
+  std::unique_lock<std::mutex> lk{mu};
+  REQUIRE(replies == std::vector<std::string>{"second", "first"});
+
+  REQUIRE(executor.stats().submitted >= 2);
+}
@@ -8,6 +8,7 @@
 #include <a0/string_view.hpp>
 
 #include <doctest.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -95,6 +96,131 @@ TEST_CASE("file] bad size") {
   REQUIRE_OK(a0_file_close(&file));
 }
 
+TEST_CASE("file] grow") {
+  static const char* TEST_FILE = "/tmp/test.file";
+  a0_file_remove(TEST_FILE);
+
+  a0_file_options_t opt = A0_FILE_OPTIONS_DEFAULT;
+  opt.create_options.size = 4096;
+
+  // Without a reservation, the file cannot grow past its mapping.
+  a0_file_t file;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &opt, &file));
+  REQUIRE(file.arena.capacity == 4096);
+  REQUIRE(a0_file_grow(&file, 8192) == A0_ERR_INVALID_ARG);
+  REQUIRE_OK(a0_file_close(&file));
+
+  opt.open_options.reserve_size = 1024 * 1024;
+  a0_file_t other;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &opt, &file));
+  REQUIRE_OK(a0_file_open(TEST_FILE, &opt, &other));
+  REQUIRE(file.arena.capacity == 1024 * 1024);
+
+  // Grows in place.
+  uint8_t* data = file.arena.buf.data;
+  REQUIRE_OK(a0_file_grow(&file, 64 * 1024));
+  REQUIRE(file.arena.buf.data == data);
+  REQUIRE(file.arena.buf.size == 64 * 1024);
+  REQUIRE(file.stat.st_size == 64 * 1024);
+
+  // Other mappings see the new space without remapping.
+  file.arena.buf.data[64 * 1024 - 1] = 'x';
+  REQUIRE(other.arena.buf.data[64 * 1024 - 1] == 'x');
+
+  // Never shrinks, and adopts the size grown by others.
+  REQUIRE(other.arena.buf.size == 4096);
+  REQUIRE_OK(a0_file_grow(&other, 16 * 1024));
+  REQUIRE(other.arena.buf.size == 64 * 1024);
+  REQUIRE(other.stat.st_size == 64 * 1024);
+
+  REQUIRE(a0_file_grow(&file, 1024 * 1024 + 1) == A0_ERR_INVALID_ARG);
+
+  // Writable mappings without room for the new size block growth.
+  // READONLY mappings do not.
+  a0_file_options_t unreserved_opt = opt;
+  unreserved_opt.open_options.reserve_size = 0;
+  a0_file_t unreserved;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &unreserved_opt, &unreserved));
+  REQUIRE(unreserved.arena.capacity == 64 * 1024);
+  REQUIRE_OK(a0_file_grow(&file, 64 * 1024));
+  REQUIRE(a0_file_grow(&file, 96 * 1024) == A0_MAKE_SYSERR(EBUSY));
+  REQUIRE(file.arena.buf.size == 64 * 1024);
+  REQUIRE(file.stat.st_size == 64 * 1024);
+  REQUIRE_OK(a0_file_close(&unreserved));
+
+  unreserved_opt.open_options.arena_mode = A0_ARENA_MODE_READONLY;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &unreserved_opt, &unreserved));
+  REQUIRE_OK(a0_file_grow(&file, 96 * 1024));
+  REQUIRE(file.arena.buf.size == 96 * 1024);
+  REQUIRE_OK(a0_file_close(&unreserved));
+
+  REQUIRE_OK(a0_file_close(&other));
+  REQUIRE_OK(a0_file_close(&file));
+
+  auto cpp_opt = a0::File::Options::DEFAULT;
+  cpp_opt.open_options.reserve_size = 1024 * 1024;
+  a0::File cpp_file(TEST_FILE, cpp_opt);
+  REQUIRE(cpp_file.size() == 96 * 1024);
+  cpp_file.grow(128 * 1024);
+  REQUIRE(cpp_file.size() == 128 * 1024);
+  REQUIRE(cpp_file.stat().st_size == 128 * 1024);
+}
+
+TEST_CASE("file] prefault") {
+  static const char* TEST_FILE = "/tmp/test.file";
+  a0_file_remove(TEST_FILE);
+
+  static const size_t kSize = 4 * 1024 * 1024;
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  auto minor_faults = []() {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_minflt;
+  };
+
+  a0_file_options_t opt = A0_FILE_OPTIONS_DEFAULT;
+  opt.create_options.size = kSize;
+  opt.create_options.fallocate = true;
+  opt.open_options.populate = true;
+  opt.open_options.hugepage = true;
+
+  a0_file_t file;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &opt, &file));
+  // Not sparse.
+  REQUIRE((size_t)file.stat.st_blocks * 512 >= kSize);
+
+  // The first lap does not fault.
+  long faults = minor_faults();
+  for (size_t off = 0; off < kSize; off += page_size) {
+    file.arena.buf.data[off] = 1;
+  }
+  REQUIRE(minor_faults() - faults < 16);
+  REQUIRE_OK(a0_file_close(&file));
+
+  // Readonly populates without copying the pages.
+  opt.open_options.arena_mode = A0_ARENA_MODE_READONLY;
+  REQUIRE_OK(a0_file_open(TEST_FILE, &opt, &file));
+  REQUIRE(file.arena.buf.data[kSize - page_size] == 1);
+  REQUIRE_OK(a0_file_close(&file));
+
+  // Locking may be refused by RLIMIT_MEMLOCK.
+  opt.open_options.arena_mode = A0_ARENA_MODE_SHARED;
+  opt.open_options.lock = true;
+  a0_err_t err = a0_file_open(TEST_FILE, &opt, &file);
+  if (err) {
+    REQUIRE((A0_SYSERR(err) == ENOMEM || A0_SYSERR(err) == EPERM));
+  } else {
+    REQUIRE(file.arena.buf.data[0] == 1);
+    REQUIRE_OK(a0_file_close(&file));
+  }
+
+  auto cpp_opt = a0::File::Options::DEFAULT;
+  cpp_opt.open_options.populate = true;
+  a0::File cpp_file(TEST_FILE, cpp_opt);
+  REQUIRE(cpp_file.size() == kSize);
+}
+
 TEST_CASE("file] double close") {
   static const char* TEST_FILE = "/tmp/test.file";
   a0_file_remove(TEST_FILE);
@@ -127,6 +127,37 @@ TEST_CASE("mtx] timedlock") {
   REQUIRE(duration_ms.count() > 900);
 }
 
+TEST_CASE("mtx] spin") {
+  a0_mtx_t mtx = A0_EMPTY;
+  a0_mtx_spin_t spin = {.max = 1 << 16, .estimate = 0};
+
+  REQUIRE_OK(a0_mtx_lock(&mtx));
+  std::thread t([&]() {
+    auto wake_time = a0::test::timeout_in(std::chrono::milliseconds(10));
+    REQUIRE(A0_SYSERR(a0_mtx_timedlock_spin(&mtx, &wake_time, &spin)) == ETIMEDOUT);
+  });
+  t.join();
+  REQUIRE_OK(a0_mtx_unlock(&mtx));
+  REQUIRE(spin.estimate <= spin.max);
+
+  int cnt = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 10000; j++) {
+        REQUIRE_OK(a0_mtx_timedlock_spin(&mtx, A0_TIMEOUT_NEVER, &spin));
+        cnt++;
+        REQUIRE_OK(a0_mtx_unlock(&mtx));
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(cnt == 40000);
+  REQUIRE(spin.estimate <= spin.max);
+}
+
 TEST_CASE("mtx] robust chain") {
   a0::test::IpcPool ipc_pool;
   auto* mtx1 = ipc_pool.make<a0_mtx_t>();
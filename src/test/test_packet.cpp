@@ -9,13 +9,16 @@
 #include <algorithm>
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "src/err_macro.h"
 #include "src/test_util.hpp"
 
 TEST_CASE("packet] init") {
@@ -190,6 +193,154 @@ TEST_CASE("flat_packet] header") {
   });
 }
 
+TEST_CASE("packet] serialize deserialize v2") {
+  with_standard_packet([](a0_packet_t pkt) {
+    a0_flat_packet_t fpkt;
+    REQUIRE_OK(a0_packet_serialize_v2(pkt, a0::test::alloc(), &fpkt));
+
+    // 32 byte fixed header, 16 byte index entry per header, then content.
+    REQUIRE(fpkt.buf.size == 32 + 5 * 16 + 5 * 2 * 2 + 13);
+
+    uint8_t version;
+    REQUIRE_OK(a0_flat_packet_version(fpkt, &version));
+    REQUIRE(version == 2);
+
+    a0_packet_t pkt_after;
+    a0_buf_t unused;
+    REQUIRE_OK(a0_packet_deserialize(fpkt, a0::test::alloc(), &pkt_after, &unused));
+
+    REQUIRE(std::string(pkt.id) == std::string(pkt_after.id));
+    REQUIRE(a0::test::str(pkt.payload) == a0::test::str(pkt_after.payload));
+
+    REQUIRE(a0::test::hdr(pkt_after) == standard_packet_hdrs());
+  });
+}
+
+TEST_CASE("flat_packet] v2") {
+  with_standard_packet([](a0_packet_t pkt) {
+    a0_flat_packet_t fpkt;
+    REQUIRE_OK(a0_packet_serialize_v2(pkt, a0::test::alloc(), &fpkt));
+
+    a0_packet_stats_t stats;
+    REQUIRE_OK(a0_flat_packet_stats(fpkt, &stats));
+    REQUIRE(stats.num_hdrs == 5);
+    REQUIRE(stats.content_size == 5 * 2 * 2 + 13);
+    REQUIRE(stats.serial_size == fpkt.buf.size);
+
+    a0_packet_stats_t pkt_stats;
+    REQUIRE_OK(a0_packet_stats_v2(pkt, &pkt_stats));
+    REQUIRE(pkt_stats.serial_size == fpkt.buf.size);
+
+    a0_uuid_t* fpkt_id;
+    REQUIRE_OK(a0_flat_packet_id(fpkt, &fpkt_id));
+    REQUIRE(std::string(*fpkt_id) == std::string(pkt.id));
+
+    a0_uuid_t id_copy;
+    REQUIRE_OK(a0_flat_packet_id_copy(fpkt, id_copy));
+    REQUIRE(std::string(id_copy) == std::string(pkt.id));
+
+    a0_buf_t flat_payload;
+    REQUIRE_OK(a0_flat_packet_payload(fpkt, &flat_payload));
+    REQUIRE(a0::test::str(flat_payload) == "Hello, World!");
+
+    REQUIRE(a0::test::hdr(fpkt) == standard_packet_hdrs());
+
+    a0_packet_header_t hdr;
+    REQUIRE_OK(a0_flat_packet_header(fpkt, 4, &hdr));
+    REQUIRE(std::string(hdr.key) == "c");
+    REQUIRE(a0_flat_packet_header(fpkt, 5, &hdr) == A0_ERR_NOT_FOUND);
+
+    a0_flat_packet_header_iterator_t iter;
+    REQUIRE_OK(a0_flat_packet_header_iterator_init(&iter, &fpkt));
+    REQUIRE_OK(a0_flat_packet_header_iterator_next_match(&iter, "g", &hdr));
+    REQUIRE(std::string(hdr.val) == "h");
+    REQUIRE(a0_flat_packet_header_iterator_next_match(&iter, "g", &hdr) == A0_ERR_NOT_FOUND);
+    REQUIRE(a0_flat_packet_header_iterator_next_match(&iter, "z", &hdr) == A0_ERR_NOT_FOUND);
+  });
+}
+
+TEST_CASE("flat_packet] v2 hashed lookup") {
+  std::vector<std::string> keys;
+  std::vector<std::string> vals;
+  for (int i = 0; i < 20; i++) {
+    keys.push_back("key" + std::to_string(i % 10));
+    vals.push_back("val" + std::to_string(i));
+  }
+  std::vector<a0_packet_header_t> hdrs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    hdrs.push_back({keys[i].c_str(), vals[i].c_str()});
+  }
+
+  a0_packet_t pkt;
+  REQUIRE_OK(a0_packet_init(&pkt));
+  pkt.headers_block = {hdrs.data(), hdrs.size(), nullptr};
+  pkt.payload = a0::test::buf("Hello, World!");
+
+  a0_flat_packet_t fpkt;
+  REQUIRE_OK(a0_packet_serialize_v2(pkt, a0::test::alloc(), &fpkt));
+
+  a0_packet_stats_t pkt_stats;
+  REQUIRE_OK(a0_packet_stats_v2(pkt, &pkt_stats));
+  REQUIRE(pkt_stats.serial_size == fpkt.buf.size);
+
+  for (int i = 0; i < 10; i++) {
+    std::string key = "key" + std::to_string(i);
+    a0_flat_packet_header_iterator_t iter;
+    a0_packet_header_t hdr;
+    REQUIRE_OK(a0_flat_packet_header_iterator_init(&iter, &fpkt));
+
+    // Duplicate keys are found in order.
+    REQUIRE_OK(a0_flat_packet_header_iterator_next_match(&iter, key.c_str(), &hdr));
+    REQUIRE(std::string(hdr.val) == "val" + std::to_string(i));
+    REQUIRE_OK(a0_flat_packet_header_iterator_next_match(&iter, key.c_str(), &hdr));
+    REQUIRE(std::string(hdr.val) == "val" + std::to_string(i + 10));
+    REQUIRE(a0_flat_packet_header_iterator_next_match(&iter, key.c_str(), &hdr) == A0_ERR_NOT_FOUND);
+  }
+
+  // Lookups resume after the iterator position.
+  a0_flat_packet_header_iterator_t iter;
+  a0_packet_header_t hdr;
+  REQUIRE_OK(a0_flat_packet_header_iterator_init(&iter, &fpkt));
+  for (int i = 0; i < 11; i++) {
+    REQUIRE_OK(a0_flat_packet_header_iterator_next(&iter, &hdr));
+  }
+  REQUIRE_OK(a0_flat_packet_header_iterator_next_match(&iter, "key1", &hdr));
+  REQUIRE(std::string(hdr.val) == "val11");
+  REQUIRE(a0_flat_packet_header_iterator_next_match(&iter, "key", &hdr) == A0_ERR_NOT_FOUND);
+
+  a0_packet_t pkt_after;
+  a0_buf_t unused;
+  REQUIRE_OK(a0_packet_deserialize(fpkt, a0::test::alloc(), &pkt_after, &unused));
+  REQUIRE(a0::test::hdr(pkt_after) == a0::test::hdr(pkt));
+  REQUIRE(a0::test::str(pkt_after.payload) == "Hello, World!");
+}
+
+TEST_CASE("flat_packet] v2 falls back to v1") {
+  with_standard_packet([](a0_packet_t pkt) {
+    // Not canonical: lowercase hex cannot be restored from binary.
+    for (size_t i = 0; i < A0_UUID_SIZE; i++) {
+      pkt.id[i] = (char)std::tolower(pkt.id[i]);
+    }
+    pkt.id[0] = 'a';
+
+    a0_flat_packet_t fpkt;
+    REQUIRE_OK(a0_packet_serialize_v2(pkt, a0::test::alloc(), &fpkt));
+
+    uint8_t version;
+    REQUIRE_OK(a0_flat_packet_version(fpkt, &version));
+    REQUIRE(version == 1);
+    REQUIRE(fpkt.buf.size == 166);
+
+    a0_uuid_t* fpkt_id;
+    REQUIRE_OK(a0_flat_packet_id(fpkt, &fpkt_id));
+    REQUIRE(std::string(*fpkt_id) == std::string(pkt.id));
+
+    a0_uuid_t id_copy;
+    REQUIRE_OK(a0_flat_packet_id_copy(fpkt, id_copy));
+    REQUIRE(std::string(id_copy) == std::string(pkt.id));
+  });
+}
+
 TEST_CASE("packet] cpp") {
   a0::Packet pkt0;
   REQUIRE(pkt0.payload() == "");
@@ -246,3 +397,16 @@ TEST_CASE("flat_packet] cpp") {
                     });
   });
 }
+
+TEST_CASE("flat_packet] cpp v2") {
+  with_standard_packet([](a0_packet_t pkt) {
+    a0::FlatPacket fpkt;
+    fpkt.c = std::make_shared<a0_flat_packet_t>();
+    REQUIRE_OK(a0_packet_serialize_v2(pkt, a0::test::alloc(), fpkt.c.get()));
+
+    REQUIRE(fpkt.id() == pkt.id);
+    REQUIRE(fpkt.payload() == "Hello, World!");
+    REQUIRE(fpkt.num_headers() == 5);
+    REQUIRE(fpkt.header(0) == std::make_pair(a0::string_view("e"), a0::string_view("f")));
+  });
+}
@@ -35,10 +35,11 @@
 #include <utility>
 #include <vector>
 
+#include "src/err_macro.h"
 #include "src/test_util.hpp"
 
 struct PubsubFixture {
-  a0_pubsub_topic_t topic = {"test", nullptr};
+  a0_pubsub_topic_t topic = {"test", nullptr, nullptr};
   const char* topic_path = "test.pubsub.a0";
   std::vector<std::thread> threads;
 
@@ -89,7 +90,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] sync") {
     REQUIRE_OK(a0_subscriber_sync_init(&sub,
                                        topic,
                                        a0::test::alloc(),
-                                       (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT}));
+                                       (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT, 0, {}}));
 
     uint64_t pkt1_time_mono;
 
@@ -190,7 +191,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] sync") {
     REQUIRE_OK(a0_subscriber_sync_init(&sub,
                                        topic,
                                        a0::test::alloc(),
-                                       (a0_reader_options_t){A0_INIT_MOST_RECENT, A0_ITER_NEWEST}));
+                                       (a0_reader_options_t){A0_INIT_MOST_RECENT, A0_ITER_NEWEST, 0, {}}));
 
     {
       bool can_read;
@@ -442,6 +443,26 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp zc") {
   }
 }
 
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp spin zc") {
+  a0::Publisher p(topic.name);
+  p.pub("msg #0");
+
+  std::vector<std::string> payloads;
+  a0_event_t done = A0_EMPTY;
+  a0::SubscriberSpinZeroCopy sub_spin_zc(
+      topic.name, a0::INIT_OLDEST, [&](a0::TransportLocked, a0::FlatPacket fpkt) {
+        payloads.push_back(std::string(fpkt.payload()));
+        if (payloads.size() == 2) {
+          a0_event_set(&done);
+        }
+      });
+
+  p.pub("msg #1");
+
+  a0_event_wait(&done);
+  REQUIRE(payloads == std::vector<std::string>{"msg #0", "msg #1"});
+}
+
 TEST_CASE_FIXTURE(PubsubFixture, "pubsub] await_new") {
   struct data_t {
     std::vector<std::string> msgs;
@@ -467,7 +488,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] await_new") {
   REQUIRE_OK(a0_subscriber_init(&sub,
                                 topic,
                                 a0::test::alloc(),
-                                (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT},
+                                (a0_reader_options_t){A0_INIT_AWAIT_NEW, A0_ITER_NEXT, 0, {}},
                                 cb));
 
   REQUIRE_OK(a0_publisher_pub(&pub, a0::test::pkt("msg after")));
@@ -526,7 +547,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] most_recent") {
   REQUIRE_OK(a0_subscriber_init(&sub,
                                 topic,
                                 a0::test::alloc(),
-                                (a0_reader_options_t){A0_INIT_MOST_RECENT, A0_ITER_NEXT},
+                                (a0_reader_options_t){A0_INIT_MOST_RECENT, A0_ITER_NEXT, 0, {}},
                                 cb));
 
   REQUIRE_OK(a0_publisher_pub(&pub, a0::test::pkt("msg after")));
@@ -538,6 +559,167 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] most_recent") {
   REQUIRE_OK(a0_subscriber_close(&sub));
 }
 
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] transport layout") {
+  auto frame_time_err = [](a0_pubsub_topic_t topic) {
+    a0_publisher_t pub;
+    REQUIRE_OK(a0_publisher_init(&pub, topic));
+    REQUIRE_OK(a0_publisher_pub(&pub, a0::test::pkt("msg")));
+
+    a0_transport_t transport;
+    REQUIRE_OK(a0_transport_init(&transport, pub._file.arena));
+    a0_transport_locked_t tlk;
+    REQUIRE_OK(a0_transport_lock(&transport, &tlk));
+    REQUIRE_OK(a0_transport_jump_head(tlk));
+    a0_time_mono_t time;
+    a0_err_t err = a0_transport_frame_time(tlk, &time);
+    REQUIRE_OK(a0_transport_unlock(tlk));
+    REQUIRE_OK(a0_publisher_close(&pub));
+    return err;
+  };
+
+  // Pubsub topics have a sequence index, which records commit times.
+  REQUIRE_OK(frame_time_err(topic));
+
+  // And watcher slots.
+  a0_file_t file;
+  REQUIRE_OK(a0_pubsub_topic_open(topic, &file));
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, file.arena));
+  a0_transport_locked_t tlk;
+  REQUIRE_OK(a0_transport_lock(&transport, &tlk));
+  a0_transport_watcher_t watcher;
+  REQUIRE_OK(a0_transport_watcher_register(tlk, &watcher));
+  REQUIRE_OK(a0_transport_watcher_unregister(tlk, &watcher));
+
+  // And reader slots, for shared locks.
+  REQUIRE_OK(a0_transport_downgrade(tlk));
+  bool shared;
+  REQUIRE_OK(a0_transport_is_shared(tlk, &shared));
+  REQUIRE(shared);
+  REQUIRE_OK(a0_transport_unlock(tlk));
+  REQUIRE_OK(a0_file_close(&file));
+
+  // Options override the layout of new topics.
+  a0_file_remove(topic_path);
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  REQUIRE(A0_SYSERR(frame_time_err({"test", nullptr, &opts})) == ENOTSUP);
+}
+
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] seek past 1024 packets") {
+  a0_file_options_t file_opts = A0_FILE_OPTIONS_DEFAULT;
+  file_opts.create_options.size = 1024 * 1024;
+  topic.file_opts = &file_opts;
+
+  // Fill the topic with the smallest packets a publisher writes.
+  a0_publisher_t pub;
+  REQUIRE_OK(a0_publisher_init(&pub, topic));
+  for (int i = 0; i < 5000; i++) {
+    REQUIRE_OK(a0_publisher_pub(&pub, a0::test::pkt("")));
+  }
+
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, pub._file.arena));
+  a0_transport_locked_t tlk;
+  REQUIRE_OK(a0_transport_lock(&transport, &tlk));
+  uint64_t seq_low;
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_low(tlk, &seq_low));
+  REQUIRE_OK(a0_transport_seq_high(tlk, &seq_high));
+  REQUIRE(seq_low > 1);
+  REQUIRE(seq_high - seq_low > 1024);
+
+  // The index spans the topic, so even the oldest packet is indexed.
+  REQUIRE_OK(a0_transport_jump_seq(tlk, seq_low + 1));
+  a0_time_mono_t time;
+  REQUIRE_OK(a0_transport_frame_time(tlk, &time));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_frame(tlk, &frame));
+  REQUIRE(frame->hdr.seq == seq_low + 1);
+  REQUIRE_OK(a0_transport_unlock(tlk));
+  REQUIRE_OK(a0_publisher_close(&pub));
+
+  a0_reader_options_t opts = A0_READER_OPTIONS_DEFAULT;
+  opts.init = A0_INIT_SEQ;
+  opts.seq = seq_low + 1;
+  a0_subscriber_sync_t sub;
+  REQUIRE_OK(a0_subscriber_sync_init(&sub, topic, a0::test::alloc(), opts));
+  a0_packet_t pkt;
+  REQUIRE_OK(a0_subscriber_sync_read(&sub, &pkt));
+  // The header holds the sequence number of the frame before.
+  auto hdrs = a0::test::hdr(pkt);
+  REQUIRE(hdrs.find("a0_transport_seq")->second == std::to_string(seq_low));
+  REQUIRE_OK(a0_subscriber_sync_close(&sub));
+
+  // Likewise by commit time. Only the oldest frame may share its commit time.
+  opts.init = A0_INIT_SINCE;
+  opts.since = time;
+  REQUIRE_OK(a0_subscriber_sync_init(&sub, topic, a0::test::alloc(), opts));
+  REQUIRE_OK(a0_subscriber_sync_read(&sub, &pkt));
+  hdrs = a0::test::hdr(pkt);
+  std::string prev_seq = hdrs.find("a0_transport_seq")->second;
+  REQUIRE((prev_seq == std::to_string(seq_low) || prev_seq == std::to_string(seq_low - 1)));
+  REQUIRE_OK(a0_subscriber_sync_close(&sub));
+}
+
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp packet v2") {
+  a0::Writer::Options opts = a0::Writer::Options::DEFAULT;
+  opts.packet_version = 2;
+  a0::Publisher p(topic.name, opts);
+  a0::Packet pkt({{"key", "val"}}, "msg");
+  p.pub(pkt);
+
+  a0::SubscriberSyncZeroCopy sub(topic.name, a0::INIT_OLDEST);
+  sub.read([&](a0::TransportLocked, a0::FlatPacket fpkt) {
+    uint8_t version;
+    REQUIRE_OK(a0_flat_packet_version(*fpkt.c, &version));
+    REQUIRE(version == 2);
+    REQUIRE(fpkt.id() == pkt.id());
+    REQUIRE(fpkt.payload() == "msg");
+  });
+}
+
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp pub_batch") {
+  std::vector<std::string> msgs;
+  std::vector<std::string> seqs;
+  a0_latch_t latch;
+  a0_latch_init(&latch, 3);
+
+  a0::Publisher p(topic.name);
+
+  a0::Subscriber sub(
+      topic.name,
+      [&](a0::Packet pkt) {
+        msgs.push_back(std::string(pkt.payload()));
+        seqs.push_back(pkt.headers().find("a0_transport_seq")->second);
+        a0_latch_count_down(&latch, 1);
+      });
+
+  size_t written = 0;
+  p.pub_batch({a0::Packet("msg #0"), a0::Packet("msg #1"), a0::Packet("msg #2")}, &written);
+  REQUIRE(written == 3);
+
+  a0_latch_wait(&latch);
+
+  REQUIRE(msgs == std::vector<std::string>{"msg #0", "msg #1", "msg #2"});
+  REQUIRE(seqs == std::vector<std::string>{"0", "1", "2"});
+}
+
+TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp reserve") {
+  a0::Publisher p(topic.name);
+  {
+    auto res = p.reserve(6);
+    memcpy(res.payload().data(), "msg #0", 6);
+    res.commit();
+  }
+
+  a0::SubscriberSync sub(topic.name, a0::INIT_OLDEST);
+  REQUIRE(sub.can_read());
+  auto pkt = sub.read();
+  REQUIRE(pkt.payload() == "msg #0");
+  REQUIRE(pkt.headers().count("a0_transport_seq") == 1);
+  REQUIRE(!sub.can_read());
+}
+
 TEST_CASE_FIXTURE(PubsubFixture, "pubsub] cpp most_recent") {
   std::vector<std::string> msgs;
   a0_latch_t latch;
@@ -599,7 +781,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] multithread") {
   REQUIRE_OK(a0_subscriber_init(&sub,
                                 topic,
                                 a0::test::alloc(),
-                                (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT},
+                                (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT, 0, {}},
                                 cb));
 
   a0_latch_wait(&data.latch);
@@ -766,7 +948,7 @@ TEST_CASE_FIXTURE(PubsubFixture, "pubsub] many publisher fuzz") {
   REQUIRE_OK(a0_subscriber_sync_init(&sub,
                                      topic,
                                      a0::test::alloc(),
-                                     (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT}));
+                                     (a0_reader_options_t){A0_INIT_OLDEST, A0_ITER_NEXT, 0, {}}));
 
   while (true) {
     a0_packet_t pkt;
@@ -0,0 +1,216 @@
+#include <a0/arena.h>
+#include <a0/arena.hpp>
+#include <a0/buf.h>
+#include <a0/empty.h>
+#include <a0/err.h>
+#include <a0/file.h>
+#include <a0/latch.h>
+#include <a0/packet.h>
+#include <a0/packet.hpp>
+#include <a0/pubsub.h>
+#include <a0/pubsub.hpp>
+#include <a0/reactor.h>
+#include <a0/reactor.hpp>
+#include <a0/reader.h>
+#include <a0/reader.hpp>
+#include <a0/transport.h>
+#include <a0/transport.hpp>
+#include <a0/writer.h>
+
+#include <doctest.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/err_macro.h"
+#include "src/test_util.hpp"
+
+struct ReactorFixture {
+  a0_pubsub_topic_t topic = {"test", nullptr, nullptr};
+  const char* topic_path = "test.pubsub.a0";
+
+  ReactorFixture() {
+    a0_file_remove(topic_path);
+  }
+
+  ~ReactorFixture() {
+    a0_file_remove(topic_path);
+  }
+};
+
+namespace {
+
+struct collect_t {
+  std::vector<std::string> payloads;
+  a0_latch_t latch;
+};
+
+void collect(void* user_data, a0_transport_locked_t, a0_flat_packet_t fpkt) {
+  auto* data = (collect_t*)user_data;
+  data->payloads.push_back(a0::test::str(a0::test::unflatten(fpkt).payload));
+  a0_latch_count_down(&data->latch, 1);
+}
+
+void write_n(a0_arena_t arena, const std::string& prefix, int n) {
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+  for (int i = 0; i < n; i++) {
+    REQUIRE_OK(a0_writer_write(&w, a0::test::pkt(prefix + std::to_string(i))));
+  }
+  REQUIRE_OK(a0_writer_close(&w));
+}
+
+}  // namespace
+
+TEST_CASE_FIXTURE(ReactorFixture, "reactor] watched and polled readers") {
+  // One arena with a watcher slot, and one that must be polled.
+  std::vector<uint8_t> watched_data(64 * 1024);
+  a0_arena_t watched_arena = {{watched_data.data(), watched_data.size()}, A0_ARENA_MODE_SHARED, 0};
+  a0_transport_t transport;
+  a0_transport_options_t transport_opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  transport_opts.watcher_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, watched_arena, transport_opts));
+
+  std::vector<uint8_t> polled_data(64 * 1024);
+  a0_arena_t polled_arena = {{polled_data.data(), polled_data.size()}, A0_ARENA_MODE_SHARED, 0};
+
+  write_n(watched_arena, "watched_", 3);
+  write_n(polled_arena, "polled_", 3);
+
+  a0_reactor_options_t opts = A0_REACTOR_OPTIONS_DEFAULT;
+  opts.batch = 2;
+  a0_reactor_t reactor;
+  REQUIRE_OK(a0_reactor_init(&reactor, opts));
+
+  a0_reader_options_t reader_opts = A0_READER_OPTIONS_DEFAULT;
+  reader_opts.init = A0_INIT_OLDEST;
+
+  collect_t watched{};
+  a0_latch_init(&watched.latch, 10);
+  a0_reactor_reader_zc_t watched_reader;
+  REQUIRE_OK(a0_reactor_reader_zc_init(&watched_reader, &reactor, watched_arena, reader_opts, {&watched, collect}));
+
+  collect_t polled{};
+  a0_latch_init(&polled.latch, 10);
+  a0_reactor_reader_zc_t polled_reader;
+  REQUIRE_OK(a0_reactor_reader_zc_init(&polled_reader, &reactor, polled_arena, reader_opts, {&polled, collect}));
+
+  REQUIRE(A0_SYSERR(a0_reactor_close(&reactor)) == EBUSY);
+
+  write_n(watched_arena, "watched_more_", 7);
+  write_n(polled_arena, "polled_more_", 7);
+
+  a0_latch_wait(&watched.latch);
+  a0_latch_wait(&polled.latch);
+
+  REQUIRE_OK(a0_reactor_reader_zc_close(&watched_reader));
+  REQUIRE_OK(a0_reactor_reader_zc_close(&polled_reader));
+  REQUIRE_OK(a0_reactor_close(&reactor));
+
+  std::vector<std::string> want_watched;
+  std::vector<std::string> want_polled;
+  for (int i = 0; i < 3; i++) {
+    want_watched.push_back("watched_" + std::to_string(i));
+    want_polled.push_back("polled_" + std::to_string(i));
+  }
+  for (int i = 0; i < 7; i++) {
+    want_watched.push_back("watched_more_" + std::to_string(i));
+    want_polled.push_back("polled_more_" + std::to_string(i));
+  }
+  REQUIRE(watched.payloads == want_watched);
+  REQUIRE(polled.payloads == want_polled);
+}
+
+TEST_CASE_FIXTURE(ReactorFixture, "reactor] watched reader in another network namespace") {
+  a0_file_t file;
+  REQUIRE_OK(a0_file_open(topic_path, nullptr, &file));
+  a0_transport_t transport;
+  a0_transport_options_t transport_opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  transport_opts.watcher_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, file.arena, transport_opts));
+
+  a0_reactor_t reactor;
+  REQUIRE_OK(a0_reactor_init(&reactor, A0_REACTOR_OPTIONS_DEFAULT));
+
+  a0_reader_options_t reader_opts = A0_READER_OPTIONS_DEFAULT;
+  reader_opts.init = A0_INIT_OLDEST;
+  collect_t collected{};
+  a0_latch_init(&collected.latch, 1);
+  a0_reactor_reader_zc_t reader;
+  REQUIRE_OK(a0_reactor_reader_zc_init(&reader, &reactor, file.arena, reader_opts, {&collected, collect}));
+
+  // Once read, the reader is watched and armed.
+  write_n(file.arena, "local_", 1);
+  a0_latch_wait(&collected.latch);
+
+  // Commits from a writer that cannot signal the watcher.
+  a0_latch_init(&collected.latch, 1);
+  pid_t pid = a0::test::subproc([&]() {
+    if (unshare(CLONE_NEWNET)) {
+      exit(2);
+    }
+    write_n(file.arena, "netns_", 1);
+  });
+  REQUIRE(pid != -1);
+  int status;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFEXITED(status));
+
+  // Exit code 2 means a network namespace could not be created here.
+  if (WEXITSTATUS(status) != 2) {
+    bool done = false;
+    for (int i = 0; i < 500 && !done; i++) {
+      REQUIRE_OK(a0_latch_try_wait(&collected.latch, &done));
+      if (!done) {
+        usleep(10 * 1000);
+      }
+    }
+    REQUIRE(done);
+    REQUIRE(collected.payloads == std::vector<std::string>{"local_0", "netns_0"});
+  }
+
+  REQUIRE_OK(a0_reactor_reader_zc_close(&reader));
+  REQUIRE_OK(a0_reactor_close(&reactor));
+  REQUIRE_OK(a0_file_close(&file));
+}
+
+TEST_CASE_FIXTURE(ReactorFixture, "reactor] cpp subscribers") {
+  a0::Reactor::Options opts = a0::Reactor::Options::DEFAULT;
+  opts.threads = 2;
+  a0::Reactor reactor(opts);
+
+  a0::Publisher p(topic.name);
+  p.pub("msg #0");
+
+  std::mutex mu;
+  std::vector<std::string> zc_payloads;
+  std::vector<std::string> payloads;
+  a0_latch_t latch;
+  a0_latch_init(&latch, 4);
+
+  a0::ReactorSubscriberZeroCopy sub_zc(
+      reactor, topic.name, a0::Reader::Options(a0::INIT_OLDEST), [&](a0::TransportLocked, a0::FlatPacket fpkt) {
+        std::unique_lock<std::mutex> lk{mu};
+        zc_payloads.push_back(std::string(fpkt.payload()));
+        a0_latch_count_down(&latch, 1);
+      });
+  a0::ReactorSubscriber sub(
+      reactor, topic.name, a0::Reader::Options(a0::INIT_OLDEST), [&](a0::Packet pkt) {
+        std::unique_lock<std::mutex> lk{mu};
+        payloads.push_back(std::string(pkt.payload()));
+        a0_latch_count_down(&latch, 1);
+      });
+
+  p.pub("msg #1");
+
+  a0_latch_wait(&latch);
+  std::unique_lock<std::mutex> lk{mu};
+  REQUIRE(zc_payloads == std::vector<std::string>{"msg #0", "msg #1"});
+  REQUIRE(payloads == std::vector<std::string>{"msg #0", "msg #1"});
+}
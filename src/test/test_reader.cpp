@@ -8,12 +8,16 @@
 #include <a0/reader.h>
 #include <a0/reader.hpp>
 #include <a0/string_view.hpp>
+#include <a0/time.h>
+#include <a0/time.hpp>
 #include <a0/transport.h>
 #include <a0/transport.hpp>
 
 #include <doctest.h>
+#include <poll.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
@@ -27,17 +31,19 @@
 #include <vector>
 
 #include "src/c_wrap.hpp"
+#include "src/err_macro.h"
 #include "src/test_util.hpp"
 
-static a0_reader_options_t C_OLDEST_NEXT{A0_INIT_OLDEST, A0_ITER_NEXT};
-static a0_reader_options_t C_MOST_RECENT_NEXT{A0_INIT_MOST_RECENT, A0_ITER_NEXT};
-static a0_reader_options_t C_AWAIT_NEW_NEXT{A0_INIT_AWAIT_NEW, A0_ITER_NEXT};
-static a0_reader_options_t C_MOST_RECENT_NEWEST{A0_INIT_MOST_RECENT, A0_ITER_NEWEST};
-static a0_reader_options_t C_AWAIT_NEW_NEWEST{A0_INIT_AWAIT_NEW, A0_ITER_NEWEST};
+static a0_reader_options_t C_OLDEST_NEXT{A0_INIT_OLDEST, A0_ITER_NEXT, 0, {}};
+static a0_reader_options_t C_MOST_RECENT_NEXT{A0_INIT_MOST_RECENT, A0_ITER_NEXT, 0, {}};
+static a0_reader_options_t C_AWAIT_NEW_NEXT{A0_INIT_AWAIT_NEW, A0_ITER_NEXT, 0, {}};
+static a0_reader_options_t C_MOST_RECENT_NEWEST{A0_INIT_MOST_RECENT, A0_ITER_NEWEST, 0, {}};
+static a0_reader_options_t C_AWAIT_NEW_NEWEST{A0_INIT_AWAIT_NEW, A0_ITER_NEWEST, 0, {}};
 
 TEST_CASE("reader_options] construct") {
   REQUIRE(A0_READER_OPTIONS_DEFAULT.init == A0_INIT_AWAIT_NEW);
   REQUIRE(A0_READER_OPTIONS_DEFAULT.iter == A0_ITER_NEXT);
+  REQUIRE(A0_READER_OPTIONS_DEFAULT.seq == 0);
 
   REQUIRE(a0::Reader::Options::DEFAULT.init == a0::INIT_AWAIT_NEW);
   REQUIRE(a0::Reader::Options::DEFAULT.iter == a0::ITER_NEXT);
@@ -81,6 +87,28 @@ struct ReaderBaseFixture {
     REQUIRE_OK(a0_transport_unlock(lk));
   }
 
+  // Reserves a frame from a producer slot, and discards it.
+  void push_discarded() {
+    a0_transport_t transport;
+    REQUIRE_OK(a0_transport_init(&transport, arena));
+
+    a0_transport_locked_t lk;
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+    a0_transport_reservation_t res;
+    REQUIRE_OK(a0_transport_reserve(lk, 8, &res));
+    REQUIRE_OK(a0_transport_discard(lk, &res));
+
+    REQUIRE_OK(a0_transport_unlock(lk));
+  }
+
+  void init_producer_slots() {
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.producer_slots = 1;
+    REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+  }
+
   void thread_sleep_push_pkt(std::string payload) {
     threads.emplace_back([this, payload]() {
       std::this_thread::sleep_for(std::chrono::milliseconds(1));
@@ -182,6 +210,39 @@ TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] oldest-next") {
   REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
 }
 
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] watch") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.watcher_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, C_AWAIT_NEW_NEXT));
+
+  int fd;
+  REQUIRE_OK(a0_reader_sync_zc_watch(&rsz, &fd));
+  struct pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+  REQUIRE(poll(&pfd, 1, 0) == 0);
+
+  push_pkt("pkt_0");
+  REQUIRE(poll(&pfd, 1, 0) == 1);
+
+  // Reading until A0_ERR_AGAIN drains and re-arms the descriptor.
+  REQUIRE_READ("pkt_0");
+  a0_zero_copy_callback_t nop = {
+      .user_data = NULL,
+      .fn = [](void*, a0_transport_locked_t, a0_flat_packet_t) {},
+  };
+  REQUIRE(a0_reader_sync_zc_read(&rsz, nop) == A0_ERR_AGAIN);
+  REQUIRE(poll(&pfd, 1, 0) == 0);
+
+  thread_sleep_push_pkt("pkt_1");
+  REQUIRE(poll(&pfd, 1, 1000) == 1);
+  join_threads();
+  REQUIRE_READ("pkt_1");
+
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
 TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] cpp oldest-next") {
   push_pkt("pkt_0");
   push_pkt("pkt_1");
@@ -402,6 +463,248 @@ TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] next without can_read")
   REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
 }
 
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] init seq") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+  push_pkt("pkt_2");
+
+  // Sequence numbers start at 1.
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SEQ, A0_ITER_NEXT, 2, {}}));
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_1");
+  REQUIRE_READ("pkt_2");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  // Older than the oldest frame starts at the oldest frame.
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SEQ, A0_ITER_NEXT, 0, {}}));
+  REQUIRE_READ("pkt_0");
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  // Not yet written awaits new frames.
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SEQ, A0_ITER_NEXT, 4, {}}));
+  REQUIRE(!can_read());
+  push_pkt("pkt_3");
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_3");
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  a0::ReaderSyncZeroCopy cpp_rsz(a0::cpp_wrap<a0::Arena>(arena), a0::Reader::Options(a0::INIT_SEQ, a0::ITER_NEXT, 3));
+  REQUIRE_READ_CPP(cpp_rsz, "pkt_2");
+  REQUIRE_READ_CPP(cpp_rsz, "pkt_3");
+  REQUIRE(!cpp_rsz.can_read());
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] init since") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.seq_index_size = 16;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  a0_time_mono_t before;
+  REQUIRE_OK(a0_time_mono_now(&before));
+  push_pkt("pkt_0");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  a0_time_mono_t since;
+  REQUIRE_OK(a0_time_mono_now(&since));
+  push_pkt("pkt_1");
+  push_pkt("pkt_2");
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SINCE, A0_ITER_NEXT, 0, since}));
+  REQUIRE_READ("pkt_1");
+  REQUIRE_READ("pkt_2");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SINCE, A0_ITER_NEXT, 0, before}));
+  REQUIRE_READ("pkt_0");
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  // Not yet written awaits new frames.
+  a0_time_mono_t after;
+  REQUIRE_OK(a0_time_mono_now(&after));
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, {A0_INIT_SINCE, A0_ITER_NEXT, 0, after}));
+  REQUIRE(!can_read());
+  push_pkt("pkt_3");
+  REQUIRE_READ("pkt_3");
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  a0::ReaderSyncZeroCopy cpp_rsz(a0::cpp_wrap<a0::Arena>(arena), a0::Reader::Options(a0::INIT_SINCE, a0::ITER_NEXT, a0::cpp_wrap<a0::TimeMono>(since)));
+  REQUIRE_READ_CPP(cpp_rsz, "pkt_1");
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] shared reader slots") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  push_pkt("pkt_0");
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, C_OLDEST_NEXT));
+
+  struct data_t {
+    ReaderSyncZCFixture* self;
+    bool executed;
+  } data{this, false};
+
+  a0_zero_copy_callback_t cb = {
+      .user_data = &data,
+      .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+        auto* data = (data_t*)user_data;
+        bool is_shared;
+        REQUIRE_OK(a0_transport_is_shared(tlk, &is_shared));
+        REQUIRE(is_shared);
+
+        // Writers are not blocked by the callback.
+        data->self->push_pkt("pkt_1");
+
+        REQUIRE(a0::test::unflatten(fpkt).payload.size == 5);
+        data->executed = true;
+      },
+  };
+
+  REQUIRE_OK(a0_reader_sync_zc_read(&rsz, cb));
+  REQUIRE(data.executed);
+
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_1");
+
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] read many") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+  push_pkt("pkt_2");
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, C_OLDEST_NEXT));
+
+  std::vector<std::string> payloads;
+  a0_zero_copy_callback_t cb = {
+      .user_data = &payloads,
+      .fn = [](void* user_data, a0_transport_locked_t, a0_flat_packet_t fpkt) {
+        ((std::vector<std::string>*)user_data)->push_back(a0::test::str(a0::test::unflatten(fpkt).payload));
+      },
+  };
+
+  size_t n_read;
+  REQUIRE_OK(a0_reader_sync_zc_read_many(&rsz, 2, cb, &n_read));
+  REQUIRE(n_read == 2);
+  REQUIRE_OK(a0_reader_sync_zc_read_many(&rsz, 0, cb, &n_read));
+  REQUIRE(n_read == 1);
+  REQUIRE(payloads == std::vector<std::string>{"pkt_0", "pkt_1", "pkt_2"});
+
+  REQUIRE(a0_reader_sync_zc_read_many(&rsz, 0, cb, &n_read) == A0_ERR_AGAIN);
+  REQUIRE(n_read == 0);
+
+  push_pkt("pkt_3");
+  push_pkt("pkt_4");
+
+  a0::ReaderSyncZeroCopy cpp_rsz = a0::cpp_wrap<a0::ReaderSyncZeroCopy>(&rsz);
+  payloads.clear();
+  REQUIRE(cpp_rsz.read_many(0, [&](a0::TransportLocked, a0::FlatPacket fpkt) {
+    payloads.push_back(std::string(fpkt.payload()));
+  }) == 2);
+  REQUIRE(payloads == std::vector<std::string>{"pkt_3", "pkt_4"});
+  REQUIRE(cpp_rsz.read_many(0, [](a0::TransportLocked, a0::FlatPacket) {}) == 0);
+
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] read many, shared reader slots") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, C_OLDEST_NEXT));
+
+  struct data_t {
+    ReaderSyncZCFixture* self;
+    std::vector<std::string> payloads;
+  } data{this, {}};
+
+  a0_zero_copy_callback_t cb = {
+      .user_data = &data,
+      .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+        auto* data = (data_t*)user_data;
+        bool is_shared;
+        REQUIRE_OK(a0_transport_is_shared(tlk, &is_shared));
+        REQUIRE(is_shared);
+
+        // Writers are not blocked by the batch, and their frames are left
+        // for the next read.
+        if (data->payloads.empty()) {
+          data->self->push_pkt("pkt_2");
+        }
+        data->payloads.push_back(a0::test::str(a0::test::unflatten(fpkt).payload));
+      },
+  };
+
+  REQUIRE_OK(a0_reader_sync_zc_read_many(&rsz, 0, cb, nullptr));
+  REQUIRE(data.payloads == std::vector<std::string>{"pkt_0", "pkt_1"});
+
+  REQUIRE_OK(a0_reader_sync_zc_read_many(&rsz, 0, cb, nullptr));
+  REQUIRE(data.payloads == std::vector<std::string>{"pkt_0", "pkt_1", "pkt_2"});
+
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] readonly arena") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+
+  a0_arena_t roarena = arena;
+  roarena.mode = A0_ARENA_MODE_READONLY;
+  std::vector<uint8_t> before = arena_data;
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, roarena, C_OLDEST_NEXT));
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_0");
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_1");
+  REQUIRE(!can_read());
+
+  // The reader never writes to the arena.
+  REQUIRE(arena_data == before);
+
+  push_pkt("pkt_2");
+
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_2");
+  REQUIRE(!can_read());
+
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] compact frames") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.compact_frames = true;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, arena, C_OLDEST_NEXT));
+  REQUIRE_READ("pkt_0");
+  REQUIRE_READ("pkt_1");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+
+  a0_arena_t roarena = arena;
+  roarena.mode = A0_ARENA_MODE_READONLY;
+  REQUIRE_OK(a0_reader_sync_zc_init(&rsz, roarena, C_OLDEST_NEXT));
+  REQUIRE_READ("pkt_0");
+  REQUIRE_READ("pkt_1");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
+}
+
 TEST_CASE_FIXTURE(ReaderSyncZCFixture, "reader_sync_zc] blocking oldest available") {
   push_pkt("pkt_0");
 
@@ -535,7 +838,7 @@ TEST_CASE_FIXTURE(ReaderSyncZCFixture, "read] random access") {
       },
   };
   REQUIRE_OK(a0_reader_sync_zc_read_blocking(&rsz, cb_0));
-  REQUIRE(off_0 == 144);
+  REQUIRE(off_0 == 320);
 
   size_t off_1 = 0;
   a0_zero_copy_callback_t cb_1 = {
@@ -547,7 +850,7 @@ TEST_CASE_FIXTURE(ReaderSyncZCFixture, "read] random access") {
       },
   };
   REQUIRE_OK(a0_reader_sync_zc_read_blocking(&rsz, cb_1));
-  REQUIRE(off_1 == 256);
+  REQUIRE(off_1 == 432);
 
   REQUIRE_OK(a0_reader_sync_zc_close(&rsz));
 
@@ -578,13 +881,13 @@ TEST_CASE_FIXTURE(ReaderSyncZCFixture, "read] cpp random access") {
   cpp_rsz.read([&](a0::TransportLocked tlk, a0::FlatPacket) {
     off_0 = tlk.frame()->hdr.off;
   });
-  REQUIRE(off_0 == 144);
+  REQUIRE(off_0 == 320);
 
   size_t off_1 = 0;
   cpp_rsz.read([&](a0::TransportLocked tlk, a0::FlatPacket) {
     off_1 = tlk.frame()->hdr.off;
   });
-  REQUIRE(off_1 == 256);
+  REQUIRE(off_1 == 432);
 
   a0::read_random_access(
       a0::cpp_wrap<a0::Arena>(arena),
@@ -643,6 +946,49 @@ TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] oldest-next") {
   REQUIRE_OK(a0_reader_sync_close(&rs));
 }
 
+TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] skips discarded frames") {
+  init_producer_slots();
+  push_discarded();
+
+  REQUIRE_OK(a0_reader_sync_init(&rs, arena, a0::test::alloc(), C_OLDEST_NEXT));
+  REQUIRE(!can_read());
+
+  push_pkt("pkt_0");
+  push_discarded();
+  push_discarded();
+  push_pkt("pkt_1");
+  push_discarded();
+
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_0");
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_1");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_close(&rs));
+
+  // The most recent frame is the newest one kept.
+  REQUIRE_OK(a0_reader_sync_init(&rs, arena, a0::test::alloc(), C_MOST_RECENT_NEXT));
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_1");
+  REQUIRE(!can_read());
+
+  push_discarded();
+  REQUIRE(!can_read());
+  push_pkt("pkt_2");
+  REQUIRE(can_read());
+  REQUIRE_READ("pkt_2");
+  REQUIRE(!can_read());
+  REQUIRE_OK(a0_reader_sync_close(&rs));
+
+  // Starting at a discarded frame starts at the next one kept.
+  REQUIRE_OK(a0_reader_sync_init(&rs, arena, a0::test::alloc(), {A0_INIT_SEQ, A0_ITER_NEXT, 3, {}}));
+  REQUIRE_READ("pkt_1");
+  REQUIRE_READ("pkt_2");
+  REQUIRE(!can_read());
+
+  REQUIRE_OK(a0_reader_sync_close(&rs));
+}
+
 TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] cpp oldest-next") {
   push_pkt("pkt_0");
   push_pkt("pkt_1");
@@ -665,6 +1011,29 @@ TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] cpp oldest-next") {
       "Not available yet");
 }
 
+TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] cpp recycles buffers") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+  push_pkt("pkt_2");
+
+  a0::ReaderSync cpp_rs(a0::cpp_wrap<a0::Arena>(arena), a0::INIT_OLDEST);
+  const char* recycled;
+  {
+    auto pkt_0 = cpp_rs.read();
+    auto pkt_1 = cpp_rs.read();
+    // Live packets never share a buffer.
+    REQUIRE(pkt_0.payload().data() != pkt_1.payload().data());
+    REQUIRE(pkt_0.payload() == "pkt_0");
+    REQUIRE(pkt_1.payload() == "pkt_1");
+    recycled = pkt_0.payload().data();
+  }
+
+  // The buffer of the last packet dropped, pkt_0, is the first reused.
+  auto pkt_2 = cpp_rs.read();
+  REQUIRE(pkt_2.payload() == "pkt_2");
+  REQUIRE(pkt_2.payload().data() == recycled);
+}
+
 TEST_CASE_FIXTURE(ReaderSyncFixture, "reader_sync] oldest-next, empty start") {
   REQUIRE_OK(a0_reader_sync_init(&rs, arena, a0::test::alloc(), C_OLDEST_NEXT));
   REQUIRE(!can_read());
@@ -1082,6 +1451,111 @@ TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] oldest-next") {
   REQUIRE_OK(a0_reader_zc_close(&rz));
 }
 
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] skips discarded frames") {
+  init_producer_slots();
+  push_discarded();
+  push_pkt("pkt_0");
+  push_discarded();
+
+  REQUIRE_OK(a0_reader_zc_init(&rz, arena, C_OLDEST_NEXT, make_callback()));
+
+  push_discarded();
+  push_pkt("pkt_1");
+  push_discarded();
+  push_pkt("pkt_2");
+
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_0", "pkt_1", "pkt_2"});
+
+  REQUIRE_OK(a0_reader_zc_close(&rz));
+}
+
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] batch") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+  push_pkt("pkt_2");
+
+  struct batch_data_t {
+    std::vector<size_t> sizes;
+    std::vector<std::string> payloads;
+    std::mutex mu;
+    std::condition_variable cv;
+  } batch_data;
+
+  a0_zero_copy_batch_callback_t onbatch = {
+      .user_data = &batch_data,
+      .fn = [](void* user_data, a0_transport_locked_t, a0_flat_packet_t* fpkts, size_t n) {
+        auto* data = (batch_data_t*)user_data;
+        std::unique_lock<std::mutex> lk{data->mu};
+        data->sizes.push_back(n);
+        for (size_t i = 0; i < n; i++) {
+          data->payloads.push_back(a0::test::str(a0::test::unflatten(fpkts[i]).payload));
+        }
+        data->cv.notify_all();
+      },
+  };
+
+  REQUIRE(A0_SYSERR(a0_reader_zc_init_batch(&rz, arena, C_OLDEST_NEXT, 0, onbatch)) == EINVAL);
+  REQUIRE_OK(a0_reader_zc_init_batch(&rz, arena, C_OLDEST_NEXT, 2, onbatch));
+
+  {
+    std::unique_lock<std::mutex> lk{batch_data.mu};
+    batch_data.cv.wait(lk, [&]() { return batch_data.payloads.size() == 3; });
+    // The frames available at start are read two at a time.
+    REQUIRE(batch_data.sizes == std::vector<size_t>{2, 1});
+  }
+
+  push_pkt("pkt_3");
+
+  {
+    std::unique_lock<std::mutex> lk{batch_data.mu};
+    batch_data.cv.wait(lk, [&]() { return batch_data.payloads.size() == 4; });
+    REQUIRE(batch_data.payloads == std::vector<std::string>{"pkt_0", "pkt_1", "pkt_2", "pkt_3"});
+  }
+
+  REQUIRE_OK(a0_reader_zc_close(&rz));
+}
+
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] shared reader slots") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  push_pkt("pkt_0");
+
+  struct lease_data_t {
+    ReaderZCFixture* self;
+    bool all_shared;
+  } lease_data{this, true};
+
+  a0_zero_copy_callback_t cb = {
+      .user_data = &lease_data,
+      .fn = [](void* user_data, a0_transport_locked_t tlk, a0_flat_packet_t fpkt) {
+        auto* lease_data = (lease_data_t*)user_data;
+        bool is_shared;
+        a0_transport_is_shared(tlk, &is_shared);
+
+        auto payload = a0::test::str(a0::test::unflatten(fpkt).payload);
+        // Writers are not blocked by the callback.
+        if (payload == "pkt_0") {
+          lease_data->self->push_pkt("pkt_1");
+        }
+
+        std::unique_lock<std::mutex> lk{lease_data->self->data.mu};
+        lease_data->all_shared &= is_shared;
+        lease_data->self->data.collected_payloads.push_back(payload);
+        lease_data->self->data.cv.notify_all();
+      },
+  };
+
+  REQUIRE_OK(a0_reader_zc_init(&rz, arena, C_OLDEST_NEXT, cb));
+
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_0", "pkt_1"});
+  REQUIRE(lease_data.all_shared);
+
+  REQUIRE_OK(a0_reader_zc_close(&rz));
+}
+
 TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] cpp oldest-next") {
   push_pkt("pkt_0");
   push_pkt("pkt_1");
@@ -1205,6 +1679,50 @@ TEST_CASE_FIXTURE(ReaderZCFixture, "reader_zc] await new-newest") {
   REQUIRE_OK(a0_reader_zc_close(&rz));
 }
 
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_spin_zc] oldest-next") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+
+  a0_reader_spin_zc_t rsz;
+  REQUIRE_OK(a0_reader_spin_zc_init(&rsz, arena, C_OLDEST_NEXT, A0_TRANSPORT_POLL_RELAX, make_callback()));
+
+  push_pkt("pkt_2");
+
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_0", "pkt_1", "pkt_2"});
+
+  REQUIRE_OK(a0_reader_spin_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_spin_zc] await new-newest, umwait") {
+  push_pkt("pkt_0");
+
+  // Falls back to relaxing on cpus without UMWAIT.
+  a0_reader_spin_zc_t rsz;
+  REQUIRE_OK(a0_reader_spin_zc_init(&rsz, arena, C_AWAIT_NEW_NEWEST, A0_TRANSPORT_POLL_UMWAIT, make_callback()));
+
+  push_pkt("pkt_1");
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_1"});
+
+  push_pkt("pkt_2");
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_1", "pkt_2"});
+
+  REQUIRE_OK(a0_reader_spin_zc_close(&rsz));
+}
+
+TEST_CASE_FIXTURE(ReaderZCFixture, "reader_spin_zc] cpp oldest-next") {
+  push_pkt("pkt_0");
+  push_pkt("pkt_1");
+
+  a0::ReaderSpinZeroCopy cpp_rsz(
+      a0::cpp_wrap<a0::Arena>(arena),
+      a0::INIT_OLDEST,
+      make_cpp_callback());
+
+  push_pkt("pkt_2");
+
+  WAIT_AND_REQUIRE_PAYLOADS({"pkt_0", "pkt_1", "pkt_2"});
+}
+
 struct ReaderFixture : ReaderBaseFixture {
   a0_reader_t r;
 
@@ -1,15 +1,22 @@
 #include <a0/arena.h>
 #include <a0/arena.hpp>
 #include <a0/buf.h>
+#include <a0/empty.h>
 #include <a0/err.h>
+#include <a0/event.h>
 #include <a0/file.h>
 #include <a0/time.h>
+#include <a0/time.hpp>
 #include <a0/transport.h>
 #include <a0/transport.hpp>
 
 #include <doctest.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/wait.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
 #include <csignal>
@@ -51,6 +58,7 @@ struct TransportFixture {
     arena = a0_arena_t{
         .buf = {stack_arena_data.data(), stack_arena_data.size()},
         .mode = A0_ARENA_MODE_SHARED,
+        .capacity = 0,
     };
 
     a0_file_remove(TEST_DISK);
@@ -97,14 +105,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] construct") {
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     },
     "working_state": {
       "seq_low": 0,
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     }
   },
   "data": [
@@ -128,14 +136,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp construct") {
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     },
     "working_state": {
       "seq_low": 0,
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     }
   },
   "data": [
@@ -144,6 +152,320 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp construct") {
 )");
 }
 
+TEST_CASE_FIXTURE(TransportFixture, "transport] update from 0.3") {
+  // Writes a 0.3 transport, with frames of the given size packed after the
+  // 144 byte header.
+  auto write_0_3 = [&](size_t data_size, uint64_t cnt) {
+    memset(arena.buf.data, 0, arena.buf.size);
+    uint8_t* hdr = arena.buf.data;
+    memcpy(hdr, "ALEPHZERO", 9);
+    hdr[10] = 3;    // version.minor
+    hdr[12] = 1;    // initialized
+    hdr[129] = 1;   // cursor_slots
+    *(size_t*)&hdr[136] = arena.buf.size;
+
+    // The single cursor slot is in front of the workspace, and was held.
+    hdr[144 + 16] = 1;
+    size_t off = 144 + 32;
+    size_t prev_off = 0;
+    for (uint64_t seq = 1; seq <= cnt; seq++) {
+      a0_transport_frame_hdr_t frame_hdr = {seq, off, 0, prev_off, data_size};
+      if (prev_off) {
+        ((a0_transport_frame_hdr_t*)&hdr[prev_off])->next_off = off;
+      }
+      memcpy(&hdr[off], &frame_hdr, sizeof(frame_hdr));
+      memset(&hdr[off + sizeof(frame_hdr)], 'a' + seq, data_size);
+      prev_off = off;
+      off += (sizeof(frame_hdr) + data_size + 15) & ~15;
+    }
+    // state_pages[0]
+    a0_transport_state_t state = {1, cnt, 144 + 32, prev_off, prev_off + sizeof(a0_transport_frame_hdr_t) + data_size};
+    memcpy(&hdr[48], &state, sizeof(state));
+  };
+
+  auto require_frames = [&](a0_transport_locked_t lk, uint64_t seq_low, uint64_t seq_high, size_t data_size) {
+    uint64_t seq;
+    REQUIRE_OK(a0_transport_seq_low(lk, &seq));
+    REQUIRE(seq == seq_low);
+    REQUIRE_OK(a0_transport_seq_high(lk, &seq));
+    REQUIRE(seq == seq_high);
+
+    REQUIRE_OK(a0_transport_jump_head(lk));
+    for (seq = seq_low; seq <= seq_high; seq++) {
+      a0_transport_frame_t* frame;
+      REQUIRE_OK(a0_transport_frame(lk, &frame));
+      REQUIRE(frame->hdr.seq == seq);
+      REQUIRE(a0::test::str(frame) == std::string(data_size, 'a' + seq));
+      if (seq < seq_high) {
+        REQUIRE_OK(a0_transport_step_next(lk));
+      }
+    }
+  };
+
+  write_0_3(1, 3);
+
+  // Readers cannot update the transport.
+  a0_arena_t readonly_arena = arena;
+  readonly_arena.mode = A0_ARENA_MODE_READONLY;
+  a0_transport_t transport;
+  REQUIRE(A0_SYSERR(a0_transport_init(&transport, readonly_arena)) == ENOTSUP);
+
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  require_frames(lk, 1, 3, 1);
+
+  // Frames are packed after the new header and cursor slot.
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->hdr.off == 320 + 32);
+
+  // Slots are reset.
+  a0_transport_cursor_t cursor;
+  REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Already updated.
+  REQUIRE_OK(a0_transport_init(&transport, readonly_arena));
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  require_frames(lk, 1, 3, 1);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The oldest frames are dropped if they no longer fit.
+  write_0_3(1250, 3);
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  require_frames(lk, 2, 3, 1250);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Concurrent openers update the transport once.
+  write_0_3(1, 3);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      a0_transport_t concurrent;
+      REQUIRE_OK(a0_transport_init(&concurrent, arena));
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  require_frames(lk, 1, 3, 1);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // An interrupted update, with the first cache line completed, resumes as an
+  // empty transport.
+  write_0_3(1, 3);
+  arena.buf.data[11] = 0xff;  // version.patch
+  arena.buf.data[16] = 1;     // cursor_slots
+  *(size_t*)&arena.buf.data[24] = arena.buf.size;
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  bool empty;
+  REQUIRE_OK(a0_transport_empty(lk, &empty));
+  REQUIRE(empty);
+  REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  REQUIRE(frame->hdr.off == 320 + 32);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] frame align") {
+  a0_transport_t transport;
+  for (uint8_t frame_align : {1, 4, 12, 128}) {
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.frame_align = frame_align;
+    REQUIRE(a0_transport_init_options(&transport, arena, opts) ==
+            A0_ERR_INVALID_ARG);
+  }
+
+  auto frame_offs = [&](uint8_t frame_align) {
+    memset(arena.buf.data, 0, arena.buf.size);
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.frame_align = frame_align;
+    REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+    a0_transport_locked_t lk;
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+    std::vector<size_t> offs;
+    for (int i = 0; i < 3; i++) {
+      a0_transport_frame_t* frame;
+      REQUIRE_OK(a0_transport_alloc(lk, 9, &frame));
+      memcpy(frame->data, "012345678", 9);
+      REQUIRE_OK(a0_transport_commit(lk));
+      offs.push_back(frame->hdr.off);
+    }
+
+    // Frames remain reachable by offset.
+    REQUIRE(a0_transport_jump(lk, offs[1] + 4) == A0_ERR_RANGE);
+    REQUIRE_OK(a0_transport_jump(lk, offs[1]));
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    REQUIRE(frame->hdr.seq == 2);
+    REQUIRE(a0::test::str(frame) == "012345678");
+    REQUIRE_OK(a0_transport_unlock(lk));
+    return offs;
+  };
+
+  REQUIRE(frame_offs(0) == std::vector<size_t>{320, 384, 448});
+  REQUIRE(frame_offs(8) == std::vector<size_t>{320, 376, 432});
+  REQUIRE(frame_offs(64) == std::vector<size_t>{320, 384, 448});
+
+  // The workspace starts aligned.
+  memset(arena.buf.data, 0, arena.buf.size);
+  a0::Transport::Options opts = a0::Transport::Options::DEFAULT;
+  opts.cursor_slots = 1;
+  opts.frame_align = 64;
+  a0::Transport cpp_transport(a0::cpp_wrap<a0::Arena>(arena), opts);
+  auto tlk = cpp_transport.lock();
+  REQUIRE(tlk.alloc(9)->hdr.off == 384);
+  tlk.commit();
+  REQUIRE(tlk.alloc(100)->hdr.off == 448);
+  tlk.commit();
+  REQUIRE(tlk.alloc(9)->hdr.off == 640);
+  tlk.commit();
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] compact frames") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.frame_align = 8;
+  opts.compact_frames = true;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  // Frames are only reachable through the accessors.
+  a0_transport_frame_t* frame;
+  REQUIRE(A0_SYSERR(a0_transport_alloc(lk, 9, &frame)) == ENOTSUP);
+
+  std::vector<size_t> offs;
+  for (int i = 0; i < 3; i++) {
+    a0_alloc_t alloc;
+    REQUIRE_OK(a0_transport_allocator(&lk, &alloc));
+    a0_buf_t buf;
+    REQUIRE_OK(a0_alloc(alloc, 9, &buf));
+    memcpy(buf.data, "012345678", 9);
+    buf.data[8] = '0' + i;
+    REQUIRE_OK(a0_transport_commit(lk));
+    REQUIRE_OK(a0_transport_jump_tail(lk));
+    offs.push_back(transport._off);
+  }
+
+  // A 24 byte header, instead of 40.
+  REQUIRE(offs == std::vector<size_t>{320, 360, 400});
+
+  auto require_at = [&](uint64_t seq, std::string data) {
+    a0_buf_t buf;
+    REQUIRE_OK(a0_transport_frame_data(lk, &buf));
+    REQUIRE(transport._seq == seq);
+    REQUIRE(a0::test::str(buf) == data);
+  };
+
+  REQUIRE(A0_SYSERR(a0_transport_frame(lk, &frame)) == ENOTSUP);
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  require_at(1, "012345670");
+  REQUIRE_OK(a0_transport_step_next(lk));
+  require_at(2, "012345671");
+  REQUIRE_OK(a0_transport_step_prev(lk));
+  require_at(1, "012345670");
+  REQUIRE_OK(a0_transport_jump_seq(lk, 3));
+  require_at(3, "012345672");
+  REQUIRE_OK(a0_transport_jump(lk, offs[1]));
+  require_at(2, "012345671");
+  REQUIRE(a0_transport_jump(lk, offs[1] + 4) == A0_ERR_RANGE);
+
+  // Links stay relative as the arena wraps around.
+  for (int i = 0; i < 200; i++) {
+    a0_alloc_t alloc;
+    REQUIRE_OK(a0_transport_allocator(&lk, &alloc));
+    a0_buf_t buf;
+    REQUIRE_OK(a0_alloc(alloc, 9 + i % 50, &buf));
+    memset(buf.data, 'a' + i % 26, buf.size);
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+
+  uint64_t seq_low, seq_high;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_low > 1);
+  REQUIRE(seq_high == 203);
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  for (uint64_t seq = seq_low; seq <= seq_high; seq++) {
+    a0_buf_t buf;
+    REQUIRE_OK(a0_transport_frame_data(lk, &buf));
+    REQUIRE(transport._seq == seq);
+    REQUIRE(buf.size == 9 + (seq - 4) % 50);
+    REQUIRE(buf.data[0] == 'a' + (seq - 4) % 26);
+    bool has_next;
+    REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+    if (has_next) {
+      REQUIRE_OK(a0_transport_step_next(lk));
+    }
+  }
+  for (uint64_t seq = seq_high; seq > seq_low; seq--) {
+    REQUIRE_OK(a0_transport_step_prev(lk));
+    REQUIRE(transport._seq == seq - 1);
+  }
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  auto cpp_tlk = a0::cpp_wrap<a0::Transport>(&transport).lock();
+  REQUIRE(cpp_tlk.seq_high() == 203);
+  cpp_tlk.jump_tail();
+  REQUIRE(cpp_tlk.frame_data().size() == 9 + 199 % 50);
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] compact frames, multi-producer") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 1;
+  opts.compact_frames = true;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  auto push = [&](std::string data, bool discard) {
+    a0_transport_reservation_t res;
+    REQUIRE_OK(a0_transport_reserve(lk, data.size(), &res));
+    REQUIRE(res.frame == nullptr);
+    REQUIRE(res.data.size == data.size());
+    memcpy(res.data.data, data.data(), data.size());
+    REQUIRE_OK(discard ? a0_transport_discard(lk, &res) : a0_transport_publish(lk, &res));
+  };
+
+  push("A", false);
+  push("B", true);
+  push("C", false);
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  auto require_at = [&](uint64_t seq, std::string data) {
+    a0_buf_t buf;
+    REQUIRE_OK(a0_transport_frame_data(lk, &buf));
+    REQUIRE(transport._seq == seq);
+    REQUIRE(a0::test::str(buf) == data);
+  };
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  require_at(1, "A");
+  REQUIRE_OK(a0_transport_step_next(lk));
+  require_at(3, "C");
+  REQUIRE_OK(a0_transport_step_prev(lk));
+  require_at(1, "A");
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
 TEST_CASE_FIXTURE(TransportFixture, "transport] alloc/commit") {
   a0_transport_t transport;
   REQUIRE_OK(a0_transport_init(&transport, arena));
@@ -164,14 +486,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] alloc/commit") {
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     },
     "working_state": {
       "seq_low": 0,
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     }
   },
   "data": [
@@ -195,32 +517,32 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] alloc/commit") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 1,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 194
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 370
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 208,
+      "next_off": 384,
       "data_size": 10,
       "data": "0123456789"
     },
     {
       "committed": false,
-      "off": 208,
+      "off": 384,
       "seq": 2,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 40,
       "data": "01234567890123456789012345678..."
@@ -238,31 +560,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] alloc/commit") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 208,
+      "next_off": 384,
       "data_size": 10,
       "data": "0123456789"
     },
     {
-      "off": 208,
+      "off": 384,
       "seq": 2,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 40,
       "data": "01234567890123456789012345678..."
@@ -289,14 +611,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp alloc/commit") {
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     },
     "working_state": {
       "seq_low": 0,
       "seq_high": 0,
       "off_head": 0,
       "off_tail": 0,
-      "high_water_mark": 144
+      "high_water_mark": 320
     }
   },
   "data": [
@@ -318,32 +640,32 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp alloc/commit") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 1,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 194
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 370
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 208,
+      "next_off": 384,
       "data_size": 10,
       "data": "0123456789"
     },
     {
       "committed": false,
-      "off": 208,
+      "off": 384,
       "seq": 2,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 40,
       "data": "01234567890123456789012345678..."
@@ -361,31 +683,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp alloc/commit") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 208,
-      "high_water_mark": 288
+      "off_head": 320,
+      "off_tail": 384,
+      "high_water_mark": 464
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 208,
+      "next_off": 384,
       "data_size": 10,
       "data": "0123456789"
     },
     {
-      "off": 208,
+      "off": 384,
       "seq": 2,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 40,
       "data": "01234567890123456789012345678..."
@@ -431,6 +753,48 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp evicts") {
       "Frame size too large");
 }
 
+TEST_CASE_FIXTURE(TransportFixture, "transport] evicts many") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  for (int i = 0; i < 50; i++) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, 8, &frame));
+    memcpy(frame->data, "01234567", 8);
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+
+  uint64_t seq_low;
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_low == 1);
+  REQUIRE(seq_high == 50);
+
+  // The large alloc wraps around and evicts many small frames.
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 2 * 1024, &frame));
+
+  // Drop the uncommitted alloc. The evictions were committed.
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_low == 45);
+  REQUIRE(seq_high == 50);
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->hdr.seq == 45);
+  REQUIRE(a0::test::str(frame) == "01234567");
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
 TEST_CASE_FIXTURE(TransportFixture, "transport] iteration") {
   // Create transport and close it.
   {
@@ -747,39 +1111,39 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] wrap around") {
     "committed_state": {
       "seq_low": 18,
       "seq_high": 20,
-      "off_head": 2288,
-      "off_tail": 1216,
-      "high_water_mark": 3352
+      "off_head": 2464,
+      "off_tail": 1392,
+      "high_water_mark": 3528
     },
     "working_state": {
       "seq_low": 18,
       "seq_high": 20,
-      "off_head": 2288,
-      "off_tail": 1216,
-      "high_water_mark": 3352
+      "off_head": 2464,
+      "off_tail": 1392,
+      "high_water_mark": 3528
     }
   },
   "data": [
     {
-      "off": 2288,
+      "off": 2464,
       "seq": 18,
-      "prev_off": 1216,
-      "next_off": 144,
+      "prev_off": 1392,
+      "next_off": 320,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
     },
     {
-      "off": 144,
+      "off": 320,
       "seq": 19,
-      "prev_off": 2288,
-      "next_off": 1216,
+      "prev_off": 2464,
+      "next_off": 1392,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
     },
     {
-      "off": 1216,
+      "off": 1392,
       "seq": 20,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
@@ -810,39 +1174,39 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp wrap around") {
     "committed_state": {
       "seq_low": 18,
       "seq_high": 20,
-      "off_head": 2288,
-      "off_tail": 1216,
-      "high_water_mark": 3352
+      "off_head": 2464,
+      "off_tail": 1392,
+      "high_water_mark": 3528
     },
     "working_state": {
       "seq_low": 18,
       "seq_high": 20,
-      "off_head": 2288,
-      "off_tail": 1216,
-      "high_water_mark": 3352
+      "off_head": 2464,
+      "off_tail": 1392,
+      "high_water_mark": 3528
     }
   },
   "data": [
     {
-      "off": 2288,
+      "off": 2464,
       "seq": 18,
-      "prev_off": 1216,
-      "next_off": 144,
+      "prev_off": 1392,
+      "next_off": 320,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
     },
     {
-      "off": 144,
+      "off": 320,
       "seq": 19,
-      "prev_off": 2288,
-      "next_off": 1216,
+      "prev_off": 2464,
+      "next_off": 1392,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
     },
     {
-      "off": 1216,
+      "off": 1392,
       "seq": 20,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 1024,
       "data": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa..."
@@ -970,21 +1334,21 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] large alloc") {
     "committed_state": {
       "seq_low": 5,
       "seq_high": 5,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 3256
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 3432
     },
     "working_state": {
       "seq_low": 5,
       "seq_high": 5,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 3256
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 3432
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 5,
       "prev_off": 0,
       "next_off": 0,
@@ -1016,21 +1380,21 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp large alloc") {
     "committed_state": {
       "seq_low": 5,
       "seq_high": 5,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 3256
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 3432
     },
     "working_state": {
       "seq_low": 5,
       "seq_high": 5,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 3256
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 3432
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 5,
       "prev_off": 0,
       "next_off": 0,
@@ -1051,7 +1415,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
 
   size_t used_space;
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 144);
+  REQUIRE(used_space == 320);
 
   std::string data(1024, 'a');
   a0_transport_frame_t* frame;
@@ -1061,11 +1425,11 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 1208);
+  REQUIRE(used_space == 1384);
 
   REQUIRE(a0_transport_resize(lk, 0) == A0_ERR_INVALID_ARG);
-  REQUIRE(a0_transport_resize(lk, 1207) == A0_ERR_INVALID_ARG);
-  REQUIRE_OK(a0_transport_resize(lk, 1208));
+  REQUIRE(a0_transport_resize(lk, 1383) == A0_ERR_INVALID_ARG);
+  REQUIRE_OK(a0_transport_resize(lk, 1384));
 
   data = std::string(1024 + 1, 'a');  // 1 byte larger than previous.
   REQUIRE(a0_transport_alloc(lk, data.size(), &frame) == A0_ERR_FRAME_LARGE);
@@ -1079,31 +1443,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_frame(lk, &frame));
   REQUIRE(frame->hdr.data_size == 1024);
   REQUIRE(a0::test::str(frame) == data);
-  REQUIRE(arena.buf.data[1207] == 'b');
-  REQUIRE(arena.buf.data[1208] != 'b');
+  REQUIRE(arena.buf.data[1383] == 'b');
+  REQUIRE(arena.buf.data[1384] != 'b');
 
   require_debugstr(lk, R"(
 {
   "header": {
-    "arena_size": 1208,
+    "arena_size": 1384,
     "committed_state": {
       "seq_low": 2,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 1208
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 1384
     },
     "working_state": {
       "seq_low": 2,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 1208
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 1384
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 2,
       "prev_off": 0,
       "next_off": 0,
@@ -1115,7 +1479,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
 )");
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 1208);
+  REQUIRE(used_space == 1384);
 
   REQUIRE_OK(a0_transport_resize(lk, 4096));
 
@@ -1125,7 +1489,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 3304);
+  REQUIRE(used_space == 3480);
 
   require_debugstr(lk, R"(
 {
@@ -1134,31 +1498,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
     "committed_state": {
       "seq_low": 2,
       "seq_high": 3,
-      "off_head": 144,
-      "off_tail": 1216,
-      "high_water_mark": 3304
+      "off_head": 320,
+      "off_tail": 1392,
+      "high_water_mark": 3480
     },
     "working_state": {
       "seq_low": 2,
       "seq_high": 3,
-      "off_head": 144,
-      "off_tail": 1216,
-      "high_water_mark": 3304
+      "off_head": 320,
+      "off_tail": 1392,
+      "high_water_mark": 3480
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 2,
       "prev_off": 0,
-      "next_off": 1216,
+      "next_off": 1392,
       "data_size": 1024,
       "data": "bbbbbbbbbbbbbbbbbbbbbbbbbbbbb..."
     },
     {
-      "off": 1216,
+      "off": 1392,
       "seq": 3,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 2048,
       "data": "ccccccccccccccccccccccccccccc..."
@@ -1175,7 +1539,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 3368);
+  REQUIRE(used_space == 3544);
 
   data = std::string(3 * 1024, 'e');
   REQUIRE_OK(a0_transport_alloc(lk, data.size(), &frame));
@@ -1183,7 +1547,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 3368);
+  REQUIRE(used_space == 3544);
 
   data = std::string(16, 'f');
   REQUIRE_OK(a0_transport_alloc(lk, data.size(), &frame));
@@ -1191,7 +1555,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 3320);
+  REQUIRE(used_space == 3496);
 
   require_debugstr(lk, R"(
 {
@@ -1200,31 +1564,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
     "committed_state": {
       "seq_low": 5,
       "seq_high": 6,
-      "off_head": 144,
-      "off_tail": 3264,
-      "high_water_mark": 3320
+      "off_head": 320,
+      "off_tail": 3440,
+      "high_water_mark": 3496
     },
     "working_state": {
       "seq_low": 5,
       "seq_high": 6,
-      "off_head": 144,
-      "off_tail": 3264,
-      "high_water_mark": 3320
+      "off_head": 320,
+      "off_tail": 3440,
+      "high_water_mark": 3496
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 5,
-      "prev_off": 3312,
-      "next_off": 3264,
+      "prev_off": 3488,
+      "next_off": 3440,
       "data_size": 3072,
       "data": "eeeeeeeeeeeeeeeeeeeeeeeeeeeee..."
     },
     {
-      "off": 3264,
+      "off": 3440,
       "seq": 6,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 16,
       "data": "ffffffffffffffff"
@@ -1241,7 +1605,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_commit(lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == (144 + 40 + 3264));
+  REQUIRE(used_space == (320 + 40 + 3264));
 
   uint64_t seq_low;
   REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
@@ -1258,7 +1622,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] resize") {
   REQUIRE_OK(a0_transport_lock(&transport, &lk));
 
   REQUIRE_OK(a0_transport_used_space(lk, &used_space));
-  REQUIRE(used_space == 144);
+  REQUIRE(used_space == 320);
 
   REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
   REQUIRE(seq_low == 8);
@@ -1273,24 +1637,24 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   a0::Transport transport(a0::cpp_wrap<a0::Arena>(arena));
   a0::TransportLocked tlk = transport.lock();
 
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
 
   std::string data(1024, 'a');
   auto* frame = tlk.alloc(data.size());
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == 1208);
+  REQUIRE(tlk.used_space() == 1384);
 
   REQUIRE_THROWS_WITH(
       tlk.resize(0),
       "Invalid argument");
 
   REQUIRE_THROWS_WITH(
-      tlk.resize(1207),
+      tlk.resize(1383),
       "Invalid argument");
 
-  tlk.resize(1208);
+  tlk.resize(1384);
 
   data = std::string(1024 + 1, 'a');  // 1 byte larger than previous.
 
@@ -1311,31 +1675,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   frame = tlk.frame();
   REQUIRE(frame->hdr.data_size == 1024);
   REQUIRE(a0::test::str(frame) == data);
-  REQUIRE(arena.buf.data[1207] == 'b');
-  REQUIRE(arena.buf.data[1208] != 'b');
+  REQUIRE(arena.buf.data[1383] == 'b');
+  REQUIRE(arena.buf.data[1384] != 'b');
 
   require_debugstr(*tlk.c, R"(
 {
   "header": {
-    "arena_size": 1208,
+    "arena_size": 1384,
     "committed_state": {
       "seq_low": 2,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 1208
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 1384
     },
     "working_state": {
       "seq_low": 2,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 1208
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 1384
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 2,
       "prev_off": 0,
       "next_off": 0,
@@ -1346,7 +1710,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
 }
 )");
 
-  REQUIRE(tlk.used_space() == 1208);
+  REQUIRE(tlk.used_space() == 1384);
 
   tlk.resize(4096);
 
@@ -1355,7 +1719,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == 3304);
+  REQUIRE(tlk.used_space() == 3480);
 
   require_debugstr(*tlk.c, R"(
 {
@@ -1364,31 +1728,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
     "committed_state": {
       "seq_low": 2,
       "seq_high": 3,
-      "off_head": 144,
-      "off_tail": 1216,
-      "high_water_mark": 3304
+      "off_head": 320,
+      "off_tail": 1392,
+      "high_water_mark": 3480
     },
     "working_state": {
       "seq_low": 2,
       "seq_high": 3,
-      "off_head": 144,
-      "off_tail": 1216,
-      "high_water_mark": 3304
+      "off_head": 320,
+      "off_tail": 1392,
+      "high_water_mark": 3480
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 2,
       "prev_off": 0,
-      "next_off": 1216,
+      "next_off": 1392,
       "data_size": 1024,
       "data": "bbbbbbbbbbbbbbbbbbbbbbbbbbbbb..."
     },
     {
-      "off": 1216,
+      "off": 1392,
       "seq": 3,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 2048,
       "data": "ccccccccccccccccccccccccccccc..."
@@ -1404,21 +1768,21 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == 3368);
+  REQUIRE(tlk.used_space() == 3544);
 
   data = std::string(3 * 1024, 'e');
   frame = tlk.alloc(data.size());
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == 3368);
+  REQUIRE(tlk.used_space() == 3544);
 
   data = std::string(16, 'f');
   frame = tlk.alloc(data.size());
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == 3320);
+  REQUIRE(tlk.used_space() == 3496);
 
   require_debugstr(*tlk.c, R"(
 {
@@ -1427,31 +1791,31 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
     "committed_state": {
       "seq_low": 5,
       "seq_high": 6,
-      "off_head": 144,
-      "off_tail": 3264,
-      "high_water_mark": 3320
+      "off_head": 320,
+      "off_tail": 3440,
+      "high_water_mark": 3496
     },
     "working_state": {
       "seq_low": 5,
       "seq_high": 6,
-      "off_head": 144,
-      "off_tail": 3264,
-      "high_water_mark": 3320
+      "off_head": 320,
+      "off_tail": 3440,
+      "high_water_mark": 3496
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 5,
-      "prev_off": 3312,
-      "next_off": 3264,
+      "prev_off": 3488,
+      "next_off": 3440,
       "data_size": 3072,
       "data": "eeeeeeeeeeeeeeeeeeeeeeeeeeeee..."
     },
     {
-      "off": 3264,
+      "off": 3440,
       "seq": 6,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 16,
       "data": "ffffffffffffffff"
@@ -1467,7 +1831,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   memcpy(frame->data, data.c_str(), data.size());
   tlk.commit();
 
-  REQUIRE(tlk.used_space() == (144 + 40 + 3264));
+  REQUIRE(tlk.used_space() == (320 + 40 + 3264));
 
   REQUIRE(tlk.seq_low() == 7);
   REQUIRE(tlk.seq_high() == 7);
@@ -1479,7 +1843,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp resize") {
   tlk = {};
   tlk = transport.lock();
 
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
 
   REQUIRE(tlk.seq_low() == 8);
   REQUIRE(tlk.seq_high() == 7);
@@ -1490,14 +1854,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp clear") {
   a0::TransportLocked tlk = transport.lock();
 
   REQUIRE(tlk.empty());
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
   REQUIRE(tlk.seq_low() == 0);
   REQUIRE(tlk.seq_high() == 0);
 
   tlk.clear();
 
   REQUIRE(tlk.empty());
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
   REQUIRE(tlk.seq_low() == 1);
   REQUIRE(tlk.seq_high() == 0);
 
@@ -1506,7 +1870,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp clear") {
 
   REQUIRE(frame->hdr.seq == 1);
   REQUIRE(!tlk.empty());
-  REQUIRE(tlk.used_space() == 696);
+  REQUIRE(tlk.used_space() == 872);
   REQUIRE(tlk.seq_low() == 1);
   REQUIRE(tlk.seq_high() == 1);
 
@@ -1515,14 +1879,14 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp clear") {
 
   REQUIRE(frame->hdr.seq == 2);
   REQUIRE(!tlk.empty());
-  REQUIRE(tlk.used_space() == 1768);
+  REQUIRE(tlk.used_space() == 1944);
   REQUIRE(tlk.seq_low() == 1);
   REQUIRE(tlk.seq_high() == 2);
 
   tlk.clear();
 
   REQUIRE(tlk.empty());
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
   REQUIRE(tlk.seq_low() == 3);
   REQUIRE(tlk.seq_high() == 2);
 
@@ -1531,7 +1895,7 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp clear") {
 
   REQUIRE(frame->hdr.seq == 3);
   REQUIRE(!tlk.empty());
-  REQUIRE(tlk.used_space() == 696);
+  REQUIRE(tlk.used_space() == 872);
   REQUIRE(tlk.seq_low() == 3);
   REQUIRE(tlk.seq_high() == 3);
 
@@ -1540,21 +1904,21 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp clear") {
 
   REQUIRE(frame->hdr.seq == 4);
   REQUIRE(!tlk.empty());
-  REQUIRE(tlk.used_space() == 1768);
+  REQUIRE(tlk.used_space() == 1944);
   REQUIRE(tlk.seq_low() == 3);
   REQUIRE(tlk.seq_high() == 4);
 
   tlk.clear();
 
   REQUIRE(tlk.empty());
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
   REQUIRE(tlk.seq_low() == 5);
   REQUIRE(tlk.seq_high() == 4);
 
   tlk.clear();
 
   REQUIRE(tlk.empty());
-  REQUIRE(tlk.used_space() == 144);
+  REQUIRE(tlk.used_space() == 320);
   REQUIRE(tlk.seq_low() == 5);
   REQUIRE(tlk.seq_high() == 4);
 }
@@ -1736,6 +2100,1286 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] cpp shm await") {
   REQUIRE(a0::test::str(frame) == "DEF");
 }
 
+TEST_CASE_FIXTURE(TransportFixture, "transport] poll seq_high") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  a0_arena_t readonly_arena = shm.arena;
+  readonly_arena.mode = A0_ARENA_MODE_READONLY;
+  a0_transport_t poller;
+  REQUIRE_OK(a0_transport_init(&poller, readonly_arena));
+
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_poll_seq_high(&poller, &seq_high));
+  REQUIRE(seq_high == 0);
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+
+  // Visible to the poller while the writer still holds the lock.
+  REQUIRE_OK(a0_transport_poll_seq_high(&poller, &seq_high));
+  REQUIRE(seq_high == 1);
+
+  // Returns at once when seq_high already moved on.
+  REQUIRE_OK(a0_transport_poll_pause(&poller, 0, A0_TRANSPORT_POLL_UMWAIT));
+  REQUIRE_OK(a0_transport_poll_pause(&poller, 1, A0_TRANSPORT_POLL_RELAX));
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] spin await") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.lock_spin_ns = 10 * 1000;
+  opts.wait_spin_ns = 100 * 1000;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  fork_sleep_push(&transport, "ABC");
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  REQUIRE_OK(a0_transport_wait(lk, a0_transport_nonempty_pred(&lk)));
+  REQUIRE_OK(a0_transport_jump_head(lk));
+
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(a0::test::str(frame) == "ABC");
+
+  // Spinning does not miss a wake, whether the commit lands during the poll or the sleep.
+  std::thread t([&]() {
+    a0_transport_t pusher;
+    REQUIRE_OK(a0_transport_init_options(&pusher, shm.arena, opts));
+    for (int i = 0; i < 100; i++) {
+      a0_transport_locked_t push_lk;
+      REQUIRE_OK(a0_transport_lock(&pusher, &push_lk));
+      a0_transport_frame_t* push_frame;
+      REQUIRE_OK(a0_transport_alloc(push_lk, 1, &push_frame));
+      REQUIRE_OK(a0_transport_commit(push_lk));
+      REQUIRE_OK(a0_transport_unlock(push_lk));
+      std::this_thread::sleep_for(std::chrono::microseconds(i % 10 * 20));
+    }
+  });
+  for (int i = 0; i < 100; i++) {
+    REQUIRE_OK(a0_transport_wait(lk, a0_transport_has_next_pred(&lk)));
+    REQUIRE_OK(a0_transport_step_next(lk));
+  }
+  t.join();
+
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 101);
+
+  auto wake_time = a0::test::timeout_in(std::chrono::milliseconds(1));
+  REQUIRE(A0_SYSERR(a0_transport_timedwait(lk, a0_transport_has_next_pred(&lk), &wake_time)) == ETIMEDOUT);
+
+  REQUIRE_OK(a0_transport_shutdown(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+static bool fd_readable(int fd) {
+  struct pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+  return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] watcher") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.watcher_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  a0_transport_watcher_t watcher;
+  REQUIRE_OK(a0_transport_watcher_register(lk, &watcher));
+  REQUIRE(watcher.fd >= 0);
+  REQUIRE(!fd_readable(watcher.fd));
+
+  a0_transport_watcher_t other;
+  REQUIRE(A0_SYSERR(a0_transport_watcher_register(lk, &other)) == EBUSY);
+
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE(fd_readable(watcher.fd));
+
+  // Signaled once per arm. Arming drains the descriptor.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_watcher_arm(lk, &watcher));
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE(!fd_readable(watcher.fd));
+
+  // Signaled from another thread, through another transport handle.
+  std::thread t([&]() {
+    a0_transport_t pusher;
+    REQUIRE_OK(a0_transport_init(&pusher, shm.arena));
+    a0_transport_locked_t push_lk;
+    REQUIRE_OK(a0_transport_lock(&pusher, &push_lk));
+    a0_transport_frame_t* push_frame;
+    REQUIRE_OK(a0_transport_alloc(push_lk, 1, &push_frame));
+    REQUIRE_OK(a0_transport_commit(push_lk));
+    REQUIRE_OK(a0_transport_unlock(push_lk));
+  });
+  struct pollfd pfd = {.fd = watcher.fd, .events = POLLIN, .revents = 0};
+  REQUIRE(poll(&pfd, 1, 1000) == 1);
+  t.join();
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_watcher_unregister(lk, &watcher));
+  REQUIRE(watcher.fd == -1);
+
+  // The slot is free again.
+  REQUIRE_OK(a0_transport_watcher_register(lk, &other));
+  REQUIRE_OK(a0_transport_watcher_unregister(lk, &other));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_transport_t unwatched;
+  REQUIRE_OK(a0_transport_init(&unwatched, arena));
+  REQUIRE_OK(a0_transport_lock(&unwatched, &lk));
+  REQUIRE(A0_SYSERR(a0_transport_watcher_register(lk, &other)) == ENOTSUP);
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] watcher in another network namespace") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.watcher_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_watcher_t watcher;
+  REQUIRE_OK(a0_transport_watcher_register(lk, &watcher));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  bool reachable;
+  REQUIRE_OK(a0_transport_watcher_reachable(&watcher, &reachable));
+  REQUIRE(reachable);
+
+  // Commits from a writer that cannot name the watcher's socket.
+  pid_t pid = a0::test::subproc([&]() {
+    if (unshare(CLONE_NEWNET)) {
+      exit(2);
+    }
+    a0_transport_t writer;
+    a0_transport_init(&writer, shm.arena);
+    a0_transport_locked_t writer_lk;
+    a0_transport_lock(&writer, &writer_lk);
+    a0_transport_frame_t* frame;
+    a0_transport_alloc(writer_lk, 1, &frame);
+    a0_transport_commit(writer_lk);
+    a0_transport_unlock(writer_lk);
+  });
+  REQUIRE(pid != -1);
+  int status;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFEXITED(status));
+  // Exit code 2 means a network namespace could not be created here.
+  if (WEXITSTATUS(status) != 2) {
+    REQUIRE(!fd_readable(watcher.fd));
+    REQUIRE_OK(a0_transport_watcher_reachable(&watcher, &reachable));
+    REQUIRE(!reachable);
+  }
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_watcher_unregister(lk, &watcher));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] await targeted") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 3, &frame));
+  memcpy(frame->data, "ABC", 3);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_event_t has_next_waiting = A0_EMPTY;
+  a0_event_t empty_waiting = A0_EMPTY;
+
+  // Waits for a specific sequence number.
+  std::thread has_next_thrd([&]() {
+    a0_transport_t t;
+    REQUIRE_OK(a0_transport_init(&t, shm.arena));
+
+    a0_transport_locked_t tlk;
+    REQUIRE_OK(a0_transport_lock(&t, &tlk));
+    REQUIRE_OK(a0_transport_jump_tail(tlk));
+    a0_event_set(&has_next_waiting);
+
+    auto timeout = a0::test::timeout_in(std::chrono::seconds(5));
+    REQUIRE_OK(a0_transport_timedwait(tlk, a0_transport_has_next_pred(&tlk), &timeout));
+
+    REQUIRE_OK(a0_transport_step_next(tlk));
+    a0_transport_frame_t* tframe;
+    REQUIRE_OK(a0_transport_frame(tlk, &tframe));
+    REQUIRE(tframe->hdr.seq == 2);
+    REQUIRE(a0::test::str(tframe) == "DEF");
+    REQUIRE_OK(a0_transport_unlock(tlk));
+  });
+
+  // Waits for any change.
+  std::thread empty_thrd([&]() {
+    a0_transport_t t;
+    REQUIRE_OK(a0_transport_init(&t, shm.arena));
+
+    a0_transport_locked_t tlk;
+    REQUIRE_OK(a0_transport_lock(&t, &tlk));
+    a0_event_set(&empty_waiting);
+
+    auto timeout = a0::test::timeout_in(std::chrono::seconds(5));
+    REQUIRE_OK(a0_transport_timedwait(tlk, a0_transport_empty_pred(&tlk), &timeout));
+    REQUIRE_OK(a0_transport_unlock(tlk));
+  });
+
+  a0_event_wait(&has_next_waiting);
+  a0_event_wait(&empty_waiting);
+
+  // Clearing does not commit a new sequence number.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_clear(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  empty_thrd.join();
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_alloc(lk, 3, &frame));
+  memcpy(frame->data, "DEF", 3);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  has_next_thrd.join();
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] grow") {
+  // A mapping without room to grow.
+  a0_file_options_t small_opt = shmopt;
+  small_opt.open_options.arena_mode = A0_ARENA_MODE_READONLY;
+  a0_file_t small;
+  REQUIRE_OK(a0_file_open(TEST_SHM, &small_opt, &small));
+
+  REQUIRE_OK(a0_file_close(&shm));
+  shmopt.open_options.reserve_size = 1024 * 1024;
+  REQUIRE_OK(a0_file_open(TEST_SHM, &shmopt, &shm));
+  a0_file_t other;
+  REQUIRE_OK(a0_file_open(TEST_SHM, &shmopt, &other));
+
+  a0_transport_t transport;
+  a0_transport_t other_transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+  REQUIRE_OK(a0_transport_init(&other_transport, other.arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&other_transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE(a0_transport_alloc(lk, 64 * 1024, &frame) == A0_ERR_FRAME_LARGE);
+  REQUIRE(a0_transport_resize(lk, other.arena.buf.size + 1) == A0_ERR_INVALID_ARG);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Grow the file, and resize through a transport on the grown arena.
+  REQUIRE_OK(a0_file_grow(&shm, 128 * 1024));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(a0_transport_resize(lk, 128 * 1024) == A0_ERR_INVALID_ARG);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_transport_t grown;
+  REQUIRE_OK(a0_transport_init(&grown, shm.arena));
+  REQUIRE_OK(a0_transport_lock(&grown, &lk));
+  REQUIRE_OK(a0_transport_resize(lk, 128 * 1024));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The other mapping adopts the new size on lock.
+  std::string data(64 * 1024, 'a');
+  REQUIRE_OK(a0_transport_lock(&other_transport, &lk));
+  REQUIRE_OK(a0_transport_alloc(lk, data.size(), &frame));
+  memcpy(frame->data, data.data(), data.size());
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_jump_tail(lk));
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(std::string((char*)frame->data, frame->hdr.data_size) == data);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The size written by other processes is never trusted past the mapping.
+  a0_transport_t small_transport;
+  REQUIRE_OK(a0_transport_init(&small_transport, small.arena));
+  REQUIRE_OK(a0_transport_lock(&small_transport, &lk));
+  REQUIRE(small_transport._arena.buf.size == 4096);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // A writable mapping without room to grow blocks growth.
+  a0_file_options_t unreserved_opt = shmopt;
+  unreserved_opt.open_options.reserve_size = 0;
+  a0_file_t unreserved;
+  REQUIRE_OK(a0_file_open(TEST_SHM, &unreserved_opt, &unreserved));
+  REQUIRE(a0_file_grow(&shm, 256 * 1024) == A0_MAKE_SYSERR(EBUSY));
+  REQUIRE(shm.arena.buf.size == 128 * 1024);
+  REQUIRE_OK(a0_file_close(&unreserved));
+
+  REQUIRE_OK(a0_file_close(&small));
+  REQUIRE_OK(a0_file_close(&other));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] grown past a mapping") {
+  // Two views of the same memory. Only the reserved one reaches the grown space.
+  std::vector<uint8_t> data(64 * 1024);
+  a0_arena_t reserved_arena = {
+      .buf = {data.data(), data.size()},
+      .mode = A0_ARENA_MODE_SHARED,
+      .capacity = data.size(),
+  };
+  a0_arena_t unreserved_arena = {
+      .buf = {data.data(), 4096},
+      .mode = A0_ARENA_MODE_SHARED,
+      .capacity = 0,
+  };
+
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = 1;
+  a0_transport_t unreserved;
+  REQUIRE_OK(a0_transport_init_options(&unreserved, unreserved_arena, opts));
+  a0_transport_t reserved;
+  REQUIRE_OK(a0_transport_init(&reserved, reserved_arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&reserved, &lk));
+  REQUIRE_OK(a0_transport_resize(lk, data.size()));
+  for (int i = 0; i < 6; i++) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, 1024, &frame));
+    memset(frame->data, 'a' + i, 1024);
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  REQUIRE_OK(a0_transport_lock(&unreserved, &lk));
+  REQUIRE(unreserved._arena.buf.size == 4096);
+
+  // Frames within the mapping are still readable.
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->data[0] == 'a');
+
+  // Frames past it are not.
+  REQUIRE_OK(a0_transport_jump_tail(lk));
+  REQUIRE(a0_transport_frame(lk, &frame) == A0_MAKE_SYSERR(ESPIPE));
+  REQUIRE(a0_transport_step_prev(lk) == A0_MAKE_SYSERR(ESPIPE));
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  a0_err_t err = A0_OK;
+  for (int i = 0; i < 6 && !err; i++) {
+    err = a0_transport_step_next(lk);
+    if (!err) {
+      err = a0_transport_frame(lk, &frame);
+    }
+  }
+  REQUIRE(err == A0_MAKE_SYSERR(ESPIPE));
+
+  REQUIRE(a0_transport_alloc(lk, 8, &frame) == A0_ERR_RANGE);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Shared readers are bound by the same mapping.
+  REQUIRE_OK(a0_transport_lock_shared(&unreserved, &lk));
+  bool shared;
+  REQUIRE_OK(a0_transport_is_shared(lk, &shared));
+  REQUIRE(shared);
+  REQUIRE_OK(a0_transport_jump_tail(lk));
+  REQUIRE(a0_transport_frame(lk, &frame) == A0_MAKE_SYSERR(ESPIPE));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] jump_seq") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.seq_index_size = 3;
+  REQUIRE(a0_transport_init_options(&transport, shm.arena, opts) ==
+          A0_ERR_INVALID_ARG);
+  opts.seq_index_size = 1024;
+  REQUIRE(a0_transport_init_options(&transport, shm.arena, opts) ==
+          A0_ERR_INVALID_ARG);
+
+  // Without an index, with an index of some recent frames, and with an index of all frames.
+  for (uint32_t seq_index_size : {0u, 16u, 128u}) {
+    a0_file_remove(TEST_SHM);
+    a0_file_close(&shm);
+    REQUIRE_OK(a0_file_open(TEST_SHM, &shmopt, &shm));
+    opts.seq_index_size = seq_index_size;
+    REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+    a0_transport_locked_t lk;
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+    REQUIRE(a0_transport_jump_seq(lk, 1) == A0_ERR_RANGE);
+
+    // Enough frames to wrap around the arena.
+    for (uint64_t i = 1; i <= 200; i++) {
+      a0_transport_frame_t* frame;
+      REQUIRE_OK(a0_transport_alloc(lk, sizeof(uint64_t), &frame));
+      memcpy(frame->data, &i, sizeof(uint64_t));
+      REQUIRE_OK(a0_transport_commit(lk));
+    }
+
+    // An uncommitted alloc leaves a stale index entry.
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, sizeof(uint64_t), &frame));
+    REQUIRE_OK(a0_transport_unlock(lk));
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+    uint64_t seq_low;
+    uint64_t seq_high;
+    REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+    REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+    REQUIRE(seq_low > 1);
+    REQUIRE(seq_high == 200);
+
+    REQUIRE(a0_transport_jump_seq(lk, seq_low - 1) == A0_ERR_RANGE);
+    REQUIRE(a0_transport_jump_seq(lk, seq_high + 1) == A0_ERR_RANGE);
+
+    for (uint64_t seq = seq_low; seq <= seq_high; seq++) {
+      REQUIRE_OK(a0_transport_jump_seq(lk, seq));
+      REQUIRE_OK(a0_transport_frame(lk, &frame));
+      REQUIRE(frame->hdr.seq == seq);
+      REQUIRE(*(uint64_t*)frame->data == seq);
+    }
+
+    REQUIRE_OK(a0_transport_unlock(lk));
+  }
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] jump_time") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(a0_transport_jump_time(lk, *A0_TIMEOUT_IMMEDIATE) == A0_MAKE_SYSERR(ENOTSUP));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_file_remove(TEST_SHM);
+  a0_file_close(&shm);
+  REQUIRE_OK(a0_file_open(TEST_SHM, &shmopt, &shm));
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.seq_index_size = 16;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(a0_transport_jump_time(lk, *A0_TIMEOUT_IMMEDIATE) == A0_ERR_RANGE);
+
+  a0_time_mono_t start;
+  REQUIRE_OK(a0_time_mono_now(&start));
+
+  // Enough frames to wrap around the arena and the index.
+  for (uint64_t i = 1; i <= 200; i++) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, sizeof(uint64_t), &frame));
+    memcpy(frame->data, &i, sizeof(uint64_t));
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+
+  a0_time_mono_t end;
+  REQUIRE_OK(a0_time_mono_now(&end));
+
+  uint64_t seq_low;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low < 200 - 16);
+
+  // Frames older than the index have unknown commit times.
+  REQUIRE_OK(a0_transport_jump_seq(lk, 200 - 16));
+  a0_time_mono_t time;
+  REQUIRE(a0_transport_frame_time(lk, &time) == A0_ERR_RANGE);
+
+  // Commit times are non-decreasing, and each seeks to the oldest frame committed at that time.
+  // Older frames have unknown commit times, so seeking never moves before the index.
+  a0_time_mono_t prev_time = start;
+  for (uint64_t seq = 200 - 15; seq <= 200; seq++) {
+    REQUIRE_OK(a0_transport_jump_seq(lk, seq));
+    REQUIRE_OK(a0_transport_frame_time(lk, &time));
+    REQUIRE(a0::cpp_wrap<a0::TimeMono>(time) >= a0::cpp_wrap<a0::TimeMono>(prev_time));
+    REQUIRE(a0::cpp_wrap<a0::TimeMono>(time) <= a0::cpp_wrap<a0::TimeMono>(end));
+
+    REQUIRE_OK(a0_transport_jump_time(lk, time));
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    REQUIRE(frame->hdr.seq >= 200 - 15);
+    if (seq == 200 - 15 || a0::cpp_wrap<a0::TimeMono>(time) != a0::cpp_wrap<a0::TimeMono>(prev_time)) {
+      REQUIRE(frame->hdr.seq == seq);
+    } else {
+      REQUIRE(frame->hdr.seq < seq);
+    }
+    prev_time = time;
+  }
+
+  // Before the index, the oldest indexed frame. Never a frame committed before the time.
+  REQUIRE_OK(a0_transport_jump_time(lk, start));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->hdr.seq == 200 - 15);
+
+  // After the newest frame.
+  REQUIRE_OK(a0_time_mono_add(end, 1, &time));
+  REQUIRE(a0_transport_jump_time(lk, time) == A0_ERR_RANGE);
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0::Transport cpp_transport(a0::cpp_wrap<a0::Arena>(shm.arena));
+  auto cpp_lk = cpp_transport.lock();
+  cpp_lk.jump_seq(200);
+  cpp_lk.jump_time(cpp_lk.frame_time());
+  REQUIRE(cpp_lk.frame()->hdr.seq <= 200);
+  REQUIRE(cpp_lk.frame_time() <= a0::cpp_wrap<a0::TimeMono>(end));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] shared readers") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = A0_TRANSPORT_MAX_READER_SLOTS + 1;
+  REQUIRE(a0_transport_init_options(&transport, shm.arena, opts) ==
+          A0_ERR_INVALID_ARG);
+  opts.reader_slots = 2;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  for (auto data : {"A", "B", "C"}) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+    memcpy(frame->data, data, 1);
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+  // Frames start after the header and the 2 reader slots.
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->hdr.off == 448);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Pin from frame B.
+  a0_transport_t reader;
+  REQUIRE_OK(a0_transport_init(&reader, shm.arena));
+  a0_transport_locked_t rlk;
+  REQUIRE_OK(a0_transport_lock(&reader, &rlk));
+  REQUIRE_OK(a0_transport_jump_head(rlk));
+  REQUIRE_OK(a0_transport_step_next(rlk));
+  REQUIRE_OK(a0_transport_downgrade(rlk));
+
+  bool is_shared;
+  REQUIRE_OK(a0_transport_is_shared(rlk, &is_shared));
+  REQUIRE(is_shared);
+
+  // A second shared reader takes the other slot.
+  a0_transport_t reader2;
+  REQUIRE_OK(a0_transport_init(&reader2, shm.arena));
+  a0_transport_locked_t rlk2;
+  REQUIRE_OK(a0_transport_lock_shared(&reader2, &rlk2));
+  REQUIRE_OK(a0_transport_is_shared(rlk2, &is_shared));
+  REQUIRE(is_shared);
+
+  // Writers are not blocked by shared readers.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  memcpy(frame->data, "D", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+
+  // No slot is left, so the lock stays exclusive.
+  a0_transport_t reader3;
+  REQUIRE_OK(a0_transport_init(&reader3, shm.arena));
+  a0_transport_locked_t rlk3 = {.transport = &reader3};
+  REQUIRE_OK(a0_transport_downgrade(rlk3));
+  REQUIRE_OK(a0_transport_is_shared(rlk3, &is_shared));
+  REQUIRE(!is_shared);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The shared lock sees the pinned view.
+  uint64_t seq;
+  REQUIRE_OK(a0_transport_seq_low(rlk, &seq));
+  REQUIRE(seq == 2);
+  REQUIRE_OK(a0_transport_seq_high(rlk, &seq));
+  REQUIRE(seq == 3);
+
+  REQUIRE_OK(a0_transport_frame(rlk, &frame));
+  REQUIRE(a0::test::str(frame) == "B");
+  bool has_prev;
+  REQUIRE_OK(a0_transport_has_prev(rlk, &has_prev));
+  REQUIRE(!has_prev);
+  REQUIRE_OK(a0_transport_step_next(rlk));
+  REQUIRE_OK(a0_transport_frame(rlk, &frame));
+  REQUIRE(a0::test::str(frame) == "C");
+  bool has_next;
+  REQUIRE_OK(a0_transport_has_next(rlk, &has_next));
+  REQUIRE(!has_next);
+
+  // Shared locks are read-only.
+  REQUIRE(A0_SYSERR(a0_transport_alloc(rlk, 1, &frame)) == EPERM);
+  REQUIRE(A0_SYSERR(a0_transport_commit(rlk)) == EPERM);
+  REQUIRE(A0_SYSERR(a0_transport_clear(rlk)) == EPERM);
+  REQUIRE(A0_SYSERR(a0_transport_wait(rlk, a0_transport_has_next_pred(&rlk))) == EPERM);
+
+  REQUIRE_OK(a0_transport_unlock(rlk2));
+  REQUIRE_OK(a0_transport_unlock(rlk));
+
+  // After unlock, the connection locks exclusively again.
+  REQUIRE_OK(a0_transport_lock(&reader, &rlk));
+  REQUIRE_OK(a0_transport_is_shared(rlk, &is_shared));
+  REQUIRE(!is_shared);
+  REQUIRE_OK(a0_transport_seq_high(rlk, &seq));
+  REQUIRE(seq == 4);
+  REQUIRE_OK(a0_transport_unlock(rlk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] shared reader blocks eviction") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.reader_slots = 2;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 2000, &frame));
+  memcpy(frame->data, "A", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  memcpy(frame->data, "B", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_event_t pinned = A0_EMPTY;
+  std::atomic<bool> released{false};
+
+  // Pins frame B, the tail.
+  std::thread reader_thrd([&]() {
+    a0_transport_t t;
+    REQUIRE_OK(a0_transport_init(&t, shm.arena));
+
+    a0_transport_locked_t tlk;
+    REQUIRE_OK(a0_transport_lock(&t, &tlk));
+    REQUIRE_OK(a0_transport_jump_tail(tlk));
+    REQUIRE_OK(a0_transport_downgrade(tlk));
+    a0_event_set(&pinned);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(tlk, &frame));
+    REQUIRE(a0::test::str(frame) == "B");
+    released = true;
+    REQUIRE_OK(a0_transport_unlock(tlk));
+  });
+
+  a0_event_wait(&pinned);
+
+  // Evicting frame A, which is not pinned, does not wait.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_alloc(lk, 1700, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  uint64_t seq_low;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low == 2);
+  REQUIRE(!released);
+
+  // Evicting frame B waits for the reader.
+  REQUIRE_OK(a0_transport_alloc(lk, 1700, &frame));
+  REQUIRE(released);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  reader_thrd.join();
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] shared reader robust") {
+  {
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.reader_slots = 1;
+    REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+    a0_transport_locked_t lk;
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, 3, &frame));
+    memcpy(frame->data, "ABC", 3);
+    REQUIRE_OK(a0_transport_commit(lk));
+    REQUIRE_OK(a0_transport_unlock(lk));
+  }
+
+  REQUIRE_EXIT({
+    a0_transport_t transport;
+    REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+    a0_transport_locked_t lk;
+    REQUIRE_OK(a0_transport_lock_shared(&transport, &lk));
+    bool is_shared;
+    REQUIRE_OK(a0_transport_is_shared(lk, &is_shared));
+    REQUIRE(is_shared);
+
+    // Exit without releasing the slot.
+    std::quick_exit(0);
+  });
+
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  // The dead reader's pin does not block eviction.
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 3650, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  uint64_t seq_low;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low == 2);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The slot is available again.
+  REQUIRE_OK(a0_transport_lock_shared(&transport, &lk));
+  bool is_shared;
+  REQUIRE_OK(a0_transport_is_shared(lk, &is_shared));
+  REQUIRE(is_shared);
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] multi-producer") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = A0_TRANSPORT_MAX_PRODUCER_SLOTS + 1;
+  REQUIRE(a0_transport_init_options(&transport, shm.arena, opts) ==
+          A0_ERR_INVALID_ARG);
+  opts.producer_slots = 2;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  a0_transport_reservation_t res_a;
+  a0_transport_reservation_t res_b;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_reserve(lk, 1, &res_a));
+  REQUIRE_OK(a0_transport_reserve(lk, 1, &res_b));
+  REQUIRE(res_a.frame->hdr.seq == 1);
+  REQUIRE(res_b.frame->hdr.seq == 2);
+  // Frames start after the header and the producer slots.
+  REQUIRE(res_a.frame->hdr.off == 448);
+
+  // Unlike a0_transport_alloc, a plain write is published after the reserved frames.
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  memcpy(frame->data, "C", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  auto require_published = [&](uint64_t expected) {
+    a0_transport_t reader;
+    REQUIRE_OK(a0_transport_init(&reader, shm.arena));
+    a0_transport_locked_t rlk;
+    REQUIRE_OK(a0_transport_lock(&reader, &rlk));
+    uint64_t seq_high;
+    REQUIRE_OK(a0_transport_seq_high(rlk, &seq_high));
+    REQUIRE(seq_high == expected);
+    REQUIRE_OK(a0_transport_unlock(rlk));
+  };
+  require_published(0);
+
+  // Frames are filled unlocked, and out of order.
+  memcpy(res_b.frame->data, "B", 1);
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_publish(lk, &res_b));
+  REQUIRE(a0_transport_publish(lk, &res_b) == A0_ERR_INVALID_ARG);
+  REQUIRE_OK(a0_transport_unlock(lk));
+  require_published(0);
+
+  // The unpublished frame cannot be evicted.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(A0_SYSERR(a0_transport_alloc(lk, 3500, &frame)) == EDEADLK);
+  REQUIRE(A0_SYSERR(a0_transport_clear(lk)) == EDEADLK);
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  memcpy(res_a.frame->data, "A", 1);
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_publish(lk, &res_a));
+  // The publisher sees the published frames without relocking.
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 3);
+  REQUIRE_OK(a0_transport_unlock(lk));
+  require_published(3);
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  std::vector<std::string> got;
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  while (true) {
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    got.push_back(a0::test::str(frame));
+    bool has_next;
+    REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+    if (!has_next) {
+      break;
+    }
+    REQUIRE_OK(a0_transport_step_next(lk));
+  }
+  REQUIRE(got == std::vector<std::string>{"A", "B", "C"});
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // Without producer slots, reserve is not supported.
+  REQUIRE_OK(a0_transport_init(&transport, arena));
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(A0_SYSERR(a0_transport_reserve(lk, 1, &res_a)) == ENOTSUP);
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] multi-producer discard") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  auto push = [&](std::string data, bool discard) {
+    a0_transport_reservation_t res;
+    REQUIRE_OK(a0_transport_reserve(lk, data.size(), &res));
+    memcpy(res.frame->data, data.data(), data.size());
+    REQUIRE_OK(discard ? a0_transport_discard(lk, &res) : a0_transport_publish(lk, &res));
+  };
+
+  // A transport holding only discarded frames reads as empty.
+  push("A", true);
+  bool empty;
+  REQUIRE_OK(a0_transport_empty(lk, &empty));
+  REQUIRE(empty);
+  REQUIRE(a0_transport_jump_head(lk) == A0_ERR_RANGE);
+  REQUIRE(a0_transport_jump_tail(lk) == A0_ERR_RANGE);
+
+  push("B", false);
+  push("C", true);
+  push("D", true);
+  push("E", false);
+  push("F", true);
+  REQUIRE_OK(a0_transport_empty(lk, &empty));
+  REQUIRE(!empty);
+
+  auto require_at = [&](uint64_t seq, std::string data) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    REQUIRE(frame->hdr.seq == seq);
+    REQUIRE(a0::test::str(frame) == data);
+  };
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  require_at(2, "B");
+  REQUIRE_OK(a0_transport_step_next(lk));
+  require_at(5, "E");
+  bool has_next;
+  REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+  REQUIRE(!has_next);
+  REQUIRE(a0_transport_step_next(lk) == A0_ERR_RANGE);
+
+  REQUIRE_OK(a0_transport_step_prev(lk));
+  require_at(2, "B");
+  bool has_prev;
+  REQUIRE_OK(a0_transport_has_prev(lk, &has_prev));
+  REQUIRE(!has_prev);
+
+  REQUIRE_OK(a0_transport_jump_tail(lk));
+  require_at(5, "E");
+  REQUIRE_OK(a0_transport_jump_seq(lk, 3));
+  require_at(5, "E");
+  REQUIRE(a0_transport_jump_seq(lk, 6) == A0_ERR_RANGE);
+
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] multi-producer threads") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 4;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  constexpr int kThreads = 4;
+  constexpr int kFrames = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      a0_transport_t producer;
+      REQUIRE_OK(a0_transport_init(&producer, shm.arena));
+      for (int i = 0; i < kFrames; i++) {
+        std::string data = std::to_string(t) + ":" + std::to_string(i);
+        a0_transport_locked_t lk;
+        a0_transport_reservation_t res;
+        REQUIRE_OK(a0_transport_lock(&producer, &lk));
+        REQUIRE_OK(a0_transport_reserve(lk, data.size(), &res));
+        REQUIRE_OK(a0_transport_unlock(lk));
+
+        memcpy(res.frame->data, data.data(), data.size());
+
+        REQUIRE_OK(a0_transport_lock(&producer, &lk));
+        REQUIRE_OK(a0_transport_publish(lk, &res));
+        REQUIRE_OK(a0_transport_unlock(lk));
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  // Every frame is published, and filled, in per-producer order.
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == kThreads * kFrames);
+
+  std::vector<int> last(kThreads, -1);
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  while (true) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    std::string data = a0::test::str(frame);
+    size_t sep = data.find(':');
+    REQUIRE(sep != std::string::npos);
+    int t = std::stoi(data.substr(0, sep));
+    int i = std::stoi(data.substr(sep + 1));
+    REQUIRE(i > last[t]);
+    last[t] = i;
+
+    bool has_next;
+    REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+    if (!has_next) {
+      break;
+    }
+    REQUIRE_OK(a0_transport_step_next(lk));
+  }
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] multi-producer robust") {
+  {
+    a0_transport_t transport;
+    a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+    opts.producer_slots = 1;
+    REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+  }
+
+  REQUIRE_EXIT({
+    a0_transport_t transport;
+    REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+    a0_transport_locked_t lk;
+    a0_transport_reservation_t res;
+    REQUIRE_OK(a0_transport_lock(&transport, &lk));
+    REQUIRE_OK(a0_transport_reserve(lk, 3, &res));
+    REQUIRE_OK(a0_transport_unlock(lk));
+    memcpy(res.frame->data, "AB", 2);
+
+    // Exit without publishing.
+    std::quick_exit(0);
+  });
+
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  // The next commit publishes the dead producer's frame, discarded.
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 0);
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 1, &frame));
+  memcpy(frame->data, "C", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 2);
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  REQUIRE_OK(a0_transport_frame(lk, &frame));
+  REQUIRE(frame->hdr.seq == 2);
+  REQUIRE(a0::test::str(frame) == "C");
+  bool has_prev;
+  REQUIRE_OK(a0_transport_has_prev(lk, &has_prev));
+  REQUIRE(!has_prev);
+
+  // The slot is available again.
+  a0_transport_reservation_t res;
+  REQUIRE_OK(a0_transport_reserve(lk, 1, &res));
+  REQUIRE_OK(a0_transport_publish(lk, &res));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] backpressure") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.cursor_slots = A0_TRANSPORT_MAX_CURSOR_SLOTS + 1;
+  REQUIRE(a0_transport_init_options(&transport, shm.arena, opts) ==
+          A0_ERR_INVALID_ARG);
+  opts.cursor_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  // A cursor registered by the writing thread.
+  a0_transport_locked_t lk;
+  a0_transport_cursor_t cursor;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+  REQUIRE(A0_SYSERR(a0_transport_cursor_register(lk, 1, &cursor)) == EBUSY);
+
+  // Three frames fit. The fourth would evict the first, which is unconsumed.
+  a0_transport_frame_t* frame;
+  for (int i = 0; i < 3; i++) {
+    REQUIRE_OK(a0_transport_alloc(lk, 1000, &frame));
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+  REQUIRE(A0_SYSERR(a0_transport_alloc(lk, 1000, &frame)) == EDEADLK);
+
+  REQUIRE_OK(a0_transport_cursor_consume(lk, &cursor, 1));
+  REQUIRE_OK(a0_transport_alloc(lk, 1000, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  uint64_t seq_low;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low == 2);
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // A cursor registered by another thread.
+  std::atomic<bool> registered{false};
+  std::atomic<bool> consume{false};
+  std::thread subscriber([&]() {
+    a0_transport_t sub;
+    REQUIRE_OK(a0_transport_init(&sub, shm.arena));
+    a0_transport_locked_t slk;
+    a0_transport_cursor_t sub_cursor;
+    REQUIRE_OK(a0_transport_lock(&sub, &slk));
+    REQUIRE_OK(a0_transport_cursor_register(slk, 2, &sub_cursor));
+    REQUIRE_OK(a0_transport_unlock(slk));
+    registered = true;
+
+    while (!consume) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE_OK(a0_transport_lock(&sub, &slk));
+    REQUIRE_OK(a0_transport_cursor_consume(slk, &sub_cursor, 2));
+    REQUIRE_OK(a0_transport_cursor_unregister(slk, &sub_cursor));
+    REQUIRE_OK(a0_transport_unlock(slk));
+  });
+  while (!registered) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE(a0_transport_alloc(lk, 1000, &frame) == A0_ERR_AGAIN);
+  a0_time_mono_t timeout;
+  REQUIRE_OK(a0_time_mono_now(&timeout));
+  REQUIRE_OK(a0_time_mono_add(timeout, 10 * 1000 * 1000, &timeout));
+  REQUIRE(a0_transport_alloc_timeout(lk, 1000, &timeout, &frame) == A0_ERR_AGAIN);
+
+  // The writer waits for the subscriber to consume.
+  consume = true;
+  REQUIRE_OK(a0_time_mono_now(&timeout));
+  REQUIRE_OK(a0_time_mono_add(timeout, 5ll * 1000 * 1000 * 1000, &timeout));
+  REQUIRE_OK(a0_transport_alloc_timeout(lk, 1000, &timeout, &frame));
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low == 3);
+  REQUIRE_OK(a0_transport_unlock(lk));
+  subscriber.join();
+
+  // Without cursor slots, cursors are not supported.
+  a0_transport_t plain;
+  REQUIRE_OK(a0_transport_init(&plain, arena));
+  REQUIRE_OK(a0_transport_lock(&plain, &lk));
+  REQUIRE(A0_SYSERR(a0_transport_cursor_register(lk, 1, &cursor)) == ENOTSUP);
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] backpressure robust") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.cursor_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, shm.arena, opts));
+
+  REQUIRE_EXIT({
+    a0_transport_t sub;
+    REQUIRE_OK(a0_transport_init(&sub, shm.arena));
+
+    a0_transport_locked_t lk;
+    a0_transport_cursor_t cursor;
+    REQUIRE_OK(a0_transport_lock(&sub, &lk));
+    REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+    REQUIRE_OK(a0_transport_unlock(lk));
+
+    // Exit without unregistering.
+    std::quick_exit(0);
+  });
+
+  // The dead subscriber's cursor does not block eviction.
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  for (int i = 0; i < 4; i++) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_alloc(lk, 1000, &frame));
+    REQUIRE_OK(a0_transport_commit(lk));
+  }
+  uint64_t seq_low;
+  REQUIRE_OK(a0_transport_seq_low(lk, &seq_low));
+  REQUIRE(seq_low == 2);
+
+  // The slot is available again.
+  a0_transport_cursor_t cursor;
+  REQUIRE_OK(a0_transport_cursor_register(lk, 5, &cursor));
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] readonly") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, disk.arena));
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  a0_transport_frame_t* frame;
+  REQUIRE_OK(a0_transport_alloc(lk, 1800, &frame));
+  memcpy(frame->data, "A", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  a0_file_options_t roopt = A0_FILE_OPTIONS_DEFAULT;
+  roopt.open_options.arena_mode = A0_ARENA_MODE_READONLY;
+  a0_file_t rofile;
+  REQUIRE_OK(a0_file_open(TEST_DISK, &roopt, &rofile));
+
+  a0_transport_t rotransport;
+  REQUIRE_OK(a0_transport_init(&rotransport, rofile.arena));
+
+  // Hold the writer lock, to show that readonly access does not lock.
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+
+  a0_transport_locked_t rolk;
+  REQUIRE_OK(a0_transport_lock(&rotransport, &rolk));
+  REQUIRE_OK(a0_transport_jump_head(rolk));
+  REQUIRE_OK(a0_transport_frame(rolk, &frame));
+  REQUIRE(frame->hdr.seq == 1);
+  REQUIRE(frame->data[0] == 'A');
+
+  REQUIRE(A0_SYSERR(a0_transport_alloc(rolk, 1, &frame)) == EPERM);
+  REQUIRE(A0_SYSERR(a0_transport_commit(rolk)) == EPERM);
+  REQUIRE(A0_SYSERR(a0_transport_clear(rolk)) == EPERM);
+
+  // The writer proceeds while the reader is "locked".
+  REQUIRE_OK(a0_transport_alloc(lk, 1800, &frame));
+  memcpy(frame->data, "B", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+
+  // The readonly lock keeps its snapshot.
+  uint64_t seq;
+  REQUIRE_OK(a0_transport_seq_high(rolk, &seq));
+  REQUIRE(seq == 1);
+  bool valid;
+  REQUIRE_OK(a0_transport_iter_revalidate(rolk, &valid));
+  REQUIRE(valid);
+
+  // Evicts and overwrites frame A.
+  REQUIRE_OK(a0_transport_alloc(lk, 1800, &frame));
+  memcpy(frame->data, "C", 1);
+  REQUIRE_OK(a0_transport_commit(lk));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  REQUIRE_OK(a0_transport_iter_valid(rolk, &valid));
+  REQUIRE(valid);
+  REQUIRE_OK(a0_transport_iter_revalidate(rolk, &valid));
+  REQUIRE(!valid);
+  REQUIRE(A0_SYSERR(a0_transport_frame(rolk, &frame)) == ESPIPE);
+  REQUIRE_OK(a0_transport_unlock(rolk));
+
+  // A new lock sees the latest commit. This also shows the reader never wrote
+  // to its private mapping, which would have detached it from the file.
+  REQUIRE_OK(a0_transport_lock(&rotransport, &rolk));
+  REQUIRE_OK(a0_transport_seq_low(rolk, &seq));
+  REQUIRE(seq == 2);
+  REQUIRE_OK(a0_transport_seq_high(rolk, &seq));
+  REQUIRE(seq == 3);
+  REQUIRE_OK(a0_transport_step_next(rolk));
+  REQUIRE_OK(a0_transport_frame(rolk, &frame));
+  REQUIRE(frame->data[0] == 'B');
+  REQUIRE_OK(a0_transport_step_next(rolk));
+  REQUIRE_OK(a0_transport_frame(rolk, &frame));
+  REQUIRE(frame->data[0] == 'C');
+  REQUIRE_OK(a0_transport_unlock(rolk));
+
+  REQUIRE(memcmp(rofile.arena.buf.data, disk.arena.buf.data, disk.arena.buf.size) == 0);
+
+  REQUIRE_OK(a0_file_close(&rofile));
+}
+
+TEST_CASE_FIXTURE(TransportFixture, "transport] readonly concurrent writer") {
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init(&transport, shm.arena));
+
+  a0_arena_t roarena = shm.arena;
+  roarena.mode = A0_ARENA_MODE_READONLY;
+
+  // Every frame is filled with its own sequence number.
+  std::atomic<bool> done{false};
+  std::thread writer_thrd([&]() {
+    while (!done) {
+      a0_transport_locked_t lk;
+      REQUIRE_OK(a0_transport_lock(&transport, &lk));
+      a0_transport_frame_t* frame;
+      REQUIRE_OK(a0_transport_alloc(lk, 512, &frame));
+      memset(frame->data, (uint8_t)frame->hdr.seq, 512);
+      REQUIRE_OK(a0_transport_commit(lk));
+      REQUIRE_OK(a0_transport_unlock(lk));
+    }
+  });
+
+  a0_transport_t rotransport;
+  REQUIRE_OK(a0_transport_init(&rotransport, roarena));
+
+  size_t num_valid = 0;
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  while (std::chrono::steady_clock::now() < end) {
+    a0_transport_locked_t rolk;
+    REQUIRE_OK(a0_transport_lock(&rotransport, &rolk));
+    if (a0_transport_jump_head(rolk) != A0_OK) {
+      REQUIRE_OK(a0_transport_unlock(rolk));
+      continue;
+    }
+
+    a0_transport_frame_t* frame;
+    if (a0_transport_frame(rolk, &frame) == A0_OK) {
+      // Give the writer a chance to overwrite the frame.
+      std::this_thread::yield();
+      uint8_t copy[512];
+      memcpy(copy, frame->data, sizeof(copy));
+
+      bool valid;
+      REQUIRE_OK(a0_transport_iter_revalidate(rolk, &valid));
+      if (valid) {
+        num_valid++;
+        uint64_t seq;
+        REQUIRE_OK(a0_transport_seq_low(rolk, &seq));
+        REQUIRE(std::all_of(copy, copy + sizeof(copy), [&](uint8_t c) { return c == (uint8_t)seq; }));
+      }
+    }
+    REQUIRE_OK(a0_transport_unlock(rolk));
+  }
+
+  done = true;
+  writer_thrd.join();
+  REQUIRE(num_valid > 0);
+}
+
 TEST_CASE_FIXTURE(TransportFixture, "transport] robust") {
   REQUIRE_EXIT({
     a0_transport_t transport;
@@ -1770,32 +3414,32 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] robust") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 1,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 187
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 363
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 2,
-      "off_head": 144,
-      "off_tail": 192,
-      "high_water_mark": 234
+      "off_head": 320,
+      "off_tail": 368,
+      "high_water_mark": 410
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 192,
+      "next_off": 368,
       "data_size": 3,
       "data": "YES"
     },
     {
       "committed": false,
-      "off": 192,
+      "off": 368,
       "seq": 2,
-      "prev_off": 144,
+      "prev_off": 320,
       "next_off": 0,
       "data_size": 2,
       "data": "NO"
@@ -1822,24 +3466,24 @@ TEST_CASE_FIXTURE(TransportFixture, "transport] robust") {
     "committed_state": {
       "seq_low": 1,
       "seq_high": 1,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 187
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 363
     },
     "working_state": {
       "seq_low": 1,
       "seq_high": 1,
-      "off_head": 144,
-      "off_tail": 144,
-      "high_water_mark": 187
+      "off_head": 320,
+      "off_tail": 320,
+      "high_water_mark": 363
     }
   },
   "data": [
     {
-      "off": 144,
+      "off": 320,
       "seq": 1,
       "prev_off": 0,
-      "next_off": 192,
+      "next_off": 368,
       "data_size": 3,
       "data": "YES"
     }
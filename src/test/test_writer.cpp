@@ -17,6 +17,7 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -43,6 +44,10 @@ struct WriterFixture {
     bool empty;
     REQUIRE_OK(a0_transport_empty(lk, &empty));
     REQUIRE(empty == want_pkts.empty());
+    if (empty) {
+      REQUIRE_OK(a0_transport_unlock(lk));
+      return;
+    }
 
     a0_transport_frame_t* frame;
 
@@ -427,6 +432,386 @@ TEST_CASE_FIXTURE(WriterFixture, "writer] cpp write_if_empty result") {
       }});
 }
 
+TEST_CASE_FIXTURE(WriterFixture, "writer] batch") {
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+  REQUIRE_OK(a0_writer_push(&w, a0_add_transport_seq_header()));
+  REQUIRE_OK(a0_writer_push(&w, a0_add_writer_seq_header()));
+
+  std::vector<a0_packet_t> pkts = {
+      a0::test::pkt({{"key", "val"}}, "msg #0"),
+      a0::test::pkt({{"key", "val"}}, "msg #1"),
+      a0::test::pkt({{"key", "val"}}, "msg #2"),
+  };
+  size_t written;
+  REQUIRE_OK(a0_writer_write_batch(&w, pkts.data(), pkts.size(), &written));
+  REQUIRE(written == 3);
+  REQUIRE_OK(a0_writer_write_batch(&w, nullptr, 0, &written));
+  REQUIRE(written == 0);
+  REQUIRE_OK(a0_writer_write(&w, a0::test::pkt({{"key", "val"}}, "msg #3")));
+
+  REQUIRE_OK(a0_writer_close(&w));
+
+  std::vector<std::pair<std::vector<std::pair<std::string, std::string>>, std::string>> want;
+  for (int i = 0; i < 4; i++) {
+    want.push_back({
+        {
+            {"a0_transport_seq", std::to_string(i)},
+            {"a0_writer_seq", std::to_string(i)},
+            {"key", "val"},
+        },
+        "msg #" + std::to_string(i),
+    });
+  }
+  require_transport_state(want);
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] cpp batch write_if_empty") {
+  a0::Writer w(a0::cpp_wrap<a0::Arena>(arena));
+  w.push(a0::write_if_empty());
+
+  w.write_batch({a0::Packet("msg #0"), a0::Packet("msg #1"), a0::Packet("msg #2")});
+  w.write_batch({a0::Packet("msg #3")});
+
+  require_transport_state(
+      {{
+          {},
+          "msg #0",
+      }});
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] reserve") {
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+
+  a0_writer_reservation_t res;
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, "ignored"), 6, &res));
+  REQUIRE(res.payload.size == 6);
+  memcpy(res.payload.data, "msg #0", 6);
+  REQUIRE_OK(a0_writer_commit(&res));
+  REQUIRE(a0_writer_commit(&res) == A0_ERR_INVALID_ARG);
+
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, ""), 6, &res));
+  memcpy(res.payload.data, "msg #1", 6);
+  REQUIRE_OK(a0_writer_abort(&res));
+
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, ""), 6, &res));
+  memcpy(res.payload.data, "msg #2", 6);
+  REQUIRE_OK(a0_writer_commit(&res));
+
+  REQUIRE_OK(a0_writer_close(&w));
+
+  require_transport_state(
+      {{
+           {{"key", "val"}},
+           "msg #0",
+       },
+       {
+           {{"key", "val"}},
+           "msg #2",
+       }});
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] cpp reserve") {
+  a0::Writer w(a0::cpp_wrap<a0::Arena>(arena));
+  w.push(a0::add_writer_seq_header());
+
+  {
+    auto res = w.reserve(6);
+    memcpy(res.payload().data(), "msg #0", 6);
+    res.commit();
+  }
+  {
+    // Aborted on destruction.
+    auto res = w.reserve(6);
+    memcpy(res.payload().data(), "msg #1", 6);
+  }
+  {
+    auto res = w.reserve({{"key", "val"}}, 6);
+    REQUIRE(res.payload().size() == 6);
+    memcpy(res.payload().data(), "msg #2", 6);
+    res.commit();
+    REQUIRE_THROWS_WITH(res.abort(), "Invalid argument");
+  }
+
+  w.push(a0::write_if_empty());
+  REQUIRE_THROWS_WITH(w.reserve(6), "Operation cancelled");
+
+  require_transport_state(
+      {{
+           {{"a0_writer_seq", "0"}},
+           "msg #0",
+       },
+       {
+           {{"a0_writer_seq", "2"}, {"key", "val"}},
+           "msg #2",
+       }});
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] multi-producer") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 4;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      a0_writer_t w;
+      REQUIRE_OK(a0_writer_init(&w, arena));
+      REQUIRE_OK(a0_writer_push(&w, a0_add_transport_seq_header()));
+      for (int i = 0; i < 50; i++) {
+        REQUIRE_OK(a0_writer_write(&w, a0::test::pkt("msg #" + std::to_string(t) + "." + std::to_string(i))));
+      }
+      REQUIRE_OK(a0_writer_close(&w));
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  // Packets are stamped and published in order.
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 200);
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  while (true) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    a0_packet_t pkt = a0::test::unflatten(a0_flat_packet_t{a0::test::buf(frame)});
+    REQUIRE(pkt.headers_block.size == 1);
+    REQUIRE(std::string(pkt.headers_block.headers[0].val) == std::to_string(frame->hdr.seq - 1));
+    REQUIRE(a0::test::str(pkt.payload).rfind("msg #", 0) == 0);
+
+    bool has_next;
+    REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+    if (!has_next) {
+      break;
+    }
+    REQUIRE_OK(a0_transport_step_next(lk));
+  }
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] multi-producer large packets") {
+  arena_data.resize(64 * 1024);
+  arena.buf = {arena_data.data(), arena_data.size()};
+
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 4;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  // Large payloads are copied unlocked, into reserved frames.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      a0_writer_t w;
+      REQUIRE_OK(a0_writer_init(&w, arena));
+      std::string payload(5000, 'a' + t);
+      for (int i = 0; i < 20; i++) {
+        REQUIRE_OK(a0_writer_write(&w, a0::test::pkt(payload)));
+      }
+      REQUIRE_OK(a0_writer_close(&w));
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 80);
+
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  while (true) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    std::string payload = a0::test::str(a0::test::unflatten(a0_flat_packet_t{a0::test::buf(frame)}).payload);
+    REQUIRE(payload == std::string(5000, payload[0]));
+
+    bool has_next;
+    REQUIRE_OK(a0_transport_has_next(lk, &has_next));
+    if (!has_next) {
+      break;
+    }
+    REQUIRE_OK(a0_transport_step_next(lk));
+  }
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] multi-producer reserve") {
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.producer_slots = 2;
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+
+  // The transport is not locked while the reservation is filled.
+  a0_writer_reservation_t res;
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, ""), 6, &res));
+  std::thread([&]() {
+    a0_writer_t other;
+    REQUIRE_OK(a0_writer_init(&other, arena));
+    REQUIRE_OK(a0_writer_write(&other, a0::test::pkt("other")));
+    REQUIRE_OK(a0_writer_close(&other));
+  }).join();
+  memcpy(res.payload.data, "msg #0", 6);
+
+  // Neither packet is published until the reservation is committed.
+  require_transport_state({});
+  REQUIRE_OK(a0_writer_commit(&res));
+  REQUIRE(a0_writer_commit(&res) == A0_ERR_INVALID_ARG);
+
+  // An aborted reservation is discarded, and never read.
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, ""), 6, &res));
+  memcpy(res.payload.data, "msg #1", 6);
+  REQUIRE_OK(a0_writer_abort(&res));
+  REQUIRE_OK(a0_writer_write(&w, a0::test::pkt("msg #2")));
+
+  REQUIRE_OK(a0_writer_close(&w));
+
+  require_transport_state(
+      {{
+           {{"key", "val"}},
+           "msg #0",
+       },
+       {
+           {},
+           "other",
+       },
+       {
+           {},
+           "msg #2",
+       }});
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] packet v2") {
+  a0_transport_options_t transport_opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  transport_opts.producer_slots = 1;
+  a0_transport_t transport;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, transport_opts));
+
+  a0_writer_t w;
+  a0_writer_options_t opts = A0_WRITER_OPTIONS_DEFAULT;
+  opts.packet_version = 3;
+  REQUIRE(a0_writer_init_options(&w, arena, opts) == A0_ERR_INVALID_ARG);
+  opts.packet_version = 2;
+  REQUIRE_OK(a0_writer_init_options(&w, arena, opts));
+
+  REQUIRE_OK(a0_writer_write(&w, a0::test::pkt({{"key", "val"}}, "msg #0")));
+
+  // Reserved frames are sized for the v2 format.
+  a0_writer_reservation_t res;
+  REQUIRE_OK(a0_writer_reserve(&w, a0::test::pkt({{"key", "val"}}, ""), 6, &res));
+  memcpy(res.payload.data, "msg #1", 6);
+  REQUIRE_OK(a0_writer_commit(&res));
+
+  REQUIRE_OK(a0_writer_close(&w));
+
+  require_transport_state(
+      {{
+           {{"key", "val"}},
+           "msg #0",
+       },
+       {
+           {{"key", "val"}},
+           "msg #1",
+       }});
+
+  a0_transport_locked_t lk;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_jump_head(lk));
+  for (int i = 0; i < 2; i++) {
+    a0_transport_frame_t* frame;
+    REQUIRE_OK(a0_transport_frame(lk, &frame));
+    uint8_t version;
+    REQUIRE_OK(a0_flat_packet_version(a0_flat_packet_t{a0::test::buf(frame)}, &version));
+    REQUIRE(version == 2);
+    if (!i) {
+      REQUIRE_OK(a0_transport_step_next(lk));
+    }
+  }
+  REQUIRE_OK(a0_transport_unlock(lk));
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] backpressure") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.cursor_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+  a0_transport_locked_t lk;
+  a0_transport_cursor_t cursor;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The write that would evict the unconsumed packet fails, and writes nothing.
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+  REQUIRE_OK(a0_writer_write(&w, a0::test::pkt(std::string(3000, 'a'))));
+  REQUIRE(a0_writer_write(&w, a0::test::pkt(std::string(3000, 'b'))) != A0_OK);
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  uint64_t seq_high;
+  REQUIRE_OK(a0_transport_seq_high(lk, &seq_high));
+  REQUIRE(seq_high == 1);
+
+  REQUIRE_OK(a0_transport_cursor_consume(lk, &cursor, 1));
+  REQUIRE_OK(a0_transport_unlock(lk));
+  REQUIRE_OK(a0_writer_write(&w, a0::test::pkt(std::string(3000, 'b'))));
+  REQUIRE_OK(a0_writer_close(&w));
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  require_transport_state({{{}, std::string(3000, 'b')}});
+}
+
+TEST_CASE_FIXTURE(WriterFixture, "writer] batch backpressure") {
+  a0_transport_t transport;
+  a0_transport_options_t opts = A0_TRANSPORT_OPTIONS_DEFAULT;
+  opts.cursor_slots = 1;
+  REQUIRE_OK(a0_transport_init_options(&transport, arena, opts));
+  a0_transport_locked_t lk;
+  a0_transport_cursor_t cursor;
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_cursor_register(lk, 1, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  // The third packet would evict the unconsumed first. The batch stops there,
+  // and the first two are committed.
+  a0_writer_t w;
+  REQUIRE_OK(a0_writer_init(&w, arena));
+  std::vector<a0_packet_t> pkts = {
+      a0::test::pkt(std::string(1000, 'a')),
+      a0::test::pkt(std::string(1000, 'b')),
+      a0::test::pkt(std::string(3000, 'c')),
+      a0::test::pkt(std::string(10, 'd')),
+  };
+  size_t written;
+  REQUIRE(a0_writer_write_batch(&w, pkts.data(), pkts.size(), &written) != A0_OK);
+  REQUIRE(written == 2);
+  REQUIRE_OK(a0_writer_close(&w));
+
+  REQUIRE_OK(a0_transport_lock(&transport, &lk));
+  REQUIRE_OK(a0_transport_cursor_unregister(lk, &cursor));
+  REQUIRE_OK(a0_transport_unlock(lk));
+
+  require_transport_state({
+      {{}, std::string(1000, 'a')},
+      {{}, std::string(1000, 'b')},
+  });
+}
+
 TEST_CASE_FIXTURE(WriterFixture, "writer] cpp json_mergepatch") {
   a0::Writer w(a0::cpp_wrap<a0::Arena>(arena));
   auto w_merge = w.wrap(a0::json_mergepatch());
@@ -5,30 +5,48 @@
 #include <a0/err.h>
 #include <a0/inline.h>
 #include <a0/mtx.h>
+#include <a0/tid.h>
 #include <a0/time.h>
 #include <a0/transport.h>
 #include <a0/unused.h>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
 #include <stdalign.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/un.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "atomic.h"
 #include "clock.h"
 #include "err_macro.h"
+#include "ftx.h"
+#include "rand.h"
+#include "spin.h"
 #include "tsan.h"
 
-typedef struct a0_transport_state_s {
-  uint64_t seq_low;
-  uint64_t seq_high;
-  size_t off_head;
-  size_t off_tail;
-  size_t high_water_mark;
-} a0_transport_state_t;
+// A shared-reader slot. The slot is held by a shared reader for the duration
+// of its shared lock.
+typedef struct a0_transport_reader_slot_s {
+  a0_mtx_t mtx;
+  // The view of the transport pinned by the slot owner.
+  // Only written under the transport lock.
+  a0_transport_state_t state;
+} a0_transport_reader_slot_t;
 
 typedef struct a0_transport_version_s {
   uint8_t major;
@@ -36,44 +54,269 @@ typedef struct a0_transport_version_s {
   uint8_t patch;
 } a0_transport_version_t;
 
+#define A0_TRANSPORT_CACHE_LINE_SIZE 64
+
+// A state page, alone on its cache line.
+typedef struct a0_transport_state_page_s {
+  alignas(A0_TRANSPORT_CACHE_LINE_SIZE) a0_transport_state_t state;
+} a0_transport_state_page_t;
+
+// The header is laid out by who writes each cache line:
+// * The first line is read by every reader. It is written at init, by resize,
+//   and by commit.
+// * The lock line is only touched by threads taking the lock.
+// * The condition variable line is written by notify, and waited on.
+// * Each state page is on its own line, so filling the working page does not
+//   evict the committed page from lock-free readers.
 typedef struct a0_transport_hdr_s {
   char magic[9]; /* ALEPHZERO */
   a0_transport_version_t version;
   bool initialized;
+  // Number of shared-reader slots following the header.
+  uint8_t reader_slots;
+  // log2 of the number of sequence index entries following the reader slots.
+  // Zero if the transport has no sequence index.
+  uint8_t seq_index_log2;
+  // Number of producer slots following the sequence index.
+  // Zero if the transport is single-producer.
+  uint8_t producer_slots;
+  // Number of durable cursor slots following the producer slots.
+  // Zero if the transport evicts unread frames.
+  uint8_t cursor_slots;
+  uint8_t committed_page_idx;
+  // log2 of the frame alignment.
+  // Zero if frames are aligned to max_align_t.
+  uint8_t frame_align_log2;
+  // Number of watcher slots following the cursor slots.
+  uint8_t watcher_slots;
+  // Incremented by every commit, before the previously committed page is
+  // overwritten. Lets lock-free readers detect a torn state snapshot.
+  uint32_t commit_cnt;
+  size_t arena_size;
+  // Whether frames start with a0_transport_compact_frame_hdr_t.
+  bool frame_compact;
+
+  alignas(A0_TRANSPORT_CACHE_LINE_SIZE) a0_mtx_t mtx;
+  // Number of threads, across all processes, blocked on cnd.
+  // Guarded by mtx.
+  uint32_t wait_cnt;
+
+  alignas(A0_TRANSPORT_CACHE_LINE_SIZE) a0_cnd_t cnd;
+
+  a0_transport_state_page_t state_pages[2];
+} a0_transport_hdr_t;
+
+_Static_assert(sizeof(a0_transport_hdr_t) == 5 * A0_TRANSPORT_CACHE_LINE_SIZE,
+               "Unexpected transport binary representation.");
+
+// The 0.3 header. Only used to upgrade 0.3 transports.
+typedef struct a0_transport_hdr_0_3_s {
+  char magic[9]; /* ALEPHZERO */
+  a0_transport_version_t version;
+  bool initialized;
+  uint8_t reader_slots;
+  uint8_t seq_index_log2;
+  uint8_t producer_slots;
 
   a0_mtx_t mtx;
   a0_cnd_t cnd;
+  uint32_t wait_cnt;
 
   a0_transport_state_t state_pages[2];
   uint8_t committed_page_idx;
+  uint8_t cursor_slots;
+  uint32_t commit_cnt;
 
   size_t arena_size;
-} a0_transport_hdr_t;
+} a0_transport_hdr_0_3_t;
 
-// TODO(lshamis): Consider packing or reordering fields to reduce this.
-_Static_assert(sizeof(a0_transport_hdr_t) == 144, "Unexpected transport binary representation.");
+_Static_assert(sizeof(a0_transport_hdr_0_3_t) == 144, "Unexpected 0.3 transport binary representation.");
 
 A0_STATIC_INLINE
 a0_transport_hdr_t* a0_transport_header(a0_transport_locked_t lk) {
   return (a0_transport_hdr_t*)lk.transport->_arena.buf.data;
 }
 
+// Usable size of the arena. The size in the header is only trusted as far as
+// the arena here reaches.
+A0_STATIC_INLINE
+size_t a0_transport_arena_size(a0_transport_locked_t lk) {
+  size_t arena_size = a0_atomic_load(&a0_transport_header(lk)->arena_size);
+  return arena_size < lk.transport->_arena.buf.size ? arena_size : lk.transport->_arena.buf.size;
+}
+
+// The frame header of transports created with compact_frames.
+//
+// Links are relative to the frame, and the frame's own offset is not stored.
+typedef struct a0_transport_compact_frame_hdr_s {
+  uint64_t seq;
+  // Offset of the next frame, relative to this one. Zero if unlinked.
+  uint32_t next_rel;
+  // Offset of the previous frame, relative to this one. Zero if unlinked.
+  // The low bit is set if the frame was discarded.
+  uint32_t prev_rel;
+  uint64_t data_size;
+} a0_transport_compact_frame_hdr_t;
+
+_Static_assert(sizeof(a0_transport_compact_frame_hdr_t) == 24,
+               "Unexpected compact frame binary representation.");
+
+// Relative links are signed 32-bit, which limits the arena of compact transports.
+#define A0_TRANSPORT_COMPACT_MAX_ARENA_SIZE ((size_t)INT32_MAX)
+
+// Frames are accessed by offset, through the functions below, so that the
+// rest of the transport does not depend on the frame encoding.
 A0_STATIC_INLINE
 a0_transport_frame_hdr_t* a0_transport_frame_header(a0_transport_locked_t lk, size_t off) {
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
   return (a0_transport_frame_hdr_t*)((uint8_t*)hdr + off);
 }
 
+A0_STATIC_INLINE
+a0_transport_compact_frame_hdr_t* a0_transport_compact_frame_header(a0_transport_locked_t lk, size_t off) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  return (a0_transport_compact_frame_hdr_t*)((uint8_t*)hdr + off);
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_frame_hdr_size(a0_transport_hdr_t* hdr) {
+  return hdr->frame_compact ? sizeof(a0_transport_compact_frame_hdr_t) : sizeof(a0_transport_frame_hdr_t);
+}
+
+A0_STATIC_INLINE
+uint32_t a0_transport_rel_link(size_t off, size_t link_off) {
+  return link_off ? (uint32_t)(int32_t)((int64_t)link_off - (int64_t)off) : 0;
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_abs_link(size_t off, uint32_t rel) {
+  return rel ? (size_t)((int64_t)off + (int32_t)rel) : 0;
+}
+
+// Frames are aligned to at least 8 bytes, so the low bit of the previous frame
+// link is free. It marks a frame that its producer discarded. The bit is set
+// before the frame is published, and readers step over the frame.
+#define A0_TRANSPORT_FRAME_DISCARDED ((size_t)1)
+
+A0_STATIC_INLINE
+uint64_t a0_transport_frame_seq(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return a0_atomic_load(&a0_transport_compact_frame_header(lk, off)->seq);
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->seq);
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_frame_data_size(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return a0_atomic_load(&a0_transport_compact_frame_header(lk, off)->data_size);
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->data_size);
+}
+
+A0_STATIC_INLINE
+uint8_t* a0_transport_frame_data_ptr(a0_transport_locked_t lk, size_t off) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  return (uint8_t*)hdr + off + a0_transport_frame_hdr_size(hdr);
+}
+
+// Whether the frame at off records off as its own offset. Compact frames do
+// not record it.
+A0_STATIC_INLINE
+bool a0_transport_frame_self_linked(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return true;
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->off) == off;
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_frame_next_off(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return a0_transport_abs_link(off, a0_atomic_load(&a0_transport_compact_frame_header(lk, off)->next_rel));
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->next_off);
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_frame_prev_off(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    uint32_t rel = a0_atomic_load(&a0_transport_compact_frame_header(lk, off)->prev_rel);
+    return a0_transport_abs_link(off, rel & ~(uint32_t)A0_TRANSPORT_FRAME_DISCARDED);
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->prev_off) & ~A0_TRANSPORT_FRAME_DISCARDED;
+}
+
+A0_STATIC_INLINE
+bool a0_transport_frame_discarded(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return a0_atomic_load(&a0_transport_compact_frame_header(lk, off)->prev_rel) & A0_TRANSPORT_FRAME_DISCARDED;
+  }
+  return a0_atomic_load(&a0_transport_frame_header(lk, off)->prev_off) & A0_TRANSPORT_FRAME_DISCARDED;
+}
+
+A0_STATIC_INLINE
+void a0_transport_frame_mark_discarded(a0_transport_locked_t lk, size_t off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    a0_atomic_fetch_or(&a0_transport_compact_frame_header(lk, off)->prev_rel, (uint32_t)A0_TRANSPORT_FRAME_DISCARDED);
+  } else {
+    a0_atomic_fetch_or(&a0_transport_frame_header(lk, off)->prev_off, A0_TRANSPORT_FRAME_DISCARDED);
+  }
+}
+
+// Links the frame at off to the frame at next_off, and back.
+A0_STATIC_INLINE
+void a0_transport_frame_link(a0_transport_locked_t lk, size_t off, size_t next_off) {
+  if (a0_transport_header(lk)->frame_compact) {
+    a0_transport_compact_frame_header(lk, off)->next_rel = a0_transport_rel_link(off, next_off);
+    a0_transport_compact_frame_header(lk, next_off)->prev_rel = a0_transport_rel_link(next_off, off);
+  } else {
+    a0_transport_frame_header(lk, off)->next_off = next_off;
+    a0_transport_frame_header(lk, next_off)->prev_off = off;
+  }
+}
+
+// Writes the header of an unlinked frame.
+A0_STATIC_INLINE
+void a0_transport_frame_init(a0_transport_locked_t lk, size_t off, uint64_t seq, size_t data_size) {
+  if (a0_transport_header(lk)->frame_compact) {
+    a0_transport_compact_frame_hdr_t* frame_hdr = a0_transport_compact_frame_header(lk, off);
+    memset(frame_hdr, 0, sizeof(a0_transport_compact_frame_hdr_t));
+    frame_hdr->seq = seq;
+    frame_hdr->data_size = data_size;
+  } else {
+    a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, off);
+    memset(frame_hdr, 0, sizeof(a0_transport_frame_hdr_t));
+    frame_hdr->seq = seq;
+    frame_hdr->off = off;
+    frame_hdr->data_size = data_size;
+  }
+}
+
 A0_STATIC_INLINE
 a0_transport_state_t* a0_transport_committed_page(a0_transport_locked_t lk) {
+  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    return &lk.transport->_snapshot;
+  }
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
-  return &hdr->state_pages[hdr->committed_page_idx];
+  return &hdr->state_pages[hdr->committed_page_idx].state;
 }
 
 A0_STATIC_INLINE
 a0_transport_state_t* a0_transport_working_page(a0_transport_locked_t lk) {
+  if (lk.transport->_reader_slot) {
+    return &lk.transport->_reader_slot->state;
+  }
+  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    return &lk.transport->_snapshot;
+  }
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
-  return &hdr->state_pages[!hdr->committed_page_idx];
+  return &hdr->state_pages[!hdr->committed_page_idx].state;
+}
+
+A0_STATIC_INLINE
+bool a0_transport_writable(a0_transport_locked_t lk) {
+  return lk.transport->_arena.mode != A0_ARENA_MODE_READONLY && !lk.transport->_reader_slot;
 }
 
 A0_STATIC_INLINE
@@ -82,8 +325,185 @@ size_t a0_max_align(size_t off) {
 }
 
 A0_STATIC_INLINE
-size_t a0_transport_workspace_off() {
-  return a0_max_align(sizeof(a0_transport_hdr_t));
+a0_transport_reader_slot_t* a0_transport_reader_slots(a0_transport_hdr_t* hdr) {
+  return (a0_transport_reader_slot_t*)((uint8_t*)hdr + a0_max_align(sizeof(a0_transport_hdr_t)));
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_seq_index_size(a0_transport_hdr_t* hdr) {
+  return hdr->seq_index_log2 ? (size_t)1 << hdr->seq_index_log2 : 0;
+}
+
+// The sequence index maps (seq % size) to the frame most recently allocated
+// with such a sequence number.
+//
+// Entries are hints. They are written at alloc time, so may refer to frames
+// that were never committed, or have since been evicted, and must be validated.
+typedef struct a0_transport_seq_index_entry_s {
+  size_t off;
+  // a0_time_mono at which the frame was committed, in nanoseconds.
+  uint64_t commit_time_ns;
+} a0_transport_seq_index_entry_t;
+
+A0_STATIC_INLINE
+a0_transport_seq_index_entry_t* a0_transport_seq_index(a0_transport_hdr_t* hdr) {
+  return (a0_transport_seq_index_entry_t*)((uint8_t*)a0_transport_reader_slots(hdr) +
+                                           hdr->reader_slots * sizeof(a0_transport_reader_slot_t));
+}
+
+// A producer slot tracks a frame reserved by a0_transport_reserve, until it is
+// published. The producer holds the slot lock while filling the frame, so a
+// producer that dies mid-copy is detected.
+typedef struct a0_transport_producer_slot_s {
+  a0_mtx_t mtx;
+  // Sequence number of the reserved frame. Zero if the slot is free.
+  uint64_t seq;
+  // Whether the frame has been filled.
+  bool done;
+} a0_transport_producer_slot_t;
+
+// The newest frame visible to readers.
+typedef struct a0_transport_published_s {
+  uint64_t seq;
+  size_t off;
+} a0_transport_published_t;
+
+// Multi-producer state.
+//
+// The committed state includes every reserved frame, so that producers
+// allocate after one another. Readers only see frames up to the published
+// frame. Frames are published in order, once they and every frame before them
+// have been filled.
+typedef struct a0_transport_producers_s {
+  // Double buffered, like the state pages, for lock-free readers.
+  a0_transport_published_t published[2];
+  uint8_t published_idx;
+  a0_transport_producer_slot_t slots[];
+} a0_transport_producers_t;
+
+A0_STATIC_INLINE
+size_t a0_transport_producers_off(a0_transport_hdr_t* hdr) {
+  return a0_max_align(sizeof(a0_transport_hdr_t) +
+                      hdr->reader_slots * sizeof(a0_transport_reader_slot_t) +
+                      a0_transport_seq_index_size(hdr) * sizeof(a0_transport_seq_index_entry_t));
+}
+
+A0_STATIC_INLINE
+a0_transport_producers_t* a0_transport_producers(a0_transport_hdr_t* hdr) {
+  if (!hdr->producer_slots) {
+    return NULL;
+  }
+  return (a0_transport_producers_t*)((uint8_t*)hdr + a0_transport_producers_off(hdr));
+}
+
+// A durable cursor slot. The slot is held by a subscriber for as long as it
+// is registered, so a subscriber that dies is detected.
+typedef struct a0_transport_cursor_slot_s {
+  a0_mtx_t mtx;
+  // Sequence number of the oldest frame the subscriber has not consumed.
+  // Only written under the transport lock.
+  uint64_t seq;
+} a0_transport_cursor_slot_t;
+
+A0_STATIC_INLINE
+a0_transport_cursor_slot_t* a0_transport_cursor_slots(a0_transport_hdr_t* hdr) {
+  size_t off = a0_transport_producers_off(hdr);
+  if (hdr->producer_slots) {
+    off = a0_max_align(off + sizeof(a0_transport_producers_t) +
+                       hdr->producer_slots * sizeof(a0_transport_producer_slot_t));
+  }
+  return (a0_transport_cursor_slot_t*)((uint8_t*)hdr + off);
+}
+
+// A watcher slot names the socket of a connection that wants to be signaled on
+// commit, instead of waiting on the futex. The slot is held by the watching
+// thread for as long as it is registered, so a watcher that dies is detected.
+typedef struct a0_transport_watcher_slot_s {
+  a0_mtx_t mtx;
+  // Nonzero while the watcher is idle. Writers clear it as they signal, so an
+  // idle watcher is signaled once, however many commits follow.
+  uint32_t armed;
+  // Names the watcher's socket. See a0_transport_watcher_addr.
+  uint64_t id;
+  // Inode of the watcher's network namespace, which scopes the socket's name.
+  // Zero if unknown.
+  uint64_t netns;
+  // Set by writers that could not signal the watcher, from another network
+  // namespace.
+  uint32_t unreachable;
+} a0_transport_watcher_slot_t;
+
+A0_STATIC_INLINE
+a0_transport_watcher_slot_t* a0_transport_watcher_slots(a0_transport_hdr_t* hdr) {
+  a0_transport_cursor_slot_t* cursor_slots = a0_transport_cursor_slots(hdr);
+  return (a0_transport_watcher_slot_t*)((uint8_t*)hdr +
+                                        a0_max_align((size_t)((uint8_t*)&cursor_slots[hdr->cursor_slots] - (uint8_t*)hdr)));
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_frame_align(a0_transport_hdr_t* hdr, size_t off) {
+  size_t align = hdr->frame_align_log2 ? (size_t)1 << hdr->frame_align_log2 : alignof(max_align_t);
+  return (off + align - 1) & ~(align - 1);
+}
+
+A0_STATIC_INLINE
+size_t a0_transport_workspace_off(a0_transport_hdr_t* hdr) {
+  a0_transport_watcher_slot_t* watcher_slots = a0_transport_watcher_slots(hdr);
+  size_t off = a0_max_align((size_t)((uint8_t*)&watcher_slots[hdr->watcher_slots] - (uint8_t*)hdr));
+  return a0_transport_frame_align(hdr, off);
+}
+
+// Limits a state to the published frames.
+A0_STATIC_INLINE
+void a0_transport_clamp_published(a0_transport_state_t* state, a0_transport_published_t published) {
+  if (state->seq_high > published.seq) {
+    state->seq_high = published.seq;
+    state->off_tail = state->seq_low <= published.seq ? published.off : 0;
+  }
+}
+
+// Copies the committed state without locking and without writing to the arena.
+//
+// Retries until no commit happened during the copy. Commits are short, so
+// this rarely spins.
+A0_NO_TSAN
+static void a0_transport_snapshot(a0_transport_hdr_t* hdr, a0_transport_state_t* out) {
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
+  a0_transport_published_t published = {0, 0};
+  uint32_t commit_cnt;
+  do {
+    commit_cnt = a0_atomic_load(&hdr->commit_cnt);
+    a0_barrier();
+    *out = hdr->state_pages[a0_atomic_load(&hdr->committed_page_idx) & 1].state;
+    if (producers) {
+      published = producers->published[a0_atomic_load(&producers->published_idx) & 1];
+    }
+    a0_barrier();
+  } while (commit_cnt != a0_atomic_load(&hdr->commit_cnt));
+
+  if (producers) {
+    a0_transport_clamp_published(out, published);
+  }
+}
+
+// Limits the working page to the frames visible to readers.
+A0_STATIC_INLINE
+void a0_transport_clamp_working(a0_transport_locked_t lk) {
+  a0_transport_producers_t* producers = a0_transport_producers(a0_transport_header(lk));
+  if (producers) {
+    a0_transport_clamp_published(a0_transport_working_page(lk),
+                                 producers->published[producers->published_idx & 1]);
+  }
+}
+
+// Restores the reserved frames to a clamped working page, before allocating.
+A0_STATIC_INLINE
+void a0_transport_unclamp_working(a0_transport_locked_t lk) {
+  a0_transport_state_t* working = a0_transport_working_page(lk);
+  a0_transport_state_t* committed = a0_transport_committed_page(lk);
+  if (a0_transport_header(lk)->producer_slots && working->seq_high < committed->seq_high) {
+    *working = *committed;
+  }
 }
 
 // Converts a 0.2 transport into a 0.3 transport.
@@ -113,8 +533,8 @@ static void a0_backward_compatiblility_update_from_0_2(a0_arena_t arena) {
   uintptr_t off_tail = *(uintptr_t*)ptr;
   // ptr += sizeof(uintptr_t);
 
-  a0_transport_hdr_t* hdr = (a0_transport_hdr_t*)arena.buf.data;
-  memset(hdr, 0, sizeof(a0_transport_hdr_t));
+  a0_transport_hdr_0_3_t* hdr = (a0_transport_hdr_0_3_t*)arena.buf.data;
+  memset(hdr, 0, sizeof(a0_transport_hdr_0_3_t));
 
   memcpy(hdr->magic, "ALEPHZERO", 9);
   hdr->version.major = 0;
@@ -132,8 +552,344 @@ static void a0_backward_compatiblility_update_from_0_2(a0_arena_t arena) {
   hdr->initialized = true;
 }
 
+A0_STATIC_INLINE
+bool a0_transport_is_version(a0_transport_hdr_t* hdr, uint8_t major, uint8_t minor) {
+  return !memcmp(hdr->magic, "ALEPHZERO", 9) &&
+         hdr->version.major == major &&
+         hdr->version.minor == minor;
+}
+
+A0_STATIC_INLINE
+void a0_transport_set_version(a0_transport_hdr_t* hdr) {
+  memcpy(hdr->magic, "ALEPHZERO", 9);
+  hdr->version.major = 0;
+  hdr->version.minor = 4;
+  hdr->version.patch = 0;
+}
+
+// The 0.4 header begins with the same fields as the 0.3 header, so the counts
+// can be read through either. Everything after the header moves by the
+// difference in header size.
+#define A0_TRANSPORT_UPDATE_SHIFT (sizeof(a0_transport_hdr_t) - sizeof(a0_transport_hdr_0_3_t))
+
+_Static_assert(A0_TRANSPORT_UPDATE_SHIFT % alignof(max_align_t) == 0,
+               "Transport regions must keep their alignment across the 0.3 update.");
+
+// Version patch of a 0.3 transport whose update to 0.4 has started.
+#define A0_TRANSPORT_UPDATE_PARTIAL 0xff
+
+// Completes an interrupted 0.3 update, as an empty transport.
+//
+// The first cache line was completed before the update started, so only the
+// regions that follow it are rebuilt.
+A0_NO_TSAN
+static a0_err_t a0_transport_update_reset(a0_arena_t arena) {
+  a0_transport_hdr_t* hdr = (a0_transport_hdr_t*)arena.buf.data;
+  size_t workspace_off = a0_transport_workspace_off(hdr);
+  if (hdr->arena_size > arena.buf.size || workspace_off >= hdr->arena_size) {
+    return A0_ERR_INVALID_ARG;
+  }
+
+  memset(arena.buf.data + offsetof(a0_transport_hdr_t, mtx), 0, workspace_off - offsetof(a0_transport_hdr_t, mtx));
+  hdr->state_pages[0].state.high_water_mark = workspace_off;
+  hdr->state_pages[1] = hdr->state_pages[0];
+
+  a0_transport_set_version(hdr);
+  return A0_OK;
+}
+
+// Converts a 0.3 transport into a 0.4 transport.
+//
+// The 0.4 header separates the lock, condition variable and state pages onto
+// their own cache lines, so it is larger and everything after it moves.
+//
+// Committed frames are packed in order from the start of the new workspace.
+// If they no longer fit, the oldest are dropped. Commit times are kept.
+// Reader, producer and cursor slots are reset, as their owners must be gone.
+//
+// Before any frame is moved, the first cache line is completed and the version
+// patch is set to A0_TRANSPORT_UPDATE_PARTIAL. An interrupted update is resumed
+// by resetting the transport to empty, as its frames may have been partly moved.
+//
+// Note: This does not allow 0.3 and 0.4 to run simultaniously.
+//       0.3 transport will no longer work after this.
+A0_NO_TSAN
+static a0_err_t a0_backward_compatiblility_update_from_0_3(a0_arena_t arena) {
+  if (arena.buf.size < sizeof(a0_transport_hdr_0_3_t)) {
+    return A0_OK;
+  }
+  a0_transport_hdr_0_3_t old = *(a0_transport_hdr_0_3_t*)arena.buf.data;
+  a0_transport_hdr_t* hdr = (a0_transport_hdr_t*)arena.buf.data;
+  if (!old.initialized || !a0_transport_is_version(hdr, 0, 3)) {
+    // Not 0.3 format.
+    return A0_OK;
+  }
+  if (hdr->version.patch == A0_TRANSPORT_UPDATE_PARTIAL) {
+    return a0_transport_update_reset(arena);
+  }
+
+  // Only cursor_slots is not shared with the 0.3 header. The bytes after it
+  // overlap the 0.3 mutex.
+  hdr->cursor_slots = old.cursor_slots;
+  hdr->frame_align_log2 = 0;
+  hdr->watcher_slots = 0;
+  hdr->frame_compact = false;
+  size_t shift = A0_TRANSPORT_UPDATE_SHIFT;
+  size_t arena_size = old.arena_size;
+  size_t workspace_off = a0_transport_workspace_off(hdr);
+  if (arena_size > arena.buf.size || workspace_off >= arena_size) {
+    return A0_ERR_INVALID_ARG;
+  }
+
+  uint8_t* data = arena.buf.data;
+  size_t old_workspace_off = workspace_off - shift;
+
+  a0_transport_state_t state = old.state_pages[old.committed_page_idx & 1];
+  if (hdr->producer_slots) {
+    a0_transport_producers_t* producers = (a0_transport_producers_t*)(data + a0_transport_producers_off(hdr) - shift);
+    a0_transport_clamp_published(&state, producers->published[producers->published_idx & 1]);
+  }
+
+  size_t index_size = a0_transport_seq_index_size(hdr);
+  a0_transport_seq_index_entry_t* old_index =
+      (a0_transport_seq_index_entry_t*)((uint8_t*)a0_transport_seq_index(hdr) - shift);
+
+  // Walk back from the tail, to find the oldest frame that still fits.
+  size_t packed_size = 0;
+  size_t first_off = 0;
+  uint64_t first_seq = 0;
+  if (state.seq_high && state.seq_low <= state.seq_high) {
+    size_t off = state.off_tail;
+    uint64_t seq = state.seq_high;
+    while (seq >= state.seq_low &&
+           off >= old_workspace_off &&
+           off + sizeof(a0_transport_frame_hdr_t) <= arena_size) {
+      a0_transport_frame_hdr_t* frame_hdr = (a0_transport_frame_hdr_t*)(data + off);
+      size_t frame_size = a0_max_align(sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size);
+      if (frame_hdr->seq != seq || workspace_off + packed_size + frame_size >= arena_size) {
+        break;
+      }
+      packed_size += frame_size;
+      first_off = off;
+      first_seq = seq;
+      off = frame_hdr->prev_off;
+      seq--;
+    }
+  }
+
+  size_t frame_cnt = packed_size ? state.seq_high - first_seq + 1 : 0;
+  uint8_t* packed = NULL;
+  uint64_t* commit_times = NULL;
+  if (frame_cnt) {
+    packed = (uint8_t*)malloc(packed_size);
+    commit_times = (uint64_t*)calloc(frame_cnt, sizeof(uint64_t));
+    if (!packed || !commit_times) {
+      free(packed);
+      free(commit_times);
+      return A0_MAKE_SYSERR(ENOMEM);
+    }
+  }
+
+  size_t off = first_off;
+  size_t packed_off = 0;
+  for (size_t i = 0; i < frame_cnt; i++) {
+    a0_transport_frame_hdr_t* frame_hdr = (a0_transport_frame_hdr_t*)(data + off);
+    size_t frame_size = sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size;
+    memcpy(packed + packed_off, frame_hdr, frame_size);
+    if (index_size) {
+      a0_transport_seq_index_entry_t* entry = &old_index[frame_hdr->seq & (index_size - 1)];
+      if (entry->off == off) {
+        commit_times[i] = entry->commit_time_ns;
+      }
+    }
+    packed_off += a0_max_align(frame_size);
+    off = frame_hdr->next_off;
+  }
+
+  // The counts are already in place. Complete the first cache line, and mark
+  // the update as started, before rebuilding the regions that follow it.
+  hdr->committed_page_idx = 0;
+  hdr->commit_cnt = old.commit_cnt;
+  hdr->arena_size = arena_size;
+  hdr->version.patch = A0_TRANSPORT_UPDATE_PARTIAL;
+  a0_barrier();
+  memset(data + offsetof(a0_transport_hdr_t, mtx), 0, workspace_off - offsetof(a0_transport_hdr_t, mtx));
+
+  a0_transport_state_t* new_state = &hdr->state_pages[0].state;
+  new_state->seq_low = state.seq_high ? state.seq_high + 1 : 0;
+  new_state->seq_high = state.seq_high;
+  new_state->high_water_mark = workspace_off;
+
+  if (frame_cnt) {
+    memcpy(data + workspace_off, packed, packed_size);
+  }
+  off = workspace_off;
+  for (size_t i = 0; i < frame_cnt; i++) {
+    a0_transport_frame_hdr_t* frame_hdr = (a0_transport_frame_hdr_t*)(data + off);
+    frame_hdr->off = off;
+    frame_hdr->prev_off = i ? new_state->off_tail : 0;
+    frame_hdr->next_off = 0;
+    if (i) {
+      ((a0_transport_frame_hdr_t*)(data + new_state->off_tail))->next_off = off;
+    }
+    if (index_size) {
+      a0_transport_seq_index(hdr)[frame_hdr->seq & (index_size - 1)] = (a0_transport_seq_index_entry_t){
+          .off = off,
+          .commit_time_ns = commit_times[i],
+      };
+    }
+    new_state->off_tail = off;
+    new_state->high_water_mark = off + sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size;
+    off += a0_max_align(sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size);
+  }
+  if (frame_cnt) {
+    new_state->seq_low = first_seq;
+    new_state->off_head = workspace_off;
+  }
+  hdr->state_pages[1] = hdr->state_pages[0];
+
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
+  if (producers) {
+    producers->published[0] = (a0_transport_published_t){new_state->seq_high, new_state->off_tail};
+    producers->published[1] = producers->published[0];
+  }
+
+  free(packed);
+  free(commit_times);
+
+  a0_transport_set_version(hdr);
+  hdr->initialized = true;
+  return A0_OK;
+}
+
+A0_NO_TSAN
+A0_STATIC_INLINE
+bool a0_transport_needs_update(a0_arena_t arena) {
+  if (*(uint16_t*)arena.buf.data == 0x0101) {
+    return true;
+  }
+  return arena.buf.size >= sizeof(a0_transport_hdr_0_3_t) &&
+         a0_transport_is_version((a0_transport_hdr_t*)arena.buf.data, 0, 3);
+}
+
+static pthread_mutex_t a0_transport_update_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+// Serializes updates of the arena's format.
+//
+// The transport's own lock cannot be used, as the update moves it. An arena
+// mapped from a file is locked with flock on that file, which is released if
+// the process dies. Other arenas can only be shared within this process.
+//
+// The file is opened through /proc/self/map_files, or else by the path in
+// /proc/self/maps if it still names the mapped inode.
+//
+// Returns the locked file descriptor, or -1 if only the process is locked.
+static int a0_transport_update_lock(a0_arena_t arena) {
+  pthread_mutex_lock(&a0_transport_update_mtx);
+
+  int fd = -1;
+  FILE* maps = fopen("/proc/self/maps", "re");
+  if (maps) {
+    uintptr_t addr = (uintptr_t)arena.buf.data;
+    char line[PATH_MAX + 128];
+    while (fgets(line, sizeof(line), maps)) {
+      uintptr_t start;
+      uintptr_t end;
+      unsigned int dev_major;
+      unsigned int dev_minor;
+      unsigned long inode;
+      int path_off = 0;
+      if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %*s %*s %x:%x %lu %n",
+                 &start, &end, &dev_major, &dev_minor, &inode, &path_off) < 5) {
+        continue;
+      }
+      if (addr < start || addr >= end) {
+        continue;
+      }
+      if (!inode) {
+        break;
+      }
+
+      char map_file[64];
+      snprintf(map_file, sizeof(map_file), "/proc/self/map_files/%" PRIxPTR "-%" PRIxPTR, start, end);
+      fd = open(map_file, O_RDONLY | O_CLOEXEC);
+      if (fd == -1 && path_off) {
+        char* path = line + path_off;
+        path[strcspn(path, "\n")] = '\0';
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd != -1 && (fstat(fd, &st) == -1 || st.st_ino != inode ||
+                         major(st.st_dev) != dev_major || minor(st.st_dev) != dev_minor)) {
+          close(fd);
+          fd = -1;
+        }
+      }
+      break;
+    }
+    fclose(maps);
+  }
+
+  if (fd != -1 && flock(fd, LOCK_EX) == -1) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+static void a0_transport_update_unlock(int fd) {
+  if (fd != -1) {
+    flock(fd, LOCK_UN);
+    close(fd);
+  }
+  pthread_mutex_unlock(&a0_transport_update_mtx);
+}
+
+const a0_transport_options_t A0_TRANSPORT_OPTIONS_DEFAULT = {
+    .reader_slots = 0,
+    .seq_index_size = 0,
+    .producer_slots = 0,
+    .cursor_slots = 0,
+    .frame_align = 0,
+    .watcher_slots = 0,
+    .lock_spin_ns = 0,
+    .wait_spin_ns = 0,
+    .compact_frames = false,
+};
+
 a0_err_t a0_transport_init(a0_transport_t* transport, a0_arena_t arena) {
-  a0_backward_compatiblility_update_from_0_2(arena);
+  return a0_transport_init_options(transport, arena, A0_TRANSPORT_OPTIONS_DEFAULT);
+}
+
+a0_err_t a0_transport_init_options(a0_transport_t* transport,
+                                   a0_arena_t arena,
+                                   a0_transport_options_t opts) {
+  if (opts.reader_slots > A0_TRANSPORT_MAX_READER_SLOTS) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (opts.seq_index_size == 1 || (opts.seq_index_size & (opts.seq_index_size - 1))) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (opts.producer_slots > A0_TRANSPORT_MAX_PRODUCER_SLOTS) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (opts.cursor_slots > A0_TRANSPORT_MAX_CURSOR_SLOTS) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (opts.frame_align && (opts.frame_align < 8 || opts.frame_align > 64 ||
+                           (opts.frame_align & (opts.frame_align - 1)))) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (opts.watcher_slots > A0_TRANSPORT_MAX_WATCHER_SLOTS) {
+    return A0_ERR_INVALID_ARG;
+  }
+
+  if (arena.mode != A0_ARENA_MODE_READONLY && a0_transport_needs_update(arena)) {
+    int fd = a0_transport_update_lock(arena);
+    a0_backward_compatiblility_update_from_0_2(arena);
+    a0_err_t err = a0_backward_compatiblility_update_from_0_3(arena);
+    a0_transport_update_unlock(fd);
+    A0_RETURN_ERR_ON_ERR(err);
+  }
   // The arena is expected to be either:
   // 1) all null bytes.
   //    this is guaranteed by ftruncate, as is used in a0/file.h
@@ -142,197 +898,987 @@ a0_err_t a0_transport_init(a0_transport_t* transport, a0_arena_t arena) {
 
   memset(transport, 0, sizeof(a0_transport_t));
   transport->_arena = arena;
+  transport->_lock_spin.max = a0_spin_iters(opts.lock_spin_ns);
+  transport->_wait_spin_iters = a0_spin_iters(opts.wait_spin_ns);
 
   if (transport->_arena.mode == A0_ARENA_MODE_EXCLUSIVE) {
     memset(&hdr->mtx, 0, sizeof(hdr->mtx));
+    hdr->wait_cnt = 0;
+    for (uint8_t i = 0; i < hdr->reader_slots; i++) {
+      memset(&a0_transport_reader_slots(hdr)[i].mtx, 0, sizeof(a0_mtx_t));
+    }
+    a0_transport_producers_t* producers = a0_transport_producers(hdr);
+    for (uint8_t i = 0; producers && i < hdr->producer_slots; i++) {
+      memset(&producers->slots[i].mtx, 0, sizeof(a0_mtx_t));
+    }
+    for (uint8_t i = 0; i < hdr->cursor_slots; i++) {
+      memset(&a0_transport_cursor_slots(hdr)[i].mtx, 0, sizeof(a0_mtx_t));
+    }
+    for (uint8_t i = 0; i < hdr->watcher_slots; i++) {
+      memset(&a0_transport_watcher_slots(hdr)[i].mtx, 0, sizeof(a0_mtx_t));
+      a0_transport_watcher_slots(hdr)[i].armed = 0;
+    }
+  }
+
+  if (transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    // An uninitialized arena is read as an empty transport.
+    // Older versions must first be updated by a writer.
+    if (hdr->initialized && !a0_transport_is_version(hdr, 0, 4)) {
+      return A0_MAKE_SYSERR(ENOTSUP);
+    }
+    return A0_OK;
+  }
+
+  a0_transport_locked_t lk;
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &lk));
+
+  if (!hdr->initialized) {
+    hdr->reader_slots = opts.reader_slots;
+    hdr->seq_index_log2 = opts.seq_index_size ? (uint8_t)__builtin_ctz(opts.seq_index_size) : 0;
+    hdr->producer_slots = opts.producer_slots;
+    hdr->cursor_slots = opts.cursor_slots;
+    hdr->frame_align_log2 = opts.frame_align ? (uint8_t)__builtin_ctz(opts.frame_align) : 0;
+    hdr->watcher_slots = opts.watcher_slots;
+    hdr->frame_compact = opts.compact_frames;
+    if (a0_transport_workspace_off(hdr) >= transport->_arena.buf.size ||
+        (opts.compact_frames && transport->_arena.buf.size > A0_TRANSPORT_COMPACT_MAX_ARENA_SIZE)) {
+      hdr->reader_slots = 0;
+      hdr->seq_index_log2 = 0;
+      hdr->producer_slots = 0;
+      hdr->cursor_slots = 0;
+      hdr->frame_align_log2 = 0;
+      hdr->watcher_slots = 0;
+      hdr->frame_compact = false;
+      a0_transport_unlock(lk);
+      return A0_ERR_INVALID_ARG;
+    }
+
+    a0_transport_set_version(hdr);
+    hdr->arena_size = transport->_arena.buf.size;
+    hdr->state_pages[0].state.high_water_mark = a0_transport_workspace_off(hdr);
+    hdr->state_pages[1].state.high_water_mark = a0_transport_workspace_off(hdr);
+    hdr->initialized = true;
+  } else if (!a0_transport_is_version(hdr, 0, 4)) {
+    a0_transport_unlock(lk);
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+
+  a0_transport_unlock(lk);
+
+  return A0_OK;
+}
+
+// Waiters sleep on hdr->cnd with a futex bitset describing what they are
+// waiting for:
+// * Waiters for a specific sequence number use bit (seq % 31).
+// * All other waiters use A0_TRANSPORT_WAKE_ANY.
+//
+// A commit only wakes the waiters whose sequence number was just committed,
+// along with the A0_TRANSPORT_WAKE_ANY waiters. Waiters that care about later
+// sequence numbers stay asleep. Hash collisions cause spurious wakeups, which
+// are handled by re-evaluating the predicate.
+#define A0_TRANSPORT_WAKE_SEQ_BITS 31
+#define A0_TRANSPORT_WAKE_ANY (1u << A0_TRANSPORT_WAKE_SEQ_BITS)
+
+A0_STATIC_INLINE
+uint32_t a0_transport_wake_seq_bit(uint64_t seq) {
+  return 1u << (seq % A0_TRANSPORT_WAKE_SEQ_BITS);
+}
+
+A0_STATIC_INLINE
+uint32_t a0_transport_wake_commit_bits(uint64_t old_seq_high, uint64_t new_seq_high) {
+  if (new_seq_high - old_seq_high >= A0_TRANSPORT_WAKE_SEQ_BITS) {
+    return FUTEX_BITSET_MATCH_ANY;
+  }
+
+  uint32_t bits = A0_TRANSPORT_WAKE_ANY;
+  for (uint64_t seq = old_seq_high + 1; seq <= new_seq_high; seq++) {
+    bits |= a0_transport_wake_seq_bit(seq);
+  }
+  return bits;
+}
+
+// Wakes the threads blocked on the transport condition variable that match
+// the given bits.
+//
+// The waiter count is maintained in shared memory, under the transport lock,
+// so this is free of syscalls when no thread in any process is blocked.
+//
+// Note: If a waiting process dies, the count is not decremented. This only
+//       results in unnecessary, but harmless, wake syscalls.
+A0_STATIC_INLINE
+void a0_transport_notify(a0_transport_locked_t lk, uint32_t wake_bits) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (hdr->wait_cnt) {
+    a0_atomic_add_fetch(&hdr->cnd, 1);
+    a0_ftx_wake_bitset(&hdr->cnd, INT_MAX, wake_bits);
+  }
+}
+
+// Watcher sockets are datagram sockets in the abstract unix namespace, so
+// writers in any process can signal them by name, and they vanish with their
+// owner.
+static socklen_t a0_transport_watcher_addr(uint64_t id, struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  int len = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "alephzero/watcher/%016" PRIx64, id);
+  return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + len);
+}
+
+// Unbound socket used by this process to signal watchers. Stored plus one, so
+// zero means not yet created.
+static int a0_transport_signal_fd_plus_one;
+
+static void a0_transport_signal_watcher(uint64_t id) {
+  int fd = a0_atomic_load(&a0_transport_signal_fd_plus_one) - 1;
+  if (fd < 0) {
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return;
+    }
+    if (!a0_cas(&a0_transport_signal_fd_plus_one, 0, fd + 1)) {
+      close(fd);
+      fd = a0_atomic_load(&a0_transport_signal_fd_plus_one) - 1;
+    }
+  }
+
+  // A full socket is already readable, and a dead watcher refuses the
+  // datagram. Neither needs handling.
+  struct sockaddr_un addr;
+  socklen_t addr_len = a0_transport_watcher_addr(id, &addr);
+  sendto(fd, "", 1, MSG_DONTWAIT | MSG_NOSIGNAL, (struct sockaddr*)&addr, addr_len);
+}
+
+// Inode of the calling thread's network namespace, or zero if unknown.
+//
+// Not cached, as a thread may move to another namespace with unshare or setns.
+static uint64_t a0_transport_netns() {
+  struct stat st;
+  return stat("/proc/thread-self/ns/net", &st) ? 0 : (uint64_t)st.st_ino;
+}
+
+// Signals the armed watchers. Only called for commits, as watchers only wait
+// for new frames.
+//
+// Called after unlocking, as each signal is a syscall. A slot reused meanwhile
+// gets at most a spurious signal.
+static void a0_transport_signal_watchers(a0_transport_hdr_t* hdr) {
+  uint64_t netns = 0;
+  bool netns_known = false;
+  a0_transport_watcher_slot_t* slots = a0_transport_watcher_slots(hdr);
+  for (uint8_t i = 0; i < hdr->watcher_slots; i++) {
+    if (!a0_atomic_load(&slots[i].armed)) {
+      continue;
+    }
+    if (!netns_known) {
+      netns = a0_transport_netns();
+      netns_known = true;
+    }
+    uint64_t slot_netns = a0_atomic_load(&slots[i].netns);
+    if (netns && slot_netns && slot_netns != netns) {
+      // The watcher's socket cannot be named from here. It stays armed, for
+      // writers that can signal it.
+      if (!a0_atomic_load(&slots[i].unreachable)) {
+        a0_atomic_store(&slots[i].unreachable, 1);
+      }
+      continue;
+    }
+    if (a0_cas(&slots[i].armed, 1, 0)) {
+      a0_transport_signal_watcher(a0_atomic_load(&slots[i].id));
+    }
+  }
+}
+
+// Commits frames whose commit was deferred, before the lock is released.
+A0_STATIC_INLINE
+void a0_transport_flush_commit(a0_transport_locked_t lk) {
+  if (lk.transport->_commit_pending) {
+    a0_transport_commit(lk);
+  }
+}
+
+// Wakes the waiters owed a wake by commits made under the current lock.
+//
+// Waiters cannot observe a commit until the lock is released, so commits only
+// accumulate wake bits and the wake is issued once, before unlocking.
+//
+// Returns whether watchers are owed a signal, which the caller sends with
+// a0_transport_signal_watchers once unlocked.
+A0_STATIC_INLINE
+bool a0_transport_flush_notify(a0_transport_locked_t lk) {
+  if (!lk.transport->_wake_bits) {
+    return false;
+  }
+  a0_transport_notify(lk, lk.transport->_wake_bits);
+  // Commits set sequence bits. Other events only set A0_TRANSPORT_WAKE_ANY.
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  bool signal_watchers = hdr->watcher_slots && (lk.transport->_wake_bits & ~A0_TRANSPORT_WAKE_ANY);
+  lk.transport->_wake_bits = 0;
+  return signal_watchers;
+}
+
+// Another process may have grown the arena, through a0_transport_resize on a
+// grown mapping. Adopt the size, as far as the mapping here reaches.
+//
+// The size in the header is written by other processes, so it is never
+// trusted past the arena capacity.
+A0_STATIC_INLINE
+void a0_transport_adopt_arena_size(a0_transport_t* transport) {
+  a0_transport_hdr_t* hdr = (a0_transport_hdr_t*)transport->_arena.buf.data;
+  size_t arena_size = a0_atomic_load(&hdr->arena_size);
+  if (arena_size > transport->_arena.capacity) {
+    arena_size = transport->_arena.capacity;
+  }
+  if (arena_size > transport->_arena.buf.size) {
+    transport->_arena.buf.size = arena_size;
+  }
+}
+
+// Takes the transport lock, spinning as configured, and clears any incomplete changes.
+A0_STATIC_INLINE
+void a0_transport_relock(a0_transport_locked_t lk) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_err_t prior_owner_died = a0_mtx_timedlock_spin(&hdr->mtx, A0_TIMEOUT_NEVER, &lk.transport->_lock_spin);
+  A0_MAYBE_UNUSED(prior_owner_died);
+
+  *a0_transport_working_page(lk) = *a0_transport_committed_page(lk);
+  a0_transport_clamp_working(lk);
+  a0_transport_adopt_arena_size(lk.transport);
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_transport_cnd_timedwait(a0_transport_locked_t lk, a0_time_mono_t* timeout, uint32_t wait_bits) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_transport_flush_commit(lk);
+  bool signal_watchers = a0_transport_flush_notify(lk);
+
+  const uint32_t init_cnd = a0_atomic_load(&hdr->cnd);
+  hdr->wait_cnt++;
+
+  // Unblock other threads to do the things that will eventually signal this wait.
+  a0_mtx_unlock(&hdr->mtx);
+  if (signal_watchers) {
+    a0_transport_signal_watchers(hdr);
+  }
+
+  a0_err_t err = a0_ftx_wait_bitset(&hdr->cnd, (int)init_cnd, timeout, wait_bits);
+
+  a0_transport_relock(lk);
+  hdr->wait_cnt--;
+
+  // EAGAIN means the condition variable was signaled between the unlock and wait.
+  // EINTR is a spurious wakeup.
+  if (A0_SYSERR(err) == EAGAIN || A0_SYSERR(err) == EINTR) {
+    return A0_OK;
+  }
+  return err;
+}
+
+// Unlocks and polls the commit counter, until a commit or the wait spin runs out.
+//
+// Other wake events do not change the counter, so the caller re-checks its
+// predicate regardless of why the poll ended.
+A0_STATIC_INLINE
+void a0_transport_spin_poll(a0_transport_locked_t lk) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_transport_flush_commit(lk);
+  bool signal_watchers = a0_transport_flush_notify(lk);
+
+  const uint32_t init_commit_cnt = a0_atomic_load(&hdr->commit_cnt);
+  a0_mtx_unlock(&hdr->mtx);
+  if (signal_watchers) {
+    a0_transport_signal_watchers(hdr);
+  }
+
+  for (uint32_t i = 0; i < lk.transport->_wait_spin_iters; i++) {
+    if (a0_atomic_load(&hdr->commit_cnt) != init_commit_cnt) {
+      break;
+    }
+    a0_spin_relax();
+  }
+
+  a0_transport_relock(lk);
+}
+
+a0_err_t a0_transport_shutdown(a0_transport_locked_t lk) {
+  if (lk.transport->_reader_slot) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  lk.transport->_shutdown = true;
+  lk.transport->_wake_bits = 0;
+  a0_transport_notify(lk, FUTEX_BITSET_MATCH_ANY);
+
+  while (lk.transport->_wait_cnt) {
+    a0_transport_cnd_timedwait(lk, A0_TIMEOUT_NEVER, A0_TRANSPORT_WAKE_ANY);
+  }
+  return A0_OK;
+}
+
+a0_err_t a0_transport_shutdown_requested(a0_transport_locked_t lk, bool* out) {
+  *out = lk.transport->_shutdown;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_lock(a0_transport_t* transport, a0_transport_locked_t* lk_out) {
+  lk_out->transport = transport;
+
+  if (transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    a0_transport_snapshot(a0_transport_header(*lk_out), &transport->_snapshot);
+    a0_transport_adopt_arena_size(transport);
+    return A0_OK;
+  }
+
+  if (transport->_arena.mode != A0_ARENA_MODE_SHARED) {
+    a0_transport_adopt_arena_size(transport);
+    return A0_OK;
+  }
+
+  a0_transport_relock(*lk_out);
+  return A0_OK;
+}
+
+a0_err_t a0_transport_poll_seq_high(a0_transport_t* transport, uint64_t* out) {
+  a0_transport_state_t state;
+  a0_transport_snapshot((a0_transport_hdr_t*)transport->_arena.buf.data, &state);
+  *out = state.seq_high;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_poll_pause(a0_transport_t* transport,
+                                 uint64_t seq_high,
+                                 a0_transport_poll_backoff_t backoff) {
+  if (backoff == A0_TRANSPORT_POLL_UMWAIT) {
+    a0_transport_hdr_t* hdr = (a0_transport_hdr_t*)transport->_arena.buf.data;
+    // Every commit and publish bumps the counter, so once seq_high is known to
+    // be unchanged at this count, any later commit ends the wait.
+    const uint32_t commit_cnt = a0_atomic_load(&hdr->commit_cnt);
+    uint64_t cur_seq_high;
+    a0_transport_poll_seq_high(transport, &cur_seq_high);
+    if (cur_seq_high != seq_high || a0_spin_umwait(&hdr->commit_cnt, commit_cnt)) {
+      return A0_OK;
+    }
+  }
+
+  a0_spin_relax();
+  return A0_OK;
+}
+
+a0_err_t a0_transport_lock_shared(a0_transport_t* transport, a0_transport_locked_t* lk_out) {
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, lk_out));
+  return a0_transport_downgrade(*lk_out);
+}
+
+a0_err_t a0_transport_downgrade(a0_transport_locked_t lk) {
+  if (lk.transport->_arena.mode != A0_ARENA_MODE_SHARED || lk.transport->_reader_slot) {
+    return A0_OK;
+  }
+
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (!hdr->reader_slots) {
+    return A0_OK;
+  }
+
+  // Start the search at a thread-dependent slot, to avoid every reader
+  // contending for the first slots.
+  a0_transport_reader_slot_t* slots = a0_transport_reader_slots(hdr);
+  const uint32_t start = a0_tid();
+  for (uint8_t i = 0; i < hdr->reader_slots; i++) {
+    a0_transport_reader_slot_t* slot = &slots[(start + i) % hdr->reader_slots];
+    if (!a0_mtx_lock_successful(a0_mtx_trylock(&slot->mtx))) {
+      continue;
+    }
+
+    // Pin the committed state, starting from the current frame.
+    a0_transport_state_t* committed = a0_transport_committed_page(lk);
+    slot->state = *committed;
+    a0_transport_producers_t* producers = a0_transport_producers(hdr);
+    if (producers) {
+      a0_transport_clamp_published(&slot->state, producers->published[producers->published_idx & 1]);
+    }
+    uint64_t seq = lk.transport->_seq;
+    if (slot->state.seq_low < seq && seq <= slot->state.seq_high) {
+      slot->state.seq_low = seq;
+      slot->state.off_head = lk.transport->_off;
+    }
+
+    *a0_transport_working_page(lk) = *committed;
+    bool signal_watchers = a0_transport_flush_notify(lk);
+    lk.transport->_reader_slot = slot;
+    a0_mtx_unlock(&hdr->mtx);
+    if (signal_watchers) {
+      a0_transport_signal_watchers(hdr);
+    }
+    return A0_OK;
+  }
+
+  return A0_OK;
+}
+
+a0_err_t a0_transport_is_shared(a0_transport_locked_t lk, bool* out) {
+  *out = lk.transport->_reader_slot;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_unlock(a0_transport_locked_t lk) {
+  if (lk.transport->_arena.mode != A0_ARENA_MODE_SHARED) {
+    return A0_OK;
+  }
+
+  if (lk.transport->_reader_slot) {
+    a0_mtx_t* slot_mtx = &lk.transport->_reader_slot->mtx;
+    lk.transport->_reader_slot = NULL;
+    return a0_mtx_unlock(slot_mtx);
+  }
+
+  a0_transport_flush_commit(lk);
+  *a0_transport_working_page(lk) = *a0_transport_committed_page(lk);
+  bool signal_watchers = a0_transport_flush_notify(lk);
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_mtx_unlock(&hdr->mtx);
+  if (signal_watchers) {
+    a0_transport_signal_watchers(hdr);
+  }
+  return A0_OK;
+}
+
+// Whether the state holds no frames, including discarded frames.
+A0_STATIC_INLINE
+bool a0_transport_state_empty(a0_transport_state_t* state) {
+  return !state->seq_high | (state->seq_low > state->seq_high);
+}
+
+a0_err_t a0_transport_iter_valid(a0_transport_locked_t lk, bool* out) {
+  a0_transport_state_t* working_page = a0_transport_working_page(lk);
+  *out = (working_page->seq_low <= lk.transport->_seq) &&
+         (lk.transport->_seq <= working_page->seq_high);
+  return A0_OK;
+}
+
+a0_err_t a0_transport_iter_revalidate(a0_transport_locked_t lk, bool* out) {
+  if (lk.transport->_arena.mode != A0_ARENA_MODE_READONLY) {
+    return a0_transport_iter_valid(lk, out);
+  }
+
+  a0_transport_state_t latest;
+  a0_transport_snapshot(a0_transport_header(lk), &latest);
+  *out = (latest.seq_low <= lk.transport->_seq) &&
+         (lk.transport->_seq <= latest.seq_high);
+  return A0_OK;
+}
+
+// Checks whether a frame header at the given offset lies within the workspace.
+//
+// Readers of READONLY arenas may follow offsets from frames that are being
+// overwritten. This keeps them within the arena.
+A0_STATIC_INLINE
+bool a0_transport_frame_hdr_in_bounds(a0_transport_locked_t lk, size_t off) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  return a0_transport_frame_align(hdr, off) == off &&
+         off >= a0_transport_workspace_off(hdr) &&
+         off + a0_transport_frame_hdr_size(hdr) <= lk.transport->_arena.buf.size;
+}
+
+// Checks whether a frame header at the given offset lies within this mapping.
+//
+// Another process may have grown the arena past the mapping here, and committed
+// frames in the grown space. See a0_transport_adopt_arena_size.
+A0_STATIC_INLINE
+bool a0_transport_frame_hdr_mapped(a0_transport_locked_t lk, size_t off) {
+  return off + a0_transport_frame_hdr_size(a0_transport_header(lk)) <= lk.transport->_arena.buf.size;
+}
+
+a0_err_t a0_transport_jump(a0_transport_locked_t lk, size_t off) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (a0_transport_frame_align(hdr, off) != off) {
+    return A0_ERR_RANGE;
+  }
+
+  size_t arena_size = a0_transport_arena_size(lk);
+  size_t hdr_size = a0_transport_frame_hdr_size(hdr);
+  if (off + hdr_size >= arena_size) {
+    return A0_ERR_RANGE;
+  }
+
+  if (off + hdr_size + a0_transport_frame_data_size(lk, off) >= arena_size) {
+    return A0_ERR_RANGE;
+  }
+
+  lk.transport->_off = off;
+  lk.transport->_seq = a0_transport_frame_seq(lk, off);
+  return A0_OK;
+}
+
+// Checks whether the frame at off is the live frame with the given sequence number.
+//
+// The offset may be stale, so the frame must be in bounds and linked to its
+// neighbor. Loads are atomic, as the frame may be concurrently overwritten when
+// the lock is shared or the arena is READONLY.
+A0_STATIC_INLINE
+bool a0_transport_is_live_frame(a0_transport_locked_t lk, a0_transport_state_t* state, size_t off, uint64_t seq) {
+  if (!a0_transport_frame_hdr_in_bounds(lk, off)) {
+    return false;
+  }
+  if (a0_transport_frame_seq(lk, off) != seq || !a0_transport_frame_self_linked(lk, off)) {
+    return false;
+  }
+  if (seq == state->seq_low) {
+    return off == state->off_head;
+  }
+  if (seq == state->seq_high) {
+    return off == state->off_tail;
+  }
+
+  size_t prev_off = a0_transport_frame_prev_off(lk, off);
+  if (!a0_transport_frame_hdr_in_bounds(lk, prev_off)) {
+    return false;
+  }
+  return a0_transport_frame_seq(lk, prev_off) == seq - 1 && a0_transport_frame_next_off(lk, prev_off) == off;
+}
+
+// Steps from the frame (off, seq) over discarded frames, forward up to seq_high
+// or backward down to seq_low, and updates off and seq to the first frame kept.
+//
+// Fails with A0_ERR_RANGE if every frame in that direction was discarded, and
+// with ESPIPE if a link was overwritten, in a READONLY arena.
+A0_STATIC_INLINE
+a0_err_t a0_transport_find_kept(a0_transport_locked_t lk,
+                                a0_transport_state_t* state,
+                                bool forward,
+                                size_t* off,
+                                uint64_t* seq) {
+  // Only producers discard frames.
+  if (!a0_transport_header(lk)->producer_slots) {
+    return A0_OK;
+  }
+
+  while (true) {
+    if (!a0_transport_frame_hdr_in_bounds(lk, *off)) {
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+    if (a0_transport_frame_seq(lk, *off) != *seq) {
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+    if (!a0_transport_frame_discarded(lk, *off)) {
+      return A0_OK;
+    }
+    if (*seq == (forward ? state->seq_high : state->seq_low)) {
+      return A0_ERR_RANGE;
+    }
+    *off = forward ? a0_transport_frame_next_off(lk, *off) : a0_transport_frame_prev_off(lk, *off);
+    *seq = forward ? *seq + 1 : *seq - 1;
   }
+}
 
-  a0_transport_locked_t lk;
-  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &lk));
-
-  if (!hdr->initialized) {
-    memcpy(hdr->magic, "ALEPHZERO", 9);
-    hdr->version.major = 0;
-    hdr->version.minor = 3;
-    hdr->version.patch = 0;
-    hdr->arena_size = transport->_arena.buf.size;
-    hdr->state_pages[0].high_water_mark = a0_transport_workspace_off();
-    hdr->state_pages[1].high_water_mark = a0_transport_workspace_off();
-    hdr->initialized = true;
-  } else {
-    // TODO(lshamis): Verify magic + version.
+a0_err_t a0_transport_empty(a0_transport_locked_t lk, bool* out) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+  *out = a0_transport_state_empty(state);
+  if (!*out) {
+    // Every frame may have been discarded. The tail is usually kept.
+    size_t off = state->off_tail;
+    uint64_t seq = state->seq_high;
+    *out = a0_transport_find_kept(lk, state, false, &off, &seq) == A0_ERR_RANGE;
   }
+  return A0_OK;
+}
 
-  a0_transport_unlock(lk);
+a0_err_t a0_transport_nonempty(a0_transport_locked_t lk, bool* out) {
+  a0_err_t err = a0_transport_empty(lk, out);
+  *out = !*out;
+  return err;
+}
 
+// Walks, one frame at a time, from the live frame (off, seq) to the frame with
+// the target sequence number, and updates off and seq to it.
+A0_STATIC_INLINE
+a0_err_t a0_transport_walk_to_seq(a0_transport_locked_t lk, size_t* off, uint64_t* seq, uint64_t target) {
+  while (*seq != target) {
+    size_t step_off = *seq < target ? a0_transport_frame_next_off(lk, *off) : a0_transport_frame_prev_off(lk, *off);
+    uint64_t step_seq = *seq < target ? *seq + 1 : *seq - 1;
+    if (!a0_transport_frame_hdr_in_bounds(lk, step_off) ||
+        a0_transport_frame_seq(lk, step_off) != step_seq) {
+      // Only possible if a writer overwrote the frames, in a READONLY arena.
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+    *off = step_off;
+    *seq = step_seq;
+  }
   return A0_OK;
 }
 
-a0_err_t a0_transport_shutdown(a0_transport_locked_t lk) {
+// Looks up the live frame with the given sequence number in the sequence index.
+A0_STATIC_INLINE
+a0_transport_seq_index_entry_t* a0_transport_seq_index_find(a0_transport_locked_t lk,
+                                                            a0_transport_state_t* state,
+                                                            uint64_t seq) {
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
-
-  lk.transport->_shutdown = true;
-  a0_cnd_broadcast(&hdr->cnd, &hdr->mtx);
-
-  while (lk.transport->_wait_cnt) {
-    a0_cnd_wait(&hdr->cnd, &hdr->mtx);
+  size_t index_size = a0_transport_seq_index_size(hdr);
+  if (!index_size) {
+    return NULL;
   }
-  return A0_OK;
+  a0_transport_seq_index_entry_t* entry = &a0_transport_seq_index(hdr)[seq & (index_size - 1)];
+  if (!a0_transport_is_live_frame(lk, state, a0_atomic_load(&entry->off), seq)) {
+    return NULL;
+  }
+  return entry;
 }
 
-a0_err_t a0_transport_shutdown_requested(a0_transport_locked_t lk, bool* out) {
-  *out = lk.transport->_shutdown;
-  return A0_OK;
+A0_STATIC_INLINE
+uint64_t a0_transport_seq_dist(uint64_t a, uint64_t b) {
+  return a < b ? b - a : a - b;
 }
 
-a0_err_t a0_transport_lock(a0_transport_t* transport, a0_transport_locked_t* lk_out) {
-  lk_out->transport = transport;
+a0_err_t a0_transport_jump_seq(a0_transport_locked_t lk, uint64_t seq) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
 
-  if (transport->_arena.mode != A0_ARENA_MODE_SHARED) {
-    return A0_OK;
+  if (a0_transport_state_empty(state) || seq < state->seq_low || seq > state->seq_high) {
+    return A0_ERR_RANGE;
   }
 
-  a0_transport_hdr_t* hdr = a0_transport_header(*lk_out);
+  // Start from whichever known frame is closest: head, tail, or an index entry.
+  size_t start_off = state->off_head;
+  uint64_t start_seq = state->seq_low;
+  if (a0_transport_seq_dist(state->seq_high, seq) < a0_transport_seq_dist(start_seq, seq)) {
+    start_off = state->off_tail;
+    start_seq = state->seq_high;
+  }
 
-  a0_err_t prior_owner_died = a0_mtx_lock(&hdr->mtx);
-  A0_MAYBE_UNUSED(prior_owner_died);
+  size_t index_size = a0_transport_seq_index_size(a0_transport_header(lk));
+  a0_transport_seq_index_entry_t* entry = a0_transport_seq_index_find(lk, state, seq);
+  if (entry) {
+    start_off = entry->off;
+    start_seq = seq;
+  } else if (index_size && state->seq_high - seq >= index_size) {
+    // Too old to be indexed. The oldest indexed frame may still be closer.
+    uint64_t oldest_seq = state->seq_high - index_size + 1;
+    if (a0_transport_seq_dist(oldest_seq, seq) < a0_transport_seq_dist(start_seq, seq) &&
+        (entry = a0_transport_seq_index_find(lk, state, oldest_seq))) {
+      start_off = entry->off;
+      start_seq = oldest_seq;
+    }
+  }
 
-  // Clear any incomplete changes.
-  *a0_transport_working_page(*lk_out) = *a0_transport_committed_page(*lk_out);
+  A0_RETURN_ERR_ON_ERR(a0_transport_walk_to_seq(lk, &start_off, &start_seq, seq));
+  A0_RETURN_ERR_ON_ERR(a0_transport_find_kept(lk, state, true, &start_off, &start_seq));
 
+  lk.transport->_off = start_off;
+  lk.transport->_seq = start_seq;
   return A0_OK;
 }
 
-a0_err_t a0_transport_unlock(a0_transport_locked_t lk) {
-  if (lk.transport->_arena.mode != A0_ARENA_MODE_SHARED) {
-    return A0_OK;
-  }
-
-  *a0_transport_working_page(lk) = *a0_transport_committed_page(lk);
-  a0_transport_hdr_t* hdr = a0_transport_header(lk);
-  a0_mtx_unlock(&hdr->mtx);
-  return A0_OK;
+A0_STATIC_INLINE
+uint64_t a0_transport_time_ns(a0_time_mono_t time) {
+  return time.ts.tv_sec * NS_PER_SEC + time.ts.tv_nsec;
 }
 
-a0_err_t a0_transport_empty(a0_transport_locked_t lk, bool* out) {
-  a0_transport_state_t* working_page = a0_transport_working_page(lk);
-  *out = !working_page->seq_high | (working_page->seq_low > working_page->seq_high);
-  return A0_OK;
-}
+a0_err_t a0_transport_frame_time(a0_transport_locked_t lk, a0_time_mono_t* out) {
+  if (!a0_transport_seq_index_size(a0_transport_header(lk))) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
 
-a0_err_t a0_transport_nonempty(a0_transport_locked_t lk, bool* out) {
-  a0_err_t err = a0_transport_empty(lk, out);
-  *out = !*out;
-  return err;
-}
+  a0_transport_seq_index_entry_t* entry =
+      a0_transport_seq_index_find(lk, a0_transport_working_page(lk), lk.transport->_seq);
+  if (!entry || lk.transport->_seq > a0_transport_committed_page(lk)->seq_high) {
+    return A0_ERR_RANGE;
+  }
 
-a0_err_t a0_transport_iter_valid(a0_transport_locked_t lk, bool* out) {
-  a0_transport_state_t* working_page = a0_transport_working_page(lk);
-  *out = (working_page->seq_low <= lk.transport->_seq) &&
-         (lk.transport->_seq <= working_page->seq_high);
+  uint64_t time_ns = a0_atomic_load(&entry->commit_time_ns);
+  out->ts.tv_sec = time_ns / NS_PER_SEC;
+  out->ts.tv_nsec = time_ns % NS_PER_SEC;
   return A0_OK;
 }
 
-a0_err_t a0_transport_jump(a0_transport_locked_t lk, size_t off) {
-  if (a0_max_align(off) != off) {
+a0_err_t a0_transport_jump_time(a0_transport_locked_t lk, a0_time_mono_t time) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  size_t index_size = a0_transport_seq_index_size(hdr);
+  if (!index_size) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+
+  a0_transport_state_t* state = a0_transport_committed_page(lk);
+  bool empty = !state->seq_high || state->seq_low > state->seq_high;
+  if (empty) {
     return A0_ERR_RANGE;
   }
 
-  a0_transport_hdr_t* hdr = a0_transport_header(lk);
-  if (off + sizeof(a0_transport_frame_hdr_t) >= hdr->arena_size) {
+  // Commit times are only known for indexed frames.
+  uint64_t lo = state->seq_low;
+  if (state->seq_high - lo >= index_size) {
+    lo = state->seq_high - index_size + 1;
+  }
+  uint64_t hi = state->seq_high;
+
+  // An uncommitted alloc may have overwritten the oldest entry.
+  if (!a0_transport_seq_index_find(lk, state, lo)) {
+    lo++;
+  }
+
+  uint64_t target_ns = a0_transport_time_ns(time);
+  a0_transport_seq_index_entry_t* hi_entry = a0_transport_seq_index_find(lk, state, hi);
+  if (!hi_entry || a0_atomic_load(&hi_entry->commit_time_ns) < target_ns) {
     return A0_ERR_RANGE;
   }
 
-  a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, off);
-  if (off + sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size >= hdr->arena_size) {
+  // Binary search for the oldest frame committed at or after the given time.
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    a0_transport_seq_index_entry_t* entry = a0_transport_seq_index_find(lk, state, mid);
+    if (!entry) {
+      // Only possible if a writer overwrote the index, in a READONLY arena.
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+    if (a0_atomic_load(&entry->commit_time_ns) < target_ns) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // Frames older than the index have unknown commit times. Starting at the
+  // oldest indexed frame may skip some committed at or after the given time,
+  // but never starts before it.
+  return a0_transport_jump_seq(lk, lo);
+}
+
+a0_err_t a0_transport_jump_head(a0_transport_locked_t lk) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+  if (a0_transport_state_empty(state)) {
     return A0_ERR_RANGE;
   }
 
+  size_t off = state->off_head;
+  uint64_t seq = state->seq_low;
+  A0_RETURN_ERR_ON_ERR(a0_transport_find_kept(lk, state, true, &off, &seq));
+
+  lk.transport->_seq = seq;
   lk.transport->_off = off;
-  lk.transport->_seq = frame_hdr->seq;
   return A0_OK;
 }
 
-a0_err_t a0_transport_jump_head(a0_transport_locked_t lk) {
+a0_err_t a0_transport_jump_tail(a0_transport_locked_t lk) {
   a0_transport_state_t* state = a0_transport_working_page(lk);
-
-  bool empty;
-  A0_RETURN_ERR_ON_ERR(a0_transport_empty(lk, &empty));
-  if (empty) {
+  if (a0_transport_state_empty(state)) {
     return A0_ERR_RANGE;
   }
 
-  lk.transport->_seq = state->seq_low;
-  lk.transport->_off = state->off_head;
+  size_t off = state->off_tail;
+  uint64_t seq = state->seq_high;
+  A0_RETURN_ERR_ON_ERR(a0_transport_find_kept(lk, state, false, &off, &seq));
+
+  lk.transport->_seq = seq;
+  lk.transport->_off = off;
   return A0_OK;
 }
 
-a0_err_t a0_transport_jump_tail(a0_transport_locked_t lk) {
+// Finds the frame after the current one, without checking whether it was discarded.
+//
+// Returns false if the current frame is the tail. Fails with ESPIPE if the
+// current frame cannot be followed.
+A0_STATIC_INLINE
+a0_err_t a0_transport_next_frame(a0_transport_locked_t lk, bool* found, size_t* off, uint64_t* seq) {
   a0_transport_state_t* state = a0_transport_working_page(lk);
+  *found = !a0_transport_state_empty(state) && lk.transport->_seq < state->seq_high;
+  if (!*found) {
+    return A0_OK;
+  }
 
-  bool empty;
-  A0_RETURN_ERR_ON_ERR(a0_transport_empty(lk, &empty));
-  if (empty) {
-    return A0_ERR_RANGE;
+  if (lk.transport->_seq < state->seq_low) {
+    *off = state->off_head;
+    *seq = state->seq_low;
+    return A0_OK;
+  }
+
+  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    // The current frame may have been overwritten since the snapshot.
+    // If the link cannot be trusted, treat the frame as evicted.
+    size_t next_off = a0_transport_frame_next_off(lk, lk.transport->_off);
+    if (!a0_transport_frame_hdr_in_bounds(lk, next_off) ||
+        a0_transport_frame_seq(lk, next_off) != lk.transport->_seq + 1) {
+      *off = state->off_head;
+      *seq = state->seq_low;
+      return A0_OK;
+    }
+    *off = next_off;
+    *seq = lk.transport->_seq + 1;
+    return A0_OK;
   }
 
-  lk.transport->_seq = state->seq_high;
-  lk.transport->_off = state->off_tail;
+  if (!a0_transport_frame_hdr_mapped(lk, lk.transport->_off)) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
+  *off = a0_transport_frame_next_off(lk, lk.transport->_off);
+  if (!a0_transport_frame_hdr_mapped(lk, *off)) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
+  *seq = a0_transport_frame_seq(lk, *off);
   return A0_OK;
 }
 
 a0_err_t a0_transport_has_next(a0_transport_locked_t lk, bool* out) {
-  bool empty;
-  A0_RETURN_ERR_ON_ERR(a0_transport_empty(lk, &empty));
-
   a0_transport_state_t* state = a0_transport_working_page(lk);
-  *out = !empty && (lk.transport->_seq < state->seq_high);
+  *out = !a0_transport_state_empty(state) && lk.transport->_seq < state->seq_high;
+  if (!*out || !a0_transport_header(lk)->producer_slots) {
+    return A0_OK;
+  }
+
+  // The frames after the current one may all have been discarded.
+  bool found;
+  size_t off = 0;
+  uint64_t seq = 0;
+  a0_err_t err = a0_transport_next_frame(lk, &found, &off, &seq);
+  if (!err) {
+    err = a0_transport_find_kept(lk, state, true, &off, &seq);
+  }
+  *out = err != A0_ERR_RANGE;
   return A0_OK;
 }
 
 a0_err_t a0_transport_step_next(a0_transport_locked_t lk) {
-  a0_transport_state_t* state = a0_transport_working_page(lk);
-
-  bool has_next;
-  A0_RETURN_ERR_ON_ERR(a0_transport_has_next(lk, &has_next));
-  if (!has_next) {
+  bool found;
+  size_t off;
+  uint64_t seq;
+  A0_RETURN_ERR_ON_ERR(a0_transport_next_frame(lk, &found, &off, &seq));
+  if (!found) {
     return A0_ERR_RANGE;
   }
+  A0_RETURN_ERR_ON_ERR(a0_transport_find_kept(lk, a0_transport_working_page(lk), true, &off, &seq));
 
-  if (lk.transport->_seq < state->seq_low) {
-    lk.transport->_seq = state->seq_low;
-    lk.transport->_off = state->off_head;
+  lk.transport->_off = off;
+  lk.transport->_seq = seq;
+  return A0_OK;
+}
+
+// Finds the frame before the current one, without checking whether it was discarded.
+//
+// Returns false if the current frame is the head. Fails with ESPIPE if the
+// current frame cannot be followed.
+A0_STATIC_INLINE
+a0_err_t a0_transport_prev_frame(a0_transport_locked_t lk, bool* found, size_t* off, uint64_t* seq) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+  *found = !a0_transport_state_empty(state) && lk.transport->_seq > state->seq_low;
+  if (!*found) {
     return A0_OK;
   }
 
-  lk.transport->_off = a0_transport_frame_header(lk, lk.transport->_off)->next_off;
-  lk.transport->_seq = a0_transport_frame_header(lk, lk.transport->_off)->seq;
+  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    // The current frame may have been overwritten since the snapshot.
+    size_t prev_off = a0_transport_frame_prev_off(lk, lk.transport->_off);
+    if (!a0_transport_frame_hdr_in_bounds(lk, prev_off) ||
+        a0_transport_frame_seq(lk, prev_off) != lk.transport->_seq - 1) {
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+    *off = prev_off;
+    *seq = lk.transport->_seq - 1;
+    return A0_OK;
+  }
 
+  if (!a0_transport_frame_hdr_mapped(lk, lk.transport->_off)) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
+  *off = a0_transport_frame_prev_off(lk, lk.transport->_off);
+  if (!a0_transport_frame_hdr_mapped(lk, *off)) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
+  *seq = a0_transport_frame_seq(lk, *off);
   return A0_OK;
 }
 
 a0_err_t a0_transport_has_prev(a0_transport_locked_t lk, bool* out) {
-  bool empty;
-  A0_RETURN_ERR_ON_ERR(a0_transport_empty(lk, &empty));
-
   a0_transport_state_t* state = a0_transport_working_page(lk);
-  *out = !empty && (lk.transport->_seq > state->seq_low);
+  *out = !a0_transport_state_empty(state) && lk.transport->_seq > state->seq_low;
+  if (!*out || !a0_transport_header(lk)->producer_slots) {
+    return A0_OK;
+  }
+
+  // The frames before the current one may all have been discarded.
+  bool found;
+  size_t off = 0;
+  uint64_t seq = 0;
+  a0_err_t err = a0_transport_prev_frame(lk, &found, &off, &seq);
+  if (!err) {
+    err = a0_transport_find_kept(lk, state, false, &off, &seq);
+  }
+  *out = err != A0_ERR_RANGE;
   return A0_OK;
 }
 
 a0_err_t a0_transport_step_prev(a0_transport_locked_t lk) {
-  bool has_prev;
-  A0_RETURN_ERR_ON_ERR(a0_transport_has_prev(lk, &has_prev));
-  if (!has_prev) {
+  bool found;
+  size_t off;
+  uint64_t seq;
+  A0_RETURN_ERR_ON_ERR(a0_transport_prev_frame(lk, &found, &off, &seq));
+  if (!found) {
     return A0_ERR_RANGE;
   }
+  A0_RETURN_ERR_ON_ERR(a0_transport_find_kept(lk, a0_transport_working_page(lk), false, &off, &seq));
 
-  lk.transport->_off = a0_transport_frame_header(lk, lk.transport->_off)->prev_off;
-  lk.transport->_seq = a0_transport_frame_header(lk, lk.transport->_off)->seq;
-
+  lk.transport->_off = off;
+  lk.transport->_seq = seq;
   return A0_OK;
 }
 
+A0_STATIC_INLINE
+a0_err_t a0_transport_empty_pred_fn(void* user_data, bool* out) {
+  return a0_transport_empty(*(a0_transport_locked_t*)user_data, out);
+}
+
+a0_predicate_t a0_transport_empty_pred(a0_transport_locked_t* lk) {
+  return (a0_predicate_t){
+      .user_data = lk,
+      .fn = a0_transport_empty_pred_fn,
+  };
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_transport_nonempty_pred_fn(void* user_data, bool* out) {
+  return a0_transport_nonempty(*(a0_transport_locked_t*)user_data, out);
+}
+
+a0_predicate_t a0_transport_nonempty_pred(a0_transport_locked_t* lk) {
+  return (a0_predicate_t){
+      .user_data = lk,
+      .fn = a0_transport_nonempty_pred_fn,
+  };
+}
+
+A0_STATIC_INLINE
+a0_err_t a0_transport_has_next_pred_fn(void* user_data, bool* out) {
+  return a0_transport_has_next(*(a0_transport_locked_t*)user_data, out);
+}
+
+a0_predicate_t a0_transport_has_next_pred(a0_transport_locked_t* lk) {
+  return (a0_predicate_t){
+      .user_data = lk,
+      .fn = a0_transport_has_next_pred_fn,
+  };
+}
+
+// Selects the futex bits to wait on, based on the predicate.
+//
+// The builtin nonempty and has_next predicates can only become satisfied by
+// the commit of a specific sequence number. Any other predicate may be
+// satisfied by any change to the transport.
+A0_STATIC_INLINE
+uint32_t a0_transport_wait_bits(a0_transport_locked_t lk, a0_predicate_t pred) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+
+  if (pred.fn == a0_transport_nonempty_pred_fn) {
+    return a0_transport_wake_seq_bit(state->seq_high + 1);
+  }
+
+  if (pred.fn == a0_transport_has_next_pred_fn &&
+      ((a0_transport_locked_t*)pred.user_data)->transport == lk.transport) {
+    uint64_t seq = lk.transport->_seq;
+    if (seq < state->seq_high) {
+      // Not satisfied due to the transport having been cleared, or to the
+      // frames after the current one having been discarded.
+      seq = state->seq_high;
+    }
+    return a0_transport_wake_seq_bit(seq + 1);
+  }
+
+  return A0_TRANSPORT_WAKE_ANY;
+}
+
 A0_STATIC_INLINE
 bool a0_transport_timedwait_istimeout(a0_time_mono_t* timeout) {
   if (!timeout) {
@@ -342,8 +1888,8 @@ bool a0_transport_timedwait_istimeout(a0_time_mono_t* timeout) {
   a0_time_mono_t now;
   a0_time_mono_now(&now);
 
-  uint64_t now_ns = now.ts.tv_sec * NS_PER_SEC + now.ts.tv_nsec;
-  uint64_t timeout_ns = timeout->ts.tv_sec * NS_PER_SEC + timeout->ts.tv_nsec;
+  uint64_t now_ns = a0_transport_time_ns(now);
+  uint64_t timeout_ns = a0_transport_time_ns(*timeout);
 
   return now_ns >= timeout_ns;
 }
@@ -352,10 +1898,9 @@ a0_err_t a0_transport_timedwait(a0_transport_locked_t lk, a0_predicate_t pred, a
   if (lk.transport->_shutdown) {
     return A0_MAKE_SYSERR(ESHUTDOWN);
   }
-  if (lk.transport->_arena.mode != A0_ARENA_MODE_SHARED) {
+  if (lk.transport->_arena.mode != A0_ARENA_MODE_SHARED || lk.transport->_reader_slot) {
     return A0_MAKE_SYSERR(EPERM);
   }
-  a0_transport_hdr_t* hdr = a0_transport_header(lk);
 
   bool sat = false;
   a0_err_t err = a0_transport_timedwait_istimeout(timeout) ? A0_MAKE_SYSERR(ETIMEDOUT) : a0_predicate_eval(pred, &sat);
@@ -366,7 +1911,18 @@ a0_err_t a0_transport_timedwait(a0_transport_locked_t lk, a0_predicate_t pred, a
   lk.transport->_wait_cnt++;
 
   while (!lk.transport->_shutdown) {
-    err = a0_cnd_timedwait(&hdr->cnd, &hdr->mtx, timeout);
+    if (lk.transport->_wait_spin_iters) {
+      a0_transport_spin_poll(lk);
+      if (lk.transport->_shutdown) {
+        break;
+      }
+      err = a0_transport_timedwait_istimeout(timeout) ? A0_MAKE_SYSERR(ETIMEDOUT) : a0_predicate_eval(pred, &sat);
+      if (err | sat) {
+        break;
+      }
+    }
+
+    err = a0_transport_cnd_timedwait(lk, timeout, a0_transport_wait_bits(lk, pred));
     if (A0_SYSERR(err) == ETIMEDOUT) {
       break;
     }
@@ -381,7 +1937,10 @@ a0_err_t a0_transport_timedwait(a0_transport_locked_t lk, a0_predicate_t pred, a
   }
 
   lk.transport->_wait_cnt--;
-  a0_cnd_broadcast(&hdr->cnd, &hdr->mtx);
+  if (lk.transport->_shutdown) {
+    // Let a0_transport_shutdown know this waiter is done.
+    a0_transport_notify(lk, A0_TRANSPORT_WAKE_ANY);
+  }
 
   return err;
 }
@@ -390,71 +1949,80 @@ a0_err_t a0_transport_wait(a0_transport_locked_t lk, a0_predicate_t pred) {
   return a0_transport_timedwait(lk, pred, A0_TIMEOUT_NEVER);
 }
 
-A0_STATIC_INLINE
-a0_err_t a0_transport_empty_pred_fn(void* user_data, bool* out) {
-  return a0_transport_empty(*(a0_transport_locked_t*)user_data, out);
-}
-
-a0_predicate_t a0_transport_empty_pred(a0_transport_locked_t* lk) {
-  return (a0_predicate_t){
-      .user_data = lk,
-      .fn = a0_transport_empty_pred_fn,
-  };
+a0_err_t a0_transport_seq_low(a0_transport_locked_t lk, uint64_t* out) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+  *out = state->seq_low;
+  return A0_OK;
 }
 
-A0_STATIC_INLINE
-a0_err_t a0_transport_nonempty_pred_fn(void* user_data, bool* out) {
-  return a0_transport_nonempty(*(a0_transport_locked_t*)user_data, out);
+a0_err_t a0_transport_seq_high(a0_transport_locked_t lk, uint64_t* out) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
+  *out = state->seq_high;
+  return A0_OK;
 }
 
-a0_predicate_t a0_transport_nonempty_pred(a0_transport_locked_t* lk) {
-  return (a0_predicate_t){
-      .user_data = lk,
-      .fn = a0_transport_nonempty_pred_fn,
-  };
+a0_err_t a0_transport_seq_high_allocated(a0_transport_locked_t lk, uint64_t* out) {
+  *out = a0_transport_working_page(lk)->seq_high;
+  if (a0_transport_writable(lk) && a0_transport_header(lk)->producer_slots) {
+    uint64_t committed_seq_high = a0_transport_committed_page(lk)->seq_high;
+    if (committed_seq_high > *out) {
+      *out = committed_seq_high;
+    }
+  }
+  return A0_OK;
 }
 
+// Checks that the frame at the current transport pointer can be read, and
+// loads its data size.
 A0_STATIC_INLINE
-a0_err_t a0_transport_has_next_pred_fn(void* user_data, bool* out) {
-  return a0_transport_has_next(*(a0_transport_locked_t*)user_data, out);
-}
+a0_err_t a0_transport_frame_check(a0_transport_locked_t lk, size_t* data_size) {
+  a0_transport_state_t* state = a0_transport_working_page(lk);
 
-a0_predicate_t a0_transport_has_next_pred(a0_transport_locked_t* lk) {
-  return (a0_predicate_t){
-      .user_data = lk,
-      .fn = a0_transport_has_next_pred_fn,
-  };
-}
+  if (lk.transport->_seq < state->seq_low) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
 
-a0_err_t a0_transport_seq_low(a0_transport_locked_t lk, uint64_t* out) {
-  a0_transport_state_t* state = a0_transport_working_page(lk);
-  *out = state->seq_low;
-  return A0_OK;
-}
+  size_t off = lk.transport->_off;
+  size_t hdr_size = a0_transport_frame_hdr_size(a0_transport_header(lk));
 
-a0_err_t a0_transport_seq_high(a0_transport_locked_t lk, uint64_t* out) {
-  a0_transport_state_t* state = a0_transport_working_page(lk);
-  *out = state->seq_high;
+  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+    // The frame may have been overwritten since the snapshot.
+    if (!a0_transport_frame_hdr_in_bounds(lk, off) ||
+        a0_transport_frame_seq(lk, off) != lk.transport->_seq) {
+      return A0_MAKE_SYSERR(ESPIPE);
+    }
+  } else if (!a0_transport_frame_hdr_mapped(lk, off)) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
+
+  *data_size = a0_transport_frame_data_size(lk, off);
+  if (*data_size > lk.transport->_arena.buf.size - off - hdr_size) {
+    return A0_MAKE_SYSERR(ESPIPE);
+  }
   return A0_OK;
 }
 
 a0_err_t a0_transport_frame(a0_transport_locked_t lk, a0_transport_frame_t** frame_out) {
-  a0_transport_state_t* state = a0_transport_working_page(lk);
-
-  if (lk.transport->_seq < state->seq_low) {
-    return A0_MAKE_SYSERR(ESPIPE);
+  if (a0_transport_header(lk)->frame_compact) {
+    return A0_MAKE_SYSERR(ENOTSUP);
   }
+  size_t data_size;
+  A0_RETURN_ERR_ON_ERR(a0_transport_frame_check(lk, &data_size));
+  *frame_out = (a0_transport_frame_t*)a0_transport_frame_header(lk, lk.transport->_off);
+  return A0_OK;
+}
 
-  a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, lk.transport->_off);
-
-  *frame_out = (a0_transport_frame_t*)frame_hdr;
+a0_err_t a0_transport_frame_data(a0_transport_locked_t lk, a0_buf_t* out) {
+  size_t data_size;
+  A0_RETURN_ERR_ON_ERR(a0_transport_frame_check(lk, &data_size));
+  *out = (a0_buf_t){a0_transport_frame_data_ptr(lk, lk.transport->_off), data_size};
   return A0_OK;
 }
 
 A0_STATIC_INLINE
 size_t a0_transport_frame_end(a0_transport_locked_t lk, size_t frame_off) {
-  a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, frame_off);
-  return frame_off + sizeof(a0_transport_frame_hdr_t) + frame_hdr->data_size;
+  return frame_off + a0_transport_frame_hdr_size(a0_transport_header(lk)) +
+         a0_transport_frame_data_size(lk, frame_off);
 }
 
 A0_STATIC_INLINE
@@ -472,15 +2040,12 @@ bool a0_transport_head_interval(a0_transport_locked_t lk,
                                 a0_transport_state_t* state,
                                 size_t* head_off,
                                 size_t* head_size) {
-  bool empty;
-  a0_transport_empty(lk, &empty);
-  if (empty) {
+  if (a0_transport_state_empty(state)) {
     return false;
   }
 
   *head_off = state->off_head;
-  a0_transport_frame_hdr_t* head_hdr = a0_transport_frame_header(lk, *head_off);
-  *head_size = sizeof(a0_transport_frame_hdr_t) + head_hdr->data_size;
+  *head_size = a0_transport_frame_end(lk, *head_off) - *head_off;
   return true;
 }
 
@@ -489,21 +2054,19 @@ void a0_transport_remove_head(a0_transport_locked_t lk, a0_transport_state_t* st
   if (state->off_head == state->off_tail) {
     state->off_head = 0;
     state->off_tail = 0;
-    state->high_water_mark = a0_transport_workspace_off();
+    state->high_water_mark = a0_transport_workspace_off(a0_transport_header(lk));
   } else {
-    a0_transport_frame_hdr_t* head_hdr = a0_transport_frame_header(lk, state->off_head);
-    state->off_head = head_hdr->next_off;
+    size_t head_off = state->off_head;
+    state->off_head = a0_transport_frame_next_off(lk, head_off);
 
     // Check whether the old head frame was responsible for the high water mark.
-    size_t head_end = a0_transport_frame_end(lk, head_hdr->off);
+    size_t head_end = a0_transport_frame_end(lk, head_off);
     if (state->high_water_mark == head_end) {
       // The high water mark is always set by a tail element.
       state->high_water_mark = a0_transport_frame_end(lk, state->off_tail);
     }
   }
   state->seq_low++;
-
-  a0_transport_commit(lk);
 }
 
 A0_STATIC_INLINE
@@ -511,86 +2074,290 @@ a0_err_t a0_transport_find_slot(a0_transport_locked_t lk, size_t frame_size, siz
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
   a0_transport_state_t* state = a0_transport_working_page(lk);
 
-  bool empty;
-  A0_RETURN_ERR_ON_ERR(a0_transport_empty(lk, &empty));
+  // Frames committed past this mapping can be neither linked nor evicted.
+  if (state->high_water_mark > lk.transport->_arena.buf.size) {
+    return A0_ERR_RANGE;
+  }
 
-  if (empty) {
-    *off = a0_transport_workspace_off();
+  size_t arena_size = a0_transport_arena_size(lk);
+  if (a0_transport_state_empty(state)) {
+    *off = a0_transport_workspace_off(hdr);
   } else {
-    *off = a0_max_align(a0_transport_frame_end(lk, state->off_tail));
-    if (*off + frame_size >= hdr->arena_size) {
-      *off = a0_transport_workspace_off();
+    *off = a0_transport_frame_align(hdr, a0_transport_frame_end(lk, state->off_tail));
+    if (*off + frame_size >= arena_size) {
+      *off = a0_transport_workspace_off(hdr);
     }
   }
 
-  if (*off + frame_size > hdr->arena_size) {
+  if (*off + frame_size > arena_size) {
     return A0_ERR_FRAME_LARGE;
   }
 
   return A0_OK;
 }
 
+// Waits for every shared reader that pinned a frame older than seq_low to
+// release its slot.
+//
+// New shared readers cannot pin frames while the transport lock is held, so
+// once this returns, frames older than seq_low may be overwritten.
+//
+// Note: A shared reader that writes to the transport it is reading cannot be
+//       waited on. The caller is responsible for not evicting its own frame.
+A0_STATIC_INLINE
+void a0_transport_wait_readers(a0_transport_locked_t lk, uint64_t seq_low) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_transport_reader_slot_t* slots = a0_transport_reader_slots(hdr);
+  for (uint8_t i = 0; i < hdr->reader_slots; i++) {
+    a0_transport_reader_slot_t* slot = &slots[i];
+    if (!a0_atomic_load(&slot->mtx.ftx) ||
+        slot->state.seq_low >= seq_low ||
+        slot->state.seq_low > slot->state.seq_high) {
+      continue;
+    }
+
+    // Blocks until the reader unlocks, boosting its priority in the meantime.
+    // If the reader died, the lock succeeds with EOWNERDEAD.
+    // If the slot is held by this thread, the lock fails with EDEADLK.
+    if (a0_mtx_lock_successful(a0_mtx_lock(&slot->mtx))) {
+      a0_mtx_unlock(&slot->mtx);
+    }
+  }
+}
+
 A0_STATIC_INLINE
 void a0_transport_evict(a0_transport_locked_t lk, size_t off, size_t frame_size) {
   size_t head_off;
   size_t head_size;
+  bool evicted = false;
   a0_transport_state_t* state = a0_transport_working_page(lk);
   while (a0_transport_head_interval(lk, state, &head_off, &head_size) &&
          a0_transport_frame_intersects(off, frame_size, head_off, head_size)) {
     a0_transport_remove_head(lk, state);
+    evicted = true;
+  }
+
+  // All evictions are published as a single state transition.
+  // The commit MUST happen before the new frame overwrites the evicted
+  // frames, otherwise a crash could leave the committed state pointing
+  // at a partially overwritten frame.
+  if (evicted) {
+    a0_transport_wait_readers(lk, state->seq_low);
+    a0_transport_commit(lk);
   }
 }
 
 A0_STATIC_INLINE
-void a0_transport_slot_init(a0_transport_state_t* state,
-                            a0_transport_frame_hdr_t* frame_hdr,
+void a0_transport_slot_init(a0_transport_locked_t lk,
+                            a0_transport_state_t* state,
                             size_t off,
                             size_t size) {
-  memset(frame_hdr, 0, sizeof(a0_transport_frame_hdr_t));
-
-  frame_hdr->seq = ++state->seq_high;
+  a0_transport_frame_init(lk, off, ++state->seq_high, size);
   if (!state->seq_low) {
-    state->seq_low = frame_hdr->seq;
+    state->seq_low = state->seq_high;
   }
-
-  frame_hdr->off = off;
-  frame_hdr->next_off = 0;
-
-  frame_hdr->data_size = size;
 }
 
 A0_STATIC_INLINE
-void a0_transport_maybe_set_head(a0_transport_state_t* state, a0_transport_frame_hdr_t* frame_hdr) {
+void a0_transport_maybe_set_head(a0_transport_state_t* state, size_t off) {
   if (!state->off_head) {
-    state->off_head = frame_hdr->off;
+    state->off_head = off;
   }
 }
 
 A0_STATIC_INLINE
 void a0_transport_update_tail(a0_transport_locked_t lk,
                               a0_transport_state_t* state,
-                              a0_transport_frame_hdr_t* frame_hdr) {
+                              size_t off) {
   if (state->off_tail) {
-    a0_transport_frame_hdr_t* tail_frame_hdr = a0_transport_frame_header(lk, state->off_tail);
-    tail_frame_hdr->next_off = frame_hdr->off;
-    frame_hdr->prev_off = state->off_tail;
+    a0_transport_frame_link(lk, state->off_tail, off);
   }
-  state->off_tail = frame_hdr->off;
+  state->off_tail = off;
 }
 
 A0_STATIC_INLINE
 void a0_transport_update_high_water_mark(a0_transport_locked_t lk,
                                          a0_transport_state_t* state,
-                                         a0_transport_frame_hdr_t* frame_hdr) {
-  size_t high_water_mark = a0_transport_frame_end(lk, frame_hdr->off);
+                                         size_t off) {
+  size_t high_water_mark = a0_transport_frame_end(lk, off);
   if (state->high_water_mark < high_water_mark) {
     state->high_water_mark = high_water_mark;
   }
 }
 
+A0_STATIC_INLINE
+a0_transport_producer_slot_t* a0_transport_producer_slot_find(a0_transport_hdr_t* hdr, uint64_t seq) {
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
+  for (uint8_t i = 0; i < hdr->producer_slots; i++) {
+    if (producers->slots[i].seq == seq) {
+      return &producers->slots[i];
+    }
+  }
+  return NULL;
+}
+
+// Publishes the committed frames that are filled, in order, stopping at the
+// first frame still being filled.
+//
+// A frame whose producer died before publishing is published as discarded.
+static void a0_transport_publish_ready(a0_transport_locked_t lk) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
+  if (!producers) {
+    return;
+  }
+
+  a0_transport_state_t* committed = a0_transport_committed_page(lk);
+  if (committed->high_water_mark > lk.transport->_arena.buf.size) {
+    // Left to the producers whose mapping reaches the frames.
+    return;
+  }
+  a0_transport_published_t old = producers->published[producers->published_idx & 1];
+  a0_transport_published_t next = old;
+  while (next.seq < committed->seq_high) {
+    // Frames evicted before being committed were never visible.
+    if (next.seq + 1 < committed->seq_low) {
+      next.seq = committed->seq_low - 1;
+    }
+    uint64_t seq = next.seq + 1;
+    size_t off = seq == committed->seq_low ? committed->off_head
+                                           : a0_transport_frame_next_off(lk, next.off);
+
+    a0_transport_producer_slot_t* slot = a0_transport_producer_slot_find(hdr, seq);
+    if (slot) {
+      if (!slot->done) {
+        if (!a0_mtx_lock_successful(a0_mtx_trylock(&slot->mtx))) {
+          break;
+        }
+        a0_transport_frame_mark_discarded(lk, off);
+        a0_mtx_unlock(&slot->mtx);
+      }
+      slot->seq = 0;
+      slot->done = false;
+    }
+
+    next.seq = seq;
+    next.off = off;
+  }
+
+  if (next.seq == old.seq) {
+    return;
+  }
+
+  // Same double buffering as commit.
+  producers->published[!(producers->published_idx & 1)] = next;
+  a0_barrier();
+  a0_atomic_store(&producers->published_idx, !(producers->published_idx & 1));
+  a0_barrier();
+  a0_atomic_add_fetch(&hdr->commit_cnt, 1);
+
+  // Waiters are woken on unlock.
+  lk.transport->_wake_bits |= a0_transport_wake_commit_bits(old.seq, next.seq);
+}
+
+// Bound on each wait for other producers or subscribers, so that the slots
+// of processes that died are reclaimed, even if nothing else wakes the waiter.
+#define A0_TRANSPORT_SLOT_POLL_NS (10 * 1000 * 1000)
+
+A0_STATIC_INLINE
+bool a0_transport_slot_owned(a0_mtx_t* mtx) {
+  return a0_ftx_tid(a0_atomic_load(&mtx->ftx)) == a0_tid();
+}
+
+// Waits, briefly, for other producers or subscribers to make progress.
+//
+// Fails with EDEADLK if waiting would discard frames allocated under the
+// current lock.
+A0_STATIC_INLINE
+a0_err_t a0_transport_wait_slots(a0_transport_locked_t lk, a0_time_mono_t* deadline) {
+  if (a0_transport_working_page(lk)->seq_high > a0_transport_committed_page(lk)->seq_high) {
+    return A0_MAKE_SYSERR(EDEADLK);
+  }
+
+  a0_time_mono_t timeout;
+  a0_time_mono_now(&timeout);
+  a0_time_mono_add(timeout, A0_TRANSPORT_SLOT_POLL_NS, &timeout);
+  if (deadline && a0_transport_time_ns(*deadline) < a0_transport_time_ns(timeout)) {
+    timeout = *deadline;
+  }
+  a0_err_t err = a0_transport_cnd_timedwait(lk, &timeout, A0_TRANSPORT_WAKE_ANY);
+  if (A0_SYSERR(err) == ETIMEDOUT) {
+    return A0_OK;
+  }
+  return err;
+}
+
+// Waits, briefly, for other producers to publish.
+//
+// Fails with EDEADLK if the frame at seq was reserved by the calling thread.
+A0_STATIC_INLINE
+a0_err_t a0_transport_wait_producers(a0_transport_locked_t lk, uint64_t seq) {
+  a0_transport_producer_slot_t* slot = a0_transport_producer_slot_find(a0_transport_header(lk), seq);
+  if (slot && a0_transport_slot_owned(&slot->mtx)) {
+    return A0_MAKE_SYSERR(EDEADLK);
+  }
+  return a0_transport_wait_slots(lk, A0_TIMEOUT_NEVER);
+}
+
+// The oldest sequence number that would remain after allocating at off.
+A0_STATIC_INLINE
+uint64_t a0_transport_seq_low_after_alloc(a0_transport_locked_t lk, size_t off, size_t frame_size) {
+  a0_transport_state_t state = *a0_transport_working_page(lk);
+  while (state.seq_high && state.seq_low <= state.seq_high) {
+    if (!a0_transport_frame_intersects(off, frame_size, state.off_head,
+                                       a0_transport_frame_end(lk, state.off_head) - state.off_head)) {
+      break;
+    }
+    a0_transport_remove_head(lk, &state);
+  }
+  return state.seq_low;
+}
+
+// Whether evicting the frames older than seq_low would evict a committed frame
+// that is not yet published.
+A0_STATIC_INLINE
+bool a0_transport_evicts_unpublished(a0_transport_locked_t lk, uint64_t seq_low) {
+  a0_transport_producers_t* producers = a0_transport_producers(a0_transport_header(lk));
+  if (!producers || seq_low <= a0_transport_working_page(lk)->seq_low) {
+    return false;
+  }
+  uint64_t evicted_seq_high = seq_low - 1;
+  uint64_t committed_seq_high = a0_transport_committed_page(lk)->seq_high;
+  if (evicted_seq_high > committed_seq_high) {
+    evicted_seq_high = committed_seq_high;
+  }
+  return evicted_seq_high > producers->published[producers->published_idx & 1].seq;
+}
+
+// Finds a live subscriber that has not consumed every frame older than
+// seq_low. Releases the cursors of subscribers that died.
+A0_STATIC_INLINE
+a0_transport_cursor_slot_t* a0_transport_blocking_cursor(a0_transport_locked_t lk, uint64_t seq_low) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (seq_low <= a0_transport_working_page(lk)->seq_low) {
+    return NULL;
+  }
+
+  a0_transport_cursor_slot_t* slots = a0_transport_cursor_slots(hdr);
+  for (uint8_t i = 0; i < hdr->cursor_slots; i++) {
+    a0_transport_cursor_slot_t* slot = &slots[i];
+    if (!a0_atomic_load(&slot->mtx.ftx) || slot->seq >= seq_low) {
+      continue;
+    }
+    // If the subscriber died, the lock succeeds with EOWNERDEAD.
+    if (a0_mtx_lock_successful(a0_mtx_trylock(&slot->mtx))) {
+      a0_mtx_unlock(&slot->mtx);
+      continue;
+    }
+    return slot;
+  }
+  return NULL;
+}
+
 a0_err_t a0_transport_alloc_evicts(a0_transport_locked_t lk, size_t size, bool* out) {
-  size_t frame_size = sizeof(a0_transport_frame_hdr_t) + size;
+  size_t frame_size = a0_transport_frame_hdr_size(a0_transport_header(lk)) + size;
 
+  a0_transport_unclamp_working(lk);
   size_t off;
   A0_RETURN_ERR_ON_ERR(a0_transport_find_slot(lk, frame_size, &off));
 
@@ -603,38 +2370,102 @@ a0_err_t a0_transport_alloc_evicts(a0_transport_locked_t lk, size_t size, bool*
   return A0_OK;
 }
 
-a0_err_t a0_transport_alloc(a0_transport_locked_t lk, size_t size, a0_transport_frame_t** frame_out) {
-  if (lk.transport->_arena.mode == A0_ARENA_MODE_READONLY) {
+// Allocates a frame, in either encoding, and returns its offset.
+A0_STATIC_INLINE
+a0_err_t a0_transport_alloc_off(a0_transport_locked_t lk,
+                                size_t size,
+                                a0_time_mono_t* timeout,
+                                size_t* off_out) {
+  if (!a0_transport_writable(lk)) {
     return A0_MAKE_SYSERR(EPERM);
   }
-  size_t frame_size = sizeof(a0_transport_frame_hdr_t) + size;
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  size_t frame_size = a0_transport_frame_hdr_size(hdr) + size;
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
 
   size_t off;
-  A0_RETURN_ERR_ON_ERR(a0_transport_find_slot(lk, frame_size, &off));
+  while (true) {
+    a0_transport_unclamp_working(lk);
+    A0_RETURN_ERR_ON_ERR(a0_transport_find_slot(lk, frame_size, &off));
+    if (!hdr->producer_slots && !hdr->cursor_slots) {
+      break;
+    }
+    uint64_t seq_low = a0_transport_seq_low_after_alloc(lk, off, frame_size);
+
+    // Frames being filled by other producers cannot be evicted.
+    if (a0_transport_evicts_unpublished(lk, seq_low)) {
+      a0_transport_publish_ready(lk);
+      if (a0_transport_evicts_unpublished(lk, seq_low)) {
+        A0_RETURN_ERR_ON_ERR(a0_transport_wait_producers(
+            lk, producers->published[producers->published_idx & 1].seq + 1));
+        continue;
+      }
+    }
+
+    // Frames not yet consumed by a subscriber cannot be evicted.
+    a0_transport_cursor_slot_t* cursor = a0_transport_blocking_cursor(lk, seq_low);
+    if (!cursor) {
+      break;
+    }
+    if (a0_transport_slot_owned(&cursor->mtx)) {
+      return A0_MAKE_SYSERR(EDEADLK);
+    }
+    if (a0_transport_timedwait_istimeout(timeout)) {
+      return A0_ERR_AGAIN;
+    }
+    a0_err_t err = a0_transport_wait_slots(lk, timeout);
+    if (A0_SYSERR(err) == EDEADLK) {
+      return A0_ERR_AGAIN;
+    }
+    A0_RETURN_ERR_ON_ERR(err);
+  }
 
   a0_transport_evict(lk, off, frame_size);
+  a0_transport_unclamp_working(lk);
 
   // Note: a0_transport_evict commits changes, which invalidates state.
   //       Must grab state afterwards.
   a0_transport_state_t* state = a0_transport_working_page(lk);
 
-  a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, off);
-  a0_transport_slot_init(state, frame_hdr, off, size);
+  a0_transport_slot_init(lk, state, off, size);
 
-  a0_transport_maybe_set_head(state, frame_hdr);
-  a0_transport_update_tail(lk, state, frame_hdr);
-  a0_transport_update_high_water_mark(lk, state, frame_hdr);
+  a0_transport_maybe_set_head(state, off);
+  a0_transport_update_tail(lk, state, off);
+  a0_transport_update_high_water_mark(lk, state, off);
 
-  *frame_out = (a0_transport_frame_t*)frame_hdr;
+  size_t index_size = a0_transport_seq_index_size(hdr);
+  if (index_size) {
+    a0_atomic_store(&a0_transport_seq_index(hdr)[state->seq_high & (index_size - 1)].off, off);
+  }
+
+  *off_out = off;
+
+  return A0_OK;
+}
 
+a0_err_t a0_transport_alloc_timeout(a0_transport_locked_t lk,
+                                    size_t size,
+                                    a0_time_mono_t* timeout,
+                                    a0_transport_frame_t** frame_out) {
+  if (a0_transport_header(lk)->frame_compact) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+  size_t off;
+  A0_RETURN_ERR_ON_ERR(a0_transport_alloc_off(lk, size, timeout, &off));
+  *frame_out = (a0_transport_frame_t*)a0_transport_frame_header(lk, off);
   return A0_OK;
 }
 
+a0_err_t a0_transport_alloc(a0_transport_locked_t lk, size_t size, a0_transport_frame_t** frame_out) {
+  return a0_transport_alloc_timeout(lk, size, A0_TIMEOUT_IMMEDIATE, frame_out);
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_transport_allocator_impl(void* user_data, size_t size, a0_buf_t* buf_out) {
-  a0_transport_frame_t* frame;
-  A0_RETURN_ERR_ON_ERR(a0_transport_alloc(*(a0_transport_locked_t*)user_data, size, &frame));
-  *buf_out = (a0_buf_t){frame->data, frame->hdr.data_size};
+  a0_transport_locked_t lk = *(a0_transport_locked_t*)user_data;
+  size_t off;
+  A0_RETURN_ERR_ON_ERR(a0_transport_alloc_off(lk, size, A0_TIMEOUT_IMMEDIATE, &off));
+  *buf_out = (a0_buf_t){a0_transport_frame_data_ptr(lk, off), size};
   return A0_OK;
 }
 
@@ -645,18 +2476,81 @@ a0_err_t a0_transport_allocator(a0_transport_locked_t* lk, a0_alloc_t* alloc_out
   return A0_OK;
 }
 
+// Records the commit time of the newly committed frames in the sequence index.
+A0_STATIC_INLINE
+void a0_transport_stamp_commit_time(a0_transport_locked_t lk) {
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  size_t index_size = a0_transport_seq_index_size(hdr);
+  uint64_t seq = a0_transport_committed_page(lk)->seq_high + 1;
+  uint64_t seq_high = a0_transport_working_page(lk)->seq_high;
+  if (!index_size || seq > seq_high) {
+    return;
+  }
+
+  if (seq_high - seq >= index_size) {
+    seq = seq_high - index_size + 1;
+  }
+
+  a0_time_mono_t now;
+  a0_time_mono_now(&now);
+  uint64_t now_ns = a0_transport_time_ns(now);
+
+  a0_transport_seq_index_entry_t* index = a0_transport_seq_index(hdr);
+  for (; seq <= seq_high; seq++) {
+    a0_atomic_store(&index[seq & (index_size - 1)].commit_time_ns, now_ns);
+  }
+}
+
 a0_err_t a0_transport_commit(a0_transport_locked_t lk) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+
+  lk.transport->_commit_pending = false;
+
+  // A working page limited to the published frames must not drop the reserved
+  // frames from the committed state.
+  a0_transport_unclamp_working(lk);
+
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  uint32_t wake_bits = a0_transport_wake_commit_bits(
+      a0_transport_committed_page(lk)->seq_high,
+      a0_transport_working_page(lk)->seq_high);
+
+  a0_transport_stamp_commit_time(lk);
+
   // Assume page A was the previously committed page and page B is the working
   // page that is ready to be committed. Both represent a valid state for the
   // transport. It's possible that the copying of B into A will fail (prog crash),
   // leaving A in an inconsistent state. We set B as the committed page, before
   // copying the page info.
   hdr->committed_page_idx = !hdr->committed_page_idx;
+  a0_barrier();
+  a0_atomic_add_fetch(&hdr->commit_cnt, 1);
+  a0_barrier();
   *a0_transport_working_page(lk) = *a0_transport_committed_page(lk);
 
-  a0_cnd_broadcast(&hdr->cnd, &hdr->mtx);
+  // With multiple producers, readers are woken as frames are published.
+  if (hdr->producer_slots) {
+    a0_transport_publish_ready(lk);
+    a0_transport_clamp_working(lk);
+    return A0_OK;
+  }
+
+  // Waiters are woken on unlock.
+  lk.transport->_wake_bits |= wake_bits;
+
+  return A0_OK;
+}
 
+a0_err_t a0_transport_commit_deferred(a0_transport_locked_t lk) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  if (a0_transport_header(lk)->producer_slots) {
+    return a0_transport_commit(lk);
+  }
+  lk.transport->_commit_pending = true;
   return A0_OK;
 }
 
@@ -667,26 +2561,268 @@ a0_err_t a0_transport_used_space(a0_transport_locked_t lk, size_t* out) {
 }
 
 a0_err_t a0_transport_resize(a0_transport_locked_t lk, size_t arena_size) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+
   size_t used_space;
   A0_RETURN_ERR_ON_ERR(a0_transport_used_space(lk, &used_space));
-  if (arena_size < used_space) {
+  if (arena_size < used_space || arena_size > lk.transport->_arena.buf.size) {
     return A0_ERR_INVALID_ARG;
   }
-
   a0_transport_hdr_t* hdr = a0_transport_header(lk);
-  hdr->arena_size = arena_size;
+  if (hdr->frame_compact && arena_size > A0_TRANSPORT_COMPACT_MAX_ARENA_SIZE) {
+    return A0_ERR_INVALID_ARG;
+  }
+
+  a0_atomic_store(&hdr->arena_size, arena_size);
   return A0_OK;
 }
 
 a0_err_t a0_transport_clear(a0_transport_locked_t lk) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+
+  // Frames being filled by other producers cannot be cleared.
+  a0_transport_producers_t* producers = a0_transport_producers(a0_transport_header(lk));
+  while (producers) {
+    a0_transport_publish_ready(lk);
+    uint64_t published_seq = producers->published[producers->published_idx & 1].seq;
+    if (published_seq >= a0_transport_committed_page(lk)->seq_high) {
+      break;
+    }
+    A0_RETURN_ERR_ON_ERR(a0_transport_wait_producers(lk, published_seq + 1));
+  }
+
   a0_transport_state_t* state = a0_transport_working_page(lk);
   state->seq_low = state->seq_high + 1;
   state->off_head = 0;
   state->off_tail = 0;
-  state->high_water_mark = a0_transport_workspace_off();
+  state->high_water_mark = a0_transport_workspace_off(a0_transport_header(lk));
+  a0_transport_wait_readers(lk, state->seq_low);
   return a0_transport_commit(lk);
 }
 
+a0_err_t a0_transport_reserve(a0_transport_locked_t lk,
+                              size_t size,
+                              a0_transport_reservation_t* reservation_out) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  a0_transport_producers_t* producers = a0_transport_producers(hdr);
+  if (!producers) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+
+  // Claim a free producer slot.
+  a0_transport_producer_slot_t* slot = NULL;
+  while (true) {
+    a0_transport_publish_ready(lk);
+    for (uint8_t i = 0; !slot && i < hdr->producer_slots; i++) {
+      if (!producers->slots[i].seq && a0_mtx_lock_successful(a0_mtx_trylock(&producers->slots[i].mtx))) {
+        slot = &producers->slots[i];
+      }
+    }
+    if (slot) {
+      break;
+    }
+    A0_RETURN_ERR_ON_ERR(a0_transport_wait_producers(
+        lk, producers->published[producers->published_idx & 1].seq + 1));
+  }
+
+  size_t off;
+  a0_err_t err = a0_transport_alloc_off(lk, size, A0_TIMEOUT_IMMEDIATE, &off);
+  if (err) {
+    a0_mtx_unlock(&slot->mtx);
+    return err;
+  }
+  slot->seq = a0_transport_frame_seq(lk, off);
+  slot->done = false;
+
+  err = a0_transport_commit(lk);
+  if (err) {
+    slot->seq = 0;
+    a0_mtx_unlock(&slot->mtx);
+    return err;
+  }
+
+  reservation_out->frame = hdr->frame_compact ? NULL : (a0_transport_frame_t*)a0_transport_frame_header(lk, off);
+  reservation_out->data = (a0_buf_t){a0_transport_frame_data_ptr(lk, off), size};
+  reservation_out->_slot = slot;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_publish(a0_transport_locked_t lk, a0_transport_reservation_t* reservation) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  a0_transport_producer_slot_t* slot = reservation->_slot;
+  if (!slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (a0_ftx_tid(a0_atomic_load(&slot->mtx.ftx)) != a0_tid()) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+
+  slot->done = true;
+  a0_mtx_unlock(&slot->mtx);
+  reservation->_slot = NULL;
+
+  // The working page was clamped to the frames published before this one.
+  a0_transport_publish_ready(lk);
+  a0_transport_unclamp_working(lk);
+  a0_transport_clamp_working(lk);
+  return A0_OK;
+}
+
+a0_err_t a0_transport_discard(a0_transport_locked_t lk, a0_transport_reservation_t* reservation) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  if (!reservation->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (a0_ftx_tid(a0_atomic_load(&reservation->_slot->mtx.ftx)) != a0_tid()) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  size_t off = (size_t)(reservation->data.data - (uint8_t*)hdr) - a0_transport_frame_hdr_size(hdr);
+  a0_transport_frame_mark_discarded(lk, off);
+  return a0_transport_publish(lk, reservation);
+}
+
+a0_err_t a0_transport_cursor_register(a0_transport_locked_t lk, uint64_t seq, a0_transport_cursor_t* cursor_out) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (!hdr->cursor_slots) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+
+  // A slot whose subscriber died is locked with EOWNERDEAD, and reused.
+  a0_transport_cursor_slot_t* slots = a0_transport_cursor_slots(hdr);
+  for (uint8_t i = 0; i < hdr->cursor_slots; i++) {
+    if (a0_mtx_lock_successful(a0_mtx_trylock(&slots[i].mtx))) {
+      slots[i].seq = seq;
+      cursor_out->_slot = &slots[i];
+      return A0_OK;
+    }
+  }
+  return A0_MAKE_SYSERR(EBUSY);
+}
+
+a0_err_t a0_transport_cursor_consume(a0_transport_locked_t lk, a0_transport_cursor_t* cursor, uint64_t seq) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  if (!cursor->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (seq >= cursor->_slot->seq) {
+    cursor->_slot->seq = seq + 1;
+    // Writers waiting for space are woken on unlock.
+    lk.transport->_wake_bits |= A0_TRANSPORT_WAKE_ANY;
+  }
+  return A0_OK;
+}
+
+a0_err_t a0_transport_cursor_unregister(a0_transport_locked_t lk, a0_transport_cursor_t* cursor) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  if (!cursor->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  A0_RETURN_ERR_ON_ERR(a0_mtx_unlock(&cursor->_slot->mtx));
+  cursor->_slot = NULL;
+  lk.transport->_wake_bits |= A0_TRANSPORT_WAKE_ANY;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_watcher_register(a0_transport_locked_t lk, a0_transport_watcher_t* watcher_out) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  a0_transport_hdr_t* hdr = a0_transport_header(lk);
+  if (!hdr->watcher_slots) {
+    return A0_MAKE_SYSERR(ENOTSUP);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  A0_RETURN_SYSERR_ON_MINUS_ONE(fd);
+
+  // Ids are random. Retry the rare collision with a live watcher.
+  uint64_t id;
+  int bind_result;
+  do {
+    id = ((uint64_t)a0_mrand48() << 32) | a0_mrand48();
+    struct sockaddr_un addr;
+    socklen_t addr_len = a0_transport_watcher_addr(id, &addr);
+    bind_result = bind(fd, (struct sockaddr*)&addr, addr_len);
+  } while (bind_result == -1 && errno == EADDRINUSE);
+  if (bind_result == -1) {
+    a0_err_t err = A0_MAKE_SYSERR(errno);
+    close(fd);
+    return err;
+  }
+
+  // A slot whose watcher died is locked with EOWNERDEAD, and reused.
+  a0_transport_watcher_slot_t* slots = a0_transport_watcher_slots(hdr);
+  for (uint8_t i = 0; i < hdr->watcher_slots; i++) {
+    if (a0_mtx_lock_successful(a0_mtx_trylock(&slots[i].mtx))) {
+      slots[i].id = id;
+      slots[i].netns = a0_transport_netns();
+      slots[i].unreachable = 0;
+      a0_atomic_store(&slots[i].armed, 1);
+      watcher_out->fd = fd;
+      watcher_out->_slot = &slots[i];
+      return A0_OK;
+    }
+  }
+  close(fd);
+  return A0_MAKE_SYSERR(EBUSY);
+}
+
+a0_err_t a0_transport_watcher_arm(a0_transport_locked_t lk, a0_transport_watcher_t* watcher) {
+  A0_MAYBE_UNUSED(lk);
+  if (!watcher->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  // Clear the datagrams of signals already handled.
+  char buf[16];
+  while (recv(watcher->fd, buf, sizeof(buf), MSG_DONTWAIT) >= 0) {
+  }
+  a0_atomic_store(&watcher->_slot->armed, 1);
+  return A0_OK;
+}
+
+a0_err_t a0_transport_watcher_unregister(a0_transport_locked_t lk, a0_transport_watcher_t* watcher) {
+  if (!a0_transport_writable(lk)) {
+    return A0_MAKE_SYSERR(EPERM);
+  }
+  if (!watcher->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  a0_atomic_store(&watcher->_slot->armed, 0);
+  A0_RETURN_ERR_ON_ERR(a0_mtx_unlock(&watcher->_slot->mtx));
+  close(watcher->fd);
+  watcher->fd = -1;
+  watcher->_slot = NULL;
+  return A0_OK;
+}
+
+a0_err_t a0_transport_watcher_reachable(a0_transport_watcher_t* watcher, bool* out) {
+  if (!watcher->_slot) {
+    return A0_ERR_INVALID_ARG;
+  }
+  *out = !a0_atomic_load(&watcher->_slot->unreachable);
+  return A0_OK;
+}
+
 A0_STATIC_INLINE
 void write_limited(FILE* f, a0_buf_t str) {
   size_t line_size = str.size;
@@ -734,8 +2870,7 @@ void a0_transport_debugstr(a0_transport_locked_t lk, a0_buf_t* out) {
     size_t off = working_state->off_head;
     bool first = true;
     while (true) {
-      a0_transport_frame_hdr_t* frame_hdr = a0_transport_frame_header(lk, off);
-      uint64_t seq = frame_hdr->seq;
+      uint64_t seq = a0_transport_frame_seq(lk, off);
 
       if (!first) {
         fprintf(ss, "    },\n");
@@ -746,20 +2881,23 @@ void a0_transport_debugstr(a0_transport_locked_t lk, a0_buf_t* out) {
       if (seq > committed_state->seq_high) {
         fprintf(ss, "      \"committed\": false,\n");
       }
-      fprintf(ss, "      \"off\": %lu,\n", frame_hdr->off);
-      fprintf(ss, "      \"seq\": %lu,\n", frame_hdr->seq);
-      fprintf(ss, "      \"prev_off\": %lu,\n", frame_hdr->prev_off);
-      fprintf(ss, "      \"next_off\": %lu,\n", frame_hdr->next_off);
-      fprintf(ss, "      \"data_size\": %lu,\n", frame_hdr->data_size);
+      if (a0_transport_frame_discarded(lk, off)) {
+        fprintf(ss, "      \"discarded\": true,\n");
+      }
+      fprintf(ss, "      \"off\": %lu,\n", off);
+      fprintf(ss, "      \"seq\": %lu,\n", seq);
+      fprintf(ss, "      \"prev_off\": %lu,\n", a0_transport_frame_prev_off(lk, off));
+      fprintf(ss, "      \"next_off\": %lu,\n", a0_transport_frame_next_off(lk, off));
+      fprintf(ss, "      \"data_size\": %lu,\n", a0_transport_frame_data_size(lk, off));
       a0_buf_t data = {
-          .data = (uint8_t*)hdr + frame_hdr->off + sizeof(a0_transport_frame_hdr_t),
-          .size = frame_hdr->data_size,
+          .data = a0_transport_frame_data_ptr(lk, off),
+          .size = a0_transport_frame_data_size(lk, off),
       };
       fprintf(ss, "      \"data\": \"");
       write_limited(ss, data);
       fprintf(ss, "\"\n");
 
-      off = frame_hdr->next_off;
+      off = a0_transport_frame_next_off(lk, off);
 
       if (seq == working_state->seq_high) {
         fprintf(ss, "    }\n");
@@ -64,11 +64,39 @@ Frame* TransportLocked::frame() const {
   return ret;
 }
 
+Buf TransportLocked::frame_data() const {
+  CHECK_C;
+  auto save = c;
+  return make_cpp<Buf>(
+      [&](a0_buf_t* buf) {
+        return a0_transport_frame_data(*c, buf);
+      },
+      [save](a0_buf_t*) {});
+}
+
+TimeMono TransportLocked::frame_time() const {
+  CHECK_C;
+  return make_cpp<TimeMono>(
+      [&](a0_time_mono_t* out) {
+        return a0_transport_frame_time(*c, out);
+      });
+}
+
 void TransportLocked::jump(size_t off) {
   CHECK_C;
   check(a0_transport_jump(*c, off));
 }
 
+void TransportLocked::jump_seq(uint64_t seq) {
+  CHECK_C;
+  check(a0_transport_jump_seq(*c, seq));
+}
+
+void TransportLocked::jump_time(TimeMono time) {
+  CHECK_C;
+  check(a0_transport_jump_time(*c, *time.c));
+}
+
 void TransportLocked::jump_head() {
   CHECK_C;
   check(a0_transport_jump_head(*c));
@@ -110,6 +138,17 @@ Frame* TransportLocked::alloc(size_t size) {
   return ret;
 }
 
+Frame* TransportLocked::alloc_for(size_t size, std::chrono::nanoseconds dur) {
+  return alloc_until(size, TimeMono::now() + dur);
+}
+
+Frame* TransportLocked::alloc_until(size_t size, TimeMono timeout) {
+  CHECK_C;
+  Frame* ret;
+  check(a0_transport_alloc_timeout(*c, size, &*timeout.c, &ret));
+  return ret;
+}
+
 bool TransportLocked::alloc_evicts(size_t size) const {
   CHECK_C;
   bool ret;
@@ -127,6 +166,59 @@ void TransportLocked::clear() {
   check(a0_transport_clear(*c));
 }
 
+Reservation TransportLocked::reserve(size_t size) {
+  CHECK_C;
+  Reservation ret;
+  check(a0_transport_reserve(*c, size, &ret));
+  return ret;
+}
+
+void TransportLocked::publish(Reservation& reservation) {
+  CHECK_C;
+  check(a0_transport_publish(*c, &reservation));
+}
+
+Cursor TransportLocked::cursor_register(uint64_t seq) {
+  CHECK_C;
+  Cursor ret;
+  check(a0_transport_cursor_register(*c, seq, &ret));
+  return ret;
+}
+
+void TransportLocked::cursor_consume(Cursor& cursor, uint64_t seq) {
+  CHECK_C;
+  check(a0_transport_cursor_consume(*c, &cursor, seq));
+}
+
+void TransportLocked::cursor_unregister(Cursor& cursor) {
+  CHECK_C;
+  check(a0_transport_cursor_unregister(*c, &cursor));
+}
+
+Watcher TransportLocked::watcher_register() {
+  CHECK_C;
+  Watcher ret;
+  check(a0_transport_watcher_register(*c, &ret));
+  return ret;
+}
+
+void TransportLocked::watcher_arm(Watcher& watcher) {
+  CHECK_C;
+  check(a0_transport_watcher_arm(*c, &watcher));
+}
+
+void TransportLocked::watcher_unregister(Watcher& watcher) {
+  CHECK_C;
+  check(a0_transport_watcher_unregister(*c, &watcher));
+}
+
+bool TransportLocked::watcher_reachable(Watcher& watcher) {
+  CHECK_C;
+  bool ret;
+  check(a0_transport_watcher_reachable(&watcher, &ret));
+  return ret;
+}
+
 namespace {
 
 a0_predicate_t pred(std::function<bool()>* fn) {
@@ -162,11 +254,49 @@ void TransportLocked::wait_until(std::function<bool()> fn, TimeMono timeout) {
   check(a0_transport_timedwait(*c, pred(&fn), &*timeout.c));
 }
 
-Transport::Transport(Arena arena) {
+void TransportLocked::downgrade() {
+  CHECK_C;
+  check(a0_transport_downgrade(*c));
+}
+
+bool TransportLocked::is_shared() const {
+  CHECK_C;
+  bool ret;
+  check(a0_transport_is_shared(*c, &ret));
+  return ret;
+}
+
+Transport::Options Transport::Options::DEFAULT = {
+    .reader_slots = A0_TRANSPORT_OPTIONS_DEFAULT.reader_slots,
+    .seq_index_size = A0_TRANSPORT_OPTIONS_DEFAULT.seq_index_size,
+    .producer_slots = A0_TRANSPORT_OPTIONS_DEFAULT.producer_slots,
+    .cursor_slots = A0_TRANSPORT_OPTIONS_DEFAULT.cursor_slots,
+    .frame_align = A0_TRANSPORT_OPTIONS_DEFAULT.frame_align,
+    .watcher_slots = A0_TRANSPORT_OPTIONS_DEFAULT.watcher_slots,
+    .lock_spin_ns = A0_TRANSPORT_OPTIONS_DEFAULT.lock_spin_ns,
+    .wait_spin_ns = A0_TRANSPORT_OPTIONS_DEFAULT.wait_spin_ns,
+    .compact_frames = A0_TRANSPORT_OPTIONS_DEFAULT.compact_frames,
+};
+
+Transport::Transport(Arena arena)
+    : Transport(arena, Options::DEFAULT) {}
+
+Transport::Transport(Arena arena, Options opts) {
   set_c(
       &c,
       [&](a0_transport_t* c) {
-        return a0_transport_init(c, *arena.c);
+        a0_transport_options_t c_opts{
+            .reader_slots = opts.reader_slots,
+            .seq_index_size = opts.seq_index_size,
+            .producer_slots = opts.producer_slots,
+            .cursor_slots = opts.cursor_slots,
+            .frame_align = opts.frame_align,
+            .watcher_slots = opts.watcher_slots,
+            .lock_spin_ns = opts.lock_spin_ns,
+            .wait_spin_ns = opts.wait_spin_ns,
+            .compact_frames = opts.compact_frames,
+        };
+        return a0_transport_init_options(c, *arena.c, c_opts);
       },
       [arena](a0_transport_t*) {});
 }
@@ -183,4 +313,16 @@ TransportLocked Transport::lock() {
       });
 }
 
+TransportLocked Transport::lock_shared() {
+  CHECK_C;
+  auto save = c;
+  return make_cpp<TransportLocked>(
+      [&](a0_transport_locked_t* lk) {
+        return a0_transport_lock_shared(&*c, lk);
+      },
+      [save](a0_transport_locked_t* lk) {
+        a0_transport_unlock(*lk);
+      });
+}
+
 }  // namespace a0
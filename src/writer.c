@@ -5,11 +5,15 @@
 #include <a0/inline.h>
 #include <a0/middleware.h>
 #include <a0/packet.h>
+#include <a0/thread_local.h>
 #include <a0/transport.h>
 #include <a0/unused.h>
 #include <a0/writer.h>
 
+#include <errno.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "err_macro.h"
 
@@ -17,6 +21,71 @@
 #include "ref_cnt.h"
 #endif
 
+const a0_writer_options_t A0_WRITER_OPTIONS_DEFAULT = {
+    .packet_version = 1,
+};
+
+// The innermost middleware of a writer, which writes to the transport.
+typedef struct a0_write_action_s {
+  a0_transport_t transport;
+  a0_writer_options_t opts;
+} a0_write_action_t;
+
+// A batch being written by the current thread.
+//
+// While a batch is active, the write action holds the transport lock across
+// packets and defers their commit. The packets are committed together, and
+// waiters woken once, when the batch releases the lock.
+typedef struct a0_writer_batch_s {
+  a0_transport_t* transport;
+  a0_transport_locked_t tlk;
+  bool locked;
+  bool reached_action;
+} a0_writer_batch_t;
+
+static A0_THREAD_LOCAL a0_writer_batch_t* a0_writer_active_batch = NULL;
+
+// A reservation being made by the current thread.
+//
+// The write action serializes the packet without its payload and hands the
+// frame to the reservation, instead of committing it. The frame is either
+// still locked, or reserved in a multi-producer transport.
+typedef struct a0_writer_reserve_ctx_s {
+  a0_transport_t* transport;
+  a0_writer_reservation_t* out;
+} a0_writer_reserve_ctx_t;
+
+static A0_THREAD_LOCAL a0_writer_reserve_ctx_t* a0_writer_active_reserve = NULL;
+
+// Smallest payload that a plain write copies into a reserved frame, unlocked,
+// in a multi-producer transport. Below this, the second lock round trip to
+// publish costs more than the copy it takes out of the critical section.
+#define A0_WRITER_UNLOCKED_COPY_MIN_SIZE 4096
+
+A0_STATIC_INLINE
+a0_writer_reserve_ctx_t* a0_writer_reserve_for(a0_transport_t* transport) {
+  a0_writer_reserve_ctx_t* ctx = a0_writer_active_reserve;
+  if (!ctx) {
+    return NULL;
+  }
+  if (!ctx->transport) {
+    ctx->transport = transport;
+  }
+  return ctx->transport == transport ? ctx : NULL;
+}
+
+A0_STATIC_INLINE
+a0_writer_batch_t* a0_writer_batch_for(a0_transport_t* transport) {
+  a0_writer_batch_t* batch = a0_writer_active_batch;
+  if (!batch) {
+    return NULL;
+  }
+  if (!batch->transport) {
+    batch->transport = transport;
+  }
+  return batch->transport == transport ? batch : NULL;
+}
+
 A0_STATIC_INLINE_RECURSIVE
 a0_err_t a0_writer_write_impl(a0_middleware_chain_node_t node, a0_packet_t* pkt) {
   a0_middleware_t action = node._curr->_action;
@@ -43,7 +112,11 @@ a0_err_t a0_writer_write_impl(a0_middleware_chain_node_t node, a0_packet_t* pkt)
 }
 
 A0_STATIC_INLINE
-a0_err_t a0_write_action_init(a0_arena_t arena, void** user_data) {
+a0_err_t a0_write_action_init(a0_arena_t arena, a0_writer_options_t opts, void** user_data) {
+  if (opts.packet_version != 1 && opts.packet_version != 2) {
+    return A0_ERR_INVALID_ARG;
+  }
+
   a0_transport_t transport;
   A0_RETURN_ERR_ON_ERR(a0_transport_init(&transport, arena));
 
@@ -51,33 +124,51 @@ a0_err_t a0_write_action_init(a0_arena_t arena, void** user_data) {
   A0_ASSERT_OK(a0_ref_cnt_inc(arena.buf.data, NULL), "");
 #endif
 
-  a0_transport_t* heap_transport = (a0_transport_t*)malloc(sizeof(a0_transport_t));
-  *heap_transport = transport;
-  *user_data = heap_transport;
+  a0_write_action_t* action = (a0_write_action_t*)malloc(sizeof(a0_write_action_t));
+  action->transport = transport;
+  action->opts = opts;
+  *user_data = action;
 
   return A0_OK;
 }
 
 A0_STATIC_INLINE
 a0_err_t a0_write_action_close(void* user_data) {
-  a0_transport_t* transport = (a0_transport_t*)user_data;
+  a0_write_action_t* action = (a0_write_action_t*)user_data;
 
 #ifdef DEBUG
   A0_ASSERT_OK(
-      a0_ref_cnt_dec(transport->_arena.buf.data, NULL),
+      a0_ref_cnt_dec(action->transport._arena.buf.data, NULL),
       "Writer closing. User bug detected. Dependent arena was closed prior to writer.");
 #endif
 
-  free(transport);
+  free(action);
 
   return A0_OK;
 }
 
+A0_STATIC_INLINE
+a0_err_t a0_write_action_serialize(a0_write_action_t* action, a0_packet_t pkt, a0_alloc_t alloc, a0_flat_packet_t* out) {
+  if (action->opts.packet_version == 2) {
+    return a0_packet_serialize_v2(pkt, alloc, out);
+  }
+  return a0_packet_serialize(pkt, alloc, out);
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_write_action_process(void* user_data, a0_packet_t* pkt, a0_middleware_chain_t chain) {
-  a0_transport_t* transport = (a0_transport_t*)user_data;
+  a0_transport_t* transport = &((a0_write_action_t*)user_data)->transport;
   a0_transport_locked_t tlk;
-  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &tlk));
+  a0_writer_batch_t* batch = a0_writer_batch_for(transport);
+  if (batch && batch->locked) {
+    tlk = batch->tlk;
+  } else {
+    A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &tlk));
+    if (batch) {
+      batch->tlk = tlk;
+      batch->locked = true;
+    }
+  }
 
   a0_middleware_chain_node_t next_node = {
       ._curr = chain._node._head,
@@ -88,23 +179,151 @@ a0_err_t a0_write_action_process(void* user_data, a0_packet_t* pkt, a0_middlewar
   return a0_writer_write_impl(next_node, pkt);
 }
 
+A0_STATIC_INLINE
+a0_err_t a0_write_action_reserved_alloc(void* user_data, size_t size, a0_buf_t* out) {
+  a0_buf_t* data = (a0_buf_t*)user_data;
+  if (size > data->size) {
+    return A0_ERR_INVALID_ARG;
+  }
+  *out = (a0_buf_t){data->data, size};
+  return A0_OK;
+}
+
+// Publishes a reservation made in a multi-producer transport.
+A0_STATIC_INLINE
+a0_err_t a0_writer_reservation_publish(a0_writer_reservation_t* res) {
+  a0_transport_t* transport = res->_tlk.transport;
+  a0_transport_reservation_t tres = res->_res;
+  *res = (a0_writer_reservation_t)A0_EMPTY;
+
+  a0_transport_locked_t tlk;
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &tlk));
+  a0_err_t err = a0_transport_publish(tlk, &tres);
+  a0_transport_unlock(tlk);
+  return err;
+}
+
+// Discards a reservation made in a multi-producer transport. Readers skip the frame.
+A0_STATIC_INLINE
+a0_err_t a0_writer_reservation_discard(a0_writer_reservation_t* res) {
+  a0_transport_t* transport = res->_tlk.transport;
+  a0_transport_reservation_t tres = res->_res;
+  *res = (a0_writer_reservation_t)A0_EMPTY;
+
+  a0_transport_locked_t tlk;
+  A0_RETURN_ERR_ON_ERR(a0_transport_lock(transport, &tlk));
+  a0_err_t err = a0_transport_discard(tlk, &tres);
+  a0_transport_unlock(tlk);
+  return err;
+}
+
+// In a multi-producer transport, the packet is serialized into a reserved
+// frame after unlocking, and the caller fills the payload while other
+// producers write.
+//
+// Fails with ENOTSUP, still locked, if the transport has no producer slots.
+// Otherwise, unlocks.
+A0_STATIC_INLINE
+a0_err_t a0_write_action_reserve_unlocked(a0_write_action_t* action,
+                                          a0_transport_locked_t tlk,
+                                          a0_packet_t* pkt,
+                                          a0_writer_reservation_t* out) {
+  a0_packet_stats_t stats;
+  a0_transport_reservation_t res;
+  a0_err_t err = action->opts.packet_version == 2 ? a0_packet_stats_v2(*pkt, &stats) : a0_packet_stats(*pkt, &stats);
+  if (!err) {
+    err = a0_transport_reserve(tlk, stats.serial_size, &res);
+  }
+  if (A0_SYSERR(err) == ENOTSUP) {
+    return err;
+  }
+  a0_transport_unlock(tlk);
+  A0_RETURN_ERR_ON_ERR(err);
+
+  out->_tlk = tlk;
+  out->_res = res;
+
+  a0_alloc_t alloc = {
+      .user_data = &out->_res.data,
+      .alloc = a0_write_action_reserved_alloc,
+      .dealloc = NULL,
+  };
+  a0_flat_packet_t fpkt;
+  err = a0_write_action_serialize(action, *pkt, alloc, &fpkt);
+  if (err) {
+    // The frame is already allocated, and must still be published.
+    a0_writer_reservation_discard(out);
+    return err;
+  }
+  a0_flat_packet_payload(fpkt, &out->payload);
+  return A0_OK;
+}
+
 A0_STATIC_INLINE
 a0_err_t a0_write_action_process_locked(void* user_data, a0_transport_locked_t tlk, a0_packet_t* pkt, a0_middleware_chain_t chain) {
-  A0_MAYBE_UNUSED(user_data);
   A0_MAYBE_UNUSED(chain);
+  a0_write_action_t* action = (a0_write_action_t*)user_data;
 
   a0_alloc_t alloc;
   a0_transport_allocator(&tlk, &alloc);
-  a0_packet_serialize(*pkt, alloc, NULL);
 
-  a0_transport_commit(tlk);
+  a0_writer_reserve_ctx_t* reserve = a0_writer_reserve_for(&action->transport);
+  if (reserve) {
+    a0_err_t err = a0_write_action_reserve_unlocked(action, tlk, pkt, reserve->out);
+    if (A0_SYSERR(err) != ENOTSUP) {
+      return err;
+    }
+
+    // The payload is written by the caller, and the reservation commits.
+    a0_flat_packet_t fpkt;
+    err = a0_write_action_serialize(action, *pkt, alloc, &fpkt);
+    if (err) {
+      a0_transport_unlock(tlk);
+      return err;
+    }
+    a0_flat_packet_payload(fpkt, &reserve->out->payload);
+    reserve->out->_tlk = tlk;
+    return A0_OK;
+  }
+
+  // In a multi-producer transport, large packets are copied unlocked, so that
+  // producers copy in parallel. A batch holds the lock for all its packets.
+  a0_writer_batch_t* batch = a0_writer_batch_for(&action->transport);
+  if (!batch && pkt->payload.size >= A0_WRITER_UNLOCKED_COPY_MIN_SIZE) {
+    a0_writer_reservation_t res = A0_EMPTY;
+    a0_err_t err = a0_write_action_reserve_unlocked(action, tlk, pkt, &res);
+    if (A0_SYSERR(err) != ENOTSUP) {
+      return err ? err : a0_writer_reservation_publish(&res);
+    }
+  }
+
+  // Fails with A0_ERR_AGAIN if a subscriber has not consumed the frames to evict.
+  a0_err_t err = a0_write_action_serialize(action, *pkt, alloc, NULL);
+  if (!err) {
+    if (batch) {
+      a0_transport_commit_deferred(tlk);
+    } else {
+      a0_transport_commit(tlk);
+    }
+  }
+
+  if (batch) {
+    // The batch unlocks once all packets are written.
+    batch->reached_action = true;
+    return err;
+  }
+
   a0_transport_unlock(tlk);
 
-  return A0_OK;
+  return err;
 }
 
 a0_err_t a0_writer_init(a0_writer_t* w, a0_arena_t arena) {
-  A0_RETURN_ERR_ON_ERR(a0_write_action_init(arena, &w->_action.user_data));
+  return a0_writer_init_options(w, arena, A0_WRITER_OPTIONS_DEFAULT);
+}
+
+a0_err_t a0_writer_init_options(a0_writer_t* w, a0_arena_t arena, a0_writer_options_t opts) {
+  A0_RETURN_ERR_ON_ERR(a0_write_action_init(arena, opts, &w->_action.user_data));
   w->_action.close = a0_write_action_close;
   w->_action.process = a0_write_action_process;
   w->_action.process_locked = a0_write_action_process_locked;
@@ -156,6 +375,92 @@ a0_err_t a0_writer_write(a0_writer_t* w, a0_packet_t pkt) {
   return a0_writer_write_impl(node, &pkt);
 }
 
+a0_err_t a0_writer_write_batch(a0_writer_t* w, const a0_packet_t* pkts, size_t cnt, size_t* written) {
+  a0_writer_batch_t batch = A0_EMPTY;
+  a0_writer_batch_t* prev_batch = a0_writer_active_batch;
+  a0_writer_active_batch = &batch;
+
+  a0_err_t err = A0_OK;
+  size_t i = 0;
+  for (; i < cnt; i++) {
+    batch.reached_action = false;
+    err = a0_writer_write(w, pkts[i]);
+    if (batch.locked && !batch.reached_action) {
+      // A middleware ended the chain early and released the lock, which
+      // committed the earlier packets.
+      batch.locked = false;
+    }
+    if (err) {
+      break;
+    }
+  }
+  if (written) {
+    *written = i;
+  }
+
+  a0_writer_active_batch = prev_batch;
+  if (batch.locked) {
+    a0_transport_unlock(batch.tlk);
+  }
+
+  return err;
+}
+
+// Releases a reservation without committing it.
+A0_STATIC_INLINE
+a0_err_t a0_writer_reservation_release(a0_writer_reservation_t* res) {
+  if (res->_res._slot) {
+    return a0_writer_reservation_discard(res);
+  }
+  a0_transport_locked_t tlk = res->_tlk;
+  *res = (a0_writer_reservation_t)A0_EMPTY;
+  return a0_transport_unlock(tlk);
+}
+
+a0_err_t a0_writer_reserve(a0_writer_t* w, a0_packet_t pkt, size_t payload_size, a0_writer_reservation_t* out) {
+  *out = (a0_writer_reservation_t)A0_EMPTY;
+
+  a0_writer_reserve_ctx_t ctx = {NULL, out};
+  a0_writer_reserve_ctx_t* prev_ctx = a0_writer_active_reserve;
+  a0_writer_active_reserve = &ctx;
+
+  pkt.payload = (a0_buf_t){NULL, payload_size};
+  a0_err_t err = a0_writer_write(w, pkt);
+
+  a0_writer_active_reserve = prev_ctx;
+
+  if (err) {
+    if (out->_tlk.transport) {
+      a0_writer_reservation_release(out);
+    }
+    return err;
+  }
+  if (!out->_tlk.transport) {
+    // A middleware ended the chain early.
+    return A0_ERR_CANCELLED;
+  }
+  return A0_OK;
+}
+
+a0_err_t a0_writer_commit(a0_writer_reservation_t* res) {
+  if (!res->_tlk.transport) {
+    return A0_ERR_INVALID_ARG;
+  }
+  if (res->_res._slot) {
+    return a0_writer_reservation_publish(res);
+  }
+  a0_err_t err = a0_transport_commit(res->_tlk);
+  a0_writer_reservation_release(res);
+  return err;
+}
+
+a0_err_t a0_writer_abort(a0_writer_reservation_t* res) {
+  if (!res->_tlk.transport) {
+    return A0_ERR_INVALID_ARG;
+  }
+  return a0_writer_reservation_release(res);
+}
+
 a0_err_t a0_writer_wrap(a0_writer_t* in, a0_middleware_t middleware, a0_writer_t* out) {
   out->_action = middleware;
   out->_next = in;
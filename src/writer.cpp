@@ -1,21 +1,56 @@
 #include <a0/arena.hpp>
+#include <a0/buf.hpp>
 #include <a0/middleware.h>
 #include <a0/middleware.hpp>
 #include <a0/packet.hpp>
 #include <a0/writer.h>
 #include <a0/writer.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "c_opts.hpp"
 #include "c_wrap.hpp"
 
 namespace a0 {
 
-Writer::Writer(Arena arena) {
+Buf WriterReservation::payload() {
+  CHECK_C;
+  auto save = c;
+  return make_cpp<Buf>(
+      [&](a0_buf_t* buf) {
+        *buf = c->payload;
+        return A0_OK;
+      },
+      [save](a0_buf_t*) {});
+}
+
+void WriterReservation::commit() {
+  CHECK_C;
+  check(a0_writer_commit(&*c));
+}
+
+void WriterReservation::abort() {
+  CHECK_C;
+  check(a0_writer_abort(&*c));
+}
+
+Writer::Options Writer::Options::DEFAULT = {
+    .packet_version = A0_WRITER_OPTIONS_DEFAULT.packet_version,
+};
+
+Writer::Writer(Arena arena)
+    : Writer(arena, Options::DEFAULT) {}
+
+Writer::Writer(Arena arena, Options opts) {
   set_c(
       &c,
       [&](a0_writer_t* c) {
-        return a0_writer_init(c, *arena.c);
+        return a0_writer_init_options(c, *arena.c, c_writeropts(opts));
       },
       [arena](a0_writer_t* c) {
         a0_writer_close(c);
@@ -27,6 +62,32 @@ void Writer::write(Packet pkt) {
   check(a0_writer_write(&*c, *pkt.c));
 }
 
+void Writer::write_batch(const std::vector<Packet>& pkts, size_t* written) {
+  CHECK_C;
+  std::vector<a0_packet_t> c_pkts;
+  c_pkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    c_pkts.push_back(*pkt.c);
+  }
+  check(a0_writer_write_batch(&*c, c_pkts.data(), c_pkts.size(), written));
+}
+
+WriterReservation Writer::reserve(std::unordered_multimap<std::string, std::string> headers,
+                                  size_t payload_size) {
+  CHECK_C;
+  auto save = c;
+  Packet pkt(std::move(headers), "", ref);
+  return make_cpp<WriterReservation>(
+      [&](a0_writer_reservation_t* res) {
+        return a0_writer_reserve(&*c, *pkt.c, payload_size, res);
+      },
+      [save](a0_writer_reservation_t* res) {
+        if (res->_tlk.transport) {
+          a0_writer_abort(res);
+        }
+      });
+}
+
 void Writer::push(Middleware m) {
   CHECK_C;
   check(a0_writer_push(&*c, *m.c));